@@ -0,0 +1,393 @@
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+#include "asset_manager.hpp"
+#include "texture.hpp"
+#include "hash.hpp"
+#include "async_loader.hpp"
+
+AssetManager &AssetManager::instance()
+{
+    // Never destroyed, so handles released during static destruction are still safe
+    static AssetManager *manager = new AssetManager();
+    return *manager;
+}
+
+std::string AssetManager::canonicalPath(const char *path)
+{
+#ifdef _WIN32
+    char resolved[_MAX_PATH];
+    if (_fullpath(resolved, path, _MAX_PATH) != NULL)
+        return resolved;
+#else
+    char *resolved = realpath(path, NULL);
+    if (resolved != NULL)
+    {
+        std::string canonical(resolved);
+        free(resolved);
+        return canonical;
+    }
+#endif
+    return path;
+}
+
+ModelHandle AssetManager::loadModel(const char *path)
+{
+    std::string key = canonicalPath(path);
+
+    ModelHandle model;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, std::weak_ptr<Model> >::iterator it = models.find(key);
+        if (it != models.end())
+            model = it->second.lock();
+    }
+    if (model)
+        return model;
+
+    // Load outside the lock, the model's GL objects are released through the manager
+    model = ModelHandle(new Model(path), [this](Model *released) { releaseModel(released); });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    models[key] = model;
+    return model;
+}
+
+std::string AssetManager::textureKey(const std::string &path, const TextureParams &params)
+{
+    char suffix[128];
+    snprintf(suffix, sizeof(suffix), "?flip=%d&srgb=%d&wrap=%04x&filter=%04x&bc=%d&mip=%d&cutoff=%.3f",
+             params.flip ? 1 : 0, params.srgb ? 1 : 0, params.wrap, params.filter, params.compression,
+             params.mipFilter, params.alphaCutoff);
+    return path + suffix;
+}
+
+TextureHandle AssetManager::findTexture(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, std::weak_ptr<TextureAsset> >::iterator it = textures.find(key);
+    if (it != textures.end())
+        return it->second.lock();
+    return TextureHandle();
+}
+
+TextureHandle AssetManager::loadTexture(const char *path, const TextureParams &params)
+{
+    std::string key = textureKey(canonicalPath(path), params);
+
+    TextureHandle texture = findTexture(key);
+    if (texture)
+        return texture;
+
+    TextureSource source;
+    if (!loadTextureSource(path, params, source))
+        return TextureHandle();
+    size_t bytes;
+    unsigned int id = uploadTextureSource(source, params, 0, bytes);
+    freeTextureSource(source);
+    return share(key, id, bytes);
+}
+
+TextureHandle AssetManager::shareTexture(const std::string &key, const TextureSource &source,
+                                         const TextureParams &params)
+{
+    TextureHandle texture = findTexture(key);
+    if (texture)
+        return texture;
+
+    size_t bytes;
+    unsigned int id = uploadTextureSource(source, params, 0, bytes);
+    return share(key, id, bytes);
+}
+
+std::vector<TextureHandle> AssetManager::loadTextures(const std::vector<TextureRequest> &requests)
+{
+    // Textures already loaded are shared, the rest are loaded together
+    std::vector<TextureHandle> loaded(requests.size());
+    std::vector<std::string> keys(requests.size());
+    std::vector<TextureRequest> missing;
+    std::vector<size_t> slots;
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        keys[i] = textureKey(canonicalPath(requests[i].path.c_str()), requests[i].params);
+        loaded[i] = findTexture(keys[i]);
+        if (loaded[i])
+            continue;
+        
+        // Each file is only loaded once even if the batch asks for it twice
+        bool duplicate = false;
+        for (size_t m = 0; m < slots.size() && !duplicate; m++)
+            duplicate = keys[slots[m]] == keys[i];
+        if (duplicate)
+            continue;
+        missing.push_back(requests[i]);
+        slots.push_back(i);
+    }
+    
+    std::vector<std::unique_ptr<TextureSource> > sources;
+    loadTextureSources(missing, sources);
+    for (size_t m = 0; m < slots.size(); m++)
+    {
+        if (!sources[m])
+            continue;
+        size_t bytes;
+        unsigned int id = uploadTextureSource(*sources[m], missing[m].params, 0, bytes);
+        freeTextureSource(*sources[m]);
+        loaded[slots[m]] = share(keys[slots[m]], id, bytes);
+    }
+    
+    // Later copies of a file in the batch share the first
+    for (size_t i = 0; i < requests.size(); i++)
+        if (!loaded[i])
+            loaded[i] = findTexture(keys[i]);
+    return loaded;
+}
+
+ModelHandle AssetManager::loadModelAsync(const char *path)
+{
+    std::string key = canonicalPath(path);
+    std::string file(path);
+
+    ModelHandle model;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, std::weak_ptr<Model> >::iterator it = models.find(key);
+        if (it != models.end())
+            model = it->second.lock();
+        if (model)
+            return model;
+
+        // Registered now so later requests share the model while it loads
+        model = ModelHandle(new Model(), [this](Model *released) { releaseModel(released); });
+        models[key] = model;
+    }
+
+    // The worker keeps the model alive while filling it in, the upload is
+    // skipped if every handle was dropped in the meantime
+    std::weak_ptr<Model> pending(model);
+    asyncLoader().submit([model, file]() { model->load(file.c_str()); },
+                         [pending]()
+                         {
+                             ModelHandle loaded = pending.lock();
+                             if (loaded)
+                                 loaded->upload();
+                         });
+    return model;
+}
+
+TextureHandle AssetManager::loadTextureAsync(const char *path, const TextureHandle &placeholder,
+                                             const TextureParams &params)
+{
+    std::string key = textureKey(canonicalPath(path), params);
+    std::string file(path);
+
+    TextureHandle texture = findTexture(key);
+    if (texture)
+        return texture;
+
+    texture = share(key, placeholder ? placeholder->id : 0, 0, placeholder);
+
+    // Decoded and compressed on a worker, uploaded through the staging buffer on the GL thread
+    std::shared_ptr<TextureSource> source(new TextureSource());
+    source->image.pixels = NULL;
+    std::shared_ptr<bool> loaded(new bool(false));
+    std::weak_ptr<TextureAsset> pending(texture);
+    asyncLoader().submit([source, loaded, file, params]() { *loaded = loadTextureSource(file.c_str(), params, *source); },
+                         [this, source, loaded, pending, params]()
+                         {
+                             TextureHandle target = pending.lock();
+                             if (target && *loaded)
+                             {
+                                 if (stagingBuffer == 0)
+                                     glGenBuffers(1, &stagingBuffer);
+                                 target->id = uploadTextureSource(*source, params, stagingBuffer, target->residentBytes);
+                                 target->placeholder.reset();
+                             }
+                             freeTextureSource(*source);
+                         });
+    return texture;
+}
+
+void AssetManager::submitLoad(const std::function<void()> &work, const std::function<void()> &finish)
+{
+    asyncLoader().submit(work, finish);
+}
+
+AsyncLoader &AssetManager::asyncLoader()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loader)
+        loader = new AsyncLoader();
+    return *loader;
+}
+
+size_t AssetManager::finishLoads(double budgetMilliseconds)
+{
+    AsyncLoader *active;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = loader;
+    }
+    return active ? active->finishLoads(budgetMilliseconds) : 0;
+}
+
+size_t AssetManager::pendingLoads()
+{
+    AsyncLoader *active;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = loader;
+    }
+    return active ? active->pending() : 0;
+}
+
+TextureHandle AssetManager::solidTexture(unsigned char r, unsigned char g, unsigned char b)
+{
+    // Generated textures are keyed by their contents
+    unsigned char pixel[3] = { r, g, b };
+    char key[64];
+    snprintf(key, sizeof(key), "generated:1x1:%016llx",
+             static_cast<unsigned long long>(hashBytes(pixel, sizeof(pixel))));
+
+    TextureHandle texture = findTexture(key);
+    if (texture)
+        return texture;
+
+    // Never changed after creation, so every caller can share it
+    TextureParams params;
+    params.filter = GL_LINEAR;
+    Image image = { 1, 1, 3, pixel };
+    return share(key, uploadTexture(image, params), textureBytes(1, 1, 3, params));
+}
+
+TextureHandle AssetManager::share(const std::string &key, unsigned int id, size_t residentBytes,
+                                  const TextureHandle &placeholder)
+{
+    TextureAsset *asset = new TextureAsset;
+    asset->id = id;
+    asset->key = key;
+    asset->residentBytes = residentBytes;
+    asset->placeholder = placeholder;
+    TextureHandle texture(asset, [this](TextureAsset *released) { releaseTexture(released); });
+
+    std::lock_guard<std::mutex> lock(mutex);
+    textures[key] = texture;
+    return texture;
+}
+
+void AssetManager::releaseModel(Model *model)
+{
+    // Handles may be dropped on any thread, the GL objects are deleted later
+    std::lock_guard<std::mutex> lock(mutex);
+    deadModels.push_back(model);
+}
+
+void AssetManager::releaseTexture(TextureAsset *texture)
+{
+    // A texture still showing its placeholder doesn't own the id
+    if (!texture->placeholder)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        deadTextures.push_back(texture->id);
+    }
+
+    // Outside the lock, this may release the placeholder too
+    delete texture;
+}
+
+void AssetManager::collectGarbage()
+{
+    std::vector<Model *> releasedModels;
+    std::vector<unsigned int> releasedTextures;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        releasedModels.swap(deadModels);
+        releasedTextures.swap(deadTextures);
+
+        // Forget keys whose assets are gone
+        for (std::map<std::string, std::weak_ptr<Model> >::iterator it = models.begin(); it != models.end();)
+        {
+            if (it->second.expired())
+                models.erase(it++);
+            else
+                ++it;
+        }
+        for (std::map<std::string, std::weak_ptr<TextureAsset> >::iterator it = textures.begin(); it != textures.end();)
+        {
+            if (it->second.expired())
+                textures.erase(it++);
+            else
+                ++it;
+        }
+    }
+
+    for (size_t i = 0; i < releasedModels.size(); i++)
+    {
+        releasedModels[i]->deleteBuffers();
+        delete releasedModels[i];
+    }
+    if (!releasedTextures.empty())
+        glDeleteTextures(static_cast<GLsizei>(releasedTextures.size()), releasedTextures.data());
+}
+
+size_t AssetManager::modelCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (std::map<std::string, std::weak_ptr<Model> >::iterator it = models.begin(); it != models.end(); ++it)
+        count += it->second.expired() ? 0 : 1;
+    return count;
+}
+
+size_t AssetManager::textureCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (std::map<std::string, std::weak_ptr<TextureAsset> >::iterator it = textures.begin(); it != textures.end(); ++it)
+        count += it->second.expired() ? 0 : 1;
+    return count;
+}
+
+void AssetManager::aliveTextures(std::vector<TextureHandle> &alive)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::map<std::string, std::weak_ptr<TextureAsset> >::iterator it = textures.begin(); it != textures.end(); ++it)
+    {
+        TextureHandle texture = it->second.lock();
+        if (texture)
+            alive.push_back(texture);
+    }
+}
+
+size_t AssetManager::residentTextureBytes()
+{
+    // The handles are dropped after unlocking, they may be the last ones
+    std::vector<TextureHandle> alive;
+    aliveTextures(alive);
+    size_t bytes = 0;
+    for (size_t i = 0; i < alive.size(); i++)
+        bytes += alive[i]->residentBytes;
+    return bytes;
+}
+
+void AssetManager::printTextures()
+{
+    std::vector<TextureHandle> alive;
+    aliveTextures(alive);
+    size_t total = 0;
+    for (size_t i = 0; i < alive.size(); i++)
+    {
+        printf("%10lu bytes  %s%s\n", (unsigned long)alive[i]->residentBytes, alive[i]->key.c_str(),
+               alive[i]->placeholder ? " (loading)" : "");
+        total += alive[i]->residentBytes;
+    }
+    printf("%10lu bytes  total\n", (unsigned long)total);
+}
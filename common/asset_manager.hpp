@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+#include "model.hpp"
+#include "texture.hpp"
+#include "async_loader.hpp"
+
+// Shared handle, the model is released when the last handle goes away
+typedef std::shared_ptr<Model> ModelHandle;
+
+// Registry of loaded models and textures so each file is loaded and uploaded
+// once however many objects use it. Models are keyed by canonical path,
+// textures by canonical path and load parameters, generated textures by a
+// hash of their contents. GL objects of released
+// assets are deleted by collectGarbage, on the thread that owns the context
+class AssetManager
+{
+public:
+    static AssetManager &instance();
+
+    // Load a model, or share the one already loaded from the same file
+    ModelHandle loadModel(const char *path);
+
+    // Load a texture, or share the one already loaded from the same file with
+    // the same parameters. Returns an empty handle if the file can't be loaded
+    TextureHandle loadTexture(const char *path, const TextureParams &params = TextureParams());
+
+    // Load a batch of textures, decoding the files at the same time instead of
+    // one after another. textures[i] is the texture of requests[i], empty if
+    // its file can't be loaded
+    std::vector<TextureHandle> loadTextures(const std::vector<TextureRequest> &requests);
+
+    // Share the texture already loaded under key, or upload a source loaded by
+    // the caller, e.g. an image embedded in a model, and share it under key
+    TextureHandle shareTexture(const std::string &key, const TextureSource &source,
+                               const TextureParams &params = TextureParams());
+
+    // Start loading a model on a worker thread. The model draws nothing until
+    // finishLoads has uploaded it
+    ModelHandle loadModelAsync(const char *path);
+
+    // Start loading a texture on a worker thread. Its id is the placeholder's
+    // until finishLoads has uploaded it, and stays so if the file can't be loaded
+    TextureHandle loadTextureAsync(const char *path, const TextureHandle &placeholder,
+                                   const TextureParams &params = TextureParams());
+
+    // Run work on a loading thread and finish on the next finishLoads call, for
+    // loads of assets managed elsewhere
+    void submitLoad(const std::function<void()> &work, const std::function<void()> &finish);
+
+    // Upload finished async loads, once per frame on the thread that owns the
+    // context. Stops once the budget is spent. Returns the number of loads finished
+    size_t finishLoads(double budgetMilliseconds = 2.0);
+
+    // Async loads not finished yet
+    size_t pendingLoads();
+
+    // A 1x1 RGB texture of one colour, shared by every caller asking for it
+    TextureHandle solidTexture(unsigned char r, unsigned char g, unsigned char b);
+
+    // Delete the GL objects of assets nobody holds any more
+    void collectGarbage();
+
+    // Assets currently alive
+    size_t modelCount();
+    size_t textureCount();
+
+    // GPU memory used by the textures currently alive
+    size_t residentTextureBytes();
+
+    // Print every texture alive with its GPU memory
+    void printTextures();
+
+    // Canonical form of a path, so different spellings of a file share a key
+    static std::string canonicalPath(const char *path);
+
+    // Key of a texture file loaded with the given parameters
+    static std::string textureKey(const std::string &path, const TextureParams &params);
+
+private:
+    std::map<std::string, std::weak_ptr<Model> > models;
+    std::map<std::string, std::weak_ptr<TextureAsset> > textures;
+    std::mutex mutex;
+
+    // Released assets waiting for collectGarbage
+    std::vector<Model *> deadModels;
+    std::vector<unsigned int> deadTextures;
+
+    // Created on the first async load
+    AsyncLoader *loader;
+    GLuint stagingBuffer;
+
+    AssetManager() : loader(NULL), stagingBuffer(0) {}
+    AssetManager(const AssetManager &);
+    AssetManager &operator=(const AssetManager &);
+
+    AsyncLoader &asyncLoader();
+    TextureHandle findTexture(const std::string &key);
+
+    // Handles of the textures alive, copied under the lock. Drop them after
+    // unlocking: releasing the last handle of a texture takes the lock again
+    void aliveTextures(std::vector<TextureHandle> &alive);
+    TextureHandle share(const std::string &key, unsigned int id, size_t residentBytes,
+                        const TextureHandle &placeholder = TextureHandle());
+    void releaseModel(Model *model);
+    void releaseTexture(TextureAsset *texture);
+};
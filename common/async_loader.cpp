@@ -0,0 +1,70 @@
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <functional>
+
+#include "async_loader.hpp"
+
+static unsigned int loaderThreads(unsigned int workerCount)
+{
+    if (workerCount != 0)
+        return workerCount;
+    unsigned int threads = ThreadPool::hardwareThreads();
+    return threads > 1 ? threads - 1 : 1;
+}
+
+AsyncLoader::AsyncLoader(unsigned int workerCount)
+    : workers(loaderThreads(workerCount)), inFlight(0)
+{
+}
+
+void AsyncLoader::submit(const std::function<void()> &work, const std::function<void()> &finish)
+{
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        inFlight++;
+    }
+
+    workers.enqueue([this, work, finish]()
+    {
+        work();
+        std::lock_guard<std::mutex> lock(completedMutex);
+        completed.push_back(finish);
+    });
+}
+
+size_t AsyncLoader::finishLoads(double budgetMilliseconds)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t finished = 0;
+    for (;;)
+    {
+        std::function<void()> finish;
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            if (completed.empty())
+                break;
+            finish = completed.front();
+            completed.pop_front();
+        }
+
+        finish();
+        finished++;
+
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            inFlight--;
+        }
+
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= budgetMilliseconds)
+            break;
+    }
+    return finished;
+}
+
+size_t AsyncLoader::pending()
+{
+    std::lock_guard<std::mutex> lock(completedMutex);
+    return inFlight;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <stddef.h>
+
+#include "thread_pool.hpp"
+
+// Runs the slow part of a load (file reads, parsing, decoding) on worker threads
+// and hands the finishing part (GL uploads) back to the thread that owns the
+// context, which drains it a few jobs per frame
+class AsyncLoader
+{
+public:
+    // Spawn workerCount loading threads, 0 leaves one hardware thread for rendering
+    explicit AsyncLoader(unsigned int workerCount = 0);
+
+    // Run work on a worker, then finish on the next finishLoads call after it's done
+    void submit(const std::function<void()> &work, const std::function<void()> &finish);
+
+    // Run finished jobs until the budget is spent, at least one per call so
+    // loading always makes progress. Returns the number of jobs finished
+    size_t finishLoads(double budgetMilliseconds);
+
+    // Jobs submitted and not finished yet
+    size_t pending();
+
+private:
+    ThreadPool workers;
+    std::deque<std::function<void()> > completed;
+    std::mutex completedMutex;
+    size_t inFlight;
+
+    AsyncLoader(const AsyncLoader &);
+    AsyncLoader &operator=(const AsyncLoader &);
+};
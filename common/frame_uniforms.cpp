@@ -0,0 +1,106 @@
+#include <vector>
+#include <string.h>
+
+#include "frame_uniforms.hpp"
+
+const char *uniformBlockName(UniformBlockBinding binding)
+{
+    static const char *names[SharedBlockCount] = { "FrameData", "ViewData", "LightData" };
+    return binding < SharedBlockCount ? names[binding] : NULL;
+}
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+FrameUniforms::FrameUniforms() : buffer(0), slot(0), slotSize(0)
+{
+    memset(offsets, 0, sizeof(offsets));
+}
+
+FrameUniforms::~FrameUniforms()
+{
+    destroy();
+}
+
+void FrameUniforms::create(unsigned int frames)
+{
+    destroy();
+
+    // Bound ranges have to start at a multiple of the alignment
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment < 16)
+        alignment = 16;
+    const size_t sizes[SharedBlockCount] = { sizeof(FrameBlock), sizeof(ViewBlock), sizeof(LightBlock) };
+    slotSize = 0;
+    for (int b = 0; b < SharedBlockCount; b++)
+    {
+        offsets[b] = slotSize;
+        slotSize += alignUp(sizes[b], alignment);
+    }
+
+    fences.assign(frames > 0 ? frames : 1, (GLsync)0);
+    slot = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, slotSize * fences.size(), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniforms::destroy()
+{
+    for (size_t i = 0; i < fences.size(); i++)
+        if (fences[i])
+            glDeleteSync(fences[i]);
+    fences.clear();
+    if (buffer != 0)
+        glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+void FrameUniforms::update(const FrameBlock &frame, const ViewBlock &view, const LightBlock &light)
+{
+    if (buffer == 0)
+        return;
+
+    // Wait for the GPU to finish the frame that last read this slot
+    slot = (slot + 1) % fences.size();
+    if (fences[slot])
+    {
+        glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fences[slot]);
+        fences[slot] = 0;
+    }
+
+    const void *blocks[SharedBlockCount] = { &frame, &view, &light };
+    const size_t sizes[SharedBlockCount] = { sizeof(FrameBlock), sizeof(ViewBlock), sizeof(LightBlock) };
+    const size_t base = slot * slotSize;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    char *mapped = static_cast<char *>(glMapBufferRange(GL_UNIFORM_BUFFER, base, slotSize,
+                                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                                        GL_MAP_UNSYNCHRONIZED_BIT));
+    for (int b = 0; b < SharedBlockCount; b++)
+    {
+        if (mapped)
+            memcpy(mapped + offsets[b], blocks[b], sizes[b]);
+        else
+            glBufferSubData(GL_UNIFORM_BUFFER, base + offsets[b], sizes[b], blocks[b]);
+    }
+    if (mapped)
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    for (int b = 0; b < SharedBlockCount; b++)
+        glBindBufferRange(GL_UNIFORM_BUFFER, b, buffer, base + offsets[b], sizes[b]);
+}
+
+void FrameUniforms::endFrame()
+{
+    if (buffer == 0)
+        return;
+    if (fences[slot])
+        glDeleteSync(fences[slot]);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
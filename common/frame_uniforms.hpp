@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Uniform blocks shared by every program, std140 layout. vec3s are padded to
+// vec4s, which is also how std140 aligns them. Declare them in GLSL as
+//   layout(std140) uniform FrameData { float time; float deltaTime; vec2 viewportSize; };
+//   layout(std140) uniform ViewData { mat4 view; mat4 projection; mat4 viewProjection; vec4 viewPosition; };
+//   layout(std140) uniform LightData { vec4 pointLightPosition; vec4 pointLightColor;
+//                                      vec4 dirLightDirection; vec4 dirLightColor; vec4 ambientColor; };
+// ShaderProgram binds blocks of these names to their binding points when it links
+struct FrameBlock
+{
+    float time;
+    float deltaTime;
+    glm::vec2 viewportSize;
+};
+
+struct ViewBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 viewPosition;      // World space, w unused
+};
+
+struct LightBlock
+{
+    glm::vec4 pointLightPosition; // World space, w unused
+    glm::vec4 pointLightColor;    // w is the power
+    glm::vec4 dirLightDirection;  // World space, from the light
+    glm::vec4 dirLightColor;
+    glm::vec4 ambientColor;
+};
+
+static_assert(sizeof(FrameBlock) == 16, "FrameBlock must match its std140 layout");
+static_assert(sizeof(ViewBlock) == 208, "ViewBlock must match its std140 layout");
+static_assert(sizeof(LightBlock) == 80, "LightBlock must match its std140 layout");
+
+// Binding points of the shared blocks
+enum UniformBlockBinding
+{
+    FrameBlockBinding = 0,
+    ViewBlockBinding = 1,
+    LightBlockBinding = 2,
+    SharedBlockCount = 3
+};
+
+// Name of the block at a binding point, as declared in GLSL
+const char *uniformBlockName(UniformBlockBinding binding);
+
+// One uniform buffer holding the shared blocks of the last few frames. Each
+// frame writes its blocks once into the next slot, unsynchronized since a
+// fence shows the GPU has finished the frame that used it last, and binds the
+// slot's ranges. Programs switched during the frame then need no uploads
+class FrameUniforms
+{
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    // Create the buffer with a slot for each frame in flight
+    void create(unsigned int frames = 3);
+
+    // Delete the buffer and fences
+    void destroy();
+
+    // Write this frame's blocks into the next slot and bind them, before the draws
+    void update(const FrameBlock &frame, const ViewBlock &view, const LightBlock &light);
+
+    // Fence the slot, after the frame's draws
+    void endFrame();
+
+private:
+    GLuint buffer;
+    std::vector<GLsync> fences;
+    unsigned int slot;
+    size_t slotSize;
+    size_t offsets[SharedBlockCount]; // Of each block inside a slot
+
+    // Buffers are owned, so they can't be copied
+    FrameUniforms(const FrameUniforms &);
+    FrameUniforms &operator=(const FrameUniforms &);
+};
@@ -0,0 +1,491 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glb_loader.hpp"
+#include "json.hpp"
+
+static const uint32_t glbMagic = 0x46546c67;     // "glTF"
+static const uint32_t glbJsonChunk = 0x4e4f534a; // "JSON"
+static const uint32_t glbBinChunk = 0x004e4942;  // "BIN\0"
+
+// Node hierarchies deeper than this are treated as cycles
+static const int maxNodeDepth = 64;
+
+static const int glbTriangles = 4;
+
+struct GlbHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;
+};
+
+struct GlbChunkHeader
+{
+    uint32_t length;
+    uint32_t type;
+};
+
+static size_t componentBytes(GLenum componentType)
+{
+    switch (componentType)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+        return 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static int typeComponents(const std::string &type)
+{
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4")
+        return 4;
+    return 0;
+}
+
+// glTF limits the stride of a vertex buffer view
+static const double maxByteStride = 252;
+
+// Whether a JSON number is a whole count or byte offset no larger than limit.
+// Anything else can't be converted to size_t safely
+static bool wholeNumber(double value, double limit)
+{
+    return value >= 0 && value <= limit && value == floor(value);
+}
+
+// Resolve an accessor against its buffer view, leaving it without components
+// or elements if it can't be read from the binary chunk
+static GlbAccessor readAccessor(const JsonValue &json, const JsonValue *bufferViews, size_t binSize)
+{
+    GlbAccessor accessor;
+    accessor.offset = 0;
+    accessor.count = 0;
+    accessor.stride = 0;
+    accessor.componentType = static_cast<GLenum>(json.intOr("componentType", 0));
+    accessor.components = 0;
+    const JsonValue *normalized = json.find("normalized");
+    accessor.normalized = normalized && normalized->type == JsonBool && normalized->boolean;
+
+    // Every element takes at least a byte, so a readable count is at most the chunk size
+    int components = typeComponents(json.stringOr("type", ""));
+    size_t elementBytes = componentBytes(accessor.componentType) * components;
+    double count = json.numberOr("count", 0);
+    int viewIndex = json.intOr("bufferView", -1);
+    if (json.find("sparse") || elementBytes == 0 || !bufferViews || !wholeNumber(count, static_cast<double>(binSize)) ||
+        viewIndex < 0 || static_cast<size_t>(viewIndex) >= bufferViews->size())
+        return accessor;
+
+    // Only the buffer stored in the binary chunk is supported
+    const JsonValue &view = (*bufferViews)[viewIndex];
+    double viewOffset = view.numberOr("byteOffset", 0);
+    double viewLength = view.numberOr("byteLength", 0);
+    double offset = json.numberOr("byteOffset", 0);
+    double stride = view.numberOr("byteStride", 0);
+    if (view.intOr("buffer", 0) != 0 || !wholeNumber(viewOffset, static_cast<double>(binSize)) ||
+        !wholeNumber(viewLength, static_cast<double>(binSize)) || !wholeNumber(offset, viewLength) ||
+        !wholeNumber(stride, maxByteStride) || viewOffset + viewLength > static_cast<double>(binSize))
+        return accessor;
+
+    size_t elementStride = stride > 0 ? static_cast<size_t>(stride) : elementBytes;
+    if (elementStride < elementBytes)
+        return accessor;
+    if (count > 0 && offset + (count - 1) * elementStride + elementBytes > viewLength)
+        return accessor;
+
+    accessor.offset = static_cast<size_t>(viewOffset + offset);
+    accessor.count = static_cast<size_t>(count);
+    accessor.stride = elementStride;
+    accessor.components = components;
+    return accessor;
+}
+
+static glm::mat4 nodeTransform(const JsonValue &node)
+{
+    const JsonValue *matrix = node.find("matrix");
+    if (matrix && matrix->isArray() && matrix->size() == 16)
+    {
+        // Column major, as glm stores it
+        glm::mat4 m;
+        for (int i = 0; i < 16; i++)
+            m[i / 4][i % 4] = static_cast<float>((*matrix)[i].number);
+        return m;
+    }
+
+    glm::vec3 translation(0.0f), scale(1.0f);
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    const JsonValue *t = node.find("translation");
+    const JsonValue *r = node.find("rotation");
+    const JsonValue *s = node.find("scale");
+    if (t && t->isArray() && t->size() == 3)
+        translation = glm::vec3((*t)[0].number, (*t)[1].number, (*t)[2].number);
+    if (r && r->isArray() && r->size() == 4)
+        rotation = glm::quat(static_cast<float>((*r)[3].number), static_cast<float>((*r)[0].number),
+                             static_cast<float>((*r)[1].number), static_cast<float>((*r)[2].number));
+    if (s && s->isArray() && s->size() == 3)
+        scale = glm::vec3((*s)[0].number, (*s)[1].number, (*s)[2].number);
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) *
+           glm::scale(glm::mat4(1.0f), scale);
+}
+
+static int attributeIndex(const JsonValue &attributes, const char *name, size_t accessorCount)
+{
+    int index = attributes.intOr(name, -1);
+    return index >= 0 && static_cast<size_t>(index) < accessorCount ? index : -1;
+}
+
+// List the triangle primitives of a mesh placed with this transform
+static void addMesh(const JsonValue &root, int meshIndex, const glm::mat4 &transform, GlbFile &glb)
+{
+    const JsonValue *meshes = root.find("meshes");
+    if (!meshes || meshIndex < 0 || static_cast<size_t>(meshIndex) >= meshes->size())
+        return;
+    const JsonValue *primitives = (*meshes)[meshIndex].find("primitives");
+    for (size_t p = 0; primitives && p < primitives->size(); p++)
+    {
+        const JsonValue &json = (*primitives)[p];
+        const JsonValue *attributes = json.find("attributes");
+        if (json.intOr("mode", glbTriangles) != glbTriangles || !attributes)
+        {
+            printf("Skipping primitive %u of mesh %d: only triangle lists are supported\n",
+                   (unsigned int)p, meshIndex);
+            continue;
+        }
+
+        GlbPrimitive primitive;
+        size_t accessorCount = glb.accessors.size();
+        primitive.position = attributeIndex(*attributes, "POSITION", accessorCount);
+        primitive.normal = attributeIndex(*attributes, "NORMAL", accessorCount);
+        primitive.uv = attributeIndex(*attributes, "TEXCOORD_0", accessorCount);
+        primitive.tangent = attributeIndex(*attributes, "TANGENT", accessorCount);
+        primitive.indices = attributeIndex(json, "indices", accessorCount);
+        primitive.material = json.intOr("material", -1);
+        if (primitive.material >= static_cast<int>(glb.materials.size()))
+            primitive.material = -1;
+        primitive.transform = transform;
+        if (primitive.position < 0)
+            continue;
+        glb.primitives.push_back(primitive);
+    }
+}
+
+static void addNode(const JsonValue &root, int nodeIndex, const glm::mat4 &parent, int depth, GlbFile &glb)
+{
+    const JsonValue *nodes = root.find("nodes");
+    if (!nodes || nodeIndex < 0 || static_cast<size_t>(nodeIndex) >= nodes->size() || depth > maxNodeDepth)
+        return;
+    const JsonValue &node = (*nodes)[nodeIndex];
+    glm::mat4 transform = parent * nodeTransform(node);
+    addMesh(root, node.intOr("mesh", -1), transform, glb);
+
+    const JsonValue *children = node.find("children");
+    for (size_t c = 0; children && c < children->size(); c++)
+        addNode(root, static_cast<int>((*children)[c].number), transform, depth + 1, glb);
+}
+
+// Image of a texture reference such as a material's normalTexture
+static int textureImage(const JsonValue *reference, const JsonValue *textures, size_t imageCount)
+{
+    if (!reference || !textures)
+        return -1;
+    int texture = reference->intOr("index", -1);
+    if (texture < 0 || static_cast<size_t>(texture) >= textures->size())
+        return -1;
+    int image = (*textures)[texture].intOr("source", -1);
+    return image >= 0 && static_cast<size_t>(image) < imageCount ? image : -1;
+}
+
+// Directory part of a path, with its trailing slash
+static std::string directoryOf(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash > slash)
+        slash = backslash;
+    return slash ? std::string(path, slash + 1) : std::string();
+}
+
+bool parseGlb(const char *path, GlbFile &glb)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    closeGlb(glb);
+    if (!glb.file.open(path))
+    {
+        printf("Impossible to open %s.\n", path);
+        return false;
+    }
+
+    // Header, then the JSON chunk and an optional binary chunk
+    const char *data = glb.file.data();
+    size_t size = glb.file.size();
+    GlbHeader header;
+    GlbChunkHeader jsonHeader;
+    if (size < sizeof(header) + sizeof(jsonHeader))
+    {
+        printf("%s is not a binary glTF file.\n", path);
+        closeGlb(glb);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    memcpy(&jsonHeader, data + sizeof(header), sizeof(jsonHeader));
+    if (header.magic != glbMagic || header.version != 2 || header.length > size ||
+        jsonHeader.type != glbJsonChunk ||
+        jsonHeader.length > header.length - sizeof(header) - sizeof(jsonHeader))
+    {
+        printf("%s is not a binary glTF 2.0 file.\n", path);
+        closeGlb(glb);
+        return false;
+    }
+    const char *json = data + sizeof(header) + sizeof(jsonHeader);
+
+    size_t binStart = sizeof(header) + sizeof(jsonHeader) + jsonHeader.length;
+    GlbChunkHeader binHeader;
+    if (binStart + sizeof(binHeader) <= header.length)
+    {
+        memcpy(&binHeader, data + binStart, sizeof(binHeader));
+        if (binHeader.type == glbBinChunk && binHeader.length <= header.length - binStart - sizeof(binHeader))
+        {
+            glb.bin = data + binStart + sizeof(binHeader);
+            glb.binSize = binHeader.length;
+        }
+    }
+
+    JsonValue root;
+    std::string error;
+    if (!parseJson(json, jsonHeader.length, root, error))
+    {
+        printf("%s has invalid JSON: %s\n", path, error.c_str());
+        closeGlb(glb);
+        return false;
+    }
+
+    // Buffer 0 must be the binary chunk, data in other files isn't supported
+    const JsonValue *buffers = root.find("buffers");
+    if (buffers && buffers->size() > 0 && (*buffers)[0].find("uri"))
+        printf("%s keeps its data in another file, only the binary chunk is read\n", path);
+
+    const JsonValue *bufferViews = root.find("bufferViews");
+    const JsonValue *accessors = root.find("accessors");
+    for (size_t a = 0; accessors && a < accessors->size(); a++)
+        glb.accessors.push_back(readAccessor((*accessors)[a], bufferViews, glb.binSize));
+
+    // Images are kept compressed, decoding them is up to the caller
+    const JsonValue *images = root.find("images");
+    for (size_t i = 0; images && i < images->size(); i++)
+    {
+        const JsonValue &json = (*images)[i];
+        GlbImage image;
+        image.mimeType = json.stringOr("mimeType", "");
+        image.offset = image.size = 0;
+        int viewIndex = json.intOr("bufferView", -1);
+        std::string uri = json.stringOr("uri", "");
+        if (viewIndex >= 0 && bufferViews && static_cast<size_t>(viewIndex) < bufferViews->size())
+        {
+            const JsonValue &view = (*bufferViews)[viewIndex];
+            double offset = view.numberOr("byteOffset", 0), length = view.numberOr("byteLength", 0);
+            if (wholeNumber(offset, static_cast<double>(glb.binSize)) &&
+                wholeNumber(length, static_cast<double>(glb.binSize)) && offset + length <= static_cast<double>(glb.binSize))
+            {
+                image.offset = static_cast<size_t>(offset);
+                image.size = static_cast<size_t>(length);
+            }
+        }
+        else if (!uri.empty() && uri.compare(0, 5, "data:") != 0)
+            image.path = directoryOf(path) + uri;
+        glb.images.push_back(image);
+    }
+
+    const JsonValue *textures = root.find("textures");
+    const JsonValue *materials = root.find("materials");
+    for (size_t m = 0; materials && m < materials->size(); m++)
+    {
+        const JsonValue &json = (*materials)[m];
+        const JsonValue *pbr = json.find("pbrMetallicRoughness");
+        GlbMaterial material;
+        material.baseColorImage = textureImage(pbr ? pbr->find("baseColorTexture") : NULL, textures, glb.images.size());
+        material.normalImage = textureImage(json.find("normalTexture"), textures, glb.images.size());
+        glb.materials.push_back(material);
+    }
+
+    // Walk the default scene, or every root node if there is none
+    const JsonValue *scenes = root.find("scenes");
+    const JsonValue *nodes = root.find("nodes");
+    int sceneIndex = root.intOr("scene", 0);
+    if (scenes && sceneIndex >= 0 && static_cast<size_t>(sceneIndex) < scenes->size())
+    {
+        const JsonValue *roots = (*scenes)[sceneIndex].find("nodes");
+        for (size_t n = 0; roots && n < roots->size(); n++)
+            addNode(root, static_cast<int>((*roots)[n].number), glm::mat4(1.0f), 0, glb);
+    }
+    else if (nodes)
+    {
+        std::vector<char> isChild(nodes->size(), 0);
+        for (size_t n = 0; n < nodes->size(); n++)
+        {
+            const JsonValue *children = (*nodes)[n].find("children");
+            for (size_t c = 0; children && c < children->size(); c++)
+            {
+                size_t child = static_cast<size_t>((*children)[c].number);
+                if (child < isChild.size())
+                    isChild[child] = 1;
+            }
+        }
+        for (size_t n = 0; n < nodes->size(); n++)
+            if (!isChild[n])
+                addNode(root, static_cast<int>(n), glm::mat4(1.0f), 0, glb);
+    }
+    else
+    {
+        const JsonValue *meshes = root.find("meshes");
+        for (size_t m = 0; meshes && m < meshes->size(); m++)
+            addMesh(root, static_cast<int>(m), glm::mat4(1.0f), glb);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Parsed GLB file %s: %u primitives, %u materials, %u images, %lu binary bytes in %.2f ms\n", path,
+           (unsigned int)glb.primitives.size(), (unsigned int)glb.materials.size(),
+           (unsigned int)glb.images.size(), (unsigned long)glb.binSize, seconds * 1000.0);
+    return true;
+}
+
+void closeGlb(GlbFile &glb)
+{
+    glb.file.close();
+    glb.bin = NULL;
+    glb.binSize = 0;
+    glb.accessors.clear();
+    glb.primitives.clear();
+    glb.materials.clear();
+    glb.images.clear();
+}
+
+bool glbAccessorIs(const GlbAccessor &accessor, GLenum componentType, int components)
+{
+    return accessor.components == components && accessor.componentType == componentType;
+}
+
+// One component as a float, normalized integers scaled as the GL does
+static float readComponent(const char *p, GLenum componentType, bool normalized)
+{
+    switch (componentType)
+    {
+    case GL_FLOAT:
+    {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    case GL_BYTE:
+    {
+        float value = static_cast<float>(*reinterpret_cast<const int8_t *>(p));
+        return normalized ? glm::max(value / 127.0f, -1.0f) : value;
+    }
+    case GL_UNSIGNED_BYTE:
+    {
+        float value = static_cast<float>(*reinterpret_cast<const uint8_t *>(p));
+        return normalized ? value / 255.0f : value;
+    }
+    case GL_SHORT:
+    {
+        int16_t raw;
+        memcpy(&raw, p, sizeof(raw));
+        return normalized ? glm::max(raw / 32767.0f, -1.0f) : static_cast<float>(raw);
+    }
+    case GL_UNSIGNED_SHORT:
+    {
+        uint16_t raw;
+        memcpy(&raw, p, sizeof(raw));
+        return normalized ? raw / 65535.0f : static_cast<float>(raw);
+    }
+    case GL_UNSIGNED_INT:
+    {
+        uint32_t raw;
+        memcpy(&raw, p, sizeof(raw));
+        return static_cast<float>(raw);
+    }
+    default:
+        return 0.0f;
+    }
+}
+
+// Read up to components floats per element, missing ones are left as they are
+static void readFloats(const GlbFile &glb, const GlbAccessor &accessor, int components, float *out)
+{
+    const char *data = glbAccessorData(glb, accessor);
+    const size_t bytes = componentBytes(accessor.componentType);
+    const int count = glm::min(components, accessor.components);
+    for (size_t e = 0; e < accessor.count; e++)
+    {
+        const char *element = data + e * accessor.stride;
+        for (int c = 0; c < count; c++)
+            out[e * components + c] = readComponent(element + c * bytes, accessor.componentType, accessor.normalized);
+    }
+}
+
+void readGlbAccessor(const GlbFile &glb, const GlbAccessor &accessor, std::vector<glm::vec2> &out)
+{
+    out.assign(accessor.count, glm::vec2(0.0f));
+    if (accessor.count > 0)
+        readFloats(glb, accessor, 2, &out[0].x);
+}
+
+void readGlbAccessor(const GlbFile &glb, const GlbAccessor &accessor, std::vector<glm::vec3> &out)
+{
+    out.assign(accessor.count, glm::vec3(0.0f));
+    if (accessor.count > 0)
+        readFloats(glb, accessor, 3, &out[0].x);
+}
+
+void readGlbAccessor(const GlbFile &glb, const GlbAccessor &accessor, std::vector<glm::vec4> &out)
+{
+    out.assign(accessor.count, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    if (accessor.count > 0)
+        readFloats(glb, accessor, 4, &out[0].x);
+}
+
+void readGlbIndices(const GlbFile &glb, const GlbAccessor &accessor, std::vector<unsigned int> &out)
+{
+    out.resize(accessor.count);
+    const char *data = glbAccessorData(glb, accessor);
+    for (size_t i = 0; i < accessor.count; i++)
+    {
+        const char *element = data + i * accessor.stride;
+        if (accessor.componentType == GL_UNSIGNED_BYTE)
+            out[i] = *reinterpret_cast<const uint8_t *>(element);
+        else if (accessor.componentType == GL_UNSIGNED_SHORT)
+        {
+            uint16_t index;
+            memcpy(&index, element, sizeof(index));
+            out[i] = index;
+        }
+        else
+        {
+            uint32_t index;
+            memcpy(&index, element, sizeof(index));
+            out[i] = index;
+        }
+    }
+}
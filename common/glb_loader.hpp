@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "vfs.hpp"
+
+// Elements in the binary chunk as a glTF accessor describes them. Accessors
+// the loader can't read (sparse, matrices, outside the chunk) have no components
+struct GlbAccessor
+{
+    size_t offset;         // Of the first element, in the binary chunk
+    size_t count;
+    size_t stride;         // Bytes from one element to the next
+    GLenum componentType;  // GL_FLOAT, GL_UNSIGNED_SHORT, ... (glTF uses the GL values)
+    int components;        // 1 for scalars to 4 for vec4, 0 if unreadable
+    bool normalized;
+};
+
+// One draw of a mesh where a node places it. Attributes and indices are
+// accessor indices, -1 if absent
+struct GlbPrimitive
+{
+    int position;
+    int normal;
+    int uv;
+    int tangent;
+    int indices;
+    int material;
+    glm::mat4 transform; // Node to model space
+};
+
+// Images of a material, indices into GlbFile::images, -1 if absent
+struct GlbMaterial
+{
+    int baseColorImage;
+    int normalImage;
+};
+
+// An image embedded in the binary chunk, or a file next to the .glb
+struct GlbImage
+{
+    std::string mimeType;
+    size_t offset; // In the binary chunk when path is empty
+    size_t size;
+    std::string path;
+};
+
+// A .glb file mapped into memory, from disk or a pak. Accessors and embedded
+// images point into the binary chunk, so they are valid until the file is closed
+struct GlbFile
+{
+    VfsFile file;
+    const char *bin;
+    size_t binSize;
+    std::vector<GlbAccessor> accessors;
+    std::vector<GlbPrimitive> primitives;
+    std::vector<GlbMaterial> materials;
+    std::vector<GlbImage> images;
+
+    GlbFile() : bin(NULL), binSize(0) {}
+};
+
+// Map a binary glTF 2.0 file and read its JSON chunk. The triangle primitives
+// of the default scene are listed with their node transforms. Returns false
+// if the file is missing or isn't a valid .glb with its data in the binary chunk
+bool parseGlb(const char *path, GlbFile &glb);
+
+// Unmap the file
+void closeGlb(GlbFile &glb);
+
+// Whether the GPU can read an accessor in place as elements of this type
+bool glbAccessorIs(const GlbAccessor &accessor, GLenum componentType, int components);
+
+// First byte of an accessor's data
+inline const char *glbAccessorData(const GlbFile &glb, const GlbAccessor &accessor)
+{
+    return glb.bin + accessor.offset;
+}
+
+// Convert an accessor to floats, normalized integers are scaled to [0, 1] or [-1, 1]
+void readGlbAccessor(const GlbFile &glb, const GlbAccessor &accessor, std::vector<glm::vec2> &out);
+void readGlbAccessor(const GlbFile &glb, const GlbAccessor &accessor, std::vector<glm::vec3> &out);
+void readGlbAccessor(const GlbFile &glb, const GlbAccessor &accessor, std::vector<glm::vec4> &out);
+
+// Convert an index accessor to 32-bit indices
+void readGlbIndices(const GlbFile &glb, const GlbAccessor &accessor, std::vector<unsigned int> &out);
@@ -0,0 +1,106 @@
+#include <string.h>
+
+#include "hash.hpp"
+
+static const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+static const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t prime3 = 0x165667B19E3779F9ull;
+static const uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+static const uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read64(const unsigned char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t read32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t mixRound(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * prime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * prime1;
+}
+
+static inline uint64_t mergeRound(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= mixRound(0, accumulator);
+    return hash * prime1 + prime4;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    const unsigned char *end = p + size;
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+        // Four independent lanes over 32 byte stripes
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+        const unsigned char *limit = end - 32;
+        do
+        {
+            v1 = mixRound(v1, read64(p));
+            v2 = mixRound(v2, read64(p + 8));
+            v3 = mixRound(v3, read64(p + 16));
+            v4 = mixRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + prime5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    // Tail
+    while (p + 8 <= end)
+    {
+        hash ^= mixRound(0, read64(p));
+        hash = rotateLeft(hash, 27) * prime1 + prime4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= static_cast<uint64_t>(read32(p)) * prime1;
+        hash = rotateLeft(hash, 23) * prime2 + prime3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        hash ^= (*p) * prime5;
+        hash = rotateLeft(hash, 11) * prime1;
+        p++;
+    }
+
+    // Avalanche
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
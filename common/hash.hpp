@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 64-bit hash of a block of memory (the XXH64 algorithm)
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
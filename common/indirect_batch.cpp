@@ -0,0 +1,176 @@
+#include <vector>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "indirect_batch.hpp"
+
+// Uniforms set per draw without multi-draw, hashed once
+static const UniformId uniformModel = uniformId("model");
+static const UniformId uniformObjectColor = uniformId("objectColor");
+
+IndirectBatch::IndirectBatch() : commandBuffer(0), dataBuffer(0), drawIndexBuffer(0), capacity(0),
+                                 commandsChanged(false), dataChanged(false)
+{
+}
+
+IndirectBatch::~IndirectBatch()
+{
+    destroy();
+}
+
+void IndirectBatch::clear()
+{
+    commands.clear();
+    data.clear();
+    commandsChanged = true;
+    dataChanged = true;
+}
+
+size_t IndirectBatch::add(GLsizei indexCount, GLuint firstIndex, GLint baseVertex,
+                          const glm::mat4 &model, const glm::vec3 &color)
+{
+    // One instance, whose base instance is the index of its data
+    DrawElementsIndirectCommand command;
+    command.count = static_cast<GLuint>(indexCount);
+    command.instanceCount = 1;
+    command.firstIndex = firstIndex;
+    command.baseVertex = baseVertex;
+    command.baseInstance = static_cast<GLuint>(commands.size());
+    commands.push_back(command);
+
+    DrawData draw;
+    draw.model = model;
+    draw.color = glm::vec4(color, 1.0f);
+    data.push_back(draw);
+
+    commandsChanged = true;
+    dataChanged = true;
+    return commands.size() - 1;
+}
+
+void IndirectBatch::set(size_t draw, const glm::mat4 &model, const glm::vec3 &color)
+{
+    if (draw >= data.size())
+        return;
+    data[draw].model = model;
+    data[draw].color = glm::vec4(color, 1.0f);
+    dataChanged = true;
+}
+
+void IndirectBatch::upload()
+{
+    // Without multi-draw the draws are read from memory
+    if (!supported() || (!commandsChanged && !dataChanged))
+        return;
+
+    if (commandBuffer == 0)
+    {
+        glGenBuffers(1, &commandBuffer);
+        glGenBuffers(1, &dataBuffer);
+        glGenBuffers(1, &drawIndexBuffer);
+    }
+
+    // Grow with room to spare, the draw indices only change when the buffers grow
+    if (commands.size() > capacity)
+    {
+        capacity = std::max(commands.size(), capacity * 2);
+        std::vector<GLuint> indices(capacity);
+        for (size_t i = 0; i < capacity; i++)
+            indices[i] = static_cast<GLuint>(i);
+        glBindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        commandsChanged = true;
+        dataChanged = true;
+    }
+
+    if (commandsChanged)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STATIC_DRAW);
+        if (!commands.empty())
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand),
+                            commands.data());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        commandsChanged = false;
+    }
+
+    if (dataChanged)
+    {
+        // Orphan the data the GPU may still be reading, moving draws change it every frame
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, dataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DrawData), NULL, GL_DYNAMIC_DRAW);
+        if (!data.empty())
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, data.size() * sizeof(DrawData), data.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        dataChanged = false;
+    }
+}
+
+static size_t indexSize(GLenum indexType)
+{
+    switch (indexType)
+    {
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_UNSIGNED_SHORT:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+void IndirectBatch::draw(ShaderProgram &shader, GLenum indexType)
+{
+    if (commands.empty())
+        return;
+
+    // GL 3.3 fallback, a draw per command with its data in uniforms
+    if (!supported())
+    {
+        for (size_t i = 0; i < commands.size(); i++)
+        {
+            const DrawElementsIndirectCommand &command = commands[i];
+            shader.setMat4(uniformModel, data[i].model);
+            shader.setVec3(uniformObjectColor, glm::vec3(data[i].color));
+            glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.count), indexType,
+                                     (void*)(command.firstIndex * indexSize(indexType)), command.baseVertex);
+        }
+        return;
+    }
+
+    upload();
+
+    // Instance 0 of each draw reads the index at its base instance
+    glBindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+    glEnableVertexAttribArray(drawIndexLocation);
+    glVertexAttribIPointer(drawIndexLocation, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glVertexAttribDivisor(drawIndexLocation, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, drawDataBinding, dataBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, (void*)0, static_cast<GLsizei>(commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glVertexAttribDivisor(drawIndexLocation, 0);
+    glDisableVertexAttribArray(drawIndexLocation);
+}
+
+void IndirectBatch::destroy()
+{
+    if (commandBuffer != 0)
+    {
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &dataBuffer);
+        glDeleteBuffers(1, &drawIndexBuffer);
+    }
+    commandBuffer = 0;
+    dataBuffer = 0;
+    drawIndexBuffer = 0;
+    capacity = 0;
+    commandsChanged = true;
+    dataChanged = true;
+}
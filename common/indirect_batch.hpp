@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader_program.hpp"
+
+// Command layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Per-draw data, std430 layout. Declare it in GLSL as
+//   struct Draw { mat4 model; vec4 color; };
+//   layout(std430) buffer DrawData { Draw draws[]; };
+// ShaderProgram binds blocks of this name to drawDataBinding when it links
+struct DrawData
+{
+    glm::mat4 model;
+    glm::vec4 color; // w unused
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match GL's layout");
+static_assert(sizeof(DrawData) == 80, "DrawData must match its std430 layout");
+
+// Storage buffer binding point of the per-draw data, and the name of its block
+static const GLuint drawDataBinding = 0;
+static const char *const drawDataBlockName = "DrawData";
+
+// Attribute location of the draw index, after the instance attributes
+static const GLuint drawIndexLocation = 8;
+
+// Draws sharing a program, textures and a vertex array, i.e. meshes packed into
+// the same buffers at their own first index and base vertex, submitted with one
+// glMultiDrawElementsIndirect. Each command's base instance is its draw index,
+// which an attribute with a divisor of 1 passes to the vertex shader to read
+// the draw's data from a storage buffer. Compile the programs with
+// "#define MULTI_DRAW" when supported(), otherwise draw() loops over the draws
+// and sets the model and objectColor uniforms instead.
+// Static scenes build a batch once and just draw it. Dynamic ones set the data
+// of the draws that moved, which uploads the data again but not the commands
+class IndirectBatch
+{
+public:
+    IndirectBatch();
+    ~IndirectBatch();
+
+    // Whether the context has multi-draw indirect, base instances and storage buffers
+    static bool supported()
+    {
+        return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance &&
+                                    GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_program_interface_query);
+    }
+
+    // Remove the draws, keeping the buffers
+    void clear();
+
+    // Add a draw of indexCount elements from firstIndex, returns its index
+    size_t add(GLsizei indexCount, GLuint firstIndex, GLint baseVertex,
+               const glm::mat4 &model, const glm::vec3 &color);
+
+    // Move a draw or change its color
+    void set(size_t draw, const glm::mat4 &model, const glm::vec3 &color);
+
+    size_t size() const { return commands.size(); }
+    bool empty() const { return commands.empty(); }
+
+    // Upload the commands and data that changed since the last upload
+    void upload();
+
+    // Draw everything from the bound vertex array, whose elements are of indexType
+    void draw(ShaderProgram &shader, GLenum indexType);
+
+    // Delete the buffers
+    void destroy();
+
+private:
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawData> data;
+    GLuint commandBuffer;
+    GLuint dataBuffer;
+    GLuint drawIndexBuffer; // 0, 1, 2... read once per draw through its base instance
+    size_t capacity;        // Draws the buffers have room for
+    bool commandsChanged;
+    bool dataChanged;
+
+    // Buffers are owned, so they can't be copied
+    IndirectBatch(const IndirectBatch &);
+    IndirectBatch &operator=(const IndirectBatch &);
+};
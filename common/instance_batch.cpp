@@ -0,0 +1,125 @@
+#include <vector>
+#include <algorithm>
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "instance_batch.hpp"
+
+VertexLayout VertexFormat<InstanceData>::layout()
+{
+    // The material index arrives as a float, exact for any realistic count
+    VertexLayout layout(sizeof(InstanceData));
+    layout.add(4, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, positionScale))
+          .add(5, 4, GL_FLOAT, GL_FALSE, offsetof(InstanceData, rotation))
+          .add(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(InstanceData, tint))
+          .add(7, 1, GL_UNSIGNED_INT, GL_FALSE, offsetof(InstanceData, material));
+    return layout;
+}
+
+InstanceBatch::InstanceBatch() : buffer(0), capacity(0), changed(false)
+{
+}
+
+InstanceBatch::~InstanceBatch()
+{
+    destroy();
+}
+
+void InstanceBatch::clear()
+{
+    data.clear();
+    materialRanges.clear();
+    changed = true;
+}
+
+void InstanceBatch::add(const glm::vec3 &position, const glm::quat &rotation, float scale,
+                        const glm::vec4 &tint, uint32_t material)
+{
+    InstanceData instance;
+    instance.positionScale = glm::vec4(position, scale);
+    instance.rotation = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+    for (int i = 0; i < 4; i++)
+        instance.tint[i] = static_cast<uint8_t>(glm::clamp(tint[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    instance.material = material;
+    add(instance);
+}
+
+void InstanceBatch::add(const InstanceData &instance)
+{
+    data.push_back(instance);
+    changed = true;
+}
+
+static bool lessMaterial(const InstanceData &a, const InstanceData &b)
+{
+    return a.material < b.material;
+}
+
+void InstanceBatch::upload()
+{
+    if (!changed)
+        return;
+    changed = false;
+
+    // Instances of a material are drawn with one call, so they have to be consecutive
+    std::stable_sort(data.begin(), data.end(), lessMaterial);
+    materialRanges.clear();
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        if (materialRanges.empty() || materialRanges.back().material != data[i].material)
+        {
+            Range range = { data[i].material, i, 0 };
+            materialRanges.push_back(range);
+        }
+        materialRanges.back().count++;
+    }
+
+    if (buffer == 0)
+        glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    // Orphan the storage the GPU may still be reading. It grows with room to
+    // spare, so batches that change size each frame rarely need more
+    if (data.size() > capacity)
+        capacity = std::max(data.size(), capacity * 2);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+    if (!data.empty())
+        glBufferSubData(GL_ARRAY_BUFFER, 0, data.size() * sizeof(InstanceData), data.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatch::bindAttributes(size_t first) const
+{
+    static const VertexLayout layout = VertexFormat<InstanceData>::layout();
+    const size_t base = first * sizeof(InstanceData);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (size_t i = 0; i < layout.attributes.size(); i++)
+    {
+        const VertexAttribute &attribute = layout.attributes[i];
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type,
+                              attribute.normalized, layout.stride, (void*)(base + attribute.offset));
+        glVertexAttribDivisor(attribute.location, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatch::unbindAttributes()
+{
+    static const VertexLayout layout = VertexFormat<InstanceData>::layout();
+    for (size_t i = 0; i < layout.attributes.size(); i++)
+    {
+        glVertexAttribDivisor(layout.attributes[i].location, 0);
+        glDisableVertexAttribArray(layout.attributes[i].location);
+    }
+}
+
+void InstanceBatch::destroy()
+{
+    if (buffer != 0)
+        glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    capacity = 0;
+    changed = true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "vertex_layout.hpp"
+
+// 40 byte per-instance attributes. A packed translation, uniform scale and
+// rotation instead of a matrix, so the shaders can rotate normals without
+// inverting anything
+struct InstanceData
+{
+    glm::vec4 positionScale; // World position, w is the uniform scale
+    glm::vec4 rotation;      // Unit quaternion, xyzw
+    uint8_t tint[4];         // RGBA8, multiplied into the object color
+    uint32_t material;       // Index into the materials given to Model::drawInstanced
+};
+
+// Attribute format, locations 4-7 follow the vertex attributes of the models
+template <>
+struct VertexFormat<InstanceData>
+{
+    static VertexLayout layout();
+};
+
+// Builds the instances of one model and uploads them to a GL buffer, grouped
+// by material. Build it again each frame for moving objects, or once for
+// static ones: the buffer is only uploaded again after it changes
+class InstanceBatch
+{
+public:
+    // Instances sharing a material, consecutive once uploaded
+    struct Range
+    {
+        uint32_t material;
+        size_t first;
+        size_t count;
+    };
+
+    InstanceBatch();
+    ~InstanceBatch();
+
+    // Remove the instances, keeping the buffer
+    void clear();
+
+    // Add an instance
+    void add(const glm::vec3 &position, const glm::quat &rotation = glm::quat(), float scale = 1.0f,
+             const glm::vec4 &tint = glm::vec4(1.0f), uint32_t material = 0);
+    void add(const InstanceData &instance);
+
+    size_t size() const { return data.size(); }
+    bool empty() const { return data.empty(); }
+    const std::vector<InstanceData> &instances() const { return data; }
+
+    // Group the instances by material and upload them, if they changed since the last upload
+    void upload();
+
+    // Material ranges of the last upload
+    const std::vector<Range> &ranges() const { return materialRanges; }
+
+    // Point the instance attributes of the bound vertex array at the
+    // instances from first on, one element per instance
+    void bindAttributes(size_t first) const;
+
+    // Disable the instance attributes of the bound vertex array again
+    static void unbindAttributes();
+
+    // Delete the buffer
+    void destroy();
+
+private:
+    std::vector<InstanceData> data;
+    std::vector<Range> materialRanges;
+    GLuint buffer;
+    size_t capacity; // Instances the buffer has room for
+    bool changed;
+
+    // Buffers are owned, so they can't be copied
+    InstanceBatch(const InstanceBatch &);
+    InstanceBatch &operator=(const InstanceBatch &);
+};
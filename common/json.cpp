@@ -0,0 +1,342 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "json.hpp"
+
+// Deeper documents are rejected rather than overflowing the stack
+static const int maxDepth = 64;
+
+const JsonValue *JsonValue::find(const char *key) const
+{
+    if (type != JsonObject)
+        return NULL;
+    for (size_t i = 0; i < members.size(); i++)
+        if (members[i].first == key)
+            return &members[i].second;
+    return NULL;
+}
+
+double JsonValue::numberOr(const char *key, double fallback) const
+{
+    const JsonValue *value = find(key);
+    return value && value->type == JsonNumber ? value->number : fallback;
+}
+
+int JsonValue::intOr(const char *key, int fallback) const
+{
+    // Fractions and numbers out of range would be undefined to convert, NaN fails every comparison
+    const JsonValue *value = find(key);
+    if (!value || value->type != JsonNumber || !(value->number >= INT_MIN && value->number <= INT_MAX) ||
+        value->number != floor(value->number))
+        return fallback;
+    return static_cast<int>(value->number);
+}
+
+std::string JsonValue::stringOr(const char *key, const std::string &fallback) const
+{
+    const JsonValue *value = find(key);
+    return value && value->type == JsonString ? value->string : fallback;
+}
+
+struct JsonParser
+{
+    const char *p;
+    const char *begin;
+    const char *end;
+    std::string error;
+
+    bool fail(const char *message)
+    {
+        char position[32];
+        snprintf(position, sizeof(position), " at byte %lu", (unsigned long)(p - begin));
+        error = std::string(message) + position;
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    }
+
+    bool literal(const char *word)
+    {
+        size_t length = strlen(word);
+        if (static_cast<size_t>(end - p) < length || memcmp(p, word, length) != 0)
+            return fail("Unexpected token");
+        p += length;
+        return true;
+    }
+
+    static void appendUtf8(std::string &out, unsigned int code)
+    {
+        if (code < 0x80)
+            out += static_cast<char>(code);
+        else if (code < 0x800)
+        {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else if (code < 0x10000)
+        {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else
+        {
+            out += static_cast<char>(0xf0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool hex4(unsigned int &code)
+    {
+        if (end - p < 4)
+            return fail("Truncated escape");
+        code = 0;
+        for (int i = 0; i < 4; i++, p++)
+        {
+            char c = *p;
+            code <<= 4;
+            if (c >= '0' && c <= '9')
+                code |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                code |= c - 'A' + 10;
+            else
+                return fail("Bad escape");
+        }
+        return true;
+    }
+
+    bool parseString(std::string &out)
+    {
+        // Opening quote already checked
+        p++;
+        out.clear();
+        while (p < end && *p != '"')
+        {
+            if (static_cast<unsigned char>(*p) < 0x20)
+                return fail("Control character in string");
+            if (*p != '\\')
+            {
+                out += *p++;
+                continue;
+            }
+            if (++p >= end)
+                break;
+            char c = *p++;
+            switch (c)
+            {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                unsigned int code = 0;
+                if (!hex4(code))
+                    return false;
+                // A surrogate pair encodes one code point above the basic plane
+                if (code >= 0xd800 && code < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+                {
+                    const char *next = p;
+                    p += 2;
+                    unsigned int low = 0;
+                    if (!hex4(low))
+                        return false;
+                    if (low >= 0xdc00 && low < 0xe000)
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    else
+                        p = next; // Not a pair, read the next escape on its own
+                }
+
+                // Half a pair isn't a character, UTF-8 can't encode it
+                if (code >= 0xd800 && code < 0xe000)
+                    code = 0xfffd;
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                return fail("Bad escape");
+            }
+        }
+        if (p >= end)
+            return fail("Unterminated string");
+        p++;
+        return true;
+    }
+
+    bool parseNumber(double &out)
+    {
+        // strtod would accept hex, inf and nan, so check the JSON grammar first
+        const char *start = p;
+        if (p < end && *p == '-')
+            p++;
+        const char *digits = p;
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+        if (p == digits)
+            return fail("Bad number");
+        if (p < end && *p == '.')
+        {
+            p++;
+            const char *fraction = p;
+            while (p < end && *p >= '0' && *p <= '9')
+                p++;
+            if (p == fraction)
+                return fail("Bad number");
+        }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            if (p < end && (*p == '+' || *p == '-'))
+                p++;
+            const char *exponent = p;
+            while (p < end && *p >= '0' && *p <= '9')
+                p++;
+            if (p == exponent)
+                return fail("Bad number");
+        }
+        // The text may not be null terminated
+        std::string number(start, p);
+        out = strtod(number.c_str(), NULL);
+        return true;
+    }
+
+    bool parseValue(JsonValue &out, int depth)
+    {
+        if (depth > maxDepth)
+            return fail("Nested too deeply");
+        skipSpace();
+        if (p >= end)
+            return fail("Unexpected end");
+
+        switch (*p)
+        {
+        case '{':
+        {
+            out.type = JsonObject;
+            p++;
+            skipSpace();
+            if (p < end && *p == '}')
+            {
+                p++;
+                return true;
+            }
+            for (;;)
+            {
+                skipSpace();
+                if (p >= end || *p != '"')
+                    return fail("Expected a member name");
+                out.members.push_back(std::make_pair(std::string(), JsonValue()));
+                if (!parseString(out.members.back().first))
+                    return false;
+                skipSpace();
+                if (p >= end || *p != ':')
+                    return fail("Expected ':'");
+                p++;
+                if (!parseValue(out.members.back().second, depth + 1))
+                    return false;
+                skipSpace();
+                if (p < end && *p == ',')
+                {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == '}')
+                {
+                    p++;
+                    return true;
+                }
+                return fail("Expected ',' or '}'");
+            }
+        }
+        case '[':
+        {
+            out.type = JsonArray;
+            p++;
+            skipSpace();
+            if (p < end && *p == ']')
+            {
+                p++;
+                return true;
+            }
+            for (;;)
+            {
+                out.items.push_back(JsonValue());
+                if (!parseValue(out.items.back(), depth + 1))
+                    return false;
+                skipSpace();
+                if (p < end && *p == ',')
+                {
+                    p++;
+                    continue;
+                }
+                if (p < end && *p == ']')
+                {
+                    p++;
+                    return true;
+                }
+                return fail("Expected ',' or ']'");
+            }
+        }
+        case '"':
+            out.type = JsonString;
+            return parseString(out.string);
+        case 't':
+            out.type = JsonBool;
+            out.boolean = true;
+            return literal("true");
+        case 'f':
+            out.type = JsonBool;
+            out.boolean = false;
+            return literal("false");
+        case 'n':
+            out.type = JsonNull;
+            return literal("null");
+        default:
+            out.type = JsonNumber;
+            return parseNumber(out.number);
+        }
+    }
+};
+
+bool parseJson(const char *text, size_t length, JsonValue &out, std::string &error)
+{
+    JsonParser parser;
+    parser.p = parser.begin = text;
+    parser.end = text + length;
+    out = JsonValue();
+
+    // Skip a byte order mark
+    if (length >= 3 && memcmp(text, "\xef\xbb\xbf", 3) == 0)
+        parser.p += 3;
+
+    bool ok = parser.parseValue(out, 0);
+    if (ok)
+    {
+        parser.skipSpace();
+        if (parser.p != parser.end)
+            ok = parser.fail("Trailing characters");
+    }
+    if (!ok)
+    {
+        error = parser.error;
+        out = JsonValue();
+    }
+    return ok;
+}
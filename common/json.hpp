@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <stddef.h>
+
+enum JsonType
+{
+    JsonNull,
+    JsonBool,
+    JsonNumber,
+    JsonString,
+    JsonArray,
+    JsonObject
+};
+
+// A parsed JSON document. Objects keep their members in file order
+struct JsonValue
+{
+    JsonType type;
+    bool boolean;
+    double number;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue> > members;
+
+    JsonValue() : type(JsonNull), boolean(false), number(0.0) {}
+
+    // Member of an object, NULL if it is missing or this isn't an object
+    const JsonValue *find(const char *key) const;
+
+    // Value of a member of the given type, or the fallback if it is missing or of another type
+    double numberOr(const char *key, double fallback) const;
+    // Also the fallback for numbers that aren't whole or don't fit in an int
+    int intOr(const char *key, int fallback) const;
+    std::string stringOr(const char *key, const std::string &fallback) const;
+
+    bool isArray() const { return type == JsonArray; }
+    bool isObject() const { return type == JsonObject; }
+    size_t size() const { return items.size(); }
+    const JsonValue &operator[](size_t i) const { return items[i]; }
+};
+
+// Parse a UTF-8 JSON document. Returns false with a message and the byte
+// offset of the problem if it isn't valid
+bool parseJson(const char *text, size_t length, JsonValue &out, std::string &error);
@@ -0,0 +1,143 @@
+#include <vector>
+#include <string.h>
+
+#include "lz_block.hpp"
+
+// Shortest back reference worth encoding, and the furthest one can reach
+static const size_t minMatch = 4;
+static const size_t maxOffset = 65535;
+
+// Positions of recent 4 byte sequences, by hash
+static const int hashBits = 14;
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hashSequence(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - hashBits);
+}
+
+// Lengths of 15 or more continue in bytes of 255 and a final smaller byte
+static uint8_t *writeLength(uint8_t *out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        *out++ = 255;
+    *out++ = static_cast<uint8_t>(length);
+    return out;
+}
+
+// One sequence: a token with both lengths, the literals, then the match if there is one
+static uint8_t *writeSequence(uint8_t *out, const uint8_t *literals, size_t literalLength,
+                              size_t offset, size_t matchLength)
+{
+    size_t matchCode = matchLength > 0 ? matchLength - minMatch : 0;
+    uint8_t *token = out++;
+    *token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4 |
+                                  (matchCode < 15 ? matchCode : 15));
+    if (literalLength >= 15)
+        out = writeLength(out, literalLength - 15);
+    memcpy(out, literals, literalLength);
+    out += literalLength;
+
+    if (matchLength == 0)
+        return out;
+    *out++ = static_cast<uint8_t>(offset & 0xff);
+    *out++ = static_cast<uint8_t>(offset >> 8);
+    if (matchCode >= 15)
+        out = writeLength(out, matchCode - 15);
+    return out;
+}
+
+size_t lzCompressBound(size_t size)
+{
+    // A token and its length bytes for one run of literals
+    return size + size / 255 + 16;
+}
+
+size_t lzCompress(const uint8_t *data, size_t size, uint8_t *out)
+{
+    std::vector<size_t> table(static_cast<size_t>(1) << hashBits, static_cast<size_t>(-1));
+    uint8_t *start = out;
+    size_t position = 0, anchor = 0;
+    while (position + minMatch <= size)
+    {
+        uint32_t sequence = read32(data + position);
+        size_t &slot = table[hashSequence(sequence)];
+        size_t candidate = slot;
+        slot = position;
+        if (candidate == static_cast<size_t>(-1) || position - candidate > maxOffset ||
+            read32(data + candidate) != sequence)
+        {
+            position++;
+            continue;
+        }
+
+        size_t length = minMatch;
+        while (position + length < size && data[candidate + length] == data[position + length])
+            length++;
+        out = writeSequence(out, data + anchor, position - anchor, position - candidate, length);
+        position += length;
+        anchor = position;
+    }
+
+    // The rest is literals, the decoder stops when it runs out of input after them
+    out = writeSequence(out, data + anchor, size - anchor, 0, 0);
+    return static_cast<size_t>(out - start);
+}
+
+// Read the continuation bytes of a length of 15 or more
+static bool readLength(const uint8_t *&in, const uint8_t *end, size_t &length)
+{
+    uint8_t byte;
+    do
+    {
+        if (in >= end)
+            return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool lzDecompress(const uint8_t *data, size_t size, uint8_t *out, size_t outSize)
+{
+    const uint8_t *in = data, *end = data + size;
+    size_t written = 0;
+    while (in < end)
+    {
+        uint8_t token = *in++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(in, end, literalLength))
+            return false;
+        if (literalLength > static_cast<size_t>(end - in) || literalLength > outSize - written)
+            return false;
+        memcpy(out + written, in, literalLength);
+        in += literalLength;
+        written += literalLength;
+        if (in == end)
+            break;
+
+        if (end - in < 2)
+            return false;
+        size_t offset = in[0] | static_cast<size_t>(in[1]) << 8;
+        in += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(in, end, matchLength))
+            return false;
+        matchLength += minMatch;
+        if (offset == 0 || offset > written || matchLength > outSize - written)
+            return false;
+
+        // Byte by byte, a match may overlap the bytes it produces
+        const uint8_t *match = out + written - offset;
+        for (size_t i = 0; i < matchLength; i++)
+            out[written + i] = match[i];
+        written += matchLength;
+    }
+    return written == outSize;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Byte oriented LZ77 compression in the style of LZ4: runs of literals and
+// back references of at least 4 bytes up to 64 KB away. Fast to decode, meant
+// for text and other data with repeats rather than for the best ratio
+
+// Largest output lzCompress can produce for size bytes of input
+size_t lzCompressBound(size_t size);
+
+// Compress size bytes into out, which holds at least lzCompressBound(size)
+// bytes. Returns the compressed size
+size_t lzCompress(const uint8_t *data, size_t size, uint8_t *out);
+
+// Decompress into out, which must be exactly the original size. Returns false
+// if the data is corrupt or doesn't decompress to outSize bytes
+bool lzDecompress(const uint8_t *data, size_t size, uint8_t *out, size_t outSize);
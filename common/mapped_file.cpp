@@ -0,0 +1,139 @@
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_file.hpp"
+
+MappedFile::MappedFile()
+    : buffer(NULL), length(0), opened(false)
+#ifdef _WIN32
+    , fileHandle(NULL), mappingHandle(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char *path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    opened = true;
+
+    // Empty files can't be mapped but are still valid
+    if (length == 0)
+        return true;
+
+    mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle != NULL)
+        buffer = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+    if (buffer == NULL)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (buffer)
+        UnmapViewOfFile(buffer);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+
+    buffer = NULL;
+    length = 0;
+    opened = false;
+    mappingHandle = NULL;
+    fileHandle = NULL;
+}
+
+#else
+
+bool MappedFile::open(const char *path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    opened = true;
+
+    // Empty files can't be mapped but are still valid
+    if (length == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+
+    void *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        length = 0;
+        opened = false;
+        return false;
+    }
+
+    // The file is read front to back, so let the kernel read ahead
+    madvise(mapping, length, MADV_SEQUENTIAL);
+
+    buffer = static_cast<const char *>(mapping);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (buffer)
+        munmap(const_cast<char *>(buffer), length);
+
+    buffer = NULL;
+    length = 0;
+    opened = false;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Map the file at path, returns false if it can't be opened
+    bool open(const char *path);
+
+    // Unmap the file
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char *data() const { return buffer; }
+    size_t size() const { return length; }
+
+private:
+    const char *buffer;
+    size_t length;
+    bool opened;
+#ifdef _WIN32
+    void *fileHandle;
+    void *mappingHandle;
+#endif
+
+    // Mappings are owned, so they can't be copied
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+};
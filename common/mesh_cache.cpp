@@ -0,0 +1,337 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include "mesh_cache.hpp"
+#include "vertex_format.hpp"
+#include "hash.hpp"
+
+// Bump whenever the layout below or the meaning of a stream changes
+static const uint32_t meshCacheVersion = 5;
+static const char meshCacheMagic[4] = { 'M', 'E', 'S', 'H' };
+
+// Streams start on this boundary so they can be read in place
+static const uint64_t streamAlignment = 16;
+
+enum MeshCacheFlags
+{
+    MeshCacheCompact = 1 // Vertices are CompactVertex
+};
+
+struct MeshCacheHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t  sourceModified;
+    uint64_t sourceHash;
+    uint64_t options;
+    uint32_t flags;
+    uint32_t vertexSize;
+    uint32_t vertexCount;
+    uint32_t indexSize;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    uint32_t meshletCount;
+    float    worldPerUv;
+    float    boundsMin[3];
+    float    boundsMax[3];
+    uint64_t verticesOffset;
+    uint64_t indicesOffset;
+    uint64_t lodsOffset;
+    uint64_t meshletsOffset;
+};
+
+MeshData::MeshData()
+    : vertices(NULL), vertexCount(0), vertexSize(0), compact(false), indices(NULL), indexCount(0),
+      indexSize(4), boundsMin(0.0f), boundsMax(0.0f), worldPerUv(1.0f)
+{
+}
+
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + streamAlignment - 1) & ~(streamAlignment - 1);
+}
+
+std::string meshCachePath(const char *sourcePath)
+{
+    return std::string(sourcePath) + ".mesh";
+}
+
+bool hashSourceFile(const char *path, uint64_t &size, uint64_t &hash)
+{
+    VfsFile file;
+    if (!file.open(path))
+        return false;
+
+    size = file.size();
+    hash = hashBytes(file.data(), file.size());
+    return true;
+}
+
+bool statMeshSource(const char *path, MeshSource &source)
+{
+    source.hashed = false;
+    return vfsStat(path, source.size, source.modified);
+}
+
+bool hashMeshSource(const char *path, MeshSource &source)
+{
+    if (!source.hashed)
+        source.hashed = hashSourceFile(path, source.size, source.hash);
+    return source.hashed;
+}
+
+// Check a stream of count elements of elementSize lies inside the file,
+// empty streams at the end aren't written so they may start past it
+static bool streamFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+{
+    if (count == 0)
+        return true;
+    return offset % streamAlignment == 0 && offset <= fileSize &&
+           count <= (fileSize - offset) / elementSize;
+}
+
+// Whether every index refers to a vertex
+template <typename Index>
+static bool indicesInRange(const void *data, uint32_t count, uint32_t vertexCount)
+{
+    const Index *indices = static_cast<const Index *>(data);
+    for (uint32_t i = 0; i < count; i++)
+        if (indices[i] >= vertexCount)
+            return false;
+    return true;
+}
+
+// Record the source's new time in a cache whose source was touched but not
+// changed, so the next load doesn't hash it again
+static void updateSourceTime(const char *cachePath, int64_t modified)
+{
+    FILE *file = fopen(cachePath, "r+b");
+    if (file == NULL)
+        return;
+    if (fseek(file, offsetof(MeshCacheHeader, sourceModified), SEEK_SET) == 0)
+        fwrite(&modified, sizeof(modified), 1, file);
+    fclose(file);
+}
+
+static bool readMeshCache(const char *cachePath, const char *sourcePath, MeshSource *source, MeshData &mesh)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    closeMeshCache(mesh);
+    VfsFile &file = mesh.file;
+    if (!file.open(cachePath))
+        return false;
+
+    MeshCacheHeader header;
+    if (file.size() < sizeof(header))
+    {
+        printf("Mesh cache %s is truncated, rebuilding.\n", cachePath);
+        closeMeshCache(mesh);
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0 ||
+        header.version != meshCacheVersion)
+    {
+        printf("Mesh cache %s is from another version, rebuilding.\n", cachePath);
+        closeMeshCache(mesh);
+        return false;
+    }
+
+    // Same size and time is taken as the same file, anything else is hashed
+    if (source)
+    {
+        bool fresh = header.options == source->options && header.sourceSize == source->size;
+        bool touched = fresh && (source->modified == 0 || header.sourceModified != source->modified);
+        if (touched)
+            fresh = hashMeshSource(sourcePath, *source) && header.sourceHash == source->hash;
+        if (!fresh)
+        {
+            printf("Mesh cache %s is stale, rebuilding.\n", cachePath);
+            closeMeshCache(mesh);
+            return false;
+        }
+        if (touched && source->modified != 0 && !file.inPak())
+            updateSourceTime(cachePath, source->modified);
+        source->hash = header.sourceHash;
+    }
+
+    const bool compact = (header.flags & MeshCacheCompact) != 0;
+    const uint32_t vertexSize = compact ? sizeof(CompactVertex) : sizeof(ModelVertex);
+    const uint64_t fileSize = file.size();
+    bool valid = header.vertexSize == vertexSize && header.lodCount > 0 &&
+                 (header.indexSize == 2 || header.indexSize == 4) &&
+                 (header.indexSize == 4 || header.vertexCount <= 65536) &&
+                 streamFits(header.verticesOffset, header.vertexCount, header.vertexSize, fileSize) &&
+                 streamFits(header.indicesOffset, header.indexCount, header.indexSize, fileSize) &&
+                 streamFits(header.lodsOffset, header.lodCount, sizeof(MeshLod), fileSize) &&
+                 streamFits(header.meshletsOffset, header.meshletCount, sizeof(Meshlet), fileSize);
+    if (!valid)
+    {
+        printf("Mesh cache %s is corrupt, rebuilding.\n", cachePath);
+        closeMeshCache(mesh);
+        return false;
+    }
+
+    // The vertices and indices stay in the mapping until they are uploaded
+    const char *data = file.data();
+    const MeshLod *lods = reinterpret_cast<const MeshLod *>(data + header.lodsOffset);
+    const Meshlet *meshlets = reinterpret_cast<const Meshlet *>(data + header.meshletsOffset);
+    mesh.vertices = data + header.verticesOffset;
+    mesh.vertexCount = header.vertexCount;
+    mesh.vertexSize = header.vertexSize;
+    mesh.compact = compact;
+    mesh.indices = data + header.indicesOffset;
+    mesh.indexCount = header.indexCount;
+    mesh.indexSize = header.indexSize;
+    mesh.lods.assign(lods, lods + header.lodCount);
+    mesh.meshlets.assign(meshlets, meshlets + header.meshletCount);
+    mesh.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    mesh.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    mesh.worldPerUv = header.worldPerUv;
+
+    // Every index must refer to a vertex
+    valid = header.indexSize == 2 ? indicesInRange<uint16_t>(mesh.indices, mesh.indexCount, mesh.vertexCount)
+                                  : indicesInRange<uint32_t>(mesh.indices, mesh.indexCount, mesh.vertexCount);
+
+    // Every level and meshlet must be a range of the indices
+    for (uint32_t i = 0; valid && i < header.lodCount; i++)
+        valid = static_cast<uint64_t>(mesh.lods[i].firstIndex) + mesh.lods[i].indexCount <= header.indexCount;
+    for (uint32_t i = 0; valid && i < header.meshletCount; i++)
+        valid = static_cast<uint64_t>(mesh.meshlets[i].firstIndex) + mesh.meshlets[i].indexCount <= header.indexCount;
+    if (!valid)
+    {
+        printf("Mesh cache %s is corrupt, rebuilding.\n", cachePath);
+        closeMeshCache(mesh);
+        return false;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Mapped mesh cache %s: %u vertices, %u indices in %.2f ms\n", cachePath,
+           header.vertexCount, header.indexCount, seconds * 1000.0);
+    return true;
+}
+
+bool loadMeshCache(const char *cachePath, const char *sourcePath, MeshSource &source, MeshData &mesh)
+{
+    return readMeshCache(cachePath, sourcePath, &source, mesh);
+}
+
+bool loadMeshCache(const char *cachePath, MeshData &mesh)
+{
+    return readMeshCache(cachePath, NULL, NULL, mesh);
+}
+
+void setMeshStreams(MeshData &mesh, const void *vertices, uint32_t vertexCount, uint32_t vertexSize,
+                    const void *indices, uint32_t indexCount, uint32_t indexSize)
+{
+    closeMeshCache(mesh);
+    const size_t vertexBytes = static_cast<size_t>(vertexCount) * vertexSize;
+    const size_t indexBytes = static_cast<size_t>(indexCount) * indexSize;
+    mesh.storage.resize(vertexBytes + indexBytes);
+    if (vertexBytes > 0)
+        memcpy(mesh.storage.data(), vertices, vertexBytes);
+    if (indexBytes > 0)
+        memcpy(mesh.storage.data() + vertexBytes, indices, indexBytes);
+
+    mesh.vertices = mesh.storage.data();
+    mesh.vertexCount = vertexCount;
+    mesh.vertexSize = vertexSize;
+    mesh.indices = mesh.storage.data() + vertexBytes;
+    mesh.indexCount = indexCount;
+    mesh.indexSize = indexSize;
+}
+
+void closeMeshCache(MeshData &mesh)
+{
+    mesh.file.close();
+    std::vector<char>().swap(mesh.storage);
+    mesh.vertices = mesh.indices = NULL;
+    mesh.vertexCount = mesh.indexCount = 0;
+}
+
+static bool writeStream(FILE *file, uint64_t offset, const void *data, size_t bytes)
+{
+    if (bytes == 0)
+        return true;
+    return fseek(file, static_cast<long>(offset), SEEK_SET) == 0 &&
+           fwrite(data, 1, bytes, file) == bytes;
+}
+
+bool saveMeshCache(const char *cachePath, const MeshSource &source, const MeshData &mesh)
+{
+    if (mesh.vertexSize != (mesh.compact ? sizeof(CompactVertex) : sizeof(ModelVertex)) ||
+        (mesh.indexSize != 2 && mesh.indexSize != 4))
+        return false;
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+    header.version = meshCacheVersion;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.sourceHash = source.hash;
+    header.options = source.options;
+    header.flags = mesh.compact ? MeshCacheCompact : 0;
+    header.vertexSize = mesh.vertexSize;
+    header.vertexCount = mesh.vertexCount;
+    header.indexSize = mesh.indexSize;
+    header.indexCount = mesh.indexCount;
+    header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    header.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+    header.worldPerUv = mesh.worldPerUv;
+    for (int i = 0; i < 3; i++)
+    {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+    }
+
+    const size_t vertexBytes = static_cast<size_t>(mesh.vertexCount) * mesh.vertexSize;
+    const size_t indexBytes = static_cast<size_t>(mesh.indexCount) * mesh.indexSize;
+    const size_t lodBytes = mesh.lods.size() * sizeof(MeshLod);
+    const size_t meshletBytes = mesh.meshlets.size() * sizeof(Meshlet);
+    header.verticesOffset = alignUp(sizeof(header));
+    header.indicesOffset = alignUp(header.verticesOffset + vertexBytes);
+    header.lodsOffset = alignUp(header.indicesOffset + indexBytes);
+    header.meshletsOffset = alignUp(header.lodsOffset + lodBytes);
+
+    // Write to a temporary file and rename it so a crash never leaves half a cache
+    std::string tempPath = std::string(cachePath) + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == NULL)
+    {
+        printf("Can't write mesh cache %s.\n", cachePath);
+        return false;
+    }
+
+    bool ok = writeStream(file, 0, &header, sizeof(header)) &&
+              writeStream(file, header.verticesOffset, mesh.vertices, vertexBytes) &&
+              writeStream(file, header.indicesOffset, mesh.indices, indexBytes) &&
+              writeStream(file, header.lodsOffset, mesh.lods.data(), lodBytes) &&
+              writeStream(file, header.meshletsOffset, mesh.meshlets.data(), meshletBytes);
+    ok = fclose(file) == 0 && ok;
+
+    if (ok)
+    {
+        remove(cachePath);
+        ok = rename(tempPath.c_str(), cachePath) == 0;
+    }
+    if (!ok)
+    {
+        remove(tempPath.c_str());
+        printf("Can't write mesh cache %s.\n", cachePath);
+        return false;
+    }
+
+    printf("Wrote mesh cache %s\n", cachePath);
+    return true;
+}
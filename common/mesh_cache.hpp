@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "vfs.hpp"
+#include "meshlet.hpp"
+#include "mesh_simplifier.hpp"
+
+// A mesh ready to draw, as stored in a .mesh cache file: the interleaved
+// vertices and the indices exactly as they are uploaded, and what is needed to
+// cull, pick levels and stream textures. Loaded streams point into the mapped
+// file, built ones into storage, so they are valid until the mesh is closed
+struct MeshData
+{
+    VfsFile file;
+    std::vector<char> storage;
+
+    const void *vertices;         // ModelVertex, or CompactVertex when compact
+    uint32_t vertexCount;
+    uint32_t vertexSize;
+    bool compact;
+    const void *indices;          // Full mesh followed by the simplified levels
+    uint32_t indexCount;
+    uint32_t indexSize;           // 2 or 4 bytes
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets; // Of the full mesh
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    float worldPerUv;
+
+    MeshData();
+};
+
+// The source file a cache is built from and the build options that change it
+struct MeshSource
+{
+    uint64_t size;
+    int64_t modified; // Nanoseconds, 0 when the file has no time (e.g. in a pak)
+    uint64_t hash;    // Content hash, only read when size or time changed
+    bool hashed;
+    uint64_t options;
+
+    MeshSource() : size(0), modified(0), hash(0), hashed(false), options(0) {}
+};
+
+// Cache file used for a source model, e.g. models/ball.obj -> models/ball.obj.mesh
+std::string meshCachePath(const char *sourcePath);
+
+// Size and content hash of a source file, returns false if it can't be read
+bool hashSourceFile(const char *path, uint64_t &size, uint64_t &hash);
+
+// Size and modification time of a source, returns false if it doesn't exist
+bool statMeshSource(const char *path, MeshSource &source);
+
+// Hash the contents of a source unless that's been done already
+bool hashMeshSource(const char *path, MeshSource &source);
+
+// Map a cache file if it was built from this source with these options. A
+// source whose size and time match is taken as unchanged, otherwise its
+// contents are hashed and, if they still match, the cache's time is updated.
+// Returns false if the cache is missing, corrupt, from another version or stale
+bool loadMeshCache(const char *cachePath, const char *sourcePath, MeshSource &source, MeshData &mesh);
+
+// Map a cache file without checking it against a source (used when only the cache is shipped)
+bool loadMeshCache(const char *cachePath, MeshData &mesh);
+
+// Copy the streams of a built mesh into its storage and point it at them
+void setMeshStreams(MeshData &mesh, const void *vertices, uint32_t vertexCount, uint32_t vertexSize,
+                    const void *indices, uint32_t indexCount, uint32_t indexSize);
+
+// Unmap the file or free the storage the streams point into
+void closeMeshCache(MeshData &mesh);
+
+// Write a cache file for a mesh built from a hashed source
+bool saveMeshCache(const char *cachePath, const MeshSource &source, const MeshData &mesh);
@@ -0,0 +1,285 @@
+#include <vector>
+#include <algorithm>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh_optimizer.hpp"
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount,
+                                    unsigned int cacheSize)
+{
+    VertexCacheStats stats = { 0.0, 0.0 };
+    if (indices.empty())
+        return stats;
+
+    // A vertex is in the FIFO if it entered less than cacheSize misses ago
+    std::vector<unsigned int> entered(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    unsigned int misses = 0;
+    size_t usedCount = 0;
+
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        unsigned int v = indices[i];
+        if (entered[v] == 0 || misses - entered[v] >= cacheSize)
+        {
+            misses++;
+            entered[v] = misses;
+        }
+        if (!used[v])
+        {
+            used[v] = true;
+            usedCount++;
+        }
+    }
+
+    stats.acmr = static_cast<double>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<double>(misses) / usedCount;
+    return stats;
+}
+
+// Triangles that use each vertex, stored as one flat list with offsets
+struct VertexAdjacency
+{
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> triangles;
+};
+
+static void buildAdjacency(const std::vector<unsigned int> &indices, size_t vertexCount,
+                           VertexAdjacency &adjacency)
+{
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency.offsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+    std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    adjacency.triangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency.triangles[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+}
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount,
+                         unsigned int cacheSize)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+        return;
+
+    VertexAdjacency adjacency;
+    buildAdjacency(indices, vertexCount, adjacency);
+
+    // Triangles each vertex still has to emit
+    std::vector<unsigned int> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+    // Time each vertex last entered the cache
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    unsigned int cursor = 0;
+    int fanning = 0;
+    while (fanning >= 0)
+    {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (unsigned int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++)
+        {
+            unsigned int t = adjacency.triangles[a];
+            if (emitted[t])
+                continue;
+
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time;
+                    time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // Next fanning vertex: the candidate that stays in cache longest
+        // after its remaining triangles are emitted
+        int next = -1;
+        int best = -1;
+        for (size_t c = 0; c < candidates.size(); c++)
+        {
+            unsigned int v = candidates[c];
+            if (live[v] == 0)
+                continue;
+
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = static_cast<int>(time - cacheTime[v]);
+            if (priority > best)
+            {
+                best = priority;
+                next = static_cast<int>(v);
+            }
+        }
+
+        // Dead end: back up through recently used vertices, then scan forwards
+        while (next < 0 && !deadEnd.empty())
+        {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0)
+                next = static_cast<int>(v);
+        }
+        while (next < 0 && cursor < vertexCount)
+        {
+            if (live[cursor] > 0)
+                next = static_cast<int>(cursor);
+            cursor++;
+        }
+
+        fanning = next;
+    }
+
+    indices.swap(output);
+}
+
+// A run of triangles in a cache-optimized index buffer
+struct TriangleCluster
+{
+    size_t first;
+    size_t count;
+    float sortKey;
+};
+
+static bool drawsBefore(const TriangleCluster &a, const TriangleCluster &b)
+{
+    return a.sortKey > b.sortKey;
+}
+
+void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions,
+                      unsigned int cacheSize)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // Split into clusters where the cache restarts (all three corners miss)
+    std::vector<TriangleCluster> clusters;
+    std::vector<unsigned int> entered(positions.size(), 0);
+    unsigned int misses = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        int triangleMisses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (entered[v] == 0 || misses - entered[v] >= cacheSize)
+            {
+                misses++;
+                entered[v] = misses;
+                triangleMisses++;
+            }
+        }
+
+        if (t == 0 || triangleMisses == 3)
+        {
+            TriangleCluster cluster = { t, 0, 0.0f };
+            clusters.push_back(cluster);
+        }
+        clusters.back().count++;
+    }
+
+    if (clusters.size() < 2)
+        return;
+
+    // Area weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> clusterCentroids(clusters.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusters.size(), glm::vec3(0.0f));
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        float clusterArea = 0.0f;
+        for (size_t t = clusters[c].first; t < clusters[c].first + clusters[c].count; t++)
+        {
+            const glm::vec3 &p0 = positions[indices[t * 3 + 0]];
+            const glm::vec3 &p1 = positions[indices[t * 3 + 1]];
+            const glm::vec3 &p2 = positions[indices[t * 3 + 2]];
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+
+            clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormals[c] += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroids[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f)
+            clusterCentroids[c] /= clusterArea;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters on the outside facing away from the centre occlude the rest, so draw them first
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        float length = glm::length(clusterNormals[c]);
+        glm::vec3 direction = length > 0.0f ? clusterNormals[c] / length : glm::vec3(0.0f);
+        clusters[c].sortKey = glm::dot(clusterCentroids[c] - meshCentroid, direction);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), drawsBefore);
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (size_t c = 0; c < clusters.size(); c++)
+        output.insert(output.end(),
+                      indices.begin() + clusters[c].first * 3,
+                      indices.begin() + (clusters[c].first + clusters[c].count) * 3);
+    indices.swap(output);
+}
+
+template <typename T>
+static void remapStream(std::vector<T> &stream, const std::vector<unsigned int> &remap, size_t newCount)
+{
+    std::vector<T> reordered(newCount);
+    for (size_t v = 0; v < stream.size(); v++)
+    {
+        if (remap[v] != 0xFFFFFFFFu)
+            reordered[remap[v]] = stream[v];
+    }
+    stream.swap(reordered);
+}
+
+void optimizeVertexFetch(std::vector<unsigned int> &indices,
+                         std::vector<glm::vec3> &positions,
+                         std::vector<glm::vec2> &uvs,
+                         std::vector<glm::vec3> &normals)
+{
+    const unsigned int unused = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(positions.size(), unused);
+    unsigned int next = 0;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        unsigned int &target = remap[indices[i]];
+        if (target == unused)
+            target = next++;
+        indices[i] = target;
+    }
+
+    remapStream(positions, remap, next);
+    remapStream(uvs, remap, next);
+    remapStream(normals, remap, next);
+}
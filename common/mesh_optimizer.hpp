@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Post-transform cache size assumed by the optimizer and the statistics
+const unsigned int vertexCacheSize = 16;
+
+// Efficiency of an index buffer with a FIFO post-transform cache
+struct VertexCacheStats
+{
+    double acmr; // Average cache misses per triangle (0.5 is ideal, 3 is worst)
+    double atvr; // Average transforms per vertex (1 is ideal)
+};
+
+// Simulate a FIFO post-transform cache over an index buffer
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount,
+                                    unsigned int cacheSize = vertexCacheSize);
+
+// Reorder triangles for post-transform cache locality (Tipsify, Sander et al. 2007)
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount,
+                         unsigned int cacheSize = vertexCacheSize);
+
+// Reorder the clusters of a cache-optimized index buffer so outward facing
+// clusters draw first, lowering overdraw while keeping most of the cache gain
+void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions,
+                      unsigned int cacheSize = vertexCacheSize);
+
+// Renumber vertices in the order the index buffer first uses them, so vertex
+// fetch walks memory forwards. Unreferenced vertices are dropped
+void optimizeVertexFetch(std::vector<unsigned int> &indices,
+                         std::vector<glm::vec3> &positions,
+                         std::vector<glm::vec2> &uvs,
+                         std::vector<glm::vec3> &normals);
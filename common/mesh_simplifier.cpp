@@ -0,0 +1,472 @@
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+
+// Open edges are kept much stiffer than the surface so borders and seams stay put
+static const double borderWeight = 10.0;
+
+// Levels with fewer triangles than this aren't worth drawing separately
+static const size_t minLodTriangles = 32;
+
+// Weighted sum of squared distances to a set of planes, v'Av + 2b.v + c
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+};
+
+static void addPlane(Quadric &q, const glm::vec3 &normal, float distance, double weight)
+{
+    const double x = normal.x, y = normal.y, z = normal.z, d = distance;
+    q.a00 += weight * x * x;
+    q.a01 += weight * x * y;
+    q.a02 += weight * x * z;
+    q.a11 += weight * y * y;
+    q.a12 += weight * y * z;
+    q.a22 += weight * z * z;
+    q.b0 += weight * x * d;
+    q.b1 += weight * y * d;
+    q.b2 += weight * z * d;
+    q.c += weight * d * d;
+    q.weight += weight;
+}
+
+static void addQuadric(Quadric &q, const Quadric &r)
+{
+    q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02;
+    q.a11 += r.a11; q.a12 += r.a12; q.a22 += r.a22;
+    q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+    q.c += r.c;
+    q.weight += r.weight;
+}
+
+// Mean squared distance to the planes
+static double quadricError(const Quadric &q, const glm::vec3 &v)
+{
+    const double x = v.x, y = v.y, z = v.z;
+    double error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+                   2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+                   2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return error > 0.0 && q.weight > 0.0 ? error / q.weight : 0.0;
+}
+
+// Orders vertex ids by position so equal positions end up next to each other
+struct PositionLess
+{
+    const std::vector<glm::vec3> *positions;
+
+    bool operator()(unsigned int a, unsigned int b) const
+    {
+        const glm::vec3 &pa = (*positions)[a];
+        const glm::vec3 &pb = (*positions)[b];
+        if (pa.x != pb.x)
+            return pa.x < pb.x;
+        if (pa.y != pb.y)
+            return pa.y < pb.y;
+        return pa.z < pb.z;
+    }
+};
+
+// Flat lists of items grouped by key, group k is items[offsets[k]..offsets[k+1])
+struct Groups
+{
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> items;
+};
+
+// Group the triangles of an index buffer by the vertices they use
+static void groupTriangles(const std::vector<unsigned int> &indices, size_t vertexCount, Groups &groups)
+{
+    groups.offsets.assign(vertexCount + 1, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+        groups.offsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        groups.offsets[v + 1] += groups.offsets[v];
+
+    std::vector<unsigned int> fill(groups.offsets.begin(), groups.offsets.end() - 1);
+    groups.items.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+        groups.items[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+}
+
+static uint64_t edgeKey(unsigned int a, unsigned int b)
+{
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+static bool hasKey(const std::vector<uint64_t> &sortedKeys, uint64_t key)
+{
+    return std::binary_search(sortedKeys.begin(), sortedKeys.end(), key);
+}
+
+// How far a position may move
+enum PositionKind
+{
+    PositionManifold, // Collapses onto any neighbour
+    PositionBorder,   // Collapses only along the open border it lies on
+    PositionLocked    // Shared by more than two triangles along an edge, never moves
+};
+
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+static bool cheaper(const Collapse &a, const Collapse &b)
+{
+    return a.cost < b.cost;
+}
+
+float simplifyMesh(const std::vector<unsigned int> &indices,
+                   const std::vector<glm::vec3> &positions,
+                   size_t targetIndexCount,
+                   std::vector<unsigned int> &outIndices)
+{
+    const size_t vertexCount = positions.size();
+
+    // Vertices split across a uv or normal seam share a position, pick one id per position
+    std::vector<unsigned int> positionOf(vertexCount);
+    {
+        std::vector<unsigned int> order(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            order[v] = static_cast<unsigned int>(v);
+        PositionLess less = { &positions };
+        std::sort(order.begin(), order.end(), less);
+        for (size_t i = 0; i < vertexCount; i++)
+            positionOf[order[i]] = (i > 0 && !less(order[i - 1], order[i])) ? positionOf[order[i - 1]] : order[i];
+    }
+
+    // Triangles that are already degenerate draw nothing, drop them
+    outIndices.clear();
+    outIndices.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        unsigned int p0 = positionOf[indices[i]], p1 = positionOf[indices[i + 1]], p2 = positionOf[indices[i + 2]];
+        if (p0 != p1 && p1 != p2 && p2 != p0)
+            outIndices.insert(outIndices.end(), indices.begin() + i, indices.begin() + i + 3);
+    }
+    if (outIndices.size() <= targetIndexCount)
+        return 0.0f;
+
+    // Wedges, the vertices that share each position
+    Groups wedges;
+    wedges.offsets.assign(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        wedges.offsets[positionOf[v] + 1]++;
+    for (size_t p = 0; p < vertexCount; p++)
+        wedges.offsets[p + 1] += wedges.offsets[p];
+    {
+        std::vector<unsigned int> fill(wedges.offsets.begin(), wedges.offsets.end() - 1);
+        wedges.items.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            wedges.items[fill[positionOf[v]]++] = static_cast<unsigned int>(v);
+    }
+
+    // Directed edges, between vertices and between positions
+    std::vector<uint64_t> vertexEdges, positionEdges;
+    vertexEdges.reserve(outIndices.size());
+    positionEdges.reserve(outIndices.size());
+    for (size_t i = 0; i < outIndices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = outIndices[i + k], b = outIndices[i + (k + 1) % 3];
+            vertexEdges.push_back(edgeKey(a, b));
+            positionEdges.push_back(edgeKey(positionOf[a], positionOf[b]));
+        }
+    }
+    std::sort(vertexEdges.begin(), vertexEdges.end());
+    std::sort(positionEdges.begin(), positionEdges.end());
+
+    // Planes of the triangles, plus planes through the open edges (borders and seams)
+    Quadric zero = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    std::vector<Quadric> quadrics(vertexCount, zero);
+    for (size_t i = 0; i < outIndices.size(); i += 3)
+    {
+        const glm::vec3 &p0 = positions[outIndices[i + 0]];
+        const glm::vec3 &p1 = positions[outIndices[i + 1]];
+        const glm::vec3 &p2 = positions[outIndices[i + 2]];
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length == 0.0f)
+            continue;
+        normal /= length;
+
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = outIndices[i + k], b = outIndices[i + (k + 1) % 3];
+            addPlane(quadrics[positionOf[a]], normal, -glm::dot(normal, p0), 1.0);
+
+            if (!hasKey(vertexEdges, edgeKey(b, a)))
+            {
+                glm::vec3 edge = positions[b] - positions[a];
+                glm::vec3 side = glm::cross(edge, normal);
+                float sideLength = glm::length(side);
+                if (sideLength == 0.0f)
+                    continue;
+                side /= sideLength;
+                addPlane(quadrics[positionOf[a]], side, -glm::dot(side, positions[a]), borderWeight);
+                addPlane(quadrics[positionOf[b]], side, -glm::dot(side, positions[a]), borderWeight);
+            }
+        }
+    }
+
+    // Open borders between positions, and positions on non-manifold edges
+    std::vector<unsigned char> kinds(vertexCount, PositionManifold);
+    std::vector<uint64_t> borderEdges;
+    for (size_t e = 0; e < positionEdges.size();)
+    {
+        size_t end = e;
+        while (end < positionEdges.size() && positionEdges[end] == positionEdges[e])
+            end++;
+
+        unsigned int a = static_cast<unsigned int>(positionEdges[e] >> 32);
+        unsigned int b = static_cast<unsigned int>(positionEdges[e]);
+        std::vector<uint64_t>::const_iterator reverse =
+            std::lower_bound(positionEdges.begin(), positionEdges.end(), edgeKey(b, a));
+        size_t reverseCount = 0;
+        while (reverse != positionEdges.end() && *reverse == edgeKey(b, a))
+        {
+            reverseCount++;
+            ++reverse;
+        }
+
+        if (end - e > 1 || reverseCount > 1)
+        {
+            kinds[a] = kinds[b] = PositionLocked;
+        }
+        else if (reverseCount == 0)
+        {
+            kinds[a] = std::max<unsigned char>(kinds[a], PositionBorder);
+            kinds[b] = std::max<unsigned char>(kinds[b], PositionBorder);
+            borderEdges.push_back(edgeKey(std::min(a, b), std::max(a, b)));
+        }
+        e = end;
+    }
+    std::sort(borderEdges.begin(), borderEdges.end());
+
+    double maxError = 0.0;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<unsigned int> wedgeTarget(vertexCount);
+    std::vector<unsigned char> locked(vertexCount);
+    std::vector<uint64_t> edges;
+    std::vector<Collapse> collapses;
+    Groups triangles;
+
+    // Each pass collapses the cheapest edges that don't touch each other
+    while (outIndices.size() > targetIndexCount)
+    {
+        groupTriangles(outIndices, vertexCount, triangles);
+
+        // Undirected edges between positions
+        edges.clear();
+        for (size_t i = 0; i < outIndices.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = positionOf[outIndices[i + k]];
+                unsigned int b = positionOf[outIndices[i + (k + 1) % 3]];
+                edges.push_back(edgeKey(std::min(a, b), std::max(a, b)));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        // Cheapest allowed direction of every edge
+        collapses.clear();
+        for (size_t e = 0; e < edges.size(); e++)
+        {
+            unsigned int a = static_cast<unsigned int>(edges[e] >> 32);
+            unsigned int b = static_cast<unsigned int>(edges[e]);
+            bool alongBorder = hasKey(borderEdges, edges[e]);
+
+            Quadric sum = quadrics[a];
+            addQuadric(sum, quadrics[b]);
+
+            Collapse best = { 0, 0, -1.0 };
+            if (kinds[a] == PositionManifold || (kinds[a] == PositionBorder && alongBorder))
+            {
+                Collapse collapse = { a, b, quadricError(sum, positions[b]) };
+                best = collapse;
+            }
+            if (kinds[b] == PositionManifold || (kinds[b] == PositionBorder && alongBorder))
+            {
+                Collapse collapse = { b, a, quadricError(sum, positions[a]) };
+                if (best.cost < 0.0 || collapse.cost < best.cost)
+                    best = collapse;
+            }
+            if (best.cost >= 0.0)
+                collapses.push_back(best);
+        }
+        std::sort(collapses.begin(), collapses.end(), cheaper);
+
+        for (size_t v = 0; v < vertexCount; v++)
+            remap[v] = static_cast<unsigned int>(v);
+        std::fill(locked.begin(), locked.end(), 0);
+
+        size_t removedIndices = 0;
+        size_t collapsed = 0;
+        for (size_t c = 0; c < collapses.size(); c++)
+        {
+            if (outIndices.size() - removedIndices <= targetIndexCount)
+                break;
+
+            const Collapse &collapse = collapses[c];
+            if (locked[collapse.from] || locked[collapse.to])
+                continue;
+
+            // Every wedge needs a wedge on the other end to merge into, so
+            // seams only collapse along themselves, and no triangle may flip
+            bool valid = true;
+            size_t removed = 0;
+            for (unsigned int w = wedges.offsets[collapse.from]; valid && w < wedges.offsets[collapse.from + 1]; w++)
+            {
+                unsigned int wedge = wedges.items[w];
+                wedgeTarget[wedge] = wedge;
+                for (unsigned int t = triangles.offsets[wedge]; t < triangles.offsets[wedge + 1]; t++)
+                {
+                    const unsigned int *corners = &outIndices[triangles.items[t] * 3];
+                    int shared = -1;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        if (positionOf[corners[k]] == collapse.to)
+                            shared = k;
+                    }
+
+                    if (shared >= 0)
+                    {
+                        wedgeTarget[wedge] = corners[shared];
+                        removed += 3;
+                        continue;
+                    }
+
+                    glm::vec3 p[3], moved[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        p[k] = positions[corners[k]];
+                        moved[k] = corners[k] == wedge ? positions[collapse.to] : p[k];
+                    }
+                    glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                    if (glm::dot(before, before) > 0.0f && glm::dot(before, after) <= 0.0f)
+                    {
+                        valid = false;
+                        break;
+                    }
+                }
+
+                if (triangles.offsets[wedge] != triangles.offsets[wedge + 1] && wedgeTarget[wedge] == wedge)
+                    valid = false;
+            }
+            if (!valid)
+                continue;
+
+            for (unsigned int w = wedges.offsets[collapse.from]; w < wedges.offsets[collapse.from + 1]; w++)
+            {
+                unsigned int wedge = wedges.items[w];
+                remap[wedge] = wedgeTarget[wedge];
+
+                // The neighbourhood changes shape, leave it alone until the next pass
+                for (unsigned int t = triangles.offsets[wedge]; t < triangles.offsets[wedge + 1]; t++)
+                {
+                    const unsigned int *corners = &outIndices[triangles.items[t] * 3];
+                    for (int k = 0; k < 3; k++)
+                        locked[positionOf[corners[k]]] = 1;
+                }
+            }
+            locked[collapse.from] = locked[collapse.to] = 1;
+
+            addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            maxError = std::max(maxError, collapse.cost);
+            removedIndices += removed;
+            collapsed++;
+        }
+
+        if (collapsed == 0)
+            break;
+
+        // Move the collapsed corners and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i < outIndices.size(); i += 3)
+        {
+            unsigned int a = remap[outIndices[i]], b = remap[outIndices[i + 1]], c = remap[outIndices[i + 2]];
+            if (positionOf[a] == positionOf[b] || positionOf[b] == positionOf[c] || positionOf[c] == positionOf[a])
+                continue;
+            outIndices[write++] = a;
+            outIndices[write++] = b;
+            outIndices[write++] = c;
+        }
+        outIndices.resize(write);
+    }
+
+    return static_cast<float>(sqrt(maxError));
+}
+
+void buildLodChain(const std::vector<unsigned int> &indices,
+                   const std::vector<glm::vec3> &positions,
+                   unsigned int maxLods,
+                   std::vector<unsigned int> &outLodIndices,
+                   std::vector<MeshLod> &outLods)
+{
+    outLodIndices.clear();
+    outLods.clear();
+
+    MeshLod full = { 0, static_cast<unsigned int>(indices.size()), 0.0f };
+    outLods.push_back(full);
+
+    // Each level is simplified from the previous one, so the errors add up
+    std::vector<unsigned int> source(indices);
+    std::vector<unsigned int> simplified;
+    float error = 0.0f;
+    while (outLods.size() < maxLods)
+    {
+        size_t targetIndexCount = source.size() / 6 * 3;
+        if (targetIndexCount < minLodTriangles * 3)
+            break;
+
+        error += simplifyMesh(source, positions, targetIndexCount, simplified);
+
+        // Stop when the mesh is locked up by borders and seams
+        if (simplified.size() > source.size() * 3 / 4)
+            break;
+
+        optimizeVertexCache(simplified, positions.size());
+
+        MeshLod lod = { static_cast<unsigned int>(indices.size() + outLodIndices.size()),
+                        static_cast<unsigned int>(simplified.size()), error };
+        outLods.push_back(lod);
+        outLodIndices.insert(outLodIndices.end(), simplified.begin(), simplified.end());
+        source.swap(simplified);
+    }
+}
+
+unsigned int selectLod(const std::vector<MeshLod> &lods, float distance,
+                       float fovY, float viewportHeight, float maxPixelError)
+{
+    if (lods.empty() || distance <= 0.0f)
+        return 0;
+
+    // Pixels covered by one model unit at that distance
+    float pixelsPerUnit = viewportHeight / (2.0f * tanf(fovY * 0.5f) * distance);
+
+    // Errors grow with each level, so take the last one that is still small enough
+    unsigned int lod = 0;
+    for (unsigned int l = 1; l < lods.size(); l++)
+    {
+        if (lods[l].error * pixelsPerUnit > maxPixelError)
+            break;
+        lod = l;
+    }
+    return lod;
+}
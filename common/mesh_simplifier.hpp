@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// One level of detail: a range of the combined index buffer over the shared vertices
+struct MeshLod
+{
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error; // Largest distance the surface moved from the full mesh, in model units
+};
+
+// Simplify an index buffer by collapsing edges with the lowest quadric error
+// until at most targetIndexCount indices are left (or nothing can collapse).
+// Vertices are only merged into existing vertices, so the vertex buffer is
+// shared with the source. Open borders and uv/normal seams only collapse
+// along themselves. Returns the error of the result in model units
+float simplifyMesh(const std::vector<unsigned int> &indices,
+                   const std::vector<glm::vec3> &positions,
+                   size_t targetIndexCount,
+                   std::vector<unsigned int> &outIndices);
+
+// Build up to maxLods levels, each about half the triangles of the previous.
+// Level 0 is the source indices, the others are appended to outLodIndices
+// with firstIndex counted from the end of the source indices
+void buildLodChain(const std::vector<unsigned int> &indices,
+                   const std::vector<glm::vec3> &positions,
+                   unsigned int maxLods,
+                   std::vector<unsigned int> &outLodIndices,
+                   std::vector<MeshLod> &outLods);
+
+// Pick the coarsest level whose error projects to at most maxPixelError pixels
+// when the nearest point of the mesh is distance away (in model units), seen
+// with a vertical field of view (radians) on a viewport viewportHeight pixels tall
+unsigned int selectLod(const std::vector<MeshLod> &lods, float distance,
+                       float fovY, float viewportHeight, float maxPixelError);
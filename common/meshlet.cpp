@@ -0,0 +1,163 @@
+#include <vector>
+#include <math.h>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "meshlet.hpp"
+
+// Bounding sphere and normal cone of the triangles in a meshlet
+static void computeMeshletBounds(Meshlet &meshlet,
+                                 const std::vector<unsigned int> &indices,
+                                 const std::vector<glm::vec3> &positions)
+{
+    const unsigned int first = meshlet.firstIndex;
+    const unsigned int last = meshlet.firstIndex + meshlet.indexCount;
+
+    // Sphere around the centre of the bounding box
+    glm::vec3 boxMin = positions[indices[first]];
+    glm::vec3 boxMax = boxMin;
+    for (unsigned int i = first + 1; i < last; i++)
+    {
+        boxMin = glm::min(boxMin, positions[indices[i]]);
+        boxMax = glm::max(boxMax, positions[indices[i]]);
+    }
+    meshlet.center = (boxMin + boxMax) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (unsigned int i = first; i < last; i++)
+        meshlet.radius = glm::max(meshlet.radius, glm::length(positions[indices[i]] - meshlet.center));
+
+    // Average the triangle normals, degenerate triangles face nowhere
+    std::vector<glm::vec3> triangleNormals;
+    triangleNormals.reserve(meshlet.indexCount / 3);
+    glm::vec3 axis(0.0f);
+    for (unsigned int i = first; i < last; i += 3)
+    {
+        const glm::vec3 &p0 = positions[indices[i + 0]];
+        const glm::vec3 &p1 = positions[indices[i + 1]];
+        const glm::vec3 &p2 = positions[indices[i + 2]];
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            triangleNormals.push_back(normal / length);
+            axis += normal / length;
+        }
+    }
+
+    // A cluster that faces every way can never be backface culled
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    float axisLength = glm::length(axis);
+    if (triangleNormals.empty() || axisLength == 0.0f)
+        return;
+    axis /= axisLength;
+
+    // Widest angle between the axis and a triangle normal
+    float minDot = 1.0f;
+    for (size_t t = 0; t < triangleNormals.size(); t++)
+        minDot = glm::min(minDot, glm::dot(axis, triangleNormals[t]));
+    if (minDot <= 0.0f)
+        return;
+
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// Vertices of triangle i that aren't in the meshlet yet, repeats counted once
+static unsigned int countNewVertices(const std::vector<unsigned int> &indices, size_t i,
+                                     const std::vector<unsigned int> &vertexMeshlet,
+                                     unsigned int meshletIndex)
+{
+    const unsigned int a = indices[i + 0], b = indices[i + 1], c = indices[i + 2];
+    unsigned int count = 0;
+    if (vertexMeshlet[a] != meshletIndex)
+        count++;
+    if (vertexMeshlet[b] != meshletIndex && b != a)
+        count++;
+    if (vertexMeshlet[c] != meshletIndex && c != a && c != b)
+        count++;
+    return count;
+}
+
+void buildMeshlets(const std::vector<unsigned int> &indices,
+                   const std::vector<glm::vec3> &positions,
+                   std::vector<Meshlet> &outMeshlets)
+{
+    outMeshlets.clear();
+    if (indices.size() < 3)
+        return;
+
+    // Last meshlet each vertex was added to, so membership checks are O(1)
+    std::vector<unsigned int> vertexMeshlet(positions.size(), 0xFFFFFFFFu);
+
+    Meshlet current = { 0, 0, 0, glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), 1.0f };
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        unsigned int meshletIndex = static_cast<unsigned int>(outMeshlets.size());
+        unsigned int newVertices = countNewVertices(indices, i, vertexMeshlet, meshletIndex);
+
+        // Close the meshlet when this triangle doesn't fit and start the next one with it
+        if (current.vertexCount + newVertices > meshletMaxVertices ||
+            current.indexCount / 3 + 1 > meshletMaxTriangles)
+        {
+            computeMeshletBounds(current, indices, positions);
+            outMeshlets.push_back(current);
+
+            current.firstIndex = static_cast<unsigned int>(i);
+            current.indexCount = 0;
+            current.vertexCount = 0;
+            meshletIndex++;
+            newVertices = countNewVertices(indices, i, vertexMeshlet, meshletIndex);
+        }
+
+        for (int k = 0; k < 3; k++)
+            vertexMeshlet[indices[i + k]] = meshletIndex;
+        current.vertexCount += newVertices;
+        current.indexCount += 3;
+    }
+
+    computeMeshletBounds(current, indices, positions);
+    outMeshlets.push_back(current);
+}
+
+Frustum extractFrustum(const glm::mat4 &modelViewProjection)
+{
+    // Rows of the matrix (glm is column major)
+    const glm::mat4 &m = modelViewProjection;
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; r++)
+        rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+
+    // Left, right, bottom, top, near, far
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    // Normalize so plane distances are real distances
+    for (int p = 0; p < 6; p++)
+    {
+        float length = glm::length(glm::vec3(frustum.planes[p]));
+        if (length > 0.0f)
+            frustum.planes[p] /= length;
+    }
+    return frustum;
+}
+
+bool cullMeshlet(const Meshlet &meshlet, const Frustum &frustum, const glm::vec3 &cameraPosition)
+{
+    // Sphere entirely behind one of the planes
+    for (int p = 0; p < 6; p++)
+    {
+        if (glm::dot(glm::vec3(frustum.planes[p]), meshlet.center) + frustum.planes[p].w < -meshlet.radius)
+            return true;
+    }
+
+    // Camera inside the back side of the normal cone, for every point of the sphere
+    glm::vec3 toCenter = meshlet.center - cameraPosition;
+    return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Meshlet size limits, small enough for a cluster to be culled as one unit
+const unsigned int meshletMaxVertices = 64;
+const unsigned int meshletMaxTriangles = 124;
+
+// A run of consecutive triangles in an index buffer with its culling bounds
+struct Meshlet
+{
+    unsigned int firstIndex;   // First index of the run in the index buffer
+    unsigned int indexCount;   // Three per triangle
+    unsigned int vertexCount;  // Unique vertices used by the run
+    glm::vec3 center;          // Bounding sphere
+    float radius;
+    glm::vec3 coneAxis;        // Average facing of the triangles
+    float coneCutoff;          // Sine of the cone's half angle, 1 if the cluster can't be backface culled
+};
+
+// Split an index buffer into meshlets without reordering it. Triangles that
+// share vertices should already be close together (see optimizeVertexCache)
+void buildMeshlets(const std::vector<unsigned int> &indices,
+                   const std::vector<glm::vec3> &positions,
+                   std::vector<Meshlet> &outMeshlets);
+
+// Planes of a view frustum in the space a matrix maps to clip space
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+// Extract the frustum planes of a model-view-projection matrix, in model space
+Frustum extractFrustum(const glm::mat4 &modelViewProjection);
+
+// True if a meshlet is entirely outside the frustum, or every triangle in it
+// faces away from a camera at cameraPosition (both in model space)
+bool cullMeshlet(const Meshlet &meshlet, const Frustum &frustum, const glm::vec3 &cameraPosition);
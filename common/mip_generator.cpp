@@ -0,0 +1,307 @@
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_SSE2 1
+#endif
+
+#include "mip_generator.hpp"
+#include "thread_pool.hpp"
+
+// Rows per task, small enough to balance the threads on the lower levels
+static const int bandRows = 16;
+
+// sRGB decode for every 8-bit value
+static const float *srgbToLinearTable()
+{
+    struct Table
+    {
+        float values[256];
+        Table()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                values[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+            }
+        }
+    };
+    static const Table table;
+    return table.values;
+}
+
+// sRGB encode sampled at 4096 linear steps, fine enough for 8-bit output
+static const uint8_t *linearToSrgbTable()
+{
+    struct Table
+    {
+        uint8_t values[4096];
+        Table()
+        {
+            for (int i = 0; i < 4096; i++)
+            {
+                float l = i / 4095.0f;
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+                values[i] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+            }
+        }
+    };
+    static const Table table;
+    return table.values;
+}
+
+static inline float saturate(float v)
+{
+    return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+}
+
+// Texels are kept as 4 floats while filtering, whatever the channel count
+typedef std::vector<float> FloatImage;
+
+static void averageBox(const FloatImage &source, int width, int height,
+                       FloatImage &out, int outWidth, int y)
+{
+    int y0 = 2 * y < height ? 2 * y : height - 1, y1 = 2 * y + 1 < height ? 2 * y + 1 : height - 1;
+    const float *row0 = &source[static_cast<size_t>(y0) * width * 4];
+    const float *row1 = &source[static_cast<size_t>(y1) * width * 4];
+    float *dst = &out[static_cast<size_t>(y) * outWidth * 4];
+    for (int x = 0; x < outWidth; x++)
+    {
+        int x0 = 2 * x < width ? 2 * x : width - 1, x1 = 2 * x + 1 < width ? 2 * x + 1 : width - 1;
+#ifdef MIP_SSE2
+        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0 * 4), _mm_loadu_ps(row0 + x1 * 4)),
+                                _mm_add_ps(_mm_loadu_ps(row1 + x0 * 4), _mm_loadu_ps(row1 + x1 * 4)));
+        _mm_storeu_ps(dst + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+        for (int c = 0; c < 4; c++)
+            dst[x * 4 + c] = 0.25f * (row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c]);
+#endif
+    }
+}
+
+// Zeroth order modified Bessel function of the first kind
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Weights of the 6 source texels around an output texel, at distances -2.5 to 2.5
+static const float *kaiserWeights()
+{
+    struct Table
+    {
+        float values[6];
+        Table()
+        {
+            const double alpha = 4.0, radius = 3.0, pi = 3.14159265358979323846;
+            double total = 0.0;
+            for (int i = 0; i < 6; i++)
+            {
+                double d = i - 2.5;
+                double x = pi * d * 0.5;
+                double sinc = sin(x) / x;
+                double t = d / radius;
+                double window = besselI0(alpha * sqrt(1.0 - t * t)) / besselI0(alpha);
+                values[i] = static_cast<float>(sinc * window);
+                total += values[i];
+            }
+            for (int i = 0; i < 6; i++)
+                values[i] = static_cast<float>(values[i] / total);
+        }
+    };
+    static const Table table;
+    return table.values;
+}
+
+// One output texel from 6 texels spaced by stride, clamped at the edges. A
+// dimension that is already 1 is copied
+static inline void filterKaiser(const float *line, int length, int stride, int outIndex, float *dst)
+{
+    const float *weights = kaiserWeights();
+#ifdef MIP_SSE2
+    __m128 sum = _mm_setzero_ps();
+#else
+    float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+#endif
+    for (int i = 0; i < 6; i++)
+    {
+        int s = length == 1 ? 0 : 2 * outIndex - 2 + i;
+        s = s < 0 ? 0 : (s >= length ? length - 1 : s);
+        const float *texel = line + static_cast<size_t>(s) * stride;
+#ifdef MIP_SSE2
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(weights[i])));
+#else
+        for (int c = 0; c < 4; c++)
+            sum[c] += texel[c] * weights[i];
+#endif
+    }
+#ifdef MIP_SSE2
+    _mm_storeu_ps(dst, sum);
+#else
+    memcpy(dst, sum, sizeof(sum));
+#endif
+}
+
+// Fraction of texels that pass the alpha test when alpha is scaled
+static float alphaCoverage(const FloatImage &image, float cutoff, float scale)
+{
+    size_t texels = image.size() / 4, passed = 0;
+    for (size_t t = 0; t < texels; t++)
+        passed += image[t * 4 + 3] * scale >= cutoff ? 1 : 0;
+    return static_cast<float>(passed) / static_cast<float>(texels);
+}
+
+// Alpha scale that gives a level the coverage of the top level
+static float coverageScale(const FloatImage &image, float cutoff, float targetCoverage)
+{
+    // Coverage grows with the scale, so bisect on it
+    float lo = 0.0f, hi = 4.0f;
+    for (int iteration = 0; iteration < 16; iteration++)
+    {
+        float mid = 0.5f * (lo + hi);
+        if (alphaCoverage(image, cutoff, mid) < targetCoverage)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    // Coverage moves in steps on small levels, take the side closer to the target
+    float below = targetCoverage - alphaCoverage(image, cutoff, lo);
+    float above = alphaCoverage(image, cutoff, hi) - targetCoverage;
+    return below < above ? lo : hi;
+}
+
+void generateMips(const uint8_t *pixels, int width, int height, int channels,
+                  const MipOptions &options, std::vector<MipLevel> &outLevels,
+                  unsigned int threadCount)
+{
+    unsigned int threads = threadCount == 0 ? ThreadPool::hardwareThreads() : threadCount;
+    ThreadPool *pool = threads > 1 ? &ThreadPool::shared() : NULL;
+
+    // Run task(y) for every row, bands of rows are spread over the threads
+    std::function<void(int, const std::function<void(int)> &)> forEachRow =
+        [pool, threads](int rows, const std::function<void(int)> &task)
+        {
+            std::function<void(size_t)> band = [rows, &task](size_t b)
+            {
+                int end = static_cast<int>(b + 1) * bandRows < rows ? static_cast<int>(b + 1) * bandRows : rows;
+                for (int y = static_cast<int>(b) * bandRows; y < end; y++)
+                    task(y);
+            };
+            size_t bands = (rows + bandRows - 1) / bandRows;
+            if (pool)
+                pool->parallelFor(bands, band, threads);
+            else
+                for (size_t b = 0; b < bands; b++)
+                    band(b);
+        };
+
+    // Only colour is sRGB, single channel and alpha data is linear
+    const bool srgb = options.srgb && channels >= 3;
+    const float *toLinear = srgbToLinearTable();
+    const uint8_t *toSrgb = linearToSrgbTable();
+
+    FloatImage current(static_cast<size_t>(width) * height * 4);
+    forEachRow(height, [&](int y)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const uint8_t *in = pixels + (static_cast<size_t>(y) * width + x) * channels;
+            float *texel = &current[(static_cast<size_t>(y) * width + x) * 4];
+            for (int c = 0; c < 4; c++)
+            {
+                if (c >= channels)
+                    texel[c] = c == 3 ? 1.0f : 0.0f;
+                else if (srgb && c < 3)
+                    texel[c] = toLinear[in[c]];
+                else
+                    texel[c] = in[c] / 255.0f;
+            }
+        }
+    });
+
+    const bool keepCoverage = options.alphaCutoff > 0.0f && channels == 4;
+    const float targetCoverage = keepCoverage ? alphaCoverage(current, options.alphaCutoff, 1.0f) : 0.0f;
+
+    outLevels.clear();
+    int levelWidth = width, levelHeight = height;
+    FloatImage next, horizontal;
+    for (;;)
+    {
+        // Quantize this level, with alpha scaled back to the coverage of the top level
+        float alphaScale = keepCoverage && !outLevels.empty() ?
+                           coverageScale(current, options.alphaCutoff, targetCoverage) : 1.0f;
+        outLevels.push_back(MipLevel());
+        MipLevel &level = outLevels.back();
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.channels = channels;
+        level.pixels.resize(static_cast<size_t>(levelWidth) * levelHeight * channels);
+        if (outLevels.size() == 1)
+            memcpy(level.pixels.data(), pixels, level.pixels.size());
+        else
+        {
+            forEachRow(levelHeight, [&](int y)
+            {
+                for (int x = 0; x < levelWidth; x++)
+                {
+                    size_t t = static_cast<size_t>(y) * levelWidth + x;
+                    const float *texel = &current[t * 4];
+                    uint8_t *out = &level.pixels[t * channels];
+                    for (int c = 0; c < channels; c++)
+                    {
+                        float v = saturate(c == 3 ? texel[c] * alphaScale : texel[c]);
+                        out[c] = srgb && c < 3 ? toSrgb[static_cast<int>(v * 4095.0f + 0.5f)]
+                                               : static_cast<uint8_t>(v * 255.0f + 0.5f);
+                    }
+                }
+            });
+        }
+
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+
+        // Filter the next level from this one, kept in float so errors don't add up
+        int nextWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+        int nextHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+        next.resize(static_cast<size_t>(nextWidth) * nextHeight * 4);
+        if (options.filter == MipBox)
+        {
+            forEachRow(nextHeight, [&](int y)
+            {
+                averageBox(current, levelWidth, levelHeight, next, nextWidth, y);
+            });
+        }
+        else
+        {
+            // Separable, rows first and then columns
+            horizontal.resize(static_cast<size_t>(nextWidth) * levelHeight * 4);
+            forEachRow(levelHeight, [&](int y)
+            {
+                for (int x = 0; x < nextWidth; x++)
+                    filterKaiser(&current[static_cast<size_t>(y) * levelWidth * 4], levelWidth, 4, x,
+                                 &horizontal[(static_cast<size_t>(y) * nextWidth + x) * 4]);
+            });
+            forEachRow(nextHeight, [&](int y)
+            {
+                for (int x = 0; x < nextWidth; x++)
+                    filterKaiser(&horizontal[static_cast<size_t>(x) * 4], levelHeight, nextWidth * 4, y,
+                                 &next[(static_cast<size_t>(y) * nextWidth + x) * 4]);
+            });
+        }
+
+        current.swap(next);
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+// Downsampling filter between mip levels
+enum MipFilter
+{
+    MipBox,   // 2x2 average
+    MipKaiser // 6 tap Kaiser windowed sinc, sharper distant mips
+};
+
+struct MipOptions
+{
+    MipFilter filter;
+    bool srgb;         // RGB is sRGB encoded, so it is averaged in linear space
+    float alphaCutoff; // Alpha test threshold whose coverage every level keeps, 0 = off
+
+    MipOptions() : filter(MipBox), srgb(false), alphaCutoff(0.0f) {}
+};
+
+// One mip level of 8-bit texels, rows top to bottom
+struct MipLevel
+{
+    int width;
+    int height;
+    int channels;
+    std::vector<uint8_t> pixels;
+};
+
+// Build the full mip chain of an 8-bit image with 1-4 channels, level 0 is a
+// copy of the image. Levels are filtered in float from the level above, with
+// rows of each level split across threadCount threads (0 = all cores)
+void generateMips(const uint8_t *pixels, int width, int height, int channels,
+                  const MipOptions &options, std::vector<MipLevel> &outLevels,
+                  unsigned int threadCount = 0);
@@ -2,291 +2,923 @@
 #include <stdio.h>
 #include <string>
 #include <cstring>
-#include <iostream>
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
 #include "model.hpp"
-#include "stb_image.hpp"
+#include "obj_loader.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "hash.hpp"
+#include "vertex_format.hpp"
+#include "tangent_space.hpp"
+#include "asset_manager.hpp"
+#include "camera.hpp"
+
+unsigned int Model::objLoaderThreads = 0;
+bool Model::reduceOverdraw = false;
+bool Model::compactVertices = false;
+unsigned int Model::maxLods = 5;
+
+// Material uniforms, hashed once
+static const UniformId uniformKa = uniformId("ka");
+static const UniformId uniformKd = uniformId("kd");
+static const UniformId uniformKs = uniformId("ks");
+static const UniformId uniformNs = uniformId("Ns");
+static const UniformId uniformCompactVertices = uniformId("compactVertices");
+static const UniformId uniformPositionOffset = uniformId("positionOffset");
+static const UniformId uniformPositionScale = uniformId("positionScale");
 
 Model::Model(const char *path)
+    : currentLod(0), worldPerUv(1.0f), drawnClusters(0), drawnTriangles(0), indexType(GL_UNSIGNED_INT), compact(false), glbBuffer(0)
+{
+    load(path);
+    upload();
+}
+
+Model::Model()
+    : currentLod(0), worldPerUv(1.0f), drawnClusters(0), drawnTriangles(0), indexType(GL_UNSIGNED_INT), compact(false), glbBuffer(0)
+{
+}
+
+// Whether a path names a binary glTF file
+static bool isGlbPath(const char *path)
 {
-    // Load object - now also tries to get tangents/bitangents (will be empty from current loadObj)
-    bool res = loadObj(path, vertices, uvs, normals, tangents, bitangents);
+    size_t length = strlen(path);
+    return length >= 4 && (strcmp(path + length - 4, ".glb") == 0 || strcmp(path + length - 4, ".GLB") == 0);
+}
+
+bool Model::load(const char *path)
+{
+    // Binary glTF is already indexed and binary, it needs no mesh cache
+    if (isGlbPath(path))
+        return loadGlb(path);
+    
+    // Use the binary cache when it was built from this exact .obj file,
+    // otherwise parse the .obj and rebuild the cache
+    std::string cachePath = meshCachePath(path);
+    MeshSource source;
+    bool haveSource = statMeshSource(path, source);
+    
+    // Build options change the cached result, so they are part of its key
+    const uint32_t options[3] = { reduceOverdraw, maxLods, compactVertices };
+    source.options = hashBytes(options, sizeof(options));
+    
+    bool res;
+    if (haveSource)
+        res = loadMeshCache(cachePath.c_str(), path, source, meshData);
+    else
+        res = loadMeshCache(cachePath.c_str(), meshData);
+    
+    if (!res)
+    {
+        res = buildMesh(path);
+        if (res && hashMeshSource(path, source))
+            saveMeshCache(cachePath.c_str(), source, meshData);
+    }
+    
+    // The streams stay in meshData until upload, the rest is used to draw
+    if (meshData.lods.empty())
+    {
+        MeshLod none = { 0, 0, 0.0f };
+        meshData.lods.push_back(none);
+    }
+    lods.swap(meshData.lods);
+    meshlets.swap(meshData.meshlets);
+    currentLod = 0;
+    boundsMin = meshData.boundsMin;
+    boundsMax = meshData.boundsMax;
+    worldPerUv = meshData.worldPerUv;
+    
+    return res;
+}
+
+bool Model::buildMesh(const char *path)
+{
+    // Load object
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec4> tangents;
+    std::vector<unsigned int> indices, lodIndices;
+    if (!loadObj(path, positions, uvs, normals, indices))
+        return false;
+    
+    optimizeMesh(positions, uvs, normals, indices);
+    
+    // Tangent frames, vertices on mirrored uv seams are split
+    std::chrono::steady_clock::time_point tangentStart = std::chrono::steady_clock::now();
+    size_t vertexCount = positions.size();
+    generateTangents(indices, positions, uvs, normals, tangents, objLoaderThreads);
+    double tangentSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tangentStart).count();
+    printf("Generated tangents in %.2f ms, split %u vertices on mirrored uvs\n",
+           tangentSeconds * 1000.0, (unsigned int)(positions.size() - vertexCount));
+    
+    // Simplified levels share the vertices of the full mesh
+    MeshData &mesh = meshData;
+    std::chrono::steady_clock::time_point lodStart = std::chrono::steady_clock::now();
+    buildLodChain(indices, positions, maxLods, lodIndices, mesh.lods);
+    double lodSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lodStart).count();
+    printf("Built %u levels of detail in %.2f ms:", (unsigned int)mesh.lods.size(), lodSeconds * 1000.0);
+    for (size_t l = 0; l < mesh.lods.size(); l++)
+        printf(" %u", mesh.lods[l].indexCount / 3);
+    printf(" triangles\n");
+    if (mesh.lods.empty())
+    {
+        MeshLod full = { 0, static_cast<unsigned int>(indices.size()), 0.0f };
+        mesh.lods.push_back(full);
+    }
+    
+    // Bounds of the positions
+    mesh.boundsMin = mesh.boundsMax = positions.empty() ? glm::vec3(0.0f) : positions[0];
+    for (size_t i = 1; i < positions.size(); i++)
+    {
+        mesh.boundsMin = glm::min(mesh.boundsMin, positions[i]);
+        mesh.boundsMax = glm::max(mesh.boundsMax, positions[i]);
+    }
+    
+    // Average uv scale, used to pick the texture mips a model needs
+    double surfaceArea = 0.0, uvArea = 0.0;
+    for (size_t i = 0; uvs.size() == positions.size() && i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec3 &p0 = positions[indices[i]], &p1 = positions[indices[i + 1]], &p2 = positions[indices[i + 2]];
+        const glm::vec2 &t0 = uvs[indices[i]], &t1 = uvs[indices[i + 1]], &t2 = uvs[indices[i + 2]];
+        glm::vec2 e1 = t1 - t0, e2 = t2 - t0;
+        surfaceArea += 0.5 * glm::length(glm::cross(p1 - p0, p2 - p0));
+        uvArea += 0.5 * fabs(e1.x * e2.y - e1.y * e2.x);
+    }
+    mesh.worldPerUv = uvArea > 0.0 ? static_cast<float>(sqrt(surfaceArea / uvArea)) : 1.0f;
     
+    // Split into meshlets for per-cluster culling, the index order is kept
+    std::chrono::steady_clock::time_point clusterStart = std::chrono::steady_clock::now();
+    buildMeshlets(indices, positions, mesh.meshlets);
+    double clusterSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - clusterStart).count();
+    printf("Built %u meshlets in %.2f ms\n", (unsigned int)mesh.meshlets.size(), clusterSeconds * 1000.0);
+    
+    // The full mesh followed by the simplified levels, 16-bit when every
+    // vertex can be addressed with them
+    indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+    std::vector<unsigned short> shortIndices;
+    const bool shortIndexed = positions.size() <= 65536;
+    if (shortIndexed)
+        shortIndices.assign(indices.begin(), indices.end());
+    const void *indexData = shortIndexed ? static_cast<const void *>(shortIndices.data()) : indices.data();
+    const uint32_t indexSize = shortIndexed ? sizeof(unsigned short) : sizeof(unsigned int);
+    
+    // Interleave the vertices as they are uploaded, float or compact
+    if (!compactVertices)
+    {
+        std::vector<ModelVertex> interleaved;
+        packModelVertices(positions, uvs, normals, tangents, interleaved);
+        setMeshStreams(mesh, interleaved.data(), static_cast<uint32_t>(interleaved.size()), sizeof(ModelVertex),
+                       indexData, static_cast<uint32_t>(indices.size()), indexSize);
+        mesh.compact = false;
+        return true;
+    }
+    
+    std::vector<CompactVertex> packed;
+    packCompactVertices(positions, uvs, normals, tangents, mesh.boundsMin, mesh.boundsMax, packed);
+    setMeshStreams(mesh, packed.data(), static_cast<uint32_t>(packed.size()), sizeof(CompactVertex),
+                   indexData, static_cast<uint32_t>(indices.size()), indexSize);
+    mesh.compact = true;
+    
+    unsigned long floatBytes = positions.size() * sizeof(ModelVertex);
+    unsigned long packedBytes = packed.size() * sizeof(CompactVertex);
+    printf("Compact vertices: %lu bytes instead of %lu bytes\n", packedBytes, floatBytes);
+    return true;
+}
+
+void Model::upload()
+{
     // Setup buffers
-    setupBuffers();
+    if (glb)
+        setupGlbBuffers();
+    else
+        setupBuffers();
 }
 
-void Model::draw(unsigned int &shaderID)
+void Model::bindMaterial(ShaderProgram &shader)
 {
     // Send material properties to the shader
-    glUniform1f(glGetUniformLocation(shaderID, "ka"), ka);
-    glUniform1f(glGetUniformLocation(shaderID, "kd"), kd);
-    glUniform1f(glGetUniformLocation(shaderID, "ks"), ks);
-    glUniform1f(glGetUniformLocation(shaderID, "Ns"), Ns);
+    shader.setFloat(uniformKa, ka);
+    shader.setFloat(uniformKd, kd);
+    shader.setFloat(uniformKs, ks);
+    shader.setFloat(uniformNs, Ns);
+    
+    // Tell the vertex shader how to decode the positions
+    shader.setInt(uniformCompactVertices, compact);
+    shader.setVec3(uniformPositionOffset, positionOffset);
+    shader.setVec3(uniformPositionScale, positionScale);
     
     // Bind the textures
-    unsigned int diffuseNum = 0;
-    unsigned int normalNum = 0;
-    for (unsigned int i = 0; i < textures.size(); i++)
+    bindTextures(shader, textures);
+}
+
+void Model::bindTextures(ShaderProgram &shader, const std::vector<Texture> &bound)
+{
+    for (unsigned int i = 0; i < bound.size(); i++)
     {
         // Bind texture
-        std::string name = textures[i].type;
         glActiveTexture(GL_TEXTURE0 + i);
-        glUniform1i(glGetUniformLocation(shaderID, (name + "Map").c_str()), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        shader.setInt(bound[i].sampler, i);
+        glBindTexture(GL_TEXTURE_2D, bound[i].asset->id);
     }
+}
+
+void Model::draw(ShaderProgram &shader)
+{
+    // Nothing to draw while the model is still loading
+    if (!ready())
+        return;
     
-    // Draw the triangles
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, static_cast<unsigned int>(vertices.size()));
+    bindMaterial(shader);
+    
+    // Primitives of a .glb file, each with its own streams and material
+    if (!primitives.empty())
+    {
+        for (size_t p = 0; p < primitives.size(); p++)
+        {
+            const Primitive &primitive = primitives[p];
+            bindTextures(shader, primitive.material >= 0 ? materials[primitive.material] : textures);
+            glBindVertexArray(primitive.vao);
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(primitive.indexCount), primitive.indexType,
+                           (void*)primitive.indexOffset);
+        }
+        glBindVertexArray(0);
+        return;
+    }
+    
+    // Draw the triangles of the selected level
+    const MeshLod &lod = lods[currentLod];
+    const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    glBindVertexArray(vertexArray.vao);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount), indexType, (void*)(lod.firstIndex * indexSize));
     glBindVertexArray(0);
 }
 
-void Model::setupBuffers()
+void Model::drawInstanced(ShaderProgram &shader, InstanceBatch &batch,
+                          const std::vector<TextureHandle> &materialTextures)
 {
-    // Create and bind the Vertex Array Object (VAO)
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    
-    // Create Vertex Buffer Object
-    unsigned int vertexBuffer;
-    glGenBuffers(1, &vertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-    
-    // Create uv buffer
-    unsigned int uvBuffer;
-    glGenBuffers(1, &uvBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
-    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-    
-    // Create normal buffer
-    unsigned int normalBuffer;
-    glGenBuffers(1, &normalBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
-
-    // Create tangent buffer (new)
-    glGenBuffers(1, &tangentBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, tangentBuffer);
-    glBufferData(GL_ARRAY_BUFFER, tangents.size() * sizeof(glm::vec3), &tangents[0], GL_STATIC_DRAW);
+    // Nothing to draw while the model is still loading
+    if (!ready() || batch.empty())
+        return;
+    
+    batch.upload();
+    bindMaterial(shader);
+    
+    // Primitives of a .glb file, each with its own streams and material
+    if (!primitives.empty())
+    {
+        for (size_t p = 0; p < primitives.size(); p++)
+        {
+            const Primitive &primitive = primitives[p];
+            bindTextures(shader, primitive.material >= 0 ? materials[primitive.material] : textures);
+            glBindVertexArray(primitive.vao);
+            drawInstanceRanges(static_cast<GLsizei>(primitive.indexCount), primitive.indexType,
+                               (void*)primitive.indexOffset, batch, materialTextures);
+        }
+        glBindVertexArray(0);
+        return;
+    }
+    
+    // Every instance draws the triangles of the selected level
+    const MeshLod &lod = lods[currentLod];
+    const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    glBindVertexArray(vertexArray.vao);
+    drawInstanceRanges(static_cast<GLsizei>(lod.indexCount), indexType, (void*)(lod.firstIndex * indexSize),
+                       batch, materialTextures);
+    glBindVertexArray(0);
+}
 
-    // Create bitangent buffer (new)
-    glGenBuffers(1, &bitangentBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, bitangentBuffer);
-    glBufferData(GL_ARRAY_BUFFER, bitangents.size() * sizeof(glm::vec3), &bitangents[0], GL_STATIC_DRAW);
-    
-    // Bind the vertex buffer
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    
-    // Bind the uv buffer
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    
-    // Bind the normal buffer
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    
-    // Bind the tangent buffer (new) - Attribute location 3
-    glEnableVertexAttribArray(3);
-    glBindBuffer(GL_ARRAY_BUFFER, tangentBuffer);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+void Model::drawInstanceRanges(GLsizei indexCount, GLenum type, const void *offset, InstanceBatch &batch,
+                               const std::vector<TextureHandle> &materialTextures)
+{
+    if (materialTextures.empty())
+    {
+        batch.bindAttributes(0);
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, type, offset, static_cast<GLsizei>(batch.size()));
+    }
+    else
+    {
+        // GL 3.3 has no base instance, so the attributes start at each range instead
+        const std::vector<InstanceBatch::Range> &ranges = batch.ranges();
+        for (size_t r = 0; r < ranges.size(); r++)
+        {
+            if (ranges[r].material < materialTextures.size() && materialTextures[ranges[r].material])
+            {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, materialTextures[ranges[r].material]->id);
+            }
+            batch.bindAttributes(ranges[r].first);
+            glDrawElementsInstanced(GL_TRIANGLES, indexCount, type, offset, static_cast<GLsizei>(ranges[r].count));
+        }
+    }
+    InstanceBatch::unbindAttributes();
+}
 
-    // Bind the bitangent buffer (new) - Attribute location 4
-    glEnableVertexAttribArray(4);
-    glBindBuffer(GL_ARRAY_BUFFER, bitangentBuffer);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+void Model::drawClusters(ShaderProgram &shader, const glm::mat4 &modelMatrix,
+                         const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
+{
+    // Nothing to draw while the model is still loading
+    if (!ready())
+    {
+        drawnClusters = drawnTriangles = 0;
+        return;
+    }
     
-     // Unbind the VAO (corrected from Bind the VAO comment)
+    // Meshlets cover the full mesh, simplified levels and models without
+    // meshlets (.glb files) are drawn whole
+    if (currentLod != 0 || meshlets.empty())
+    {
+        draw(shader);
+        drawnClusters = 0;
+        drawnTriangles = lods[currentLod].indexCount / 3;
+        return;
+    }
+    
+    // Cull in model space so the meshlet bounds don't need transforming
+    glm::mat4 modelView = viewMatrix * modelMatrix;
+    Frustum frustum = extractFrustum(projectionMatrix * modelView);
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+    
+    // Visible meshlets are runs of the index buffer, adjacent runs are merged.
+    // The run lists keep their capacity between draws
+    const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    std::vector<GLsizei> &counts = runCounts;
+    std::vector<const void *> &offsets = runOffsets;
+    counts.clear();
+    offsets.clear();
+    drawnClusters = drawnTriangles = 0;
+    unsigned int runEnd = 0;
+    for (size_t m = 0; m < meshlets.size(); m++)
+    {
+        const Meshlet &meshlet = meshlets[m];
+        if (cullMeshlet(meshlet, frustum, cameraPosition))
+            continue;
+        
+        if (!counts.empty() && runEnd == meshlet.firstIndex)
+            counts.back() += meshlet.indexCount;
+        else
+        {
+            counts.push_back(meshlet.indexCount);
+            offsets.push_back((const void *)(meshlet.firstIndex * indexSize));
+        }
+        runEnd = meshlet.firstIndex + meshlet.indexCount;
+        drawnClusters++;
+        drawnTriangles += meshlet.indexCount / 3;
+    }
+    
+    if (counts.empty())
+        return;
+    
+    bindMaterial(shader);
+    glBindVertexArray(vertexArray.vao);
+    glMultiDrawElements(GL_TRIANGLES, counts.data(), indexType, offsets.data(), static_cast<GLsizei>(counts.size()));
     glBindVertexArray(0);
 }
 
+unsigned int Model::selectLod(const glm::mat4 &modelMatrix, const Camera &camera,
+                             float viewportHeight, float maxPixelError)
+{
+    return selectLod(modelMatrix, camera.Position, glm::radians(camera.Fov), viewportHeight, maxPixelError);
+}
+
+unsigned int Model::selectLod(const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix,
+                             const glm::mat4 &projectionMatrix, float viewportHeight,
+                             float maxPixelError)
+{
+    // projection[1][1] is 1 / tan(fov / 2) for a perspective projection
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(viewMatrix)[3]);
+    float fovY = 2.0f * atanf(1.0f / projectionMatrix[1][1]);
+    return selectLod(modelMatrix, cameraPosition, fovY, viewportHeight, maxPixelError);
+}
+
+unsigned int Model::selectLod(const glm::mat4 &modelMatrix, const glm::vec3 &cameraPosition,
+                             float fovY, float viewportHeight, float maxPixelError)
+{
+    // The bounds aren't known until the model is loaded
+    if (!ready())
+        return 0;
+    
+    // Distance from the camera to the bounding sphere, in model units like the errors
+    glm::vec3 cameraInModel = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(cameraPosition, 1.0f));
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+    float distance = glm::length(cameraInModel - center) - radius;
+    
+    currentLod = ::selectLod(lods, distance, fovY, viewportHeight, maxPixelError);
+    return currentLod;
+}
+
+float Model::uvDensity(const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix,
+                       const glm::mat4 &projectionMatrix, float viewportHeight) const
+{
+    // The bounds aren't known until the model is loaded
+    if (!ready())
+        return 0.0f;
+    
+    // Bounding sphere in world space, scaled by the largest axis of the model matrix
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+    float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+                           glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    float radius = glm::length(boundsMax - boundsMin) * 0.5f * scale;
+    
+    // Pixels per world unit at the nearest point, projection[1][1] is 1 / tan(fov / 2).
+    // Inside the sphere the distance is clamped so the density stays finite
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(viewMatrix)[3]);
+    float distance = glm::max(glm::length(cameraPosition - center) - radius, 0.01f);
+    float pixelsPerUnit = 0.5f * viewportHeight * projectionMatrix[1][1] / distance;
+    return pixelsPerUnit * worldPerUv * scale;
+}
+
+void Model::setupBuffers()
+{
+    compact = meshData.compact;
+    if (compact)
+        compactPositionTransform(boundsMin, boundsMax, positionOffset, positionScale);
+    else
+    {
+        positionOffset = glm::vec3(0.0f);
+        positionScale = glm::vec3(1.0f);
+    }
+    
+    // Upload straight from the mapped cache, or the streams just built
+    indexType = meshData.indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    createVertexArray(compact ? VertexFormat<CompactVertex>::layout() : VertexFormat<ModelVertex>::layout(),
+                      meshData.vertices, static_cast<size_t>(meshData.vertexCount) * meshData.vertexSize,
+                      meshData.indices, static_cast<size_t>(meshData.indexCount) * meshData.indexSize,
+                      vertexArray);
+    
+    // Everything is on the GPU, unmap the file
+    closeMeshCache(meshData);
+}
+
 void Model::deleteBuffers()
 {
-    glDeleteBuffers(1, &vertexBuffer);
-    glDeleteBuffers(1, &uvBuffer);
-    glDeleteBuffers(1, &normalBuffer);
-    glDeleteBuffers(1, &tangentBuffer);
-    glDeleteBuffers(1, &bitangentBuffer);
-    glDeleteVertexArrays(1, &VAO);
+    deleteVertexArray(vertexArray);
+    for (size_t p = 0; p < primitives.size(); p++)
+        glDeleteVertexArrays(1, &primitives[p].vao);
+    glDeleteBuffers(1, &glbBuffer);
+    primitives.clear();
+    glbBuffer = 0;
 }
 
 bool Model::loadObj(const char *path,
                     std::vector<glm::vec3> &outVertices,
                     std::vector<glm::vec2> &outUVs,
                     std::vector<glm::vec3> &outNormals,
-                    std::vector<glm::vec3> &outTangents,
-                    std::vector<glm::vec3> &outBitangents)
+                    std::vector<unsigned int> &outIndices)
 {
     printf("Loading OBJ file %s\n", path);
     
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-    std::vector<glm::vec3> tempVertices;
-    std::vector<glm::vec2> tempUVs;
-    std::vector<glm::vec3> tempNormals;
+    // Memory-map and parse the file, split across threads if it is large
+    ObjMesh mesh;
+    ObjLoadStats stats;
+    if (!parseObj(path, mesh, stats, objLoaderThreads))
+        return false;
+    
+    // Share vertices between the face corners that use them
+    indexObj(mesh, outVertices, outUVs, outNormals, outIndices, stats);
+    printObjLoadReport(path, mesh, stats);
+    
+    return true;
+}
+
+// Converted streams start on this boundary after the binary chunk and each other
+static size_t alignStream(size_t offset)
+{
+    return (offset + 15) & ~static_cast<size_t>(15);
+}
+
+// Append a converted stream, returns its offset in the buffer that follows the binary chunk
+static size_t appendStream(std::vector<char> &converted, size_t base, const void *data, size_t bytes)
+{
+    size_t offset = alignStream(converted.size());
+    converted.resize(offset + bytes);
+    if (bytes > 0)
+        memcpy(&converted[offset], data, bytes);
+    return base + offset;
+}
+
+// A stream holding a single attribute
+static VertexLayout streamLayout(GLuint location, GLint components, GLenum type, GLboolean normalized,
+                                 size_t stride, size_t offset)
+{
+    VertexLayout layout(static_cast<GLsizei>(stride));
+    layout.add(location, components, type, normalized, offset);
+    return layout;
+}
+
+// Area weighted vertex normals, for files without them
+static void generateNormals(const std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions,
+                            std::vector<glm::vec3> &normals)
+{
+    normals.assign(positions.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec3 &p0 = positions[indices[i]], &p1 = positions[indices[i + 1]], &p2 = positions[indices[i + 2]];
+        glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+        normals[indices[i]] += faceNormal;
+        normals[indices[i + 1]] += faceNormal;
+        normals[indices[i + 2]] += faceNormal;
+    }
+    for (size_t v = 0; v < normals.size(); v++)
+        normals[v] = glm::dot(normals[v], normals[v]) > 0.0f ? glm::normalize(normals[v]) : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+bool Model::loadGlb(const char *path)
+{
+    printf("Loading GLB file %s\n", path);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    // Draws nothing if the file can't be loaded
+    MeshLod none = { 0, 0, 0.0f };
+    lods.assign(1, none);
+    currentLod = 0;
     
-    FILE *file = fopen(path, "r");
-    if (file==NULL)
+    glb.reset(new GlbFile());
+    if (!parseGlb(path, *glb))
     {
-        printf("Impossible to open the file. Check paths and directories.");
-        getchar();
+        glb.reset();
         return false;
     }
+    const GlbFile &file = *glb;
+    
+    // Converted streams follow the binary chunk in the same buffer
+    const size_t convertedBase = alignStream(file.binSize);
+    converted.clear();
+    primitives.clear();
+    unsigned int inPlaceStreams = 0, convertedStreams = 0, indexCount = 0;
+    boundsMin = glm::vec3(FLT_MAX);
+    boundsMax = glm::vec3(-FLT_MAX);
+    double surfaceArea = 0.0, uvArea = 0.0;
     
-    while (true)
+    for (size_t p = 0; p < file.primitives.size(); p++)
     {
-        // Read the first word of the line
-        char lineHeader[128];
-        int res = fscanf(file, "%s", lineHeader);
-        if (res == EOF)
+        const GlbPrimitive &source = file.primitives[p];
+        const GlbAccessor &position = file.accessors[source.position];
+        const GlbAccessor *normal = source.normal >= 0 ? &file.accessors[source.normal] : NULL;
+        const GlbAccessor *uv = source.uv >= 0 ? &file.accessors[source.uv] : NULL;
+        const GlbAccessor *tangent = source.tangent >= 0 ? &file.accessors[source.tangent] : NULL;
+        const GlbAccessor *index = source.indices >= 0 ? &file.accessors[source.indices] : NULL;
+        
+        // Unreadable optional streams, or ones of another length, are treated as missing
+        if (normal && (normal->components != 3 || normal->count != position.count))
+            normal = NULL;
+        if (uv && (uv->components != 2 || uv->count != position.count))
+            uv = NULL;
+        if (tangent && (tangent->components != 4 || tangent->count != position.count))
+            tangent = NULL;
+        if (position.components != 3 || position.count == 0 ||
+            (source.indices >= 0 && (index->components != 1 || index->componentType == GL_FLOAT)))
         {
-            // If end of file reached exit the loop
-            break;
+            printf("Skipping primitive %u of %s: unsupported positions or indices\n", (unsigned int)p, path);
+            continue;
         }
         
-        if (strcmp(lineHeader, "v") == 0)
+        // Indices are read to check them, the GPU must never read past the vertices
+        std::vector<unsigned int> indices;
+        if (index)
+            readGlbIndices(file, *index, indices);
+        else
         {
-            // Read vertices
-            glm::vec3 vertex;
-            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-            tempVertices.push_back(vertex);
+            indices.resize(position.count);
+            for (size_t i = 0; i < indices.size(); i++)
+                indices[i] = static_cast<unsigned int>(i);
         }
-        else if (strcmp(lineHeader, "vt") == 0)
+        bool indicesValid = indices.size() % 3 == 0;
+        for (size_t i = 0; indicesValid && i < indices.size(); i++)
+            indicesValid = indices[i] < position.count;
+        if (!indicesValid || indices.empty())
         {
-            // Read texture co-ordinates
-            glm::vec2 uv;
-            fscanf(file, "%f %f\n", &uv.x, &uv.y);
-            tempUVs.push_back(uv);
+            printf("Skipping primitive %u of %s: indices out of range\n", (unsigned int)p, path);
+            continue;
         }
-        else if (strcmp(lineHeader, "vn") == 0)
+        
+        // Streams are in mesh space, the node transform moves them into model space
+        const glm::mat4 &transform = source.transform;
+        const bool identity = transform == glm::mat4(1.0f);
+        const bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+        
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> uvs;
+        readGlbAccessor(file, position, positions);
+        if (uv)
+            readGlbAccessor(file, *uv, uvs);
+        for (size_t v = 0; !identity && v < positions.size(); v++)
+            positions[v] = glm::vec3(transform * glm::vec4(positions[v], 1.0f));
+        
+        // A mirroring transform turns the triangles inside out
+        if (mirrored)
+            for (size_t i = 0; i < indices.size(); i += 3)
+                std::swap(indices[i + 1], indices[i + 2]);
+        
+        // Bounds and uv density over every primitive
+        for (size_t v = 0; v < positions.size(); v++)
         {
-            // Read vertex normals
-            glm::vec3 normal;
-            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-            tempNormals.push_back(normal);
+            boundsMin = glm::min(boundsMin, positions[v]);
+            boundsMax = glm::max(boundsMax, positions[v]);
         }
-        else if (strcmp(lineHeader, "f") == 0)
+        for (size_t i = 0; uv && i < indices.size(); i += 3)
         {
-            // Read vertex indices
-            std::string vertex1, vertex2, vertex3;
-            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-            int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n",
-                                 &vertexIndex[0], &uvIndex[0], &normalIndex[0],
-                                 &vertexIndex[1], &uvIndex[1], &normalIndex[1],
-                                 &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
+            const glm::vec3 &p0 = positions[indices[i]], &p1 = positions[indices[i + 1]], &p2 = positions[indices[i + 2]];
+            const glm::vec2 &t0 = uvs[indices[i]], &t1 = uvs[indices[i + 1]], &t2 = uvs[indices[i + 2]];
+            glm::vec2 e1 = t1 - t0, e2 = t2 - t0;
+            surfaceArea += 0.5 * glm::length(glm::cross(p1 - p0, p2 - p0));
+            uvArea += 0.5 * fabs(e1.x * e2.y - e1.y * e2.x);
+        }
+        
+        Primitive primitive;
+        primitive.material = source.material;
+        primitive.vao = 0;
+        
+        if (!tangent)
+        {
+            // Generating tangents may split vertices on mirrored uvs, so every stream is converted
+            std::vector<glm::vec3> normals;
+            std::vector<glm::vec4> tangents;
+            if (normal)
+            {
+                readGlbAccessor(file, *normal, normals);
+                for (size_t v = 0; !identity && v < normals.size(); v++)
+                    normals[v] = glm::normalize(normalMatrix * normals[v]);
+            }
+            else
+                generateNormals(indices, positions, normals);
+            uvs.resize(positions.size(), glm::vec2(0.0f));
+            generateTangents(indices, positions, uvs, normals, tangents, objLoaderThreads);
             
-            // Check for error
-            if (matches != 9)
+            primitive.streams.push_back(streamLayout(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+                appendStream(converted, convertedBase, positions.data(), positions.size() * sizeof(glm::vec3))));
+            primitive.streams.push_back(streamLayout(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
+                appendStream(converted, convertedBase, uvs.data(), uvs.size() * sizeof(glm::vec2))));
+            primitive.streams.push_back(streamLayout(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+                appendStream(converted, convertedBase, normals.data(), normals.size() * sizeof(glm::vec3))));
+            primitive.streams.push_back(streamLayout(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4),
+                appendStream(converted, convertedBase, tangents.data(), tangents.size() * sizeof(glm::vec4))));
+            convertedStreams += 4;
+            index = NULL;
+        }
+        else
+        {
+            // Positions, normals and tangents are used in place when they are floats
+            // in model space, uvs when the GL can read their type
+            if (identity && glbAccessorIs(position, GL_FLOAT, 3))
+            {
+                primitive.streams.push_back(streamLayout(0, 3, GL_FLOAT, GL_FALSE, position.stride, position.offset));
+                inPlaceStreams++;
+            }
+            else
+            {
+                primitive.streams.push_back(streamLayout(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+                    appendStream(converted, convertedBase, positions.data(), positions.size() * sizeof(glm::vec3))));
+                convertedStreams++;
+            }
+            
+            if (uv && (uv->componentType == GL_FLOAT ||
+                       (uv->normalized && (uv->componentType == GL_UNSIGNED_BYTE || uv->componentType == GL_UNSIGNED_SHORT))))
+            {
+                primitive.streams.push_back(streamLayout(1, 2, uv->componentType, uv->normalized ? GL_TRUE : GL_FALSE,
+                                                         uv->stride, uv->offset));
+                inPlaceStreams++;
+            }
+            else if (uv)
+            {
+                primitive.streams.push_back(streamLayout(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
+                    appendStream(converted, convertedBase, uvs.data(), uvs.size() * sizeof(glm::vec2))));
+                convertedStreams++;
+            }
+            
+            if (normal && identity && glbAccessorIs(*normal, GL_FLOAT, 3))
+            {
+                primitive.streams.push_back(streamLayout(2, 3, GL_FLOAT, GL_FALSE, normal->stride, normal->offset));
+                inPlaceStreams++;
+            }
+            else
             {
-                printf("File can't be read by loadObj().\n");
-                fclose(file);
-                return false;
+                std::vector<glm::vec3> normals;
+                if (normal)
+                {
+                    readGlbAccessor(file, *normal, normals);
+                    for (size_t v = 0; v < normals.size(); v++)
+                        normals[v] = glm::normalize(normalMatrix * normals[v]);
+                }
+                else
+                    generateNormals(indices, positions, normals);
+                primitive.streams.push_back(streamLayout(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+                    appendStream(converted, convertedBase, normals.data(), normals.size() * sizeof(glm::vec3))));
+                convertedStreams++;
             }
-            vertexIndices.push_back(vertexIndex[0]);
-            vertexIndices.push_back(vertexIndex[1]);
-            vertexIndices.push_back(vertexIndex[2]);
-            uvIndices    .push_back(uvIndex[0]);
-            uvIndices    .push_back(uvIndex[1]);
-            uvIndices    .push_back(uvIndex[2]);
-            normalIndices.push_back(normalIndex[0]);
-            normalIndices.push_back(normalIndex[1]);
-            normalIndices.push_back(normalIndex[2]);
+            
+            if (identity && glbAccessorIs(*tangent, GL_FLOAT, 4))
+            {
+                primitive.streams.push_back(streamLayout(3, 4, GL_FLOAT, GL_FALSE, tangent->stride, tangent->offset));
+                inPlaceStreams++;
+            }
+            else
+            {
+                // The bitangent sign flips with the handedness of the transform
+                std::vector<glm::vec4> tangents;
+                readGlbAccessor(file, *tangent, tangents);
+                for (size_t v = 0; v < tangents.size(); v++)
+                {
+                    glm::vec3 t = glm::mat3(transform) * glm::vec3(tangents[v]);
+                    float sign = tangents[v].w < 0.0f ? -1.0f : 1.0f;
+                    tangents[v] = glm::vec4(glm::dot(t, t) > 0.0f ? glm::normalize(t) : glm::vec3(1.0f, 0.0f, 0.0f),
+                                            mirrored ? -sign : sign);
+                }
+                primitive.streams.push_back(streamLayout(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4),
+                    appendStream(converted, convertedBase, tangents.data(), tangents.size() * sizeof(glm::vec4))));
+                convertedStreams++;
+            }
+        }
+        
+        // 16 and 32-bit indices are used in place unless they were reordered
+        primitive.indexCount = static_cast<unsigned int>(indices.size());
+        if (index && !mirrored && index->stride == (index->componentType == GL_UNSIGNED_SHORT ? 2u : 4u) &&
+            (index->componentType == GL_UNSIGNED_SHORT || index->componentType == GL_UNSIGNED_INT))
+        {
+            primitive.indexType = index->componentType;
+            primitive.indexOffset = index->offset;
+            inPlaceStreams++;
+        }
+        else if (positions.size() <= 65536)
+        {
+            std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+            primitive.indexType = GL_UNSIGNED_SHORT;
+            primitive.indexOffset = appendStream(converted, convertedBase, shortIndices.data(),
+                                                 shortIndices.size() * sizeof(unsigned short));
+            convertedStreams++;
         }
         else
         {
-            // Remove comment line
-            char commentBuffer[1000];
-            fgets(commentBuffer, 1000, file);
+            primitive.indexType = GL_UNSIGNED_INT;
+            primitive.indexOffset = appendStream(converted, convertedBase, indices.data(),
+                                                 indices.size() * sizeof(unsigned int));
+            convertedStreams++;
         }
+        indexCount += primitive.indexCount;
+        primitives.push_back(primitive);
     }
     
-    // For each vertex of the triangle
-    for (unsigned int i = 0; i < vertexIndices.size(); i++)
+    if (primitives.empty())
     {
-        // Get the indices of its attributes
-        unsigned int vertexIndex = vertexIndices[i];
-        unsigned int uvIndex = uvIndices[i];
-        unsigned int normalIndex = normalIndices[i];
-        
-        // Get the attributes
-        glm::vec3 vertex = tempVertices[vertexIndex - 1];
-        glm::vec2 uv = tempUVs[uvIndex - 1];
-        glm::vec3 normal = tempNormals[normalIndex - 1];
-        
-        // Copy the attributes to the buffers
-        outVertices.push_back(vertex);
-        outUVs.push_back(uv);
-        outNormals.push_back(normal);
+        printf("%s has no triangles to draw\n", path);
+        glb.reset();
+        return false;
     }
     
-    // Placeholder: For now, we are not calculating tangents/bitangents from OBJ data.
-    // We will fill them with dummy data matching the vertex count if vertices were loaded.
-    // This allows the VBO setup to proceed without crashing.
-    // A proper implementation would calculate these based on vertex positions and UVs.
-    if (!outVertices.empty()) {
-        outTangents.resize(outVertices.size(), glm::vec3(1.0f, 0.0f, 0.0f)); // Dummy tangent
-        outBitangents.resize(outVertices.size(), glm::vec3(0.0f, 1.0f, 0.0f)); // Dummy bitangent
-        printf("Note: Tangents and Bitangents are currently NOT calculated from OBJ, using dummy data.\n");
-    } else {
-        // if outVertices is empty, make sure tangents/bitangents are also empty to avoid issues with &tangents[0]
-        outTangents.clear();
-        outBitangents.clear();
-    }
+    // Streams are floats as they are stored, decoded like compact vertices
+    compact = true;
+    positionOffset = glm::vec3(0.0f);
+    positionScale = glm::vec3(1.0f);
+    worldPerUv = uvArea > 0.0 ? static_cast<float>(sqrt(surfaceArea / uvArea)) : 1.0f;
+    lods[0].indexCount = indexCount;
     
-    // Close .obj file
-    fclose(file);
+    // Decode the embedded images the materials use here rather than on the GL thread
+    pendingImages.assign(file.images.size(), PendingImage());
+    std::vector<char> used(file.images.size(), 0);
+    for (size_t m = 0; m < file.materials.size(); m++)
+    {
+        // Colour is sRGB, normals are linear
+        int colour = file.materials[m].baseColorImage, normalMap = file.materials[m].normalImage;
+        if (colour >= 0 && !used[colour])
+        {
+            pendingImages[colour].params.srgb = true;
+            used[colour] = 1;
+        }
+        if (normalMap >= 0)
+            used[normalMap] = 1;
+    }
+    for (size_t i = 0; i < file.images.size(); i++)
+    {
+        if (!used[i])
+            continue;
+        
+        // glTF puts uv (0, 0) at the top left, the first row of the image
+        PendingImage &image = pendingImages[i];
+        image.params.flip = false;
+        if (!file.images[i].path.empty())
+        {
+            image.path = file.images[i].path;
+            continue;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "#image%u", (unsigned int)i);
+        std::string imageName = path + std::string(name);
+        image.key = AssetManager::textureKey(AssetManager::canonicalPath(path) + name, image.params);
+        image.source.reset(new TextureSource());
+        if (!loadTextureSourceMemory(imageName.c_str(), file.bin + file.images[i].offset, file.images[i].size,
+                                     image.params, *image.source))
+            image.source.reset();
+    }
     
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Loaded %s in %.2f ms: %u primitives, %u triangles, %u streams in place, %u converted (%lu bytes)\n",
+           path, seconds * 1000.0, (unsigned int)primitives.size(), indexCount / 3,
+           inPlaceStreams, convertedStreams, (unsigned long)converted.size());
     return true;
 }
 
-void Model::addTexture(const char *path, const std::string type)
-{
-    Texture texture;
-    texture.id = loadTexture(path);
-    texture.type = type;
-    textures.push_back(texture);
-}
-
-unsigned int Model::loadTexture(const char *path)
+void Model::setupGlbBuffers()
 {
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, numComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &numComponents, 0);
-    if (data)
+    // The binary chunk goes straight from the mapping to the GL, with the
+    // converted streams after it when there are any
+    const GlbFile &file = *glb;
+    glGenBuffers(1, &glbBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, glbBuffer);
+    if (converted.empty())
+        glBufferData(GL_ARRAY_BUFFER, file.binSize, file.bin, GL_STATIC_DRAW);
+    else
     {
-        GLenum format;
-        if (numComponents == 1)
-            format = GL_RED;
-        else if (numComponents == 3)
-            format = GL_RGB;
-        else if (numComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        size_t base = alignStream(file.binSize);
+        glBufferData(GL_ARRAY_BUFFER, base + converted.size(), NULL, GL_STATIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, file.binSize, file.bin);
+        glBufferSubData(GL_ARRAY_BUFFER, base, converted.size(), converted.data());
     }
-    else
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    for (size_t p = 0; p < primitives.size(); p++)
+    {
+        createStreamVertexArray(glbBuffer, primitives[p].streams, primitives[p].vao);
+        std::vector<VertexLayout>().swap(primitives[p].streams);
+    }
+    
+    // Images are shared like any other texture
+    AssetManager &assets = AssetManager::instance();
+    std::vector<TextureHandle> images(pendingImages.size());
+    for (size_t i = 0; i < pendingImages.size(); i++)
+    {
+        PendingImage &image = pendingImages[i];
+        if (image.source)
+        {
+            images[i] = assets.shareTexture(image.key, *image.source, image.params);
+            freeTextureSource(*image.source);
+        }
+        else if (!image.path.empty())
+            images[i] = assets.loadTexture(image.path.c_str(), image.params);
+    }
+    materials.assign(file.materials.size(), std::vector<Texture>());
+    for (size_t m = 0; m < file.materials.size(); m++)
     {
-        std::cout << "Texture " << path << " failed to load." << std::endl;
-        stbi_image_free(data);
+        int slots[2] = { file.materials[m].baseColorImage, file.materials[m].normalImage };
+        const char *types[2] = { "diffuse", "normal" };
+        for (int s = 0; s < 2; s++)
+        {
+            if (slots[s] < 0 || !images[slots[s]])
+                continue;
+            Texture texture;
+            texture.asset = images[slots[s]];
+            texture.type = types[s];
+            texture.sampler = uniformId((texture.type + "Map").c_str());
+            materials[m].push_back(texture);
+        }
     }
+    
+    // Everything is on the GPU, unmap the file
+    pendingImages.clear();
+    std::vector<char>().swap(converted);
+    glb.reset();
+}
+
+void Model::optimizeMesh(std::vector<glm::vec3> &inVertices,
+                         std::vector<glm::vec2> &inUVs,
+                         std::vector<glm::vec3> &inNormals,
+                         std::vector<unsigned int> &inIndices)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    VertexCacheStats before = analyzeVertexCache(inIndices, inVertices.size());
+    
+    // Reorder triangles for the post-transform cache, then optionally for overdraw
+    optimizeVertexCache(inIndices, inVertices.size());
+    if (reduceOverdraw)
+        optimizeOverdraw(inIndices, inVertices);
+    
+    // Lay vertices out in the order they are first used
+    optimizeVertexFetch(inIndices, inVertices, inUVs, inNormals);
+    
+    VertexCacheStats after = analyzeVertexCache(inIndices, inVertices.size());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Optimized mesh in %.2f ms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (cache size %u)\n",
+           seconds * 1000.0, before.acmr, after.acmr, before.atvr, after.atvr, vertexCacheSize);
+}
 
-    return textureID;
+void Model::addTexture(const char *path, const std::string type, const TextureParams &params)
+{
+    // Plain white if the file can't be loaded
+    AssetManager &assets = AssetManager::instance();
+    Texture texture;
+    texture.asset = assets.loadTexture(path, params);
+    if (!texture.asset)
+        texture.asset = assets.solidTexture(255, 255, 255);
+    texture.type = type;
+    texture.sampler = uniformId((type + "Map").c_str());
+    textures.push_back(texture);
 }
@@ -3,63 +3,195 @@
 #include <vector>
 #include <stdio.h>
 #include <string>
+#include <memory>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "meshlet.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_simplifier.hpp"
+#include "vertex_layout.hpp"
+#include "texture.hpp"
+#include "glb_loader.hpp"
+#include "shader_program.hpp"
+#include "instance_batch.hpp"
+
+class Camera; // Only referenced, so programs with their own camera can include this
+
 // Texture struct
 struct Texture
 {
-    unsigned int id;
+    TextureHandle asset;
     std::string type;
+    UniformId sampler; // Hash of its sampler uniform, type + "Map"
 };
 
 class Model
 {
 public:
-    // Model attributes
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec2> uvs;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec3> tangents;
-    std::vector<glm::vec3> bitangents;
+    // Model attributes, the vertices and indices only live on the GPU
+    std::vector<Meshlet>   meshlets;
+    std::vector<MeshLod>   lods;
+    unsigned int currentLod;
     std::vector<Texture>   textures;
+    glm::vec3 boundsMin, boundsMax;
     unsigned int textureID;
     float ka, kd, ks, Ns;
     
-    // Constructor
+    // Threads used to parse .obj files (0 = all cores, 1 = serial)
+    static unsigned int objLoaderThreads;
+    
+    // Also reorder triangles to reduce overdraw when building meshes
+    static bool reduceOverdraw;
+    
+    // Levels of detail built per mesh, including the full mesh (1 = no simplification)
+    static unsigned int maxLods;
+    
+    // Upload 20 byte quantized vertices instead of 40 byte float and QTangent ones
+    static bool compactVertices;
+    
+    // Constructor, loads and uploads the model
     Model(const char *path);
     
+    // Empty model that draws nothing until it's loaded and uploaded
+    Model();
+    
+    // Read the mesh cache or build it from the .obj file, or map a .glb file and
+    // decode its images. Touches no GL state, so it can run on a loading thread
+    bool load(const char *path);
+    
+    // Create the GL buffers, on the thread that owns the context
+    void upload();
+    
+    // Whether the buffers have been uploaded and the model can be drawn
+    bool ready() const { return vertexArray.vao != 0 || glbBuffer != 0; }
+    
     // Draw model
-    void draw(unsigned int &shaderID);
+    void draw(ShaderProgram &shader);
+    
+    // Draw each instance of a batch with the selected level. Without material
+    // textures that is one call, otherwise one per material with its texture on unit 0
+    void drawInstanced(ShaderProgram &shader, InstanceBatch &batch,
+                       const std::vector<TextureHandle> &materialTextures = std::vector<TextureHandle>());
+    
+    // Vertex array drawn first, to sort the model's draws by
+    GLuint vao() const { return primitives.empty() ? vertexArray.vao : primitives[0].vao; }
+    
+    // Draw only the meshlets that are on screen and facing the camera
+    void drawClusters(ShaderProgram &shader, const glm::mat4 &modelMatrix,
+                      const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix);
+    
+    // Pick the level of detail drawn next from its projected error in pixels
+    unsigned int selectLod(const glm::mat4 &modelMatrix, const Camera &camera,
+                           float viewportHeight, float maxPixelError = 1.0f);
+    unsigned int selectLod(const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix,
+                           const glm::mat4 &projectionMatrix, float viewportHeight,
+                           float maxPixelError = 1.0f);
+    
+    // World units covered by one uv unit, from the ratio of surface to uv area
+    float worldPerUv;
     
-    // Add textures
-    void addTexture(const char *path, const std::string type);
+    // Screen pixels covered by one uv unit at the nearest point of the bounds,
+    // the texel density a texture on this model needs to look sharp
+    float uvDensity(const glm::mat4 &modelMatrix, const glm::mat4 &viewMatrix,
+                    const glm::mat4 &projectionMatrix, float viewportHeight) const;
+    
+    // Meshlets and triangles submitted by the last drawClusters call
+    unsigned int drawnClusters;
+    unsigned int drawnTriangles;
+    
+    // Add textures, shared through AssetManager
+    void addTexture(const char *path, const std::string type,
+                    const TextureParams &params = TextureParams());
     
     // Cleanup
     void deleteBuffers();
     
 private:
     
-    // Array buffers
-    unsigned int VAO;
-    unsigned int vertexBuffer;
-    unsigned int uvBuffer;
-    unsigned int normalBuffer;
-    unsigned int tangentBuffer;
-    unsigned int bitangentBuffer;
+    // One interleaved vertex buffer and the element buffer
+    VertexArray vertexArray;
+    
+    // Kept from load until upload: the mapped .mesh cache or the streams built from the .obj
+    MeshData meshData;
+    GLenum indexType;
+    
+    // Compact vertex decode, positionOffset + position * positionScale
+    bool compact;
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+    
+    // Primitives of a model loaded from a .glb file, drawn one by one. Their
+    // streams point into one buffer holding the file's binary chunk, followed by
+    // the streams that had to be converted
+    struct Primitive
+    {
+        std::vector<VertexLayout> streams;
+        GLenum indexType;
+        size_t indexOffset;
+        unsigned int indexCount;
+        int material;
+        GLuint vao;
+    };
+    std::vector<Primitive> primitives;
+    std::vector<std::vector<Texture> > materials;
+    GLuint glbBuffer;
+    
+    // Index runs of the visible meshlets, reused by every drawClusters call
+    std::vector<GLsizei> runCounts;
+    std::vector<const void *> runOffsets;
+    
+    // An image of a .glb file, embedded ones are decoded on the loading thread
+    struct PendingImage
+    {
+        std::string key;  // Shared under this key through AssetManager
+        std::string path; // File next to the .glb when it isn't embedded
+        TextureParams params;
+        std::shared_ptr<TextureSource> source;
+    };
+    
+    // Kept from load until upload: the mapped file, converted streams and images
+    std::shared_ptr<GlbFile> glb;
+    std::vector<char> converted;
+    std::vector<PendingImage> pendingImages;
     
     // Load .obj file method
     bool loadObj(const char *path,
                  std::vector<glm::vec3> &inVertices,
                  std::vector<glm::vec2> &inUVs,
                  std::vector<glm::vec3> &inNormals,
-                 std::vector<glm::vec3> &inTangents,
-                 std::vector<glm::vec3> &inBitangents);
+                 std::vector<unsigned int> &inIndices);
+    
+    // Load .glb file method, streams the GPU can read as they are stay in the file
+    bool loadGlb(const char *path);
+    
+    // Upload the binary chunk and converted streams of a .glb file and its images
+    void setupGlbBuffers();
+    
+    // Bind textures to consecutive units and their samplers
+    void bindTextures(ShaderProgram &shader, const std::vector<Texture> &bound);
+    
+    // Draw elements of the bound vertex array for each material range of a batch
+    void drawInstanceRanges(GLsizei indexCount, GLenum type, const void *offset, InstanceBatch &batch,
+                            const std::vector<TextureHandle> &materialTextures);
+    
+    // Parse the .obj file and build the streams, levels and meshlets in meshData
+    bool buildMesh(const char *path);
+    
+    // Reorder triangles and vertices for the GPU caches
+    void optimizeMesh(std::vector<glm::vec3> &inVertices,
+                      std::vector<glm::vec2> &inUVs,
+                      std::vector<glm::vec3> &inNormals,
+                      std::vector<unsigned int> &inIndices);
+    
+    // Send material properties and textures to the shader
+    void bindMaterial(ShaderProgram &shader);
     
-    // Setup buffers
+    // Upload the interleaved vertices and the indices in meshData
     void setupBuffers();
     
-    // Load texture
-    unsigned int loadTexture(const char *path);
+    // Pick a level from the camera position in world space
+    unsigned int selectLod(const glm::mat4 &modelMatrix, const glm::vec3 &cameraPosition,
+                           float fovY, float viewportHeight, float maxPixelError);
 };
@@ -0,0 +1,592 @@
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include "obj_loader.hpp"
+#include "vfs.hpp"
+#include "thread_pool.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Record counts used to pre-size the attribute pools
+struct ObjCounts
+{
+    size_t positions;
+    size_t uvs;
+    size_t normals;
+    size_t faces;
+};
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline const char *skipBlanks(const char *p, const char *end)
+{
+    while (p < end && isBlank(*p))
+        p++;
+    return p;
+}
+
+static inline const char *nextLine(const char *p, const char *end)
+{
+    if (p >= end)
+        return end;
+    const char *eol = static_cast<const char *>(memchr(p, '\n', static_cast<size_t>(end - p)));
+    return eol ? eol + 1 : end;
+}
+
+// Exactly representable powers of ten
+static const double powersOf10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Parse a decimal float, returns NULL if there are no digits
+static inline const char *parseFloat(const char *p, const char *end, float &out)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    // Keep up to 19 significant digits in an integer mantissa
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool anyDigits = false;
+
+    while (p < end && isDigit(*p))
+    {
+        if (significant < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0)
+                significant++;
+        }
+        else
+        {
+            exponent++;
+        }
+        anyDigits = true;
+        p++;
+    }
+
+    if (p < end && *p == '.')
+    {
+        p++;
+        while (p < end && isDigit(*p))
+        {
+            if (significant < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0)
+                    significant++;
+                exponent--;
+            }
+            anyDigits = true;
+            p++;
+        }
+    }
+
+    if (!anyDigits)
+        return NULL;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+'))
+        {
+            negativeExponent = *q == '-';
+            q++;
+        }
+        if (q < end && isDigit(*q))
+        {
+            int value = 0;
+            while (q < end && isDigit(*q))
+            {
+                if (value < 10000)
+                    value = value * 10 + (*q - '0');
+                q++;
+            }
+            exponent += negativeExponent ? -value : value;
+            p = q;
+        }
+    }
+
+    double value = static_cast<double>(mantissa);
+    if (mantissa != 0 && exponent != 0)
+    {
+        if (exponent > 0 && exponent <= 22)
+            value *= powersOf10[exponent];
+        else if (exponent < 0 && exponent >= -22)
+            value /= powersOf10[-exponent];
+        else
+            value *= pow(10.0, exponent);
+    }
+
+    out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+// Parse a signed decimal integer, returns NULL if there are no digits
+static inline const char *parseInt(const char *p, const char *end, int &out)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    if (p >= end || !isDigit(*p))
+        return NULL;
+
+    int value = 0;
+    while (p < end && isDigit(*p))
+    {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+
+    out = negative ? -value : value;
+    return p;
+}
+
+// Convert a 1-based (or negative, relative) .obj index to 0-based
+static inline int resolveIndex(int index, size_t count)
+{
+    if (index > 0)
+        return index - 1;
+    if (index < 0)
+        return static_cast<int>(count) + index;
+    return -1;
+}
+
+static void countRecords(const char *p, const char *end, ObjCounts &counts)
+{
+    while (p < end)
+    {
+        p = skipBlanks(p, end);
+        if (end - p >= 2)
+        {
+            if (p[0] == 'v')
+            {
+                if (isBlank(p[1]))
+                    counts.positions++;
+                else if (p[1] == 't')
+                    counts.uvs++;
+                else if (p[1] == 'n')
+                    counts.normals++;
+            }
+            else if (p[0] == 'f' && isBlank(p[1]))
+            {
+                counts.faces++;
+            }
+        }
+        p = nextLine(p, end);
+    }
+}
+
+static inline bool isLineEnd(const char *p, const char *end)
+{
+    return p >= end || *p == '\n';
+}
+
+// One line-aligned slice of the file. Attributes are written straight into
+// the mesh pools at the chunk's offsets, corners are kept per chunk and
+// concatenated once every chunk is done
+struct ObjChunk
+{
+    const char *begin;
+    const char *end;
+    ObjCounts counts;   // Records in this chunk
+    ObjCounts base;     // Records in all earlier chunks
+    std::vector<ObjCorner> corners;
+    bool ok;
+};
+
+// Parse one "f" record after its keyword, returns NULL if it is malformed.
+// "seen" holds the number of attributes defined before this line
+static const char *parseFace(const char *p, const char *end, const ObjCounts &seen,
+                             std::vector<ObjCorner> &corners)
+{
+    ObjCorner first = { -1, -1, -1 };
+    ObjCorner previous = { -1, -1, -1 };
+    int cornerCount = 0;
+
+    while (true)
+    {
+        p = skipBlanks(p, end);
+        if (isLineEnd(p, end))
+            break;
+
+        // v, v/vt, v//vn or v/vt/vn
+        int position = 0, uv = 0, normal = 0;
+        p = parseInt(p, end, position);
+        if (!p)
+            return NULL;
+        if (p < end && *p == '/')
+        {
+            p++;
+            if (p < end && *p != '/')
+            {
+                p = parseInt(p, end, uv);
+                if (!p)
+                    return NULL;
+            }
+            if (p < end && *p == '/')
+            {
+                p = parseInt(p + 1, end, normal);
+                if (!p)
+                    return NULL;
+            }
+        }
+        if (!isLineEnd(p, end) && !isBlank(*p))
+            return NULL;
+
+        ObjCorner corner;
+        corner.position = resolveIndex(position, seen.positions);
+        corner.uv       = resolveIndex(uv, seen.uvs);
+        corner.normal   = resolveIndex(normal, seen.normals);
+        if (corner.position < 0)
+            return NULL;
+
+        // Triangulate polygons as a fan around the first corner
+        if (cornerCount == 0)
+            first = corner;
+        if (cornerCount >= 2)
+        {
+            corners.push_back(first);
+            corners.push_back(previous);
+            corners.push_back(corner);
+        }
+        previous = corner;
+        cornerCount++;
+    }
+
+    return cornerCount >= 3 ? p : NULL;
+}
+
+// Parse "count" blank separated floats, returns NULL if any are missing
+static inline const char *parseFloats(const char *p, const char *end, float *out, int count)
+{
+    for (int i = 0; i < count && p; i++)
+        p = parseFloat(skipBlanks(p, end), end, out[i]);
+    return p;
+}
+
+static bool parseRecords(ObjChunk &chunk, ObjMesh &mesh)
+{
+    // Running totals, starting from the records in earlier chunks
+    ObjCounts seen = chunk.base;
+    const ObjCounts limit =
+    {
+        chunk.base.positions + chunk.counts.positions,
+        chunk.base.uvs + chunk.counts.uvs,
+        chunk.base.normals + chunk.counts.normals,
+        chunk.base.faces + chunk.counts.faces
+    };
+
+    chunk.corners.reserve(chunk.counts.faces * 3);
+
+    const char *p = chunk.begin;
+    const char *end = chunk.end;
+    while (p < end)
+    {
+        p = skipBlanks(p, end);
+        if (end - p < 2)
+            break;
+
+        const char *q = p;
+        if (p[0] == 'v' && isBlank(p[1]))
+        {
+            // Read vertices
+            if (seen.positions >= limit.positions)
+                return false;
+            glm::vec3 &vertex = mesh.positions[seen.positions++];
+            q = parseFloats(p + 1, end, &vertex.x, 3);
+            if (!q)
+                return false;
+        }
+        else if (p[0] == 'v' && p[1] == 't')
+        {
+            // Read texture co-ordinates, v is optional
+            if (seen.uvs >= limit.uvs)
+                return false;
+            glm::vec2 &uv = mesh.uvs[seen.uvs++];
+            q = parseFloats(p + 2, end, &uv.x, 1);
+            if (!q)
+                return false;
+            q = skipBlanks(q, end);
+            if (!isLineEnd(q, end))
+                parseFloat(q, end, uv.y);
+        }
+        else if (p[0] == 'v' && p[1] == 'n')
+        {
+            // Read vertex normals
+            if (seen.normals >= limit.normals)
+                return false;
+            glm::vec3 &normal = mesh.normals[seen.normals++];
+            q = parseFloats(p + 2, end, &normal.x, 3);
+            if (!q)
+                return false;
+        }
+        else if (p[0] == 'f' && isBlank(p[1]))
+        {
+            // Read vertex indices
+            q = parseFace(p + 1, end, seen, chunk.corners);
+            if (!q)
+                return false;
+        }
+
+        // Skip the rest of the line, anything else (comments, groups, materials) is ignored
+        p = nextLine(q, end);
+    }
+
+    return true;
+}
+
+// Below this many bytes per thread splitting costs more than it saves
+static const size_t minChunkBytes = 1 << 20;
+
+bool parseObj(const char *path, ObjMesh &mesh, ObjLoadStats &stats, unsigned int threadCount)
+{
+    memset(&stats, 0, sizeof(stats));
+    mesh = ObjMesh();
+
+    Clock::time_point start = Clock::now();
+    VfsFile file;
+    if (!file.open(path))
+    {
+        printf("Impossible to open the file. Check paths and directories.\n");
+        return false;
+    }
+    stats.fileBytes = file.size();
+    stats.mapSeconds = secondsSince(start);
+
+    const char *begin = file.data();
+    const char *end = begin + file.size();
+
+    // Split the file into line-aligned chunks, one per thread
+    unsigned int threads = threadCount > 0 ? threadCount : ThreadPool::hardwareThreads();
+    size_t chunkCount = file.size() / minChunkBytes;
+    if (chunkCount > threads)
+        chunkCount = threads;
+    if (chunkCount < 1)
+        chunkCount = 1;
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char *chunkBegin = begin;
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        const char *chunkEnd = end;
+        if (i + 1 < chunkCount)
+            chunkEnd = nextLine(std::max(chunkBegin, begin + file.size() / chunkCount * (i + 1)), end);
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunks[i].ok = true;
+        chunkBegin = chunkEnd;
+    }
+    stats.threads = threads < chunkCount ? threads : static_cast<unsigned int>(chunkCount);
+    stats.chunks = chunkCount;
+
+    // Count records first so the pools are allocated once
+    start = Clock::now();
+    runParallel(chunkCount, threads, [&chunks](size_t i)
+    {
+        ObjCounts counts = { 0, 0, 0, 0 };
+        countRecords(chunks[i].begin, chunks[i].end, counts);
+        chunks[i].counts = counts;
+    });
+
+    // Prefix sums give each chunk its offset into the pools
+    ObjCounts total = { 0, 0, 0, 0 };
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        chunks[i].base = total;
+        total.positions += chunks[i].counts.positions;
+        total.uvs += chunks[i].counts.uvs;
+        total.normals += chunks[i].counts.normals;
+        total.faces += chunks[i].counts.faces;
+    }
+    mesh.positions.resize(total.positions);
+    mesh.uvs.resize(total.uvs);
+    mesh.normals.resize(total.normals);
+    stats.countSeconds = secondsSince(start);
+
+    start = Clock::now();
+    runParallel(chunkCount, threads, [&chunks, &mesh](size_t i)
+    {
+        chunks[i].ok = parseRecords(chunks[i], mesh);
+    });
+    stats.parseSeconds = secondsSince(start);
+
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        if (!chunks[i].ok)
+        {
+            printf("File can't be read by loadObj().\n");
+            return false;
+        }
+    }
+
+    // Concatenate the corners in file order
+    start = Clock::now();
+    if (chunkCount == 1)
+    {
+        mesh.corners.swap(chunks[0].corners);
+    }
+    else
+    {
+        std::vector<size_t> cornerBase(chunkCount + 1, 0);
+        for (size_t i = 0; i < chunkCount; i++)
+            cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+
+        mesh.corners.resize(cornerBase[chunkCount]);
+        runParallel(chunkCount, threads, [&chunks, &mesh, &cornerBase](size_t i)
+        {
+            if (!chunks[i].corners.empty())
+                memcpy(&mesh.corners[cornerBase[i]], &chunks[i].corners[0],
+                       chunks[i].corners.size() * sizeof(ObjCorner));
+            std::vector<ObjCorner>().swap(chunks[i].corners);
+        });
+    }
+    stats.mergeSeconds = secondsSince(start);
+
+    // Check every corner refers to an attribute that exists
+    const int positionCount = static_cast<int>(mesh.positions.size());
+    const int uvCount = static_cast<int>(mesh.uvs.size());
+    const int normalCount = static_cast<int>(mesh.normals.size());
+    for (size_t i = 0; i < mesh.corners.size(); i++)
+    {
+        const ObjCorner &corner = mesh.corners[i];
+        if (corner.position < 0 || corner.position >= positionCount ||
+            corner.uv >= uvCount || corner.normal >= normalCount ||
+            corner.uv < -1 || corner.normal < -1)
+        {
+            printf("File can't be read by loadObj(): face index out of range.\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static inline size_t hashCorner(const ObjCorner &corner)
+{
+    uint64_t key = static_cast<uint32_t>(corner.position);
+    key = key * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(corner.uv);
+    key = key * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(corner.normal);
+    return static_cast<size_t>(key ^ (key >> 29));
+}
+
+static inline bool sameCorner(const ObjCorner &a, const ObjCorner &b)
+{
+    return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+}
+
+void indexObj(const ObjMesh &mesh,
+              std::vector<glm::vec3> &outVertices,
+              std::vector<glm::vec2> &outUVs,
+              std::vector<glm::vec3> &outNormals,
+              std::vector<unsigned int> &outIndices,
+              ObjLoadStats &stats)
+{
+    Clock::time_point start = Clock::now();
+
+    const size_t count = mesh.corners.size();
+    const unsigned int emptySlot = 0xFFFFFFFFu;
+
+    // Open addressing table from corner to vertex number, kept under half full
+    size_t capacity = 16;
+    while (capacity < count * 2)
+        capacity <<= 1;
+    std::vector<unsigned int> slots(capacity, emptySlot);
+
+    std::vector<ObjCorner> unique;
+    unique.reserve(count / 2 + 1);
+    outIndices.resize(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const ObjCorner &corner = mesh.corners[i];
+        size_t slot = hashCorner(corner) & (capacity - 1);
+        while (slots[slot] != emptySlot && !sameCorner(unique[slots[slot]], corner))
+            slot = (slot + 1) & (capacity - 1);
+
+        if (slots[slot] == emptySlot)
+        {
+            slots[slot] = static_cast<unsigned int>(unique.size());
+            unique.push_back(corner);
+        }
+        outIndices[i] = slots[slot];
+    }
+
+    // Copy the attributes of each unique vertex to the buffers
+    const size_t vertexCount = unique.size();
+    outVertices.resize(vertexCount);
+    outUVs.resize(vertexCount);
+    outNormals.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const ObjCorner &corner = unique[i];
+        outVertices[i] = mesh.positions[corner.position];
+        outUVs[i]      = corner.uv >= 0 ? mesh.uvs[corner.uv] : glm::vec2(0.0f);
+        outNormals[i]  = corner.normal >= 0 ? mesh.normals[corner.normal] : glm::vec3(0.0f);
+    }
+
+    stats.uniqueVertices = vertexCount;
+    stats.indexSeconds = secondsSince(start);
+}
+
+void printObjLoadReport(const char *path, const ObjMesh &mesh, const ObjLoadStats &stats)
+{
+    double total = stats.mapSeconds + stats.countSeconds + stats.parseSeconds +
+                   stats.mergeSeconds + stats.indexSeconds;
+    double megabytes = stats.fileBytes / (1024.0 * 1024.0);
+
+    printf("Loaded %s: %u positions, %u uvs, %u normals, %u triangles\n", path,
+           static_cast<unsigned int>(mesh.positions.size()),
+           static_cast<unsigned int>(mesh.uvs.size()),
+           static_cast<unsigned int>(mesh.normals.size()),
+           static_cast<unsigned int>(mesh.corners.size() / 3));
+    printf("  %.1f MB in %.2f ms on %u thread(s), %u chunk(s) "
+           "(map %.2f, count %.2f, parse %.2f, merge %.2f), %.0f MB/s\n",
+           megabytes, total * 1000.0, stats.threads, static_cast<unsigned int>(stats.chunks),
+           stats.mapSeconds * 1000.0, stats.countSeconds * 1000.0,
+           stats.parseSeconds * 1000.0, stats.mergeSeconds * 1000.0,
+           total > 0.0 ? megabytes / total : 0.0);
+
+    if (stats.uniqueVertices > 0)
+    {
+        size_t corners = mesh.corners.size();
+        printf("  indexed in %.2f ms: %u unique vertices for %u corners (%.1fx fewer)\n",
+               stats.indexSeconds * 1000.0,
+               static_cast<unsigned int>(stats.uniqueVertices),
+               static_cast<unsigned int>(corners),
+               static_cast<double>(corners) / stats.uniqueVertices);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Indices of one face corner into the .obj attribute pools (0-based, -1 if absent)
+struct ObjCorner
+{
+    int position;
+    int uv;
+    int normal;
+};
+
+// Attribute pools and triangulated faces read from an .obj file
+struct ObjMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    std::vector<ObjCorner> corners; // Three per triangle
+};
+
+// Sizes and timings collected while loading
+struct ObjLoadStats
+{
+    size_t fileBytes;
+    double mapSeconds;
+    double countSeconds;
+    double parseSeconds;
+    double mergeSeconds;
+    double indexSeconds;
+    size_t uniqueVertices;
+    unsigned int threads;
+    size_t chunks;
+};
+
+// Memory-map and parse an .obj file, polygons are triangulated as fans.
+// Large files are split at line boundaries and parsed on threadCount threads
+// (0 = all cores, 1 = serial), the result is identical for any thread count
+bool parseObj(const char *path, ObjMesh &mesh, ObjLoadStats &stats, unsigned int threadCount = 0);
+
+// Build a table of unique (position, uv, normal) vertices and an index
+// buffer with three indices per triangle (the layout glDrawElements expects)
+void indexObj(const ObjMesh &mesh,
+              std::vector<glm::vec3> &outVertices,
+              std::vector<glm::vec2> &outUVs,
+              std::vector<glm::vec3> &outNormals,
+              std::vector<unsigned int> &outIndices,
+              ObjLoadStats &stats);
+
+// Print counts, timings and throughput of a load
+void printObjLoadReport(const char *path, const ObjMesh &mesh, const ObjLoadStats &stats);
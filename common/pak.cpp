@@ -0,0 +1,257 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "pak.hpp"
+#include "lz_block.hpp"
+#include "hash.hpp"
+
+// Bump whenever the layout below changes
+static const uint32_t pakVersion = 1;
+static const char pakMagic[4] = { 'P', 'A', 'K', 'C' };
+
+// Files and the table of contents start on this boundary, so cooked meshes
+// and textures can be read in place like their own cache files
+static const uint64_t pakAlignment = 16;
+
+struct PakHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint64_t entryCount;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + pakAlignment - 1) & ~(pakAlignment - 1);
+}
+
+PakArchive::PakArchive()
+    : data(NULL), size(0), entries(NULL), names(NULL), count(0)
+{
+}
+
+bool PakArchive::open(const char *path)
+{
+    if (!file.open(path))
+        return false;
+    archiveName = path;
+    data = file.data();
+    size = file.size();
+    if (!parse())
+    {
+        printf("Pak %s is corrupt.\n", path);
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+bool PakArchive::openMemory(const void *memory, size_t memorySize, const char *name)
+{
+    archiveName = name;
+    data = static_cast<const char *>(memory);
+    size = memorySize;
+    if (!parse())
+    {
+        printf("Pak %s is corrupt.\n", name);
+        return false;
+    }
+    return true;
+}
+
+bool PakArchive::parse()
+{
+    PakHeader header;
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, pakMagic, sizeof(pakMagic)) != 0 || header.version != pakVersion)
+        return false;
+
+    // The table and the names must lie inside the pak
+    if (header.tocOffset % pakAlignment != 0 || header.tocOffset > size ||
+        header.entryCount > (size - header.tocOffset) / sizeof(PakEntry) ||
+        header.namesOffset > size || header.namesSize > size - header.namesOffset)
+        return false;
+    entries = reinterpret_cast<const PakEntry *>(data + header.tocOffset);
+    names = data + header.namesOffset;
+    count = static_cast<size_t>(header.entryCount);
+
+    // And so must every file, in place or decompressed into a copy
+    for (size_t i = 0; i < count; i++)
+    {
+        const PakEntry &entry = entries[i];
+        if (entry.nameOffset > header.namesSize || entry.nameLength > header.namesSize - entry.nameOffset ||
+            entry.offset % pakAlignment != 0 || entry.offset > size || entry.storedSize > size - entry.offset ||
+            ((entry.flags & PakCompressed) == 0 && entry.storedSize != entry.size))
+            return false;
+    }
+    return true;
+}
+
+std::string PakArchive::entryName(const PakEntry &entry) const
+{
+    return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+// Byte order of a name against an entry's name, as the table is sorted
+static int compareName(const std::string &name, const char *entryName, size_t entryLength)
+{
+    size_t length = std::min(name.size(), entryLength);
+    int order = memcmp(name.data(), entryName, length);
+    if (order != 0)
+        return order;
+    return name.size() < entryLength ? -1 : (name.size() > entryLength ? 1 : 0);
+}
+
+const PakEntry *PakArchive::find(const std::string &name) const
+{
+    size_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        int order = compareName(name, names + entries[mid].nameOffset, entries[mid].nameLength);
+        if (order == 0)
+            return &entries[mid];
+        if (order < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return NULL;
+}
+
+bool PakArchive::decompress(const PakEntry &entry, std::vector<char> &out) const
+{
+    out.resize(static_cast<size_t>(entry.size));
+    const uint8_t *stored = reinterpret_cast<const uint8_t *>(storedData(entry));
+    bool ok;
+    if (entry.flags & PakCompressed)
+        ok = lzDecompress(stored, static_cast<size_t>(entry.storedSize),
+                          reinterpret_cast<uint8_t *>(out.data()), out.size());
+    else
+    {
+        memcpy(out.data(), stored, out.size());
+        ok = true;
+    }
+    if (!ok || hashBytes(out.data(), out.size()) != entry.hash)
+    {
+        printf("Pak %s has a corrupt copy of %s.\n", archiveName.c_str(), entryName(entry).c_str());
+        return false;
+    }
+    return true;
+}
+
+void PakWriter::add(const std::string &name, const void *contents, size_t size, bool compress)
+{
+    // A later file of the same name replaces the earlier one
+    size_t index = files.size();
+    for (size_t i = 0; i < files.size(); i++)
+        if (files[i].name == name)
+            index = i;
+    if (index == files.size())
+        files.push_back(File());
+
+    File &added = files[index];
+    added.name = name;
+    added.size = size;
+    added.hash = hashBytes(contents, size);
+    added.flags = 0;
+
+    const char *bytes = static_cast<const char *>(contents);
+    if (compress && size > 0)
+    {
+        added.stored.resize(lzCompressBound(size));
+        size_t compressedSize = lzCompress(reinterpret_cast<const uint8_t *>(bytes), size,
+                                           reinterpret_cast<uint8_t *>(added.stored.data()));
+        if (compressedSize <= size - size / 8)
+        {
+            added.stored.resize(compressedSize);
+            added.flags = PakCompressed;
+        }
+    }
+    if (added.flags == 0)
+        added.stored.assign(bytes, bytes + size);
+}
+
+static bool writeBytes(FILE *file, uint64_t offset, const void *data, size_t bytes)
+{
+    if (bytes == 0)
+        return true;
+    return fseek(file, static_cast<long>(offset), SEEK_SET) == 0 &&
+           fwrite(data, 1, bytes, file) == bytes;
+}
+
+bool PakWriter::write(const char *path)
+{
+    // Sorted for binary search, which also makes the output reproducible
+    std::vector<size_t> order(files.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return files[a].name < files[b].name; });
+
+    std::vector<PakEntry> entries(files.size());
+    std::string names;
+    uint64_t offset = alignUp(sizeof(PakHeader));
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const File &source = files[order[i]];
+        PakEntry &entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        entry.nameOffset = names.size();
+        entry.nameLength = static_cast<uint32_t>(source.name.size());
+        entry.flags = source.flags;
+        entry.offset = offset;
+        entry.storedSize = source.stored.size();
+        entry.size = source.size;
+        entry.hash = source.hash;
+        names += source.name;
+        offset = alignUp(offset + entry.storedSize);
+    }
+
+    PakHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, pakMagic, sizeof(pakMagic));
+    header.version = pakVersion;
+    header.entryCount = entries.size();
+    header.tocOffset = offset;
+    header.namesOffset = offset + entries.size() * sizeof(PakEntry);
+    header.namesSize = names.size();
+
+    // Write to a temporary file and rename it so a crash never leaves half a pak.
+    // The gaps between files are zero, fseek past the end fills them
+    std::string tempPath = std::string(path) + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == NULL)
+    {
+        printf("Can't write pak %s.\n", path);
+        return false;
+    }
+
+    bool ok = writeBytes(file, 0, &header, sizeof(header));
+    for (size_t i = 0; ok && i < order.size(); i++)
+        ok = writeBytes(file, entries[i].offset, files[order[i]].stored.data(), files[order[i]].stored.size());
+    ok = ok && writeBytes(file, header.tocOffset, entries.data(), entries.size() * sizeof(PakEntry)) &&
+         writeBytes(file, header.namesOffset, names.data(), names.size());
+    ok = fclose(file) == 0 && ok;
+
+    if (ok)
+    {
+        remove(path);
+        ok = rename(tempPath.c_str(), path) == 0;
+    }
+    if (!ok)
+    {
+        remove(tempPath.c_str());
+        printf("Can't write pak %s.\n", path);
+        return false;
+    }
+    return true;
+}
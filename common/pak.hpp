@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mapped_file.hpp"
+
+// Flags of a file stored in a pak
+enum PakEntryFlags
+{
+    PakCompressed = 1 // Stored with lzCompress, read into a copy instead of in place
+};
+
+// Table of contents entry of a file in a pak, sorted by name
+struct PakEntry
+{
+    uint64_t nameOffset; // Into the names block
+    uint32_t nameLength;
+    uint32_t flags;
+    uint64_t offset;     // Of the stored bytes, from the start of the pak
+    uint64_t storedSize;
+    uint64_t size;       // Once decompressed
+    uint64_t hash;       // hashBytes of the decompressed contents
+};
+
+// Read-only archive of cooked assets: the files one after another on 16 byte
+// boundaries, then a table of contents and the names. Uncompressed files are
+// read in place from the mapping
+class PakArchive
+{
+public:
+    PakArchive();
+
+    // Map a pak file, returns false if it can't be opened or is corrupt
+    bool open(const char *path);
+
+    // Use a pak already in memory, e.g. embedded in the executable. The memory
+    // isn't copied and must outlive the archive
+    bool openMemory(const void *data, size_t size, const char *name);
+
+    // Entry of the file with this name, or NULL
+    const PakEntry *find(const std::string &name) const;
+
+    // Stored bytes of an entry, the contents themselves unless it's compressed
+    const char *storedData(const PakEntry &entry) const { return data + entry.offset; }
+
+    // Decompress an entry into out. Returns false if it is corrupt
+    bool decompress(const PakEntry &entry, std::vector<char> &out) const;
+
+    const std::string &name() const { return archiveName; }
+    size_t entryCount() const { return count; }
+    const PakEntry &entry(size_t index) const { return entries[index]; }
+    std::string entryName(const PakEntry &entry) const;
+
+private:
+    MappedFile file;
+    std::string archiveName;
+    const char *data;
+    size_t size;
+    const PakEntry *entries;
+    const char *names;
+    size_t count;
+
+    bool parse();
+
+    // Mappings are owned, so they can't be copied
+    PakArchive(const PakArchive &);
+    PakArchive &operator=(const PakArchive &);
+};
+
+// Builds a pak from files added in any order. The output only depends on the
+// files, so cooking the same assets twice gives the same bytes
+class PakWriter
+{
+public:
+    // Add a file. With compress it is stored compressed if that saves at least
+    // an eighth of its size
+    void add(const std::string &name, const void *contents, size_t size, bool compress);
+
+    // Write the pak, returns false if it can't be written
+    bool write(const char *path);
+
+    size_t fileCount() const { return files.size(); }
+
+private:
+    struct File
+    {
+        std::string name;
+        std::vector<char> stored;
+        uint64_t size;
+        uint64_t hash;
+        uint32_t flags;
+    };
+    std::vector<File> files;
+};
@@ -0,0 +1,200 @@
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#include "render_queue.hpp"
+
+// Marks state the queue doesn't know, after a callback bound its own
+static const GLuint unknownName = ~0u;
+
+// What the queue has bound, to skip binding it again
+struct BoundState
+{
+    GLuint program;
+    GLuint vao;
+    GLuint textures[packetTextureUnits];
+
+    BoundState() : program(unknownName), vao(unknownName)
+    {
+        for (int i = 0; i < packetTextureUnits; i++)
+            textures[i] = unknownName;
+    }
+};
+
+static GLuint programId(const DrawPacket &packet)
+{
+    return packet.program ? packet.program->id() : 0;
+}
+
+// Bind the state of a packet that isn't bound yet, or only count it
+static void bindPacket(BoundState &state, const DrawPacket &packet, RenderQueueStats &stats, bool issue)
+{
+    stats.draws++;
+    GLuint program = programId(packet);
+    if (program != state.program)
+    {
+        if (issue)
+            glUseProgram(program);
+        state.program = program;
+        stats.programChanges++;
+    }
+    for (int i = 0; i < packetTextureUnits; i++)
+    {
+        if (packet.textures[i] == 0 || packet.textures[i] == state.textures[i])
+            continue;
+        if (issue)
+        {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, packet.textures[i]);
+        }
+        state.textures[i] = packet.textures[i];
+        stats.textureChanges++;
+    }
+    if (packet.vao != 0 && packet.vao != state.vao)
+    {
+        if (issue)
+            glBindVertexArray(packet.vao);
+        state.vao = packet.vao;
+        stats.vaoChanges++;
+    }
+}
+
+// Forget what a callback may have bound
+static void packetDrawn(BoundState &state, const DrawPacket &packet)
+{
+    if (!packet.bindsOwnState)
+        return;
+    state.vao = unknownName;
+    for (int i = 0; i < packetTextureUnits; i++)
+        state.textures[i] = unknownName;
+}
+
+void RenderQueue::begin(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
+{
+    this->viewMatrix = viewMatrix;
+    this->projectionMatrix = projectionMatrix;
+    packets.clear();
+    items.clear();
+}
+
+uint64_t RenderQueue::sortKey(const DrawPacket &packet, float depth)
+{
+    // Positive floats sort like their bits, the top 24 below the sign bit are kept
+    if (!(depth > 0.0f))
+        depth = 0.0f;
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    uint64_t depthBits = bits >> 7;
+
+    uint64_t pass = packet.pass;
+    uint64_t program = programId(packet) & 0x3ff;
+    uint64_t material = packet.textures[0] & 0xffff;
+    uint64_t vao = (packet.vao != 0 ? packet.vao : packet.sortVao) & 0xfff;
+
+    // Translucent packets must blend back to front whatever their state
+    if (packet.pass == RenderTranslucent)
+        return pass << 62 | (0xffffff - depthBits) << 38 | program << 28 | material << 12 | vao;
+    return pass << 62 | program << 52 | material << 36 | vao << 24 | depthBits;
+}
+
+void RenderQueue::submit(const DrawPacket &packet)
+{
+    // Distance along the view direction of the packet's origin
+    float depth = -(viewMatrix * packet.model[3]).z;
+    SortItem item = { sortKey(packet, depth), static_cast<uint32_t>(packets.size()) };
+    items.push_back(item);
+    packets.push_back(packet);
+}
+
+// Least significant digit first radix sort, one byte per pass. Bytes that are
+// the same in every key, such as the pass of an all opaque frame, are skipped
+void RenderQueue::radixSort(std::vector<SortItem> &items, std::vector<SortItem> &scratch)
+{
+    const size_t count = items.size();
+    if (count < 2)
+        return;
+
+    unsigned int histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (size_t i = 0; i < count; i++)
+        for (int b = 0; b < 8; b++)
+            histograms[b][(items[i].key >> (b * 8)) & 0xff]++;
+
+    scratch.resize(count);
+    for (int b = 0; b < 8; b++)
+    {
+        unsigned int *histogram = histograms[b];
+        if (histogram[(items[0].key >> (b * 8)) & 0xff] == count)
+            continue;
+
+        // Turn the counts into the first slot of each bucket
+        unsigned int offset = 0;
+        for (int i = 0; i < 256; i++)
+        {
+            unsigned int bucket = histogram[i];
+            histogram[i] = offset;
+            offset += bucket;
+        }
+        for (size_t i = 0; i < count; i++)
+            scratch[histogram[(items[i].key >> (b * 8)) & 0xff]++] = items[i];
+        items.swap(scratch);
+    }
+}
+
+RenderQueueStats RenderQueue::countChanges(const std::vector<SortItem> &order) const
+{
+    RenderQueueStats stats;
+    BoundState state;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const DrawPacket &packet = packets[order[i].index];
+        bindPacket(state, packet, stats, false);
+        packetDrawn(state, packet);
+    }
+    return stats;
+}
+
+void RenderQueue::flush()
+{
+    // Submission order is what drawing each object right away would bind
+    unsorted = countChanges(items);
+    radixSort(items, scratch);
+
+    sorted = RenderQueueStats();
+    BoundState state;
+    bool blending = false;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        const DrawPacket &packet = packets[items[i].index];
+        if (packet.pass == RenderTranslucent && !blending)
+        {
+            // Translucent surfaces are tested against the opaque depth but don't write it
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            blending = true;
+        }
+        bindPacket(state, packet, sorted, true);
+        if (packet.draw)
+            packet.draw(packet, *this);
+        packetDrawn(state, packet);
+    }
+
+    if (blending)
+    {
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+    }
+    if (state.vao != 0)
+        glBindVertexArray(0);
+    packets.clear();
+    items.clear();
+}
+
+void RenderQueue::printStats() const
+{
+    printf("Render queue: %u draws, %u state changes unsorted (%u programs, %u vertex arrays, %u textures), "
+           "%u sorted (%u programs, %u vertex arrays, %u textures)\n",
+           sorted.draws, unsorted.total(), unsorted.programChanges, unsorted.vaoChanges, unsorted.textureChanges,
+           sorted.total(), sorted.programChanges, sorted.vaoChanges, sorted.textureChanges);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader_program.hpp"
+
+class RenderQueue;
+
+// Opaque packets draw first, front to back so early depth testing rejects
+// hidden fragments, then translucent ones back to front with blending
+enum RenderPass
+{
+    RenderOpaque = 0,
+    RenderTranslucent = 1
+};
+
+// Texture units a packet binds before its draw
+static const int packetTextureUnits = 2;
+
+// One draw submitted to the queue. The queue binds the program, textures and
+// vertex array, then calls draw to set the per-draw uniforms and draw
+struct DrawPacket
+{
+    RenderPass pass;
+    ShaderProgram *program;
+    GLuint textures[packetTextureUnits]; // Units 0 and up, 0 leaves a unit as it is
+    GLuint vao;                          // Bound before the draw, 0 leaves it to the callback
+    GLuint sortVao;                      // Sorts the packet when the callback binds its own
+    bool bindsOwnState;                  // The callback binds textures or vertex arrays (Model::draw)
+    glm::mat4 model;                     // Its translation sorts the packet by depth
+    glm::vec3 color;
+    void (*draw)(const DrawPacket &packet, const RenderQueue &queue);
+    void *object;
+
+    DrawPacket() : pass(RenderOpaque), program(NULL), vao(0), sortVao(0), bindsOwnState(false),
+                   model(1.0f), color(1.0f), draw(NULL), object(NULL)
+    {
+        for (int i = 0; i < packetTextureUnits; i++)
+            textures[i] = 0;
+    }
+};
+
+// Program, vertex array and texture binds of a frame
+struct RenderQueueStats
+{
+    unsigned int draws;
+    unsigned int programChanges;
+    unsigned int vaoChanges;
+    unsigned int textureChanges;
+
+    RenderQueueStats() : draws(0), programChanges(0), vaoChanges(0), textureChanges(0) {}
+    unsigned int total() const { return programChanges + vaoChanges + textureChanges; }
+};
+
+// Collects the draws of a frame, sorts them by a 64-bit key and submits them
+// skipping binds of state that is already bound. Opaque keys are
+//   pass (2) | program (10) | material (16) | vertex array (12) | depth (24)
+// and translucent keys put the inverted depth right after the pass. GL names
+// are masked to their fields, names that collide only sort less well
+class RenderQueue
+{
+public:
+    // Start a frame seen through these matrices, the previous packets are dropped
+    void begin(const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix);
+
+    // Add a draw, sorted by its key when the frame is flushed
+    void submit(const DrawPacket &packet);
+
+    // Sort and draw the packets of the frame. Leaves no vertex array bound
+    void flush();
+
+    const glm::mat4 &view() const { return viewMatrix; }
+    const glm::mat4 &projection() const { return projectionMatrix; }
+
+    // State changes of the last flush in submission order and in sorted order
+    const RenderQueueStats &unsortedStats() const { return unsorted; }
+    const RenderQueueStats &sortedStats() const { return sorted; }
+
+    // Print both, e.g. once a second
+    void printStats() const;
+
+    // Sort key of a packet at this distance from the camera
+    static uint64_t sortKey(const DrawPacket &packet, float depth);
+
+private:
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    std::vector<DrawPacket> packets;
+    std::vector<SortItem> items;
+    std::vector<SortItem> scratch;
+    RenderQueueStats unsorted;
+    RenderQueueStats sorted;
+
+    // Sort the items by key, scratch is reused between frames
+    static void radixSort(std::vector<SortItem> &items, std::vector<SortItem> &scratch);
+
+    // Count the binds drawing the packets in this order takes
+    RenderQueueStats countChanges(const std::vector<SortItem> &order) const;
+};
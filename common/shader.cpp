@@ -13,43 +13,59 @@ using namespace std;
 #include <GL/glew.h>
 
 #include "shader.hpp"
+#include "vfs.hpp"
+
+// Insert lines of defines after the #version line, which has to come first
+static void InsertDefines(std::string & code, const char * defines){
+    if(defines == NULL || *defines == '\0')
+        return;
+    size_t lineEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : std::string::npos;
+    size_t at = lineEnd == std::string::npos ? 0 : lineEnd + 1;
+    code.insert(at, std::string(defines) + "\n");
+}
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path,const char * defines){
 
-    // Create the shaders
-    GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-    GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-    // Read the Vertex Shader code from the file
+    // Read the Vertex Shader code from a mounted pak or the file
     std::string VertexShaderCode;
-    std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-    if(VertexShaderStream.is_open()){
-        std::stringstream sstr;
-        sstr << VertexShaderStream.rdbuf();
-        VertexShaderCode = sstr.str();
-        VertexShaderStream.close();
+    VfsFile VertexShaderFile;
+    if(VertexShaderFile.open(vertex_file_path)){
+        VertexShaderCode.assign(VertexShaderFile.data(), VertexShaderFile.size());
+        VertexShaderFile.close();
     }else{
         printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
         getchar();
         return 0;
     }
 
-    // Read the Fragment Shader code from the file
+    // Read the Fragment Shader code from a mounted pak or the file
     std::string FragmentShaderCode;
-    std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-    if(FragmentShaderStream.is_open()){
-        std::stringstream sstr;
-        sstr << FragmentShaderStream.rdbuf();
-        FragmentShaderCode = sstr.str();
-        FragmentShaderStream.close();
+    VfsFile FragmentShaderFile;
+    if(FragmentShaderFile.open(fragment_file_path)){
+        FragmentShaderCode.assign(FragmentShaderFile.data(), FragmentShaderFile.size());
+        FragmentShaderFile.close();
     }
 
+    // Variants of the same files, e.g. "#define INSTANCED"
+    InsertDefines(VertexShaderCode, defines);
+    InsertDefines(FragmentShaderCode, defines);
+
+    return CompileShaders(vertex_file_path, VertexShaderCode.c_str(), fragment_file_path, FragmentShaderCode.c_str());
+}
+
+GLuint CompileShaders(const char * vertex_name, const char * vertex_source,
+                      const char * fragment_name, const char * fragment_source){
+
+    // Create the shaders
+    GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+    GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+
     GLint Result = GL_FALSE;
     int InfoLogLength;
 
     // Compile Vertex Shader
-    printf("Compiling shader : %s\n", vertex_file_path);
-    char const * VertexSourcePointer = VertexShaderCode.c_str();
+    printf("Compiling shader : %s\n", vertex_name);
+    char const * VertexSourcePointer = vertex_source;
     glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
     glCompileShader(VertexShaderID);
 
@@ -63,8 +79,8 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
     }
 
     // Compile Fragment Shader
-    printf("Compiling shader : %s\n", fragment_file_path);
-    char const * FragmentSourcePointer = FragmentShaderCode.c_str();
+    printf("Compiling shader : %s\n", fragment_name);
+    char const * FragmentSourcePointer = fragment_source;
     glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
     glCompileShader(FragmentShaderID);
 
@@ -8,6 +8,11 @@
 // Forward declarations or minimal includes needed for the function signature
 // (In this case, none beyond GLuint from glew.h)
 
-// Declaration of LoadShaders
+// Declaration of LoadShaders, defines are inserted after the #version lines
 GLuint LoadShaders(const char *vertex_file_path, 
-                   const char *fragment_file_path);
+                   const char *fragment_file_path,
+                   const char *defines = NULL);
+
+// Compile and link shaders from source, the names are only used in messages
+GLuint CompileShaders(const char *vertex_name, const char *vertex_source,
+                      const char *fragment_name, const char *fragment_source);
@@ -0,0 +1,211 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+#include "shader_program.hpp"
+#include "shader.hpp"
+#include "frame_uniforms.hpp"
+#include "indirect_batch.hpp"
+
+ShaderProgram::ShaderProgram() : program(0), samplers(0)
+{
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    destroy();
+}
+
+bool ShaderProgram::load(const char *vertexPath, const char *fragmentPath, const char *defines)
+{
+    destroy();
+    program = LoadShaders(vertexPath, fragmentPath, defines);
+    reflect();
+    return program != 0;
+}
+
+bool ShaderProgram::compile(const char *vertexSource, const char *fragmentSource)
+{
+    destroy();
+    program = CompileShaders("vertex source", vertexSource, "fragment source", fragmentSource);
+    reflect();
+    return program != 0;
+}
+
+void ShaderProgram::destroy()
+{
+    if (program != 0)
+        glDeleteProgram(program);
+    program = 0;
+    uniforms.clear();
+    table.clear();
+    samplers = 0;
+}
+
+static bool isSampler(GLenum type)
+{
+    switch (type)
+    {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_CUBE_SHADOW:
+    case GL_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+    case GL_SAMPLER_BUFFER:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ShaderProgram::reflect()
+{
+    // A program that didn't link has no uniforms
+    GLint linked = GL_FALSE;
+    if (program != 0)
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+        destroy();
+        return;
+    }
+
+    // Shared blocks read the frame's uniform buffer, GLSL 3.30 can't bind them itself
+    for (int b = 0; b < SharedBlockCount; b++)
+    {
+        GLuint block = glGetUniformBlockIndex(program, uniformBlockName(static_cast<UniformBlockBinding>(b)));
+        if (block != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, block, b);
+    }
+
+    // So is the per-draw data of multi-draw batches, where there are storage buffers
+    if (IndirectBatch::supported())
+    {
+        GLuint block = glGetProgramResourceIndex(program, GL_SHADER_STORAGE_BLOCK, drawDataBlockName);
+        if (block != GL_INVALID_INDEX)
+            glShaderStorageBlockBinding(program, block, drawDataBinding);
+    }
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(maxLength + 1);
+    for (GLint i = 0; i < count; i++)
+    {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, static_cast<GLsizei>(name.size()), NULL, &size, &type, name.data());
+
+        // Uniforms in blocks have no location
+        GLint location = glGetUniformLocation(program, name.data());
+        if (location < 0)
+            continue;
+
+        // Arrays are named after their first element, e.g. lights[0]
+        char *bracket = strchr(name.data(), '[');
+        if (bracket)
+            *bracket = '\0';
+
+        Uniform uniform;
+        uniform.id = uniformId(name.data());
+        uniform.location = location;
+        uniform.type = type;
+        uniform.set = false;
+        memset(uniform.value, 0, sizeof(uniform.value));
+        if (find(uniform.id))
+        {
+            printf("Uniform %s of program %u has the hash of another one, it can't be set.\n", name.data(), program);
+            continue;
+        }
+        if (isSampler(type))
+            samplers++;
+
+        // Grow the table to at least twice the uniforms, so probes stay short. Its
+        // size stays a power of two, so slots can be masked
+        uniforms.push_back(uniform);
+        if (table.size() < uniforms.size() * 2)
+        {
+            size_t size = 4;
+            while (size < uniforms.size() * 4)
+                size *= 2;
+            table.assign(size, 0);
+            for (size_t u = 0; u < uniforms.size(); u++)
+            {
+                size_t slot = uniforms[u].id & (table.size() - 1);
+                while (table[slot] != 0)
+                    slot = (slot + 1) & (table.size() - 1);
+                table[slot] = static_cast<int>(u) + 1;
+            }
+        }
+        else
+        {
+            size_t slot = uniform.id & (table.size() - 1);
+            while (table[slot] != 0)
+                slot = (slot + 1) & (table.size() - 1);
+            table[slot] = static_cast<int>(uniforms.size());
+        }
+    }
+}
+
+const ShaderProgram::Uniform *ShaderProgram::find(UniformId uniform) const
+{
+    if (table.empty())
+        return NULL;
+    size_t mask = table.size() - 1;
+    for (size_t slot = uniform & mask; table[slot] != 0; slot = (slot + 1) & mask)
+        if (uniforms[table[slot] - 1].id == uniform)
+            return &uniforms[table[slot] - 1];
+    return NULL;
+}
+
+GLint ShaderProgram::location(UniformId uniform) const
+{
+    const Uniform *found = find(uniform);
+    return found ? found->location : -1;
+}
+
+ShaderProgram::Uniform *ShaderProgram::changed(UniformId uniform, const void *value, size_t size)
+{
+    Uniform *found = const_cast<Uniform *>(find(uniform));
+    if (found == NULL || (found->set && memcmp(found->value, value, size) == 0))
+        return NULL;
+    memcpy(found->value, value, size);
+    found->set = true;
+    return found;
+}
+
+void ShaderProgram::setInt(UniformId uniform, int value)
+{
+    if (Uniform *found = changed(uniform, &value, sizeof(value)))
+        glUniform1i(found->location, value);
+}
+
+void ShaderProgram::setFloat(UniformId uniform, float value)
+{
+    if (Uniform *found = changed(uniform, &value, sizeof(value)))
+        glUniform1f(found->location, value);
+}
+
+void ShaderProgram::setVec3(UniformId uniform, const glm::vec3 &value)
+{
+    if (Uniform *found = changed(uniform, &value[0], sizeof(value)))
+        glUniform3fv(found->location, 1, &value[0]);
+}
+
+void ShaderProgram::setVec4(UniformId uniform, const glm::vec4 &value)
+{
+    if (Uniform *found = changed(uniform, &value[0], sizeof(value)))
+        glUniform4fv(found->location, 1, &value[0]);
+}
+
+void ShaderProgram::setMat4(UniformId uniform, const glm::mat4 &value)
+{
+    if (Uniform *found = changed(uniform, &value[0][0], sizeof(value)))
+        glUniformMatrix4fv(found->location, 1, GL_FALSE, &value[0][0]);
+}
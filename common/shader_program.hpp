@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// A uniform is named by the 32-bit FNV-1a hash of its name. Hash names once,
+// into constants at file scope, so drawing needs no string lookups:
+//   static const UniformId uniformModel = uniformId("model");
+typedef uint32_t UniformId;
+
+constexpr UniformId uniformId(const char *name, UniformId hash = 2166136261u)
+{
+    return *name ? uniformId(name + 1, (hash ^ static_cast<unsigned char>(*name)) * 16777619u) : hash;
+}
+
+// A linked program and its active uniforms, reflected once after linking into
+// a hash table. Setters upload to the program in use and skip values that are
+// already set, so don't set its uniforms with glUniform* directly. Blocks named
+// like the shared ones in frame_uniforms.hpp and indirect_batch.hpp are bound
+// to their binding points
+class ShaderProgram
+{
+public:
+    ShaderProgram();
+    ~ShaderProgram();
+
+    // Compile and link shader files, read through the VFS, with optional
+    // defines for a variant such as "#define INSTANCED". Returns false if
+    // they can't be read or don't link
+    bool load(const char *vertexPath, const char *fragmentPath, const char *defines = NULL);
+
+    // Compile and link shaders from source
+    bool compile(const char *vertexSource, const char *fragmentSource);
+
+    // Delete the program
+    void destroy();
+
+    GLuint id() const { return program; }
+    void use() const { glUseProgram(program); }
+
+    // Whether the program has an active uniform of that name, and its location (-1 if not)
+    bool has(UniformId uniform) const { return find(uniform) != NULL; }
+    GLint location(UniformId uniform) const;
+
+    // Number of sampler uniforms, they can be set with setInt
+    unsigned int samplerCount() const { return samplers; }
+
+    // Set a uniform of the program in use, uniforms it doesn't have are ignored
+    void setInt(UniformId uniform, int value);
+    void setFloat(UniformId uniform, float value);
+    void setVec3(UniformId uniform, const glm::vec3 &value);
+    void setVec4(UniformId uniform, const glm::vec4 &value);
+    void setMat4(UniformId uniform, const glm::mat4 &value);
+
+private:
+    struct Uniform
+    {
+        UniformId id;
+        GLint location;
+        GLenum type;
+        bool set;               // Whether value holds what was last uploaded
+        unsigned char value[sizeof(glm::mat4)];
+    };
+
+    GLuint program;
+    std::vector<Uniform> uniforms;
+    std::vector<int> table; // Open addressing, uniform index + 1 or 0 for empty slots
+    unsigned int samplers;
+
+    // Read the active uniforms of the linked program
+    void reflect();
+
+    const Uniform *find(UniformId uniform) const;
+
+    // The uniform to upload a value to, NULL if it's missing or already has the value
+    Uniform *changed(UniformId uniform, const void *value, size_t size);
+
+    // Programs are owned, so they can't be copied
+    ShaderProgram(const ShaderProgram &);
+    ShaderProgram &operator=(const ShaderProgram &);
+};
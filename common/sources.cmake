@@ -0,0 +1,35 @@
+# Engine sources shared by the coursework, the asset cooker and the tests,
+# relative to the repository root. Files are read through the VFS, from a
+# mounted pak or the disk
+set(ENGINE_SOURCES
+    common/model.cpp
+    common/obj_loader.cpp
+    common/glb_loader.cpp
+    common/json.cpp
+    common/mesh_cache.cpp
+    common/mesh_optimizer.cpp
+    common/mesh_simplifier.cpp
+    common/meshlet.cpp
+    common/tangent_space.cpp
+    common/vertex_format.cpp
+    common/vertex_layout.cpp
+    common/texture.cpp
+    common/texture_cache.cpp
+    common/texture_compression.cpp
+    common/texture_streamer.cpp
+    common/mip_generator.cpp
+    common/asset_manager.cpp
+    common/async_loader.cpp
+    common/thread_pool.cpp
+    common/render_queue.cpp
+    common/shader_program.cpp
+    common/shader.cpp
+    common/frame_uniforms.cpp
+    common/instance_batch.cpp
+    common/indirect_batch.cpp
+    common/vfs.cpp
+    common/pak.cpp
+    common/lz_block.cpp
+    common/mapped_file.cpp
+    common/hash.cpp
+)
@@ -0,0 +1,214 @@
+#include <vector>
+#include <math.h>
+#include <stdint.h>
+#include <functional>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "tangent_space.hpp"
+#include "thread_pool.hpp"
+
+// Triangles per task when work is split across threads
+static const size_t trianglesPerTask = 1 << 16;
+
+// Vertices per task when work is split across threads
+static const size_t verticesPerTask = 1 << 16;
+
+// Direction of increasing u and v over a triangle, unnormalized so larger
+// triangles weigh more, and the handedness of its uv mapping (0 if degenerate)
+struct FaceTangent
+{
+    glm::vec3 uDirection;
+    glm::vec3 vDirection;
+    int handedness;
+};
+
+static FaceTangent computeFaceTangent(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2,
+                                      const glm::vec2 &uv0, const glm::vec2 &uv1, const glm::vec2 &uv2)
+{
+    FaceTangent face = { glm::vec3(0.0f), glm::vec3(0.0f), 0 };
+
+    glm::vec3 edge1 = p1 - p0;
+    glm::vec3 edge2 = p2 - p0;
+    glm::vec2 deltaUV1 = uv1 - uv0;
+    glm::vec2 deltaUV2 = uv2 - uv0;
+
+    float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+    if (!(fabsf(determinant) > 0.0f))
+        return face;
+
+    // Solving with the sign of the determinant only keeps the area weighting
+    float sign = determinant > 0.0f ? 1.0f : -1.0f;
+    face.uDirection = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) * sign;
+    face.vDirection = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) * sign;
+    face.handedness = determinant > 0.0f ? 1 : -1;
+    return face;
+}
+
+// Give triangles with mirrored uvs their own copy of any vertex they share
+// with unmirrored triangles, so tangents aren't averaged across the mirror seam
+static void splitMirroredVertices(std::vector<unsigned int> &indices,
+                                  std::vector<glm::vec3> &positions,
+                                  std::vector<glm::vec2> &uvs,
+                                  std::vector<glm::vec3> &normals,
+                                  const std::vector<FaceTangent> &faces)
+{
+    const size_t vertexCount = positions.size();
+    std::vector<unsigned char> seen(vertexCount, 0); // Bit 0 right handed, bit 1 left handed
+    for (size_t t = 0; t < faces.size(); t++)
+    {
+        unsigned char bit = faces[t].handedness > 0 ? 1 : (faces[t].handedness < 0 ? 2 : 0);
+        for (int k = 0; k < 3; k++)
+            seen[indices[t * 3 + k]] |= bit;
+    }
+
+    const unsigned int none = 0xFFFFFFFFu;
+    std::vector<unsigned int> mirrored(vertexCount, none);
+    for (size_t t = 0; t < faces.size(); t++)
+    {
+        if (faces[t].handedness >= 0)
+            continue;
+
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (seen[v] != 3)
+                continue;
+
+            if (mirrored[v] == none)
+            {
+                mirrored[v] = static_cast<unsigned int>(positions.size());
+                positions.push_back(positions[v]);
+                uvs.push_back(uvs[v]);
+                normals.push_back(normals[v]);
+            }
+            indices[t * 3 + k] = mirrored[v];
+        }
+    }
+}
+
+void generateTangents(std::vector<unsigned int> &indices,
+                      std::vector<glm::vec3> &positions,
+                      std::vector<glm::vec2> &uvs,
+                      std::vector<glm::vec3> &normals,
+                      std::vector<glm::vec4> &outTangents,
+                      unsigned int threadCount)
+{
+    const unsigned int threads = threadCount > 0 ? threadCount : ThreadPool::hardwareThreads();
+    const size_t triangleCount = indices.size() / 3;
+
+    // Tangent directions of every triangle
+    std::vector<FaceTangent> faces(triangleCount);
+    runParallel((triangleCount + trianglesPerTask - 1) / trianglesPerTask, threads,
+                [&](size_t task)
+    {
+        size_t end = glm::min((task + 1) * trianglesPerTask, triangleCount);
+        for (size_t t = task * trianglesPerTask; t < end; t++)
+        {
+            unsigned int i0 = indices[t * 3 + 0], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+            faces[t] = computeFaceTangent(positions[i0], positions[i1], positions[i2],
+                                          uvs[i0], uvs[i1], uvs[i2]);
+        }
+    });
+
+    splitMirroredVertices(indices, positions, uvs, normals, faces);
+    const size_t vertexCount = positions.size();
+
+    // Triangles around each vertex, so vertices can be summed without sharing writes
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+        offsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] += offsets[v];
+    std::vector<unsigned int> vertexFaces(indices.size());
+    {
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            vertexFaces[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    // Sum the faces, then make the tangent perpendicular to the normal
+    outTangents.resize(vertexCount);
+    runParallel((vertexCount + verticesPerTask - 1) / verticesPerTask, threads,
+                [&](size_t task)
+    {
+        size_t end = glm::min((task + 1) * verticesPerTask, vertexCount);
+        for (size_t v = task * verticesPerTask; v < end; v++)
+        {
+            glm::vec3 uDirection(0.0f), vDirection(0.0f);
+            for (unsigned int f = offsets[v]; f < offsets[v + 1]; f++)
+            {
+                uDirection += faces[vertexFaces[f]].uDirection;
+                vDirection += faces[vertexFaces[f]].vDirection;
+            }
+
+            glm::vec3 normal = normals[v];
+            float normalLength = glm::length(normal);
+            normal = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+            glm::vec3 tangent = uDirection - normal * glm::dot(normal, uDirection);
+            float tangentLength = glm::length(tangent);
+            if (tangentLength > 1e-12f)
+                tangent /= tangentLength;
+            else
+            {
+                // No usable uvs, any direction perpendicular to the normal will do
+                glm::vec3 axis = fabsf(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                tangent = glm::normalize(glm::cross(axis, normal));
+            }
+
+            float sign = glm::dot(glm::cross(normal, tangent), vDirection) < 0.0f ? -1.0f : 1.0f;
+            outTangents[v] = glm::vec4(tangent, sign);
+        }
+    });
+}
+
+QTangent packQTangent(const glm::vec3 &normal, const glm::vec4 &tangent)
+{
+    glm::vec3 n = glm::normalize(normal);
+    glm::vec3 t = glm::normalize(glm::vec3(tangent) - n * glm::dot(n, glm::vec3(tangent)));
+    glm::vec3 b = glm::cross(n, t);
+
+    glm::quat q = glm::normalize(glm::quat_cast(glm::mat3(t, b, n)));
+    if (q.w < 0.0f)
+        q = -q;
+
+    // Keep w away from zero so its sign survives snorm16 quantization
+    const float bias = 1.0f / 32767.0f;
+    if (q.w < bias)
+    {
+        float scale = sqrtf(1.0f - bias * bias) / glm::length(glm::vec3(q.x, q.y, q.z));
+        q = glm::quat(bias, q.x * scale, q.y * scale, q.z * scale);
+    }
+
+    // A mirrored bitangent is stored as a negative w
+    if (tangent.w < 0.0f)
+        q = -q;
+
+    QTangent packed;
+    packed.q[0] = static_cast<int16_t>(glm::packSnorm1x16(q.x));
+    packed.q[1] = static_cast<int16_t>(glm::packSnorm1x16(q.y));
+    packed.q[2] = static_cast<int16_t>(glm::packSnorm1x16(q.z));
+    packed.q[3] = static_cast<int16_t>(glm::packSnorm1x16(q.w));
+    return packed;
+}
+
+void unpackQTangent(const QTangent &packed, glm::vec3 &normal, glm::vec4 &tangent)
+{
+    glm::vec4 q(glm::unpackSnorm1x16(static_cast<uint16_t>(packed.q[0])),
+                glm::unpackSnorm1x16(static_cast<uint16_t>(packed.q[1])),
+                glm::unpackSnorm1x16(static_cast<uint16_t>(packed.q[2])),
+                glm::unpackSnorm1x16(static_cast<uint16_t>(packed.q[3])));
+    q = glm::normalize(q);
+
+    // First and third columns of the rotation matrix
+    glm::vec3 t(1.0f - 2.0f * (q.y * q.y + q.z * q.z),
+                2.0f * (q.x * q.y + q.w * q.z),
+                2.0f * (q.x * q.z - q.w * q.y));
+    normal = glm::vec3(2.0f * (q.x * q.z + q.w * q.y),
+                       2.0f * (q.y * q.z - q.w * q.x),
+                       1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+    tangent = glm::vec4(t, q.w < 0.0f ? -1.0f : 1.0f);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+// Tangent frame packed into one quaternion: the rotation whose columns are
+// (tangent, cross(normal, tangent), normal), with w negated when the
+// bitangent is mirrored. Four snorm16 components, 8 bytes
+struct QTangent
+{
+    int16_t q[4]; // x, y, z, w
+};
+
+// Generate a tangent per vertex from positions and uvs (xyz tangent, w = bitangent
+// sign). Vertices shared by triangles with mirrored uvs are split first, so
+// indices and the vertex streams may grow. Runs on threadCount threads (0 = all cores)
+void generateTangents(std::vector<unsigned int> &indices,
+                      std::vector<glm::vec3> &positions,
+                      std::vector<glm::vec2> &uvs,
+                      std::vector<glm::vec3> &normals,
+                      std::vector<glm::vec4> &outTangents,
+                      unsigned int threadCount = 0);
+
+// Pack a normal and a tangent with its bitangent sign into a QTangent
+QTangent packQTangent(const glm::vec3 &normal, const glm::vec4 &tangent);
+
+// Unpack a QTangent (what normal_mapping.vert does)
+void unpackQTangent(const QTangent &packed, glm::vec3 &normal, glm::vec4 &tangent);
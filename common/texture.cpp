@@ -1,52 +1,533 @@
-#include "texture.hpp" // For the loadTexture declaration
+#include "texture.hpp" // For the texture declarations
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.hpp" // Path relative to common/ or adjust as needed if stb_image.h is elsewhere
                          // Assuming stb_image.hpp is in the common/ directory alongside texture.hpp/cpp
 
+#include "mesh_cache.hpp" // For hashSourceFile
+#include "hash.hpp"
+#include "thread_pool.hpp"
+#include "vfs.hpp"
+
 #include <stdio.h> // For printf
+#include <string.h> // For memcpy
+#include <vector>
+#include <chrono>
 #include <GL/glew.h> // For OpenGL functions
 
-unsigned int loadTexture(const char *path)
+bool decodeImage(const char *path, bool flip, Image &image)
+{
+    // stb_image decodes straight from the file's mapping or its view in a pak,
+    // so a batch of images doesn't allocate a read buffer per file
+    VfsFile file;
+    image.pixels = NULL;
+    if (!file.open(path))
+    {
+        printf("Texture %s failed to load. Reason: can't read the file\n", path);
+        return false;
+    }
+    return decodeImageMemory(path, file.data(), file.size(), flip, image);
+}
+
+bool decodeImageMemory(const char *name, const void *data, size_t size, bool flip, Image &image)
+{
+    image.pixels = NULL;
+    if (size > 0x7fffffff)
+    {
+        printf("Texture %s failed to load. Reason: too large\n", name);
+        return false;
+    }
+    
+    // The flip setting is per thread so workers can decode at the same time
+    stbi_set_flip_vertically_on_load_thread(flip);
+    image.pixels = stbi_load_from_memory(static_cast<const stbi_uc *>(data), static_cast<int>(size),
+                                         &image.width, &image.height, &image.channels, 0);
+    if (!image.pixels)
+    {
+        printf("Texture %s failed to load. Reason: %s\n", name, stbi_failure_reason());
+        return false;
+    }
+    if (image.channels != 1 && image.channels != 3 && image.channels != 4)
+    {
+        printf("Texture %s has an unsupported number of channels: %d\n", name, image.channels);
+        freeImage(image);
+        return false;
+    }
+    return true;
+}
+
+bool decodeImages(const std::vector<ImageRequest> &requests, std::vector<Image> &images,
+                  unsigned int threadCount)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned int threads = threadCount == 0 ? ThreadPool::hardwareThreads() : threadCount;
+    
+    // Every image has its own slot, so the results come back in request order
+    images.resize(requests.size());
+    std::vector<char> decoded(requests.size(), 0);
+    runParallel(requests.size(), threads, [&](size_t i)
+    {
+        decoded[i] = decodeImage(requests[i].path.c_str(), requests[i].flip, images[i]);
+    });
+    
+    size_t failed = 0;
+    for (size_t i = 0; i < decoded.size(); i++)
+        failed += decoded[i] ? 0 : 1;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Decoded %u images on %u threads in %.2f ms\n", (unsigned int)(requests.size() - failed),
+           threads, seconds * 1000.0);
+    return failed == 0;
+}
+
+void freeImage(Image &image)
+{
+    stbi_image_free(image.pixels);
+    image.pixels = NULL;
+}
+
+// Whether a minification filter samples mipmaps
+static bool usesMipmaps(GLenum filter)
+{
+    return filter != GL_LINEAR && filter != GL_NEAREST;
+}
+
+size_t textureBytes(int width, int height, int channels, const TextureParams &params)
+{
+    // Drivers store RGB8 padded to 4 bytes per texel
+    size_t texelBytes = channels == 3 ? 4 : static_cast<size_t>(channels);
+    size_t bytes = 0;
+    for (;;)
+    {
+        bytes += static_cast<size_t>(width) * height * texelBytes;
+        if (!usesMipmaps(params.filter) || (width == 1 && height == 1))
+            break;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return bytes;
+}
+
+// Copy data into the staging buffer and leave it bound for unpacking. Returns
+// the pointer to pass to glTexImage2D: the data itself if it couldn't be staged
+static const uint8_t *stagePixels(GLuint stagingBuffer, const void *data, size_t size)
+{
+    if (stagingBuffer == 0)
+        return static_cast<const uint8_t *>(data);
+    
+    // Orphan the previous contents so the copy doesn't wait for an upload in flight
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), NULL, GL_STREAM_DRAW);
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!mapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return static_cast<const uint8_t *>(data);
+    }
+    memcpy(mapped, data, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    return NULL; // Offsets into the staging buffer
+}
+
+void setTextureSampling(const TextureParams &params)
+{
+    // Magnification only knows nearest and linear
+    GLenum magFilter = params.filter == GL_NEAREST || params.filter == GL_NEAREST_MIPMAP_NEAREST ||
+                       params.filter == GL_NEAREST_MIPMAP_LINEAR ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+}
+
+// Mip options matching the texture parameters
+static MipOptions mipOptions(const TextureParams &params)
+{
+    MipOptions options;
+    options.filter = params.mipFilter;
+    options.srgb = params.srgb;
+    options.alphaCutoff = params.alphaCutoff;
+    return options;
+}
+
+unsigned int uploadTexture(const Image &image, const TextureParams &params, GLuint stagingBuffer)
 {
+    // Mipmaps are filtered on the CPU instead of by glGenerateMipmap
+    std::vector<MipLevel> levels;
+    if (usesMipmaps(params.filter))
+        generateMips(image.pixels, image.width, image.height, image.channels, mipOptions(params), levels);
+    else
+    {
+        levels.resize(1);
+        levels[0].width = image.width;
+        levels[0].height = image.height;
+        levels[0].channels = image.channels;
+        levels[0].pixels.assign(image.pixels, image.pixels + static_cast<size_t>(image.width) * image.height * image.channels);
+    }
+    return uploadMipLevels(levels, params, stagingBuffer);
+}
+
+unsigned int uploadMipLevels(const std::vector<MipLevel> &levels, const TextureParams &params,
+                             GLuint stagingBuffer)
+{
+    // sRGB only applies to colour channels, single channel data stays linear
+    GLenum format, internalFormat;
+    if (levels[0].channels == 1)
+        format = internalFormat = GL_RED;
+    else if (levels[0].channels == 4)
+    {
+        format = GL_RGBA;
+        internalFormat = params.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA;
+    }
+    else
+    {
+        format = GL_RGB;
+        internalFormat = params.srgb ? GL_SRGB8 : GL_RGB;
+    }
+    
+    // Every level is staged in one copy
+    std::vector<uint8_t> staged;
+    const uint8_t *pixels;
+    if (levels.size() == 1)
+        pixels = stagePixels(stagingBuffer, levels[0].pixels.data(), levels[0].pixels.size());
+    else
+    {
+        for (size_t l = 0; l < levels.size(); l++)
+            staged.insert(staged.end(), levels[l].pixels.begin(), levels[l].pixels.end());
+        pixels = stagePixels(stagingBuffer, staged.data(), staged.size());
+    }
+    
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
     
-    int width, height, nChannels;
-    stbi_set_flip_vertically_on_load(true); // Good practice for OpenGL
-    unsigned char *data = stbi_load(path, &width, &height, &nChannels, 0);
-    
-    if (data)
-    {
-        GLenum format;
-        if (nChannels == 1)
-            format = GL_RED;
-        else if (nChannels == 3)
-            format = GL_RGB;
-        else if (nChannels == 4)
-            format = GL_RGBA;
-        else { // Should not happen with typical image formats
-            printf("Texture %s has an unsupported number of channels: %d\n", path, nChannels);
-            stbi_image_free(data);
-            return 0; // Or some error indicator
-        }
-        
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-                     GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Rows are tightly packed, 1 and 3 channel widths are not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    size_t offset = 0;
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        const MipLevel &level = levels[l];
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(l), internalFormat, level.width, level.height, 0,
+                     format, GL_UNSIGNED_BYTE, pixels + offset);
+        offset += level.pixels.size();
     }
-    else
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size()) - 1);
+    
+    setTextureSampling(params);
+    return textureID;
+}
+
+// Internal format of a block compressed texture
+static GLenum compressedFormat(TextureCompression compression, bool srgb)
+{
+    if (compression == TextureBC1)
+        return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    if (compression == TextureBC3)
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    return GL_COMPRESSED_RG_RGTC2; // Normal xy, never sRGB
+}
+
+unsigned int uploadCompressedTexture(const CompressedImage &image, const TextureParams &params,
+                                     GLuint stagingBuffer)
+{
+    GLenum internalFormat = compressedFormat(image.compression, params.srgb);
+    
+    // Every level is staged in one copy
+    std::vector<uint8_t> levels;
+    for (size_t l = 0; l < image.mips.size(); l++)
+        levels.insert(levels.end(), image.mips[l].blocks.begin(), image.mips[l].blocks.end());
+    
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    
+    // The blocks go to the GPU as they are, mipmaps were built when compressing
+    const uint8_t *blocks = stagePixels(stagingBuffer, levels.data(), levels.size());
+    size_t offset = 0;
+    for (size_t l = 0; l < image.mips.size(); l++)
     {
-        printf("Texture %s failed to load. Reason: %s\n", path, stbi_failure_reason());
+        const CompressedMip &mip = image.mips[l];
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(l), internalFormat, mip.width, mip.height, 0,
+                               static_cast<GLsizei>(mip.blocks.size()), blocks + offset);
+        offset += mip.blocks.size();
     }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mips.size()) - 1);
+    
+    setTextureSampling(params);
+    return textureID;
+}
 
-    stbi_image_free(data);
+void textureFormats(TextureCompression compression, int channels, bool srgb,
+                    GLenum &internalFormat, GLenum &format)
+{
+    format = channels == 1 ? GL_RED : (channels == 3 ? GL_RGB : GL_RGBA);
+    if (compression != TextureUncompressed)
+        internalFormat = compressedFormat(compression, srgb);
+    else if (channels == 1)
+        internalFormat = GL_R8;
+    else if (channels == 3)
+        internalFormat = srgb ? GL_SRGB8 : GL_RGB8;
+    else
+        internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+}
+
+unsigned int uploadTextureCache(const TextureCache &cache, const TextureParams &params)
+{
+    const bool compressed = cache.compression != TextureUncompressed;
+    const bool srgb = (cache.flags & TextureCacheSrgb) != 0;
+    const GLsizei levelCount = static_cast<GLsizei>(cache.levels.size());
+    
+    // Sized formats, texture storage only takes those
+    GLenum internalFormat, format;
+    textureFormats(cache.compression, cache.channels, srgb, internalFormat, format);
     
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    
+    // The driver reads the levels straight out of the mapped file
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // Core in 4.2, GLEW only sees the extension in compatibility contexts
+    const bool storage = GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+    if (storage)
+        glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, cache.width, cache.height);
+    for (GLsizei l = 0; l < levelCount; l++)
+    {
+        const TextureCacheLevel &level = cache.levels[l];
+        if (storage && compressed)
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, level.width, level.height, internalFormat,
+                                      static_cast<GLsizei>(level.size), level.data);
+        else if (storage)
+            glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, level.width, level.height, format, GL_UNSIGNED_BYTE, level.data);
+        else if (compressed)
+            glCompressedTexImage2D(GL_TEXTURE_2D, l, internalFormat, level.width, level.height, 0,
+                                   static_cast<GLsizei>(level.size), level.data);
+        else
+            glTexImage2D(GL_TEXTURE_2D, l, internalFormat, level.width, level.height, 0,
+                         format, GL_UNSIGNED_BYTE, level.data);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    
+    setTextureSampling(params);
     return textureID;
-} 
\ No newline at end of file
+}
+
+size_t compressedTextureBytes(const CompressedImage &image)
+{
+    size_t bytes = 0;
+    for (size_t l = 0; l < image.mips.size(); l++)
+        bytes += image.mips[l].blocks.size();
+    return bytes;
+}
+
+// Hash of the parameters that change the cooked texels
+static uint64_t textureCookHash(const TextureParams &params)
+{
+    const bool mipmaps = usesMipmaps(params.filter);
+    uint64_t hash = hashBytes(&params.flip, sizeof(params.flip));
+    hash = hashBytes(&params.srgb, sizeof(params.srgb), hash);
+    hash = hashBytes(&mipmaps, sizeof(mipmaps), hash);
+    hash = hashBytes(&params.compression, sizeof(params.compression), hash);
+    hash = hashBytes(&params.mipFilter, sizeof(params.mipFilter), hash);
+    return hashBytes(&params.alphaCutoff, sizeof(params.alphaCutoff), hash);
+}
+
+std::string textureCookPath(const char *path, const TextureParams &params)
+{
+    return textureCachePath(path, textureCookHash(params));
+}
+
+// Where a texture is cooked to and the source file it is cooked from
+struct TextureCook
+{
+    std::string cachePath;
+    uint64_t cookHash;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+};
+
+// Map the cooked texture when it was built from this exact file with these parameters
+static bool mapCookedTexture(const char *path, const TextureParams &params, TextureCook &cook,
+                             TextureSource &source)
+{
+    source.image.pixels = NULL;
+    source.mips.clear();
+    source.compressed.mips.clear();
+    
+    cook.cookHash = textureCookHash(params);
+    cook.cachePath = textureCachePath(path, cook.cookHash);
+    cook.sourceSize = cook.sourceHash = 0;
+    bool cached;
+    if (hashSourceFile(path, cook.sourceSize, cook.sourceHash))
+        cached = loadTextureCache(cook.cachePath.c_str(), cook.sourceSize, cook.sourceHash, cook.cookHash, source.cache);
+    else
+        cached = loadTextureCache(cook.cachePath.c_str(), cook.cookHash, source.cache);
+    if (cached)
+    {
+        source.image.width = source.cache.width;
+        source.image.height = source.cache.height;
+        source.image.channels = source.cache.channels;
+    }
+    return cached;
+}
+
+// Build the mips of the decoded source image, compress them and write the cache
+static void cookTexture(const char *path, const TextureParams &params, const TextureCook &cook,
+                        TextureSource &source)
+{
+    // Filter the mip chain here rather than with glGenerateMipmap on the GL thread
+    Image &image = source.image;
+    if (usesMipmaps(params.filter))
+        generateMips(image.pixels, image.width, image.height, image.channels, mipOptions(params), source.mips);
+    else
+    {
+        source.mips.resize(1);
+        source.mips[0].width = image.width;
+        source.mips[0].height = image.height;
+        source.mips[0].channels = image.channels;
+        source.mips[0].pixels.assign(image.pixels, image.pixels + static_cast<size_t>(image.width) * image.height * image.channels);
+    }
+    
+    if (params.compression != TextureUncompressed)
+    {
+        // Cook the compressed mip chain
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        compressImage(source.mips, params.compression, source.compressed);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        static const char *names[] = { "none", "BC1", "BC3", "BC5" };
+        printf("Compressed %s to %s in %.2f ms: %lu bytes instead of %lu, PSNR %.2f dB\n",
+               path, names[params.compression], seconds * 1000.0,
+               (unsigned long)compressedTextureBytes(source.compressed),
+               (unsigned long)textureBytes(image.width, image.height, image.channels, params),
+               source.compressed.psnr);
+    }
+    
+    // Images cooked from memory have no cache file of their own
+    uint32_t flags = (params.srgb ? TextureCacheSrgb : 0) | (params.flip ? TextureCacheFlipped : 0);
+    if (!cook.cachePath.empty())
+        saveTextureCache(cook.cachePath.c_str(), cook.sourceSize, cook.sourceHash, cook.cookHash, flags,
+                         source.mips, source.compressed);
+    
+    // Only the compressed mips are uploaded when there are any
+    if (!source.compressed.mips.empty())
+        std::vector<MipLevel>().swap(source.mips);
+    
+    // Level 0 is in the mip chain
+    int width = image.width, height = image.height, channels = image.channels;
+    freeImage(image);
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+}
+
+bool loadTextureSource(const char *path, const TextureParams &params, TextureSource &source)
+{
+    // Use the cooked texture when there is one, otherwise decode the file and cook it again
+    TextureCook cook;
+    if (mapCookedTexture(path, params, cook, source))
+        return true;
+    if (!decodeImage(path, params.flip, source.image))
+        return false;
+    cookTexture(path, params, cook, source);
+    return true;
+}
+
+bool loadTextureSourceMemory(const char *name, const void *data, size_t size, const TextureParams &params,
+                             TextureSource &source)
+{
+    source.mips.clear();
+    source.compressed.mips.clear();
+    if (!decodeImageMemory(name, data, size, params.flip, source.image))
+        return false;
+    TextureCook cook;
+    cook.cookHash = cook.sourceSize = cook.sourceHash = 0;
+    cookTexture(name, params, cook, source);
+    return true;
+}
+
+void loadTextureSources(const std::vector<TextureRequest> &requests,
+                        std::vector<std::unique_ptr<TextureSource> > &sources, unsigned int threadCount)
+{
+    unsigned int threads = threadCount == 0 ? ThreadPool::hardwareThreads() : threadCount;
+    sources.clear();
+    sources.resize(requests.size());
+    for (size_t i = 0; i < requests.size(); i++)
+        sources[i].reset(new TextureSource());
+    
+    // Hash the files and map their caches at the same time
+    std::vector<TextureCook> cooks(requests.size());
+    std::vector<char> cached(requests.size(), 0);
+    runParallel(requests.size(), threads, [&](size_t i)
+    {
+        cached[i] = mapCookedTexture(requests[i].path.c_str(), requests[i].params, cooks[i], *sources[i]);
+    });
+    
+    // Decode the rest in one batch
+    std::vector<size_t> misses;
+    std::vector<ImageRequest> decodes;
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        if (cached[i])
+            continue;
+        ImageRequest request;
+        request.path = requests[i].path;
+        request.flip = requests[i].params.flip;
+        decodes.push_back(request);
+        misses.push_back(i);
+    }
+    if (decodes.empty())
+        return;
+    std::vector<Image> images;
+    decodeImages(decodes, images, threads);
+    
+    // Mips and compression split each image across the threads themselves
+    for (size_t m = 0; m < misses.size(); m++)
+    {
+        size_t i = misses[m];
+        if (!images[m].pixels)
+        {
+            sources[i].reset();
+            continue;
+        }
+        sources[i]->image = images[m];
+        cookTexture(requests[i].path.c_str(), requests[i].params, cooks[i], *sources[i]);
+    }
+}
+
+unsigned int uploadTextureSource(const TextureSource &source, const TextureParams &params,
+                                 GLuint stagingBuffer, size_t &residentBytes)
+{
+    if (!source.cache.levels.empty())
+    {
+        residentBytes = 0;
+        if (source.cache.compression == TextureUncompressed)
+            residentBytes = textureBytes(source.cache.width, source.cache.height, source.cache.channels, params);
+        else
+            for (size_t l = 0; l < source.cache.levels.size(); l++)
+                residentBytes += source.cache.levels[l].size;
+        return uploadTextureCache(source.cache, params);
+    }
+    if (!source.compressed.mips.empty())
+    {
+        residentBytes = compressedTextureBytes(source.compressed);
+        return uploadCompressedTexture(source.compressed, params, stagingBuffer);
+    }
+    residentBytes = textureBytes(source.image.width, source.image.height, source.image.channels, params);
+    if (!source.mips.empty())
+        return uploadMipLevels(source.mips, params, stagingBuffer);
+    return uploadTexture(source.image, params, stagingBuffer);
+}
+
+void freeTextureSource(TextureSource &source)
+{
+    freeImage(source.image);
+    std::vector<MipLevel>().swap(source.mips);
+    std::vector<CompressedMip>().swap(source.compressed.mips);
+    closeTextureCache(source.cache);
+}
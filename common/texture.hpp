@@ -1,10 +1,151 @@
-#pragma once
-
-#include <GL/glew.h> // For GLuint
-#include <string> // Often useful, though not strictly for this declaration
-
-// Function declaration for loading a texture
-unsigned int loadTexture(const char *path);
-
-// Note: The actual STB_IMAGE_IMPLEMENTATION and the definition of loadTexture
-// will be moved to common/texture.cpp to prevent duplicate symbols.
+#pragma once
+
+#include <GL/glew.h> // For GLuint
+#include <string>
+#include <memory>
+#include <vector>
+#include <stddef.h>
+
+#include "mip_generator.hpp"
+#include "texture_compression.hpp"
+#include "texture_cache.hpp"
+
+// How a texture file is decoded and sampled. Part of the texture cache key, so
+// the same file loaded with different parameters is a different texture
+struct TextureParams
+{
+    bool flip;     // Flip rows so uv (0, 0) is the bottom left, as OpenGL expects
+    bool srgb;     // Colour data stored in sRGB, decoded to linear when sampled
+    GLenum wrap;   // Wrap mode for both axes
+    GLenum filter; // Minification filter, mipmaps are only built for mipmap filters
+    TextureCompression compression; // Block compress on load, BC5 keeps only red and green
+    MipFilter mipFilter;            // Filter the mip chain is built with
+    float alphaCutoff;              // Alpha test threshold for cutouts, mips keep its coverage. 0 = off
+
+    TextureParams()
+        : flip(true), srgb(false), wrap(GL_REPEAT), filter(GL_LINEAR_MIPMAP_LINEAR),
+          compression(TextureUncompressed), mipFilter(MipBox), alphaCutoff(0.0f) {}
+};
+
+struct TextureAsset;
+
+// Shared handle, the texture is released when the last handle goes away
+typedef std::shared_ptr<TextureAsset> TextureHandle;
+
+// A texture shared between everything that uses it
+struct TextureAsset
+{
+    unsigned int id;
+    std::string key;
+    size_t residentBytes;      // GPU memory of all mip levels, 0 while showing a placeholder
+    TextureHandle placeholder; // Set while loading, id is the placeholder's until then
+};
+
+// Decoded 8-bit image
+struct Image
+{
+    int width;
+    int height;
+    int channels;
+    unsigned char *pixels;
+};
+
+// Decode an image file without touching GL state, safe on any thread
+bool decodeImage(const char *path, bool flip, Image &image);
+
+// Decode an image file already in memory, such as one embedded in a model.
+// name is only used in messages
+bool decodeImageMemory(const char *name, const void *data, size_t size, bool flip, Image &image);
+
+// An image to decode as part of a batch
+struct ImageRequest
+{
+    std::string path;
+    bool flip;
+};
+
+// Decode a batch of image files at the same time on threadCount threads (0 = all
+// cores). images[i] is the decoded requests[i], with NULL pixels if it failed.
+// Returns false if any image failed. Touches no GL state, safe on any thread
+bool decodeImages(const std::vector<ImageRequest> &requests, std::vector<Image> &images,
+                  unsigned int threadCount = 0);
+
+// Free the pixels of a decoded image
+void freeImage(Image &image);
+
+// Create a texture from a decoded image, building its mipmaps on the CPU. With a
+// staging buffer the pixels are copied into it and the driver uploads them from there
+unsigned int uploadTexture(const Image &image, const TextureParams &params, GLuint stagingBuffer = 0);
+
+// Create a texture from a mip chain, uploaded level by level
+unsigned int uploadMipLevels(const std::vector<MipLevel> &levels, const TextureParams &params,
+                             GLuint stagingBuffer = 0);
+
+// Create a texture from compressed mips, uploaded as they are
+unsigned int uploadCompressedTexture(const CompressedImage &image, const TextureParams &params,
+                                     GLuint stagingBuffer = 0);
+
+// Create a texture from a mapped cache file. Levels are allocated first and then
+// filled straight from the mapping, with no staging copy
+unsigned int uploadTextureCache(const TextureCache &cache, const TextureParams &params);
+
+// Sized internal format and pixel format of texels stored this way
+void textureFormats(TextureCompression compression, int channels, bool srgb,
+                    GLenum &internalFormat, GLenum &format);
+
+// Set the wrap and filter modes of the bound texture
+void setTextureSampling(const TextureParams &params);
+
+// GPU memory used by an uncompressed texture with these dimensions and parameters
+size_t textureBytes(int width, int height, int channels, const TextureParams &params);
+
+// GPU memory used by a compressed texture
+size_t compressedTextureBytes(const CompressedImage &image);
+
+// A texture ready to upload: a mapped cache file, compressed mips, a mip chain,
+// or only the decoded pixels when it has no mipmaps. image keeps its size either way
+struct TextureSource
+{
+    Image image;
+    std::vector<MipLevel> mips;
+    CompressedImage compressed;
+    TextureCache cache;
+};
+
+// Map the cooked .tex file of an image when it matches the file and parameters.
+// Otherwise cook it: decode the file with stb_image, build its mips, compress
+// them if the parameters ask for it and write the cache for next time.
+// Touches no GL state, safe on any thread
+bool loadTextureSource(const char *path, const TextureParams &params, TextureSource &source);
+
+// Decode an image file already in memory and build its mips like loadTextureSource.
+// Nothing is cached, the file it came from is cached as a whole
+bool loadTextureSourceMemory(const char *name, const void *data, size_t size, const TextureParams &params,
+                             TextureSource &source);
+
+// The .tex file loadTextureSource cooks an image with these parameters to
+std::string textureCookPath(const char *path, const TextureParams &params);
+
+// A texture to load as part of a batch
+struct TextureRequest
+{
+    std::string path;
+    TextureParams params;
+};
+
+// Load a batch of textures like loadTextureSource. Cache files are mapped and
+// images decoded on threadCount threads (0 = all cores), the images to cook are
+// then cooked one by one on all of them. sources[i] is the source of requests[i],
+// empty if it failed
+void loadTextureSources(const std::vector<TextureRequest> &requests,
+                        std::vector<std::unique_ptr<TextureSource> > &sources, unsigned int threadCount = 0);
+
+// Create the texture from a loaded source and report its GPU memory
+unsigned int uploadTextureSource(const TextureSource &source, const TextureParams &params,
+                                 GLuint stagingBuffer, size_t &residentBytes);
+
+// Free the CPU copy of a loaded source and unmap its cache file
+void freeTextureSource(TextureSource &source);
+
+// Note: The actual STB_IMAGE_IMPLEMENTATION lives in common/texture.cpp to
+// prevent duplicate symbols. Textures are loaded and shared through AssetManager
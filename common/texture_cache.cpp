@@ -0,0 +1,251 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+
+#include "texture_cache.hpp"
+
+// Bump whenever the layout below or the meaning of a field changes
+static const uint32_t textureCacheVersion = 1;
+static const char textureCacheMagic[4] = { 'T', 'E', 'X', 'C' };
+
+// Levels start on this boundary so they can be read in place
+static const uint64_t levelAlignment = 16;
+
+// A full chain of a 2^31 texture has 32 levels
+static const uint32_t maxLevels = 32;
+
+struct TextureCacheHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t cookHash;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t compression;
+    uint32_t flags;
+    uint32_t levelCount;
+};
+
+// Follows the header, one per level
+struct TextureCacheLevelEntry
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + levelAlignment - 1) & ~(levelAlignment - 1);
+}
+
+std::string textureCachePath(const char *sourcePath, uint64_t cookHash)
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".%08x.tex", static_cast<unsigned int>(cookHash & 0xffffffffu));
+    return std::string(sourcePath) + suffix;
+}
+
+// Bytes a level of these dimensions must have
+static uint64_t levelBytes(uint32_t width, uint32_t height, uint32_t channels, TextureCompression compression)
+{
+    if (compression == TextureUncompressed)
+        return static_cast<uint64_t>(width) * height * channels;
+    uint64_t blocks = static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * compressedBlockBytes(compression);
+}
+
+static bool readTextureCache(const char *cachePath, bool checkSource, uint64_t sourceSize,
+                             uint64_t sourceHash, uint64_t cookHash, TextureCache &cache)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    cache.levels.clear();
+    if (!cache.file.open(cachePath))
+        return false;
+
+    VfsFile &file = cache.file;
+    TextureCacheHeader header;
+    if (file.size() < sizeof(header))
+    {
+        printf("Texture cache %s is truncated, recooking.\n", cachePath);
+        file.close();
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (memcmp(header.magic, textureCacheMagic, sizeof(textureCacheMagic)) != 0 ||
+        header.version != textureCacheVersion)
+    {
+        printf("Texture cache %s is from another version, recooking.\n", cachePath);
+        file.close();
+        return false;
+    }
+
+    if (header.cookHash != cookHash ||
+        (checkSource && (header.sourceSize != sourceSize || header.sourceHash != sourceHash)))
+    {
+        printf("Texture cache %s is stale, recooking.\n", cachePath);
+        file.close();
+        return false;
+    }
+
+    const uint64_t fileSize = file.size();
+    const TextureCompression compression = static_cast<TextureCompression>(header.compression);
+    bool valid = header.levelCount > 0 && header.levelCount <= maxLevels &&
+                 header.width > 0 && header.height > 0 &&
+                 (header.channels == 1 || header.channels == 3 || header.channels == 4) &&
+                 header.compression <= TextureBC5 &&
+                 sizeof(header) + header.levelCount * sizeof(TextureCacheLevelEntry) <= fileSize;
+
+    // Each level halves the one above and lies inside the file
+    uint32_t width = header.width, height = header.height;
+    const char *entries = file.data() + sizeof(header);
+    for (uint32_t l = 0; valid && l < header.levelCount; l++)
+    {
+        TextureCacheLevelEntry entry;
+        memcpy(&entry, entries + l * sizeof(entry), sizeof(entry));
+        valid = entry.width == width && entry.height == height &&
+                entry.size == levelBytes(width, height, header.channels, compression) &&
+                entry.offset % levelAlignment == 0 && entry.offset <= fileSize &&
+                entry.size <= fileSize - entry.offset;
+        if (!valid)
+            break;
+
+        TextureCacheLevel level;
+        level.width = static_cast<int>(entry.width);
+        level.height = static_cast<int>(entry.height);
+        level.data = reinterpret_cast<const uint8_t *>(file.data() + entry.offset);
+        level.size = static_cast<size_t>(entry.size);
+        cache.levels.push_back(level);
+
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    if (!valid)
+    {
+        printf("Texture cache %s is corrupt, recooking.\n", cachePath);
+        closeTextureCache(cache);
+        return false;
+    }
+
+    cache.width = static_cast<int>(header.width);
+    cache.height = static_cast<int>(header.height);
+    cache.channels = static_cast<int>(header.channels);
+    cache.compression = compression;
+    cache.flags = header.flags;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Mapped texture cache %s: %ux%u, %u levels in %.2f ms\n", cachePath,
+           header.width, header.height, header.levelCount, seconds * 1000.0);
+    return true;
+}
+
+bool loadTextureCache(const char *cachePath, uint64_t sourceSize, uint64_t sourceHash,
+                      uint64_t cookHash, TextureCache &cache)
+{
+    return readTextureCache(cachePath, true, sourceSize, sourceHash, cookHash, cache);
+}
+
+bool loadTextureCache(const char *cachePath, uint64_t cookHash, TextureCache &cache)
+{
+    return readTextureCache(cachePath, false, 0, 0, cookHash, cache);
+}
+
+void closeTextureCache(TextureCache &cache)
+{
+    cache.levels.clear();
+    cache.file.close();
+}
+
+static bool writeLevel(FILE *file, uint64_t offset, const void *data, size_t bytes)
+{
+    if (bytes == 0)
+        return true;
+    return fseek(file, static_cast<long>(offset), SEEK_SET) == 0 &&
+           fwrite(data, 1, bytes, file) == bytes;
+}
+
+bool saveTextureCache(const char *cachePath, uint64_t sourceSize, uint64_t sourceHash, uint64_t cookHash,
+                      uint32_t flags, const std::vector<MipLevel> &levels, const CompressedImage &compressed)
+{
+    const bool isCompressed = !compressed.mips.empty();
+    if (levels.empty() && !isCompressed)
+        return false;
+
+    // Pointers and sizes of the levels to store, largest first
+    std::vector<TextureCacheLevelEntry> entries;
+    std::vector<const void *> data;
+    size_t count = isCompressed ? compressed.mips.size() : levels.size();
+    if (count > maxLevels)
+        return false;
+    for (size_t l = 0; l < count; l++)
+    {
+        TextureCacheLevelEntry entry;
+        entry.width = static_cast<uint32_t>(isCompressed ? compressed.mips[l].width : levels[l].width);
+        entry.height = static_cast<uint32_t>(isCompressed ? compressed.mips[l].height : levels[l].height);
+        entry.size = isCompressed ? compressed.mips[l].blocks.size() : levels[l].pixels.size();
+        entry.offset = 0;
+        entries.push_back(entry);
+        data.push_back(isCompressed ? static_cast<const void *>(compressed.mips[l].blocks.data())
+                                    : static_cast<const void *>(levels[l].pixels.data()));
+    }
+
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, textureCacheMagic, sizeof(textureCacheMagic));
+    header.version = textureCacheVersion;
+    header.sourceSize = sourceSize;
+    header.sourceHash = sourceHash;
+    header.cookHash = cookHash;
+    header.width = entries[0].width;
+    header.height = entries[0].height;
+    header.channels = static_cast<uint32_t>(levels.empty() ? 4 : levels[0].channels);
+    header.compression = static_cast<uint32_t>(isCompressed ? compressed.compression : TextureUncompressed);
+    header.flags = flags;
+    header.levelCount = static_cast<uint32_t>(count);
+
+    uint64_t offset = sizeof(header) + count * sizeof(TextureCacheLevelEntry);
+    for (size_t l = 0; l < count; l++)
+    {
+        entries[l].offset = alignUp(offset);
+        offset = entries[l].offset + entries[l].size;
+    }
+
+    // Write to a temporary file and rename it so a crash never leaves half a cache
+    std::string tempPath = std::string(cachePath) + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == NULL)
+    {
+        printf("Can't write texture cache %s.\n", cachePath);
+        return false;
+    }
+
+    bool ok = writeLevel(file, 0, &header, sizeof(header)) &&
+              writeLevel(file, sizeof(header), entries.data(), count * sizeof(TextureCacheLevelEntry));
+    for (size_t l = 0; ok && l < count; l++)
+        ok = writeLevel(file, entries[l].offset, data[l], static_cast<size_t>(entries[l].size));
+    ok = fclose(file) == 0 && ok;
+
+    if (ok)
+    {
+        remove(cachePath);
+        ok = rename(tempPath.c_str(), cachePath) == 0;
+    }
+    if (!ok)
+    {
+        remove(tempPath.c_str());
+        printf("Can't write texture cache %s.\n", cachePath);
+        return false;
+    }
+
+    printf("Wrote texture cache %s\n", cachePath);
+    return true;
+}
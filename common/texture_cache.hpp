@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "vfs.hpp"
+#include "mip_generator.hpp"
+#include "texture_compression.hpp"
+
+// How the texels of a cooked texture are stored
+enum TextureCacheFlags
+{
+    TextureCacheSrgb = 1,   // Colour is sRGB encoded
+    TextureCacheFlipped = 2 // Rows are bottom to top, as OpenGL expects
+};
+
+// One mip level of a cooked texture, read in place from the mapping
+struct TextureCacheLevel
+{
+    int width;
+    int height;
+    const uint8_t *data;
+    size_t size;
+};
+
+// A .tex cache file mapped into memory, from disk or a pak. The levels point
+// into the mapping, so they are valid until the file is closed
+struct TextureCache
+{
+    VfsFile file;
+    int width;
+    int height;
+    int channels;
+    TextureCompression compression;
+    uint32_t flags;
+    std::vector<TextureCacheLevel> levels;
+};
+
+// Cache file used for a source image cooked with the settings hashed in cookHash,
+// e.g. textures/ball.png -> textures/ball.png.1a2b3c4d.tex
+std::string textureCachePath(const char *sourcePath, uint64_t cookHash);
+
+// Map a cache file if it was cooked from a source with this size and hash and
+// with these settings. Returns false if the cache is missing, corrupt, from
+// another version or stale
+bool loadTextureCache(const char *cachePath, uint64_t sourceSize, uint64_t sourceHash,
+                      uint64_t cookHash, TextureCache &cache);
+
+// Map a cache file without checking it against a source (used when only the cache is shipped)
+bool loadTextureCache(const char *cachePath, uint64_t cookHash, TextureCache &cache);
+
+// Unmap a cache file
+void closeTextureCache(TextureCache &cache);
+
+// Write a cache file holding compressed mips when there are any, otherwise the
+// uncompressed mip chain
+bool saveTextureCache(const char *cachePath, uint64_t sourceSize, uint64_t sourceHash, uint64_t cookHash,
+                      uint32_t flags, const std::vector<MipLevel> &levels, const CompressedImage &compressed);
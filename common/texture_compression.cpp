@@ -0,0 +1,458 @@
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+
+size_t compressedBlockBytes(TextureCompression compression)
+{
+    return compression == TextureBC1 ? 8 : 16;
+}
+
+// 5:6:5 colour packing, expanded back the way the hardware does
+static uint16_t packRgb565(const float color[3])
+{
+    int r = static_cast<int>(color[0] * (31.0f / 255.0f) + 0.5f);
+    int g = static_cast<int>(color[1] * (63.0f / 255.0f) + 0.5f);
+    int b = static_cast<int>(color[2] * (31.0f / 255.0f) + 0.5f);
+    r = r < 0 ? 0 : (r > 31 ? 31 : r);
+    g = g < 0 ? 0 : (g > 63 ? 63 : g);
+    b = b < 0 ? 0 : (b > 31 ? 31 : b);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRgb565(uint16_t packed, int color[3])
+{
+    int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// The four colours of a block whose first endpoint is the larger one
+static void bc1Palette(uint16_t c0, uint16_t c1, int palette[4][3])
+{
+    unpackRgb565(c0, palette[0]);
+    unpackRgb565(c1, palette[1]);
+    for (int i = 0; i < 3; i++)
+    {
+        palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+        palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+    }
+}
+
+// Pick the nearest palette colour for every texel, returns the squared error
+static int bc1Indices(const uint8_t texels[16][4], const int palette[4][3], uint8_t indices[16])
+{
+    int total = 0;
+    for (int t = 0; t < 16; t++)
+    {
+        // Plain loops over fixed size arrays, vectorized by the compiler
+        int distances[4];
+        for (int p = 0; p < 4; p++)
+        {
+            int dr = texels[t][0] - palette[p][0];
+            int dg = texels[t][1] - palette[p][1];
+            int db = texels[t][2] - palette[p][2];
+            distances[p] = dr * dr + dg * dg + db * db;
+        }
+        int best = 0;
+        for (int p = 1; p < 4; p++)
+            best = distances[p] < distances[best] ? p : best;
+        indices[t] = static_cast<uint8_t>(best);
+        total += distances[best];
+    }
+    return total;
+}
+
+// Endpoints that fit the chosen indices best in the least squares sense
+static bool refitEndpoints(const uint8_t texels[16][4], const uint8_t indices[16], float end0[3], float end1[3])
+{
+    static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < 16; t++)
+    {
+        float a = weights[indices[t]], b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int i = 0; i < 3; i++)
+        {
+            ax[i] += a * texels[t][i];
+            bx[i] += b * texels[t][i];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+        return false;
+    for (int i = 0; i < 3; i++)
+    {
+        end0[i] = (ax[i] * bb - bx[i] * ab) / det;
+        end1[i] = (bx[i] * aa - ax[i] * ab) / det;
+    }
+    return true;
+}
+
+static void writeBC1Block(uint16_t c0, uint16_t c1, const uint8_t indices[16], uint8_t out[8])
+{
+    // Four colour mode needs c0 > c1, swapping the endpoints swaps indices 0-1 and 2-3
+    uint8_t ordered[16];
+    for (int t = 0; t < 16; t++)
+        ordered[t] = c0 == c1 ? 0 : (c0 < c1 ? indices[t] ^ 1 : indices[t]);
+    if (c0 < c1)
+    {
+        uint16_t swap = c0;
+        c0 = c1;
+        c1 = swap;
+    }
+
+    uint32_t bits = 0;
+    for (int t = 0; t < 16; t++)
+        bits |= static_cast<uint32_t>(ordered[t]) << (2 * t);
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (bits >> (8 * i)) & 0xff;
+}
+
+void encodeBC1Block(const uint8_t texels[16][4], uint8_t out[8])
+{
+    // Mean and covariance of the block colours
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < 16; t++)
+        for (int i = 0; i < 3; i++)
+            mean[i] += texels[t][i];
+    for (int i = 0; i < 3; i++)
+        mean[i] /= 16.0f;
+
+    float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int t = 0; t < 16; t++)
+    {
+        float r = texels[t][0] - mean[0], g = texels[t][1] - mean[1], b = texels[t][2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    // Principal axis by power iteration, starting from the covariance row of the
+    // channel that varies most so opposite colours don't cancel out
+    int row = covariance[0] >= covariance[3] ? (covariance[0] >= covariance[5] ? 0 : 2)
+                                             : (covariance[3] >= covariance[5] ? 1 : 2);
+    static const int rowStart[3][3] = { { 0, 1, 2 }, { 1, 3, 4 }, { 2, 4, 5 } };
+    float axis[3];
+    float startLength = 0.0f;
+    for (int i = 0; i < 3; i++)
+    {
+        axis[i] = covariance[rowStart[row][i]];
+        startLength += axis[i] * axis[i];
+    }
+    startLength = sqrtf(startLength);
+    for (int i = 0; i < 3; i++)
+        axis[i] = startLength > 1e-6f ? axis[i] / startLength : 0.0f;
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+        };
+        float length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f)
+            break;
+        for (int i = 0; i < 3; i++)
+            axis[i] = next[i] / length;
+    }
+
+    // Endpoints at the extremes along the axis, inset a little to cut the error of outliers
+    float minT = 0.0f, maxT = 0.0f;
+    for (int t = 0; t < 16; t++)
+    {
+        float projection = (texels[t][0] - mean[0]) * axis[0] +
+                           (texels[t][1] - mean[1]) * axis[1] +
+                           (texels[t][2] - mean[2]) * axis[2];
+        minT = projection < minT ? projection : minT;
+        maxT = projection > maxT ? projection : maxT;
+    }
+    float inset = (maxT - minT) / 16.0f;
+    minT += inset;
+    maxT -= inset;
+
+    float end0[3], end1[3];
+    for (int i = 0; i < 3; i++)
+    {
+        end0[i] = mean[i] + axis[i] * maxT;
+        end1[i] = mean[i] + axis[i] * minT;
+    }
+
+    uint16_t c0 = packRgb565(end0), c1 = packRgb565(end1);
+    int palette[4][3];
+    uint8_t indices[16];
+    bc1Palette(c0, c1, palette);
+    int error = bc1Indices(texels, palette, indices);
+
+    // Refit the endpoints to the chosen indices and keep them if they are better
+    if (c0 != c1 && refitEndpoints(texels, indices, end0, end1))
+    {
+        uint16_t refit0 = packRgb565(end0), refit1 = packRgb565(end1);
+        uint8_t refitIndices[16];
+        bc1Palette(refit0, refit1, palette);
+        int refitError = bc1Indices(texels, palette, refitIndices);
+        if (refitError < error)
+        {
+            c0 = refit0;
+            c1 = refit1;
+            memcpy(indices, refitIndices, sizeof(indices));
+        }
+    }
+
+    writeBC1Block(c0, c1, indices, out);
+}
+
+void decodeBC1Block(const uint8_t block[8], uint8_t texels[16][4])
+{
+    uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    int palette[4][3];
+    int alpha[4] = { 255, 255, 255, 255 };
+    if (c0 > c1)
+        bc1Palette(c0, c1, palette);
+    else
+    {
+        // Three colour mode with transparent black
+        unpackRgb565(c0, palette[0]);
+        unpackRgb565(c1, palette[1]);
+        for (int i = 0; i < 3; i++)
+        {
+            palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+            palette[3][i] = 0;
+        }
+        alpha[3] = 0;
+    }
+
+    uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for (int t = 0; t < 16; t++)
+    {
+        int index = (bits >> (2 * t)) & 3;
+        for (int i = 0; i < 3; i++)
+            texels[t][i] = static_cast<uint8_t>(palette[index][i]);
+        texels[t][3] = static_cast<uint8_t>(alpha[index]);
+    }
+}
+
+// The eight values of a block whose first endpoint is the larger one
+static void bc4Palette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void encodeBC4Block(const uint8_t values[16], uint8_t out[8])
+{
+    int lo = 255, hi = 0;
+    for (int t = 0; t < 16; t++)
+    {
+        lo = values[t] < lo ? values[t] : lo;
+        hi = values[t] > hi ? values[t] : hi;
+    }
+
+    // Eight value mode, a flat block uses index 0 everywhere
+    int palette[8];
+    bc4Palette(hi, lo, palette);
+    uint64_t bits = 0;
+    for (int t = 0; t < 16; t++)
+    {
+        int best = 0, bestDistance = 256;
+        for (int p = 0; p < 8; p++)
+        {
+            int distance = abs(values[t] - palette[p]);
+            if (distance < bestDistance)
+            {
+                best = p;
+                bestDistance = distance;
+            }
+        }
+        bits |= static_cast<uint64_t>(best) << (3 * t);
+    }
+
+    out[0] = static_cast<uint8_t>(hi);
+    out[1] = static_cast<uint8_t>(lo);
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (bits >> (8 * i)) & 0xff;
+}
+
+void decodeBC4Block(const uint8_t block[8], uint8_t values[16])
+{
+    int palette[8];
+    bc4Palette(block[0], block[1], palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    for (int t = 0; t < 16; t++)
+        values[t] = static_cast<uint8_t>(palette[(bits >> (3 * t)) & 7]);
+}
+
+// Encode the 4x4 block at (blockX, blockY), edge texels are repeated past the image
+static void encodeBlock(const uint8_t *rgba, int width, int height, int blockX, int blockY,
+                        TextureCompression compression, uint8_t *out)
+{
+    uint8_t texels[16][4];
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = blockY * 4 + y < height ? blockY * 4 + y : height - 1;
+        for (int x = 0; x < 4; x++)
+        {
+            int sx = blockX * 4 + x < width ? blockX * 4 + x : width - 1;
+            memcpy(texels[y * 4 + x], rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+        }
+    }
+
+    uint8_t channel[16];
+    if (compression == TextureBC1)
+        encodeBC1Block(texels, out);
+    else if (compression == TextureBC3)
+    {
+        for (int t = 0; t < 16; t++)
+            channel[t] = texels[t][3];
+        encodeBC4Block(channel, out);
+        encodeBC1Block(texels, out + 8);
+    }
+    else
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            for (int t = 0; t < 16; t++)
+                channel[t] = texels[t][c];
+            encodeBC4Block(channel, out + 8 * c);
+        }
+    }
+}
+
+// Expand 1-4 channel texels to RGBA so every format reads them the same way
+static void expandToRgba(const MipLevel &level, std::vector<uint8_t> &rgba)
+{
+    const int channels = level.channels;
+    rgba.resize(static_cast<size_t>(level.width) * level.height * 4);
+    for (size_t p = 0; p < static_cast<size_t>(level.width) * level.height; p++)
+    {
+        const uint8_t *in = &level.pixels[p * channels];
+        uint8_t *out = &rgba[p * 4];
+        out[0] = in[0];
+        out[1] = channels >= 2 ? in[1] : in[0];
+        out[2] = channels >= 3 ? in[2] : (channels == 1 ? in[0] : 0);
+        out[3] = channels == 4 ? in[3] : 255;
+    }
+}
+
+void compressImage(const std::vector<MipLevel> &levels, TextureCompression compression,
+                   CompressedImage &out, unsigned int threadCount)
+{
+    std::vector<std::vector<uint8_t> > rgba(levels.size());
+    for (size_t l = 0; l < levels.size(); l++)
+        expandToRgba(levels[l], rgba[l]);
+
+    // One task per row of blocks across every level
+    const size_t blockBytes = compressedBlockBytes(compression);
+    std::vector<std::pair<size_t, int> > rows;
+    out.compression = compression;
+    out.mips.resize(levels.size());
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        int blocksX = (levels[l].width + 3) / 4, blocksY = (levels[l].height + 3) / 4;
+        out.mips[l].width = levels[l].width;
+        out.mips[l].height = levels[l].height;
+        out.mips[l].blocks.resize(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+        for (int by = 0; by < blocksY; by++)
+            rows.push_back(std::make_pair(l, by));
+    }
+
+    unsigned int threads = threadCount == 0 ? ThreadPool::hardwareThreads() : threadCount;
+    runParallel(rows.size(), threads, [&](size_t r)
+    {
+        size_t l = rows[r].first;
+        int by = rows[r].second;
+        int blocksX = (levels[l].width + 3) / 4;
+        uint8_t *row = &out.mips[l].blocks[static_cast<size_t>(by) * blocksX * blockBytes];
+        for (int bx = 0; bx < blocksX; bx++)
+            encodeBlock(rgba[l].data(), levels[l].width, levels[l].height, bx, by, compression, row + bx * blockBytes);
+    });
+
+    out.psnr = compressionPsnr(rgba[0].data(), levels[0].width, levels[0].height, out.mips[0], compression);
+}
+
+double compressionPsnr(const uint8_t *rgba, int width, int height,
+                       const CompressedMip &mip, TextureCompression compression)
+{
+    const size_t blockBytes = compressedBlockBytes(compression);
+    const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const int kept = compression == TextureBC1 ? 3 : (compression == TextureBC3 ? 4 : 2);
+
+    double squaredError = 0.0;
+    for (int by = 0; by < blocksY; by++)
+    {
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            const uint8_t *block = &mip.blocks[(static_cast<size_t>(by) * blocksX + bx) * blockBytes];
+            uint8_t texels[16][4];
+            uint8_t channel[16];
+            if (compression == TextureBC1)
+                decodeBC1Block(block, texels);
+            else if (compression == TextureBC3)
+            {
+                decodeBC1Block(block + 8, texels);
+                decodeBC4Block(block, channel);
+                for (int t = 0; t < 16; t++)
+                    texels[t][3] = channel[t];
+            }
+            else
+            {
+                for (int c = 0; c < 2; c++)
+                {
+                    decodeBC4Block(block + 8 * c, channel);
+                    for (int t = 0; t < 16; t++)
+                        texels[t][c] = channel[t];
+                }
+            }
+
+            // Only texels inside the image count
+            for (int t = 0; t < 16; t++)
+            {
+                int x = bx * 4 + t % 4, y = by * 4 + t / 4;
+                if (x >= width || y >= height)
+                    continue;
+                const uint8_t *source = rgba + (static_cast<size_t>(y) * width + x) * 4;
+                for (int c = 0; c < kept; c++)
+                {
+                    double difference = static_cast<double>(source[c]) - texels[t][c];
+                    squaredError += difference * difference;
+                }
+            }
+        }
+    }
+
+    double mse = squaredError / (static_cast<double>(width) * height * kept);
+    if (mse <= 0.0)
+        return 99.0; // Lossless
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
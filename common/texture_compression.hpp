@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mip_generator.hpp"
+
+// Block compressed formats, 4x4 texels per block
+enum TextureCompression
+{
+    TextureUncompressed,
+    TextureBC1, // RGB, 8 bytes per block
+    TextureBC3, // RGBA, 16 bytes per block
+    TextureBC5  // Two channels (normal map xy), 16 bytes per block
+};
+
+// One mip level of blocks, rows of blocks top to bottom
+struct CompressedMip
+{
+    int width;
+    int height;
+    std::vector<uint8_t> blocks;
+};
+
+// A compressed texture with its mip chain, largest level first
+struct CompressedImage
+{
+    TextureCompression compression;
+    std::vector<CompressedMip> mips;
+    double psnr; // Of the largest level, over the channels the format keeps
+};
+
+// Bytes per 4x4 block
+size_t compressedBlockBytes(TextureCompression compression);
+
+// Encode and decode one 4x4 block of RGBA texels
+void encodeBC1Block(const uint8_t texels[16][4], uint8_t out[8]);
+void decodeBC1Block(const uint8_t block[8], uint8_t texels[16][4]);
+
+// Encode and decode one 4x4 block of single channel values (BC3 alpha, BC5 channels)
+void encodeBC4Block(const uint8_t values[16], uint8_t out[8]);
+void decodeBC4Block(const uint8_t block[8], uint8_t values[16]);
+
+// Compress every level of a mip chain (or a lone level 0). Rows of blocks are
+// encoded on threadCount threads (0 = all cores)
+void compressImage(const std::vector<MipLevel> &levels, TextureCompression compression,
+                   CompressedImage &out, unsigned int threadCount = 0);
+
+// Peak signal to noise ratio in dB between RGBA pixels and a compressed level
+double compressionPsnr(const uint8_t *rgba, int width, int height,
+                       const CompressedMip &mip, TextureCompression compression);
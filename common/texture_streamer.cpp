@@ -0,0 +1,347 @@
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <math.h>
+
+#include "texture_streamer.hpp"
+#include "asset_manager.hpp"
+
+struct TextureStreamer::StreamedTexture
+{
+    TextureHandle asset;
+    TextureParams params;
+    TextureSource source;
+    std::vector<TextureCacheLevel> levels; // Views of the source levels, largest first
+    std::vector<size_t> levelBytes;        // GPU memory of each level
+    GLenum internalFormat;
+    GLenum format;
+    bool compressed;
+    bool loaded;
+    bool released;
+    unsigned int residentLevel;
+    unsigned int minimumLevel; // Coarsest level streamed, the ones after it are always resident
+    unsigned int wantedLevel;
+    unsigned int targetLevel;
+    float density;
+    unsigned long lastUsedFrame;
+};
+
+TextureStreamer &TextureStreamer::instance()
+{
+    static TextureStreamer streamer;
+    return streamer;
+}
+
+TextureHandle TextureStreamer::load(const char *path, const TextureHandle &placeholder,
+                                    const TextureParams &params)
+{
+    std::string key = AssetManager::textureKey(AssetManager::canonicalPath(path), params);
+    std::map<std::string, StreamedHandle>::iterator it = textures.find(key);
+    if (it != textures.end())
+        return it->second->asset;
+
+    StreamedHandle texture(new StreamedTexture());
+    texture->asset = TextureHandle(new TextureAsset());
+    texture->asset->id = placeholder ? placeholder->id : 0;
+    texture->asset->key = key;
+    texture->asset->residentBytes = 0;
+    texture->asset->placeholder = placeholder;
+    texture->params = params;
+    texture->source.image.pixels = NULL;
+    texture->compressed = false;
+    texture->loaded = false;
+    texture->released = false;
+    texture->residentLevel = texture->minimumLevel = texture->wantedLevel = texture->targetLevel = 0;
+    texture->density = 0.0f;
+    texture->lastUsedFrame = frame;
+    textures[key] = texture;
+
+    // Mapped or cooked on a worker, the coarsest levels are uploaded by finishLoads
+    std::string file(path);
+    std::shared_ptr<bool> ok(new bool(false));
+    AssetManager::instance().submitLoad(
+        [texture, ok, file]() { *ok = loadTextureSource(file.c_str(), texture->params, texture->source); },
+        [this, texture, ok]()
+        {
+            if (*ok && !texture->released)
+                upload(*texture);
+            else
+                freeTextureSource(texture->source);
+        });
+    return texture->asset;
+}
+
+// Define a level of the bound texture from its data, or free it
+static void defineLevel(GLenum internalFormat, GLenum format, bool compressed, unsigned int index,
+                        const TextureCacheLevel &level, bool resident)
+{
+    GLsizei width = resident ? level.width : 0, height = resident ? level.height : 0;
+    const uint8_t *data = resident ? level.data : NULL;
+    if (compressed)
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(index), internalFormat, width, height, 0,
+                               resident ? static_cast<GLsizei>(level.size) : 0, data);
+    else
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(index), internalFormat, width, height, 0,
+                     format, GL_UNSIGNED_BYTE, data);
+}
+
+void TextureStreamer::upload(StreamedTexture &texture)
+{
+    // The levels are read in place from the mapped cache, or from the cooked
+    // mips if the cache couldn't be written
+    TextureSource &source = texture.source;
+    TextureCompression compression = TextureUncompressed;
+    int channels = source.image.channels;
+    bool srgb = texture.params.srgb;
+    if (!source.cache.levels.empty())
+    {
+        texture.levels = source.cache.levels;
+        compression = source.cache.compression;
+        channels = source.cache.channels;
+        srgb = (source.cache.flags & TextureCacheSrgb) != 0;
+    }
+    else if (!source.compressed.mips.empty())
+    {
+        compression = source.compressed.compression;
+        for (size_t l = 0; l < source.compressed.mips.size(); l++)
+        {
+            const CompressedMip &mip = source.compressed.mips[l];
+            TextureCacheLevel level = { mip.width, mip.height, mip.blocks.data(), mip.blocks.size() };
+            texture.levels.push_back(level);
+        }
+    }
+    else
+    {
+        for (size_t l = 0; l < source.mips.size(); l++)
+        {
+            const MipLevel &mip = source.mips[l];
+            TextureCacheLevel level = { mip.width, mip.height, mip.pixels.data(), mip.pixels.size() };
+            texture.levels.push_back(level);
+        }
+    }
+    if (texture.levels.empty())
+        return;
+
+    // Drivers store RGB8 padded to 4 bytes per texel
+    texture.compressed = compression != TextureUncompressed;
+    textureFormats(compression, channels, srgb, texture.internalFormat, texture.format);
+    size_t texelBytes = channels == 3 ? 4 : static_cast<size_t>(channels);
+    for (size_t l = 0; l < texture.levels.size(); l++)
+    {
+        const TextureCacheLevel &level = texture.levels[l];
+        texture.levelBytes.push_back(texture.compressed ? level.size :
+                                     static_cast<size_t>(level.width) * level.height * texelBytes);
+    }
+
+    // Levels no larger than the minimum size are never streamed out
+    unsigned int count = static_cast<unsigned int>(texture.levels.size());
+    texture.minimumLevel = count - 1;
+    for (unsigned int l = 0; l < count; l++)
+    {
+        if (std::max(texture.levels[l].width, texture.levels[l].height) <= minimumSize)
+        {
+            texture.minimumLevel = l;
+            break;
+        }
+    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    texture.asset->residentBytes = 0;
+    for (unsigned int l = texture.minimumLevel; l < count; l++)
+    {
+        defineLevel(texture.internalFormat, texture.format, texture.compressed, l, texture.levels[l], true);
+        texture.asset->residentBytes += texture.levelBytes[l];
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(texture.minimumLevel));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(count) - 1);
+    setTextureSampling(texture.params);
+
+    texture.asset->id = textureID;
+    texture.asset->placeholder.reset();
+    texture.residentLevel = texture.wantedLevel = texture.targetLevel = texture.minimumLevel;
+    texture.loaded = true;
+}
+
+void TextureStreamer::setResidentLevel(StreamedTexture &texture, unsigned int level)
+{
+    if (level == texture.residentLevel)
+        return;
+
+    glBindTexture(GL_TEXTURE_2D, texture.asset->id);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (level < texture.residentLevel)
+    {
+        // Finer levels first, then let the sampler reach them
+        for (unsigned int l = level; l < texture.residentLevel; l++)
+        {
+            defineLevel(texture.internalFormat, texture.format, texture.compressed, l, texture.levels[l], true);
+            texture.asset->residentBytes += texture.levelBytes[l];
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level));
+    }
+    else
+    {
+        // Stop sampling the levels, then free them
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level));
+        for (unsigned int l = texture.residentLevel; l < level; l++)
+        {
+            defineLevel(texture.internalFormat, texture.format, texture.compressed, l, texture.levels[l], false);
+            texture.asset->residentBytes -= texture.levelBytes[l];
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    texture.residentLevel = level;
+}
+
+void TextureStreamer::request(const TextureHandle &texture, float pixelsPerUv)
+{
+    if (!texture)
+        return;
+    std::map<std::string, StreamedHandle>::iterator it = textures.find(texture->key);
+    if (it != textures.end() && it->second->asset == texture)
+        it->second->density = std::max(it->second->density, pixelsPerUv);
+}
+
+void TextureStreamer::update(size_t uploadBudget)
+{
+    std::vector<StreamedTexture *> loaded;
+    for (std::map<std::string, StreamedHandle>::iterator it = textures.begin(); it != textures.end();)
+    {
+        StreamedTexture &texture = *it->second;
+
+        // Release textures only the streamer holds, a load in flight frees its source when it finishes
+        if (texture.asset.use_count() == 1)
+        {
+            texture.released = true;
+            if (texture.loaded)
+            {
+                glDeleteTextures(1, &texture.asset->id);
+                freeTextureSource(texture.source);
+            }
+            textures.erase(it++);
+            continue;
+        }
+        ++it;
+        if (!texture.loaded)
+            continue;
+
+        // The level whose texels map one to one onto the pixels. Textures not
+        // drawn this frame keep their levels until the budget needs them
+        if (texture.density > 0.0f)
+        {
+            float texels = static_cast<float>(std::max(texture.levels[0].width, texture.levels[0].height));
+            float lod = log2f(texels / texture.density);
+            unsigned int wanted = lod <= 0.0f ? 0 : static_cast<unsigned int>(lod);
+            texture.wantedLevel = std::min(wanted, texture.minimumLevel);
+            texture.targetLevel = texture.wantedLevel;
+            texture.lastUsedFrame = frame;
+        }
+        else
+            texture.targetLevel = texture.residentLevel;
+        texture.density = 0.0f;
+        loaded.push_back(&texture);
+    }
+
+    // Over the budget, drop the finest levels of the least recently used textures
+    size_t total = 0;
+    for (size_t t = 0; t < loaded.size(); t++)
+        for (unsigned int l = loaded[t]->targetLevel; l < loaded[t]->levels.size(); l++)
+            total += loaded[t]->levelBytes[l];
+    if (total > budget)
+    {
+        // Least recently used first, the largest of equally old textures first
+        std::vector<StreamedTexture *> order(loaded);
+        std::sort(order.begin(), order.end(), [](const StreamedTexture *a, const StreamedTexture *b)
+        {
+            if (a->lastUsedFrame != b->lastUsedFrame)
+                return a->lastUsedFrame < b->lastUsedFrame;
+            return a->asset->residentBytes > b->asset->residentBytes;
+        });
+        for (size_t i = 0; i < order.size() && total > budget; i++)
+            while (total > budget && order[i]->targetLevel < order[i]->minimumLevel)
+                total -= order[i]->levelBytes[order[i]->targetLevel++];
+    }
+
+    // Evict first so the uploads fit
+    for (size_t t = 0; t < loaded.size(); t++)
+        if (loaded[t]->targetLevel > loaded[t]->residentLevel)
+            setResidentLevel(*loaded[t], loaded[t]->targetLevel);
+
+    // Then stream in one level per texture in turn, coarse to fine. At least one
+    // level per frame so a level over the upload budget still loads
+    size_t spent = 0;
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        for (size_t t = 0; t < loaded.size(); t++)
+        {
+            StreamedTexture &texture = *loaded[t];
+            if (texture.targetLevel >= texture.residentLevel)
+                continue;
+            size_t bytes = texture.levelBytes[texture.residentLevel - 1];
+            if (spent > 0 && spent + bytes > uploadBudget)
+                continue;
+            setResidentLevel(texture, texture.residentLevel - 1);
+            spent += bytes;
+            progress = true;
+        }
+    }
+
+    frame++;
+}
+
+size_t TextureStreamer::residentBytes() const
+{
+    size_t bytes = 0;
+    for (std::map<std::string, StreamedHandle>::const_iterator it = textures.begin(); it != textures.end(); ++it)
+        bytes += it->second->asset->residentBytes;
+    return bytes;
+}
+
+std::vector<TextureResidency> TextureStreamer::residency() const
+{
+    std::vector<TextureResidency> stats;
+    for (std::map<std::string, StreamedHandle>::const_iterator it = textures.begin(); it != textures.end(); ++it)
+    {
+        const StreamedTexture &texture = *it->second;
+        TextureResidency entry;
+        entry.key = it->first;
+        // Level 0 is the full size, the decoded image is empty when the levels come from the .tex cache
+        entry.width = texture.levels.empty() ? 0 : texture.levels[0].width;
+        entry.height = texture.levels.empty() ? 0 : texture.levels[0].height;
+        entry.levelCount = static_cast<unsigned int>(texture.levels.size());
+        entry.residentLevel = texture.loaded ? texture.residentLevel : entry.levelCount;
+        entry.wantedLevel = texture.wantedLevel;
+        entry.residentBytes = texture.asset->residentBytes;
+        entry.fullBytes = 0;
+        for (size_t l = 0; l < texture.levelBytes.size(); l++)
+            entry.fullBytes += texture.levelBytes[l];
+        entry.lastUsedFrame = texture.lastUsedFrame;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+void TextureStreamer::printResidency() const
+{
+    std::vector<TextureResidency> stats = residency();
+    printf("%u streamed textures, %.1f of %.1f MB resident:\n", (unsigned int)stats.size(),
+           residentBytes() / (1024.0 * 1024.0), budget / (1024.0 * 1024.0));
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        const TextureResidency &entry = stats[i];
+        printf("  %s: %dx%d, levels %u-%u of %u resident (wants %u), %lu of %lu KB, used frame %lu\n",
+               entry.key.c_str(), entry.width, entry.height, entry.residentLevel,
+               entry.levelCount > 0 ? entry.levelCount - 1 : 0, entry.levelCount, entry.wantedLevel,
+               (unsigned long)(entry.residentBytes / 1024), (unsigned long)(entry.fullBytes / 1024),
+               entry.lastUsedFrame);
+    }
+}
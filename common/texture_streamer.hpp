@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+#include "texture.hpp"
+
+// Residency of one streamed texture
+struct TextureResidency
+{
+    std::string key;
+    int width;
+    int height;
+    unsigned int levelCount;
+    unsigned int residentLevel; // Finest level on the GPU, levelCount while loading
+    unsigned int wantedLevel;   // Level the last density request asked for
+    size_t residentBytes;
+    size_t fullBytes;           // GPU memory of the whole mip chain
+    unsigned long lastUsedFrame;
+};
+
+// Keeps only the mip levels a texture needs on the GPU. Textures start with
+// their coarsest levels, then each frame the finest level is estimated from the
+// screen uv density of the objects drawn with it and finer levels are streamed
+// in, or out when the byte budget is exceeded, least recently used first. The
+// levels come from the mapped .tex cache, the resident range is clamped with
+// GL_TEXTURE_BASE_LEVEL. Call everything on the thread that owns the context
+class TextureStreamer
+{
+public:
+    static TextureStreamer &instance();
+
+    // Start streaming a texture, loaded on a worker through AssetManager. Its id
+    // is the placeholder's until finishLoads has uploaded the coarsest levels
+    TextureHandle load(const char *path, const TextureHandle &placeholder,
+                       const TextureParams &params = TextureParams());
+
+    // Ask for the texel density an object drawn this frame needs, in screen
+    // pixels per uv unit (see Model::uvDensity). The largest request of a frame wins
+    void request(const TextureHandle &texture, float pixelsPerUv);
+
+    // Pick the levels each texture keeps, evict over the budget and stream in at
+    // most uploadBudget bytes of finer levels. Once per frame, after the draws
+    void update(size_t uploadBudget = 4 << 20);
+
+    // GPU memory the streamed textures may use together
+    void setBudget(size_t bytes) { budget = bytes; }
+    size_t getBudget() const { return budget; }
+
+    // Levels whose larger side is at most this are always resident
+    void setMinimumSize(int size) { minimumSize = size; }
+
+    // GPU memory used by the streamed textures
+    size_t residentBytes() const;
+
+    // Residency of every streamed texture, and the same printed as a table
+    std::vector<TextureResidency> residency() const;
+    void printResidency() const;
+
+private:
+    struct StreamedTexture;
+    typedef std::shared_ptr<StreamedTexture> StreamedHandle;
+
+    std::map<std::string, StreamedHandle> textures;
+    size_t budget;
+    int minimumSize;
+    unsigned long frame;
+
+    TextureStreamer() : budget(128u << 20), minimumSize(64), frame(0) {}
+    TextureStreamer(const TextureStreamer &);
+    TextureStreamer &operator=(const TextureStreamer &);
+
+    void upload(StreamedTexture &texture);
+    void setResidentLevel(StreamedTexture &texture, unsigned int level);
+};
@@ -0,0 +1,142 @@
+#include <atomic>
+#include <memory>
+
+#include "thread_pool.hpp"
+
+// Progress of one parallelFor call, shared with workers that may outlive it
+struct ParallelForState
+{
+    std::function<void(size_t)> task;
+    size_t count;
+    std::atomic<size_t> next;
+    std::atomic<size_t> done;
+    std::mutex doneMutex;
+    std::condition_variable allDone;
+
+    // Claim and run items until none are left
+    void run()
+    {
+        size_t finished = 0;
+        for (size_t i = next++; i < count; i = next++)
+        {
+            task(i);
+            finished++;
+        }
+
+        if (finished > 0 && done.fetch_add(finished) + finished == count)
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            allDone.notify_all();
+        }
+    }
+};
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+    : stopping(false)
+{
+    if (workerCount == 0)
+        workerCount = hardwareThreads();
+
+    for (unsigned int i = 0; i < workerCount; i++)
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+void ThreadPool::enqueue(const std::function<void()> &task)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.push_back(task);
+    }
+    queueReady.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &task,
+                             unsigned int maxThreads)
+{
+    if (count == 0)
+        return;
+
+    // Nothing to share, run inline
+    if (count == 1 || workers.empty() || maxThreads == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state(new ParallelForState);
+    state->task = task;
+    state->count = count;
+    state->next = 0;
+    state->done = 0;
+
+    size_t helpers = count - 1 < workers.size() ? count - 1 : workers.size();
+    if (maxThreads > 0 && helpers > maxThreads - 1)
+        helpers = maxThreads - 1;
+    for (size_t i = 0; i < helpers; i++)
+        enqueue([state]() { state->run(); });
+
+    // Work on the items here as well, then wait for any still in flight
+    state->run();
+
+    std::unique_lock<std::mutex> lock(state->doneMutex);
+    while (state->done.load() < count)
+        state->allDone.wait(lock);
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    // Leaked on purpose: loaders still running during static destruction may
+    // call into it after a function-local static would have been destroyed
+    static ThreadPool *pool = new ThreadPool(hardwareThreads() > 1 ? hardwareThreads() - 1 : 1);
+    return *pool;
+}
+
+unsigned int ThreadPool::hardwareThreads()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            while (!stopping && tasks.empty())
+                queueReady.wait(lock);
+            if (stopping && tasks.empty())
+                return;
+            task = tasks.front();
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void runParallel(size_t count, unsigned int threads, const std::function<void(size_t)> &task)
+{
+    if (threads <= 1 || count <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+
+    // The calling thread is one of the workers
+    ThreadPool::shared().parallelFor(count, task, threads);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <stddef.h>
+
+// Fixed set of worker threads fed from a shared task queue
+class ThreadPool
+{
+public:
+    // Spawn workerCount threads, 0 uses one per hardware thread
+    explicit ThreadPool(unsigned int workerCount = 0);
+    ~ThreadPool();
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+    // Queue a task to run on a worker
+    void enqueue(const std::function<void()> &task);
+
+    // Run task(i) for every i in [0, count) and wait for them all, on at most
+    // maxThreads threads (0 for all). The calling thread works too, so this is
+    // safe to call from inside a worker
+    void parallelFor(size_t count, const std::function<void(size_t)> &task,
+                     unsigned int maxThreads = 0);
+
+    // Process-wide pool with one worker per hardware thread besides the
+    // caller (at least one), created on first use and never torn down
+    static ThreadPool &shared();
+
+    // Number of hardware threads, at least 1
+    static unsigned int hardwareThreads();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    bool stopping;
+
+    void workerLoop();
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+};
+
+// Run task(i) for i in [0, count) on up to "threads" threads of the shared
+// pool, including the calling one. Runs serially for one thread or one task
+void runParallel(size_t count, unsigned int threads, const std::function<void(size_t)> &task);
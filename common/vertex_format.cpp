@@ -0,0 +1,104 @@
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "vertex_format.hpp"
+
+VertexLayout VertexFormat<ModelVertex>::layout()
+{
+    VertexLayout layout(sizeof(ModelVertex));
+    layout.add(0, 3, GL_FLOAT, GL_FALSE, offsetof(ModelVertex, position))
+          .add(1, 2, GL_FLOAT, GL_FALSE, offsetof(ModelVertex, uv))
+          .add(2, 3, GL_FLOAT, GL_FALSE, offsetof(ModelVertex, normal))
+          .add(3, 4, GL_SHORT, GL_TRUE, offsetof(ModelVertex, tangent));
+    return layout;
+}
+
+VertexLayout VertexFormat<CompactVertex>::layout()
+{
+    // Positions are normalized to [0, 1] and scaled back in the shader, normal and
+    // tangent (w = bitangent sign) are decoded by the vertex fetch
+    VertexLayout layout(sizeof(CompactVertex));
+    layout.add(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(CompactVertex, position))
+          .add(1, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(CompactVertex, uv))
+          .add(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(CompactVertex, normal))
+          .add(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(CompactVertex, tangent));
+    return layout;
+}
+
+void packModelVertices(const std::vector<glm::vec3> &positions,
+                       const std::vector<glm::vec2> &uvs,
+                       const std::vector<glm::vec3> &normals,
+                       const std::vector<glm::vec4> &tangents,
+                       std::vector<ModelVertex> &outVertices)
+{
+    outVertices.resize(positions.size());
+    for (size_t v = 0; v < positions.size(); v++)
+    {
+        ModelVertex &out = outVertices[v];
+        out.position = positions[v];
+        out.uv = v < uvs.size() ? uvs[v] : glm::vec2(0.0f);
+        out.normal = v < normals.size() ? normals[v] : glm::vec3(0.0f, 0.0f, 1.0f);
+        glm::vec4 frame = v < tangents.size() ? tangents[v] : glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+        out.tangent = packQTangent(out.normal, frame);
+    }
+}
+
+void compactPositionTransform(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                              glm::vec3 &positionOffset, glm::vec3 &positionScale)
+{
+    positionOffset = boundsMin;
+    positionScale = boundsMax - boundsMin;
+}
+
+// Bring a direction that may be unnormalized or zero into [-1, 1]
+static glm::vec3 safeNormalize(const glm::vec3 &v, const glm::vec3 &fallback)
+{
+    float length = glm::length(v);
+    return length > 0.0f ? v / length : fallback;
+}
+
+void packCompactVertices(const std::vector<glm::vec3> &positions,
+                         const std::vector<glm::vec2> &uvs,
+                         const std::vector<glm::vec3> &normals,
+                         const std::vector<glm::vec4> &tangents,
+                         const glm::vec3 &boundsMin,
+                         const glm::vec3 &boundsMax,
+                         std::vector<CompactVertex> &outVertices)
+{
+    glm::vec3 offset, scale;
+    compactPositionTransform(boundsMin, boundsMax, offset, scale);
+
+    // Flat axes quantize to zero instead of dividing by zero
+    glm::vec3 inverseScale(0.0f);
+    for (int i = 0; i < 3; i++)
+        inverseScale[i] = scale[i] > 0.0f ? 1.0f / scale[i] : 0.0f;
+
+    outVertices.resize(positions.size());
+    for (size_t v = 0; v < positions.size(); v++)
+    {
+        CompactVertex &out = outVertices[v];
+
+        glm::vec3 position = (positions[v] - offset) * inverseScale;
+        for (int i = 0; i < 3; i++)
+            out.position[i] = glm::packUnorm1x16(position[i]);
+        out.position[3] = 0;
+
+        glm::vec2 uv = v < uvs.size() ? uvs[v] : glm::vec2(0.0f);
+        out.uv[0] = glm::packHalf1x16(uv.x);
+        out.uv[1] = glm::packHalf1x16(uv.y);
+
+        glm::vec3 normal = safeNormalize(v < normals.size() ? normals[v] : glm::vec3(0.0f),
+                                         glm::vec3(0.0f, 0.0f, 1.0f));
+        out.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+
+        // The bitangent is rebuilt in the shader as cross(normal, tangent) * sign
+        glm::vec4 frame = v < tangents.size() ? tangents[v] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        glm::vec3 tangent = safeNormalize(glm::vec3(frame), glm::vec3(1.0f, 0.0f, 0.0f));
+        float sign = frame.w < 0.0f ? -1.0f : 1.0f;
+        out.tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, sign));
+    }
+}
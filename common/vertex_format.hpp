@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "vertex_layout.hpp"
+#include "tangent_space.hpp"
+
+// 40 byte interleaved float vertex with a packed tangent frame
+struct ModelVertex
+{
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+    QTangent tangent;     // Decoded in normal_mapping.vert
+};
+
+// 20 byte vertex, decoded by the vertex attribute setup and the shaders
+struct CompactVertex
+{
+    uint16_t position[4]; // Unorm16 position inside the mesh bounds, w unused
+    uint16_t uv[2];       // Half float texture coordinates
+    uint32_t normal;      // Snorm 10_10_10_2 normal
+    uint32_t tangent;     // Snorm 10_10_10_2 tangent, w is the bitangent sign
+};
+
+// Attribute formats, locations 0-3 are position, uv, normal and tangent
+template <>
+struct VertexFormat<ModelVertex>
+{
+    static VertexLayout layout();
+};
+
+template <>
+struct VertexFormat<CompactVertex>
+{
+    static VertexLayout layout();
+};
+
+// Interleave float vertex streams, packing the tangent frames into QTangents
+void packModelVertices(const std::vector<glm::vec3> &positions,
+                       const std::vector<glm::vec2> &uvs,
+                       const std::vector<glm::vec3> &normals,
+                       const std::vector<glm::vec4> &tangents,
+                       std::vector<ModelVertex> &outVertices);
+
+// Scale and offset that turn a unorm16 position back into model space:
+// position = positionOffset + decoded * positionScale
+void compactPositionTransform(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                              glm::vec3 &positionOffset, glm::vec3 &positionScale);
+
+// Quantize float vertex streams into compact vertices
+void packCompactVertices(const std::vector<glm::vec3> &positions,
+                         const std::vector<glm::vec2> &uvs,
+                         const std::vector<glm::vec3> &normals,
+                         const std::vector<glm::vec4> &tangents,
+                         const glm::vec3 &boundsMin,
+                         const glm::vec3 &boundsMax,
+                         std::vector<CompactVertex> &outVertices);
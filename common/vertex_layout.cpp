@@ -0,0 +1,73 @@
+#include <vector>
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+#include "vertex_layout.hpp"
+
+void createVertexArray(const VertexLayout &layout,
+                       const void *vertexData, size_t vertexBytes,
+                       const void *indexData, size_t indexBytes,
+                       VertexArray &out)
+{
+    glGenVertexArrays(1, &out.vao);
+    glBindVertexArray(out.vao);
+
+    // Every attribute is read from the same buffer
+    glGenBuffers(1, &out.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, out.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+
+    for (size_t i = 0; i < layout.attributes.size(); i++)
+    {
+        const VertexAttribute &attribute = layout.attributes[i];
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type,
+                              attribute.normalized, layout.stride, (void*)attribute.offset);
+    }
+
+    // The element buffer binding is stored in the vertex array
+    out.elementBuffer = 0;
+    if (indexBytes > 0)
+    {
+        glGenBuffers(1, &out.elementBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out.elementBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void createStreamVertexArray(GLuint buffer, const std::vector<VertexLayout> &streams, GLuint &vao)
+{
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    for (size_t s = 0; s < streams.size(); s++)
+    {
+        for (size_t i = 0; i < streams[s].attributes.size(); i++)
+        {
+            const VertexAttribute &attribute = streams[s].attributes[i];
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribPointer(attribute.location, attribute.components, attribute.type,
+                                  attribute.normalized, streams[s].stride, (void*)attribute.offset);
+        }
+    }
+
+    // The element buffer binding is stored in the vertex array
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void deleteVertexArray(VertexArray &array)
+{
+    // Zero names are ignored, so a partly created or already deleted array is fine
+    glDeleteBuffers(1, &array.vertexBuffer);
+    glDeleteBuffers(1, &array.elementBuffer);
+    glDeleteVertexArrays(1, &array.vao);
+    array.vao = array.vertexBuffer = array.elementBuffer = 0;
+}
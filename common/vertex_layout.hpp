@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+// One vertex attribute inside an interleaved vertex
+struct VertexAttribute
+{
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+// Stride and attributes of an interleaved vertex
+struct VertexLayout
+{
+    GLsizei stride;
+    std::vector<VertexAttribute> attributes;
+
+    VertexLayout(GLsizei stride = 0) : stride(stride) {}
+
+    // Add an attribute, returns the layout so calls can be chained
+    VertexLayout &add(GLuint location, GLint components, GLenum type, GLboolean normalized, size_t offset)
+    {
+        VertexAttribute attribute = { location, components, type, normalized, offset };
+        attributes.push_back(attribute);
+        return *this;
+    }
+};
+
+// Attribute format of a vertex struct. Specialize it next to each vertex type:
+//   template <> struct VertexFormat<MyVertex> { static VertexLayout layout(); };
+template <typename Vertex>
+struct VertexFormat;
+
+// A vertex array with one interleaved vertex buffer and an optional element buffer
+struct VertexArray
+{
+    GLuint vao;
+    GLuint vertexBuffer;
+    GLuint elementBuffer;
+
+    VertexArray() : vao(0), vertexBuffer(0), elementBuffer(0) {}
+};
+
+// Upload interleaved vertices (and indices if indexBytes > 0) and describe them
+// with the layout. The vertex array is left unbound
+void createVertexArray(const VertexLayout &layout,
+                       const void *vertexData, size_t vertexBytes,
+                       const void *indexData, size_t indexBytes,
+                       VertexArray &out);
+
+// Same for a vector of vertices with a VertexFormat specialization
+template <typename Vertex, typename Index>
+void createVertexArray(const std::vector<Vertex> &vertices, const std::vector<Index> &indices, VertexArray &out)
+{
+    createVertexArray(VertexFormat<Vertex>::layout(),
+                      vertices.data(), vertices.size() * sizeof(Vertex),
+                      indices.data(), indices.size() * sizeof(Index), out);
+}
+
+// Describe attributes read from an existing buffer, each layout with its own
+// stride and offsets into the buffer, such as the separate streams of a glTF
+// file. The buffer is also the element buffer. The vertex array is left unbound
+void createStreamVertexArray(GLuint buffer, const std::vector<VertexLayout> &streams, GLuint &vao);
+
+// Delete the buffers and the vertex array, and zero the names
+void deleteVertexArray(VertexArray &array);
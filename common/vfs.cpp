@@ -0,0 +1,199 @@
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "vfs.hpp"
+
+#ifdef COURSEWORK_EMBEDDED_PAK
+// Generated by the cooker at build time
+extern const unsigned char embeddedPak[];
+extern const size_t embeddedPakSize;
+#endif
+
+// Mounted paks, searched from the back
+static std::vector<std::shared_ptr<PakArchive> > paks;
+static std::mutex paksMutex;
+
+static void mount(const std::shared_ptr<PakArchive> &archive)
+{
+    printf("Mounted pak %s: %u files\n", archive->name().c_str(), (unsigned int)archive->entryCount());
+    std::lock_guard<std::mutex> lock(paksMutex);
+    paks.push_back(archive);
+}
+
+bool mountPak(const char *path)
+{
+    std::shared_ptr<PakArchive> archive(new PakArchive());
+    if (!archive->open(path))
+        return false;
+    mount(archive);
+    return true;
+}
+
+bool mountPakMemory(const void *data, size_t size, const char *name)
+{
+    std::shared_ptr<PakArchive> archive(new PakArchive());
+    if (!archive->openMemory(data, size, name))
+        return false;
+    mount(archive);
+    return true;
+}
+
+int mountDefaultPaks()
+{
+    int mounted = 0;
+#ifdef COURSEWORK_EMBEDDED_PAK
+    mounted += mountPakMemory(embeddedPak, embeddedPakSize, "<embedded>") ? 1 : 0;
+#endif
+    MappedFile file;
+    if (file.open("assets.pak"))
+    {
+        file.close();
+        mounted += mountPak("assets.pak") ? 1 : 0;
+    }
+    return mounted;
+}
+
+void unmountPaks()
+{
+    std::lock_guard<std::mutex> lock(paksMutex);
+    paks.clear();
+}
+
+std::string normalizePakPath(const char *path)
+{
+    std::vector<std::string> parts;
+    std::string part;
+    for (const char *c = path;; c++)
+    {
+        if (*c != '/' && *c != '\\' && *c != '\0')
+        {
+            part += *c;
+            continue;
+        }
+        if (part == "..")
+        {
+            // Past the start it can only be on disk, keep it so nothing in a pak matches
+            if (!parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else
+                parts.push_back(part);
+        }
+        else if (!part.empty() && part != ".")
+            parts.push_back(part);
+        part.clear();
+        if (*c == '\0')
+            break;
+    }
+
+    std::string normalized;
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (i > 0)
+            normalized += '/';
+        normalized += parts[i];
+    }
+    return normalized;
+}
+
+// The newest mounted pak holding a file, and its entry
+static std::shared_ptr<PakArchive> findInPaks(const char *path, const PakEntry *&entry)
+{
+    std::string name = normalizePakPath(path);
+    std::lock_guard<std::mutex> lock(paksMutex);
+    for (size_t i = paks.size(); i-- > 0;)
+    {
+        entry = paks[i]->find(name);
+        if (entry)
+            return paks[i];
+    }
+    return std::shared_ptr<PakArchive>();
+}
+
+bool vfsExists(const char *path)
+{
+    const PakEntry *entry;
+    if (findInPaks(path, entry))
+        return true;
+    MappedFile file;
+    return file.open(path);
+}
+
+bool vfsStat(const char *path, uint64_t &size, int64_t &modified)
+{
+    const PakEntry *entry;
+    if (findInPaks(path, entry))
+    {
+        size = entry->size;
+        modified = 0;
+        return true;
+    }
+
+#ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(path, &info) != 0 || (info.st_mode & _S_IFREG) == 0)
+        return false;
+    modified = static_cast<int64_t>(info.st_mtime) * 1000000000;
+#else
+    struct stat info;
+    if (stat(path, &info) != 0 || !S_ISREG(info.st_mode))
+        return false;
+#ifdef __linux__
+    // Nanoseconds, so a file rewritten within the same second still changes
+    modified = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#else
+    modified = static_cast<int64_t>(info.st_mtime) * 1000000000;
+#endif
+#endif
+    size = static_cast<uint64_t>(info.st_size);
+    return true;
+}
+
+VfsFile::VfsFile()
+    : view(NULL), length(0), opened(false)
+{
+}
+
+bool VfsFile::open(const char *path)
+{
+    close();
+
+    const PakEntry *entry;
+    std::shared_ptr<PakArchive> found = findInPaks(path, entry);
+    if (found)
+    {
+        if (entry->flags & PakCompressed)
+        {
+            if (!found->decompress(*entry, copy))
+                return false;
+            view = copy.data();
+        }
+        else
+            view = found->storedData(*entry);
+        archive = found;
+        length = static_cast<size_t>(entry->size);
+        opened = true;
+        return true;
+    }
+
+    if (!mapped.open(path))
+        return false;
+    view = mapped.data();
+    length = mapped.size();
+    opened = true;
+    return true;
+}
+
+void VfsFile::close()
+{
+    archive.reset();
+    mapped.close();
+    std::vector<char>().swap(copy);
+    view = NULL;
+    length = 0;
+    opened = false;
+}
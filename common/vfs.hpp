@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mapped_file.hpp"
+#include "pak.hpp"
+
+// Files are looked up in the mounted paks, latest mount first, then on disk.
+// Paths are relative to the working directory, as the loaders are given them
+
+// Mount a pak file. Returns false if it can't be opened or is corrupt
+bool mountPak(const char *path);
+
+// Mount a pak already in memory. The memory isn't copied and must stay valid
+bool mountPakMemory(const void *data, size_t size, const char *name);
+
+// Mount the pak embedded in the executable when it was built with one, then
+// assets.pak from the working directory if it exists, so a fresh pak on disk
+// wins over the embedded copy. Returns the number of paks mounted
+int mountDefaultPaks();
+
+// Unmount every pak. Files already opened from them stay valid
+void unmountPaks();
+
+// Path as stored in a pak: forward slashes, no "." or empty parts, ".." resolved
+std::string normalizePakPath(const char *path);
+
+// Whether a file exists in a mounted pak or on disk
+bool vfsExists(const char *path);
+
+// Size and modification time of a file, without reading it. Files in a pak
+// have no time of their own, so modified is 0 for them. Returns false if the
+// file doesn't exist
+bool vfsStat(const char *path, uint64_t &size, int64_t &modified);
+
+// Read-only contents of a file from the mounted paks or the disk. Files stored
+// uncompressed in a pak and files on disk are read in place from their
+// mapping, compressed ones are decompressed into a copy
+class VfsFile
+{
+public:
+    VfsFile();
+
+    // Open the file at path, returns false if it isn't in a pak or on disk
+    bool open(const char *path);
+
+    // Release the file
+    void close();
+
+    bool isOpen() const { return opened; }
+    bool inPak() const { return archive != NULL; }
+    const char *data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+    std::shared_ptr<PakArchive> archive; // Keeps a view into a pak valid after unmounting
+    MappedFile mapped;
+    std::vector<char> copy;
+    const char *view;
+    size_t length;
+    bool opened;
+
+    // Views are owned, so they can't be copied
+    VfsFile(const VfsFile &);
+    VfsFile &operator=(const VfsFile &);
+};
@@ -4,18 +4,40 @@ out vec4 FragColor;
 in vec2 TexCoord;
 in vec3 FragPos;
 in vec3 Normal;
+in mat3 TBN;
+
+#ifdef INSTANCED
+in vec4 Tint; // Per-instance tint
+#endif
 
 uniform sampler2D texture_diffuse; // Diffuse map
-uniform sampler2D texture_normal;  // Not used but kept for API compatibility
+uniform sampler2D texture_normal;  // Tangent space normal map
+uniform bool useNormalMap;         // Off for models without a real normal map
 
+#ifdef MULTI_DRAW
+flat in vec4 DrawColor; // Color of the draw, instead of the uniform
+#define objectColor DrawColor.rgb
+#else
 uniform vec3 objectColor; // For tinting or if no diffuse texture
+#endif
+
+// Camera and light properties (world space), shared by every program
+layout(std140) uniform ViewData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition; // World space
+};
 
-// Light properties (world space)
-uniform vec3 pointLightPosWorld; 
-uniform vec3 pointLightColor;
-uniform vec3 dirLightDirectionWorld; // Direction FROM light source
-uniform vec3 dirLightColor;
-uniform vec3 viewPosWorld; // Camera position in world space
+layout(std140) uniform LightData
+{
+    vec4 pointLightPosition; // World space
+    vec4 pointLightColor;    // w is the power
+    vec4 dirLightDirection;  // World space, from the light
+    vec4 dirLightColor;
+    vec4 ambientColor;
+};
 
 // Shared lighting parameters
 const float ambientStrength = 0.2;
@@ -24,42 +46,54 @@ const int shininess = 32;
 
 void main()
 {
-    // Use normal directly from vertex shader (normalized in world space)
-    vec3 norm = normalize(Normal);
+    // Perturb the normal with the normal map, or use the interpolated one
+    // Normal maps may only store x and y (BC5), z is rebuilt from the unit length
+    vec3 norm;
+    if (useNormalMap)
+    {
+        vec2 xy = texture(texture_normal, TexCoord).rg * 2.0 - 1.0;
+        vec3 tangentNormal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+        norm = normalize(TBN * tangentNormal);
+    }
+    else
+        norm = normalize(Normal);
     
     // Calculate view direction in world space
-    vec3 viewDir = normalize(viewPosWorld - FragPos);
+    vec3 viewDir = normalize(viewPosition.xyz - FragPos);
     
     // === Point Light Calculation in World Space ===
-    vec3 lightDir = normalize(pointLightPosWorld - FragPos);
+    vec3 lightDir = normalize(pointLightPosition.xyz - FragPos);
     
     // Ambient
-    vec3 ambient = ambientStrength * pointLightColor;
+    vec3 ambient = ambientStrength * pointLightColor.rgb;
     
     // Diffuse
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * pointLightColor;
+    vec3 diffuse = diff * pointLightColor.rgb;
     
     // Specular
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-    vec3 specular = specularStrength * spec * pointLightColor;
+    vec3 specular = specularStrength * spec * pointLightColor.rgb;
     
     // === Directional Light Calculation in World Space ===
-    vec3 lightDirDirectional = normalize(-dirLightDirectionWorld);
+    vec3 lightDirDirectional = normalize(-dirLightDirection.xyz);
     
     // Diffuse (Directional)
     float diffDirectional = max(dot(norm, lightDirDirectional), 0.0);
-    vec3 diffuseDirectional = diffDirectional * dirLightColor;
+    vec3 diffuseDirectional = diffDirectional * dirLightColor.rgb;
     
     // Specular (Directional)
     vec3 reflectDirDirectional = reflect(-lightDirDirectional, norm);
     float specDirectional = pow(max(dot(viewDir, reflectDirDirectional), 0.0), shininess);
-    vec3 specularDirectional = specularStrength * specDirectional * dirLightColor;
+    vec3 specularDirectional = specularStrength * specDirectional * dirLightColor.rgb;
     
     // Combine all lighting
     vec3 result = (ambient + diffuse + specular + diffuseDirectional + specularDirectional) * 
                   texture(texture_diffuse, TexCoord).rgb * objectColor;
+#ifdef INSTANCED
+    result *= Tint.rgb;
+#endif
     
     FragColor = vec4(result, 1.0);
 } 
\ No newline at end of file
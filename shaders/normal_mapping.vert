@@ -1,34 +1,118 @@
 #version 330 core
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 layout (location = 2) in vec3 aNormal;
-// Tangent and bitangent not used since our OBJ doesn't include them
+layout (location = 3) in vec4 aTangent; // QTangent, or tangent and bitangent sign for compact vertices
 
+#ifdef MULTI_DRAW
+// Per-draw data of a multi-draw batch (see indirect_batch.hpp), read at the
+// draw index each command passes as its base instance
+struct Draw
+{
+    mat4 model;
+    vec4 color;
+};
+layout(std430) buffer DrawData
+{
+    Draw draws[];
+};
+layout (location = 8) in uint aDrawIndex;
+flat out vec4 DrawColor;
+#define model draws[aDrawIndex].model
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+// Shared by every program, filled once per frame (see frame_uniforms.hpp)
+layout(std140) uniform ViewData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition; // World space
+};
 
-// Uniforms for lighting in world space
-uniform vec3 pointLightPosWorld;
-uniform vec3 viewPosWorld;
-uniform vec3 dirLightDirectionWorld;
+// Compact vertices store positions as unorm16 inside the model's bounds
+uniform bool compactVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 out vec2 TexCoord;
 out vec3 FragPos;
 out vec3 Normal;
-out vec3 TangentLightPos;
-out vec3 TangentViewPos;
-out vec3 TangentFragPos;
+out mat3 TBN;
+
+#ifdef INSTANCED
+// Per-instance attributes (see instance_batch.hpp), used instead of model
+layout (location = 4) in vec4 aPositionScale; // w is the uniform scale
+layout (location = 5) in vec4 aRotation;      // Unit quaternion
+layout (location = 6) in vec4 aTint;
+out vec4 Tint;
+
+// Rotate v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
+
+// Tangent and normal are the first and third columns of the quaternion's
+// rotation, a negative w means the bitangent is mirrored
+void decodeQTangent(vec4 q, out vec3 tangent, out vec3 normal, out float sign)
+{
+    q = normalize(q);
+    tangent = vec3(1.0 - 2.0 * (q.y * q.y + q.z * q.z),
+                   2.0 * (q.x * q.y + q.w * q.z),
+                   2.0 * (q.x * q.z - q.w * q.y));
+    normal = vec3(2.0 * (q.x * q.z + q.w * q.y),
+                  2.0 * (q.y * q.z - q.w * q.x),
+                  1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+    sign = q.w < 0.0 ? -1.0 : 1.0;
+}
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = compactVertices ? positionOffset + aPos * positionScale : aPos;
+    
+#ifdef INSTANCED
+    FragPos = rotate(aRotation, position * aPositionScale.w) + aPositionScale.xyz;
+    Tint = aTint;
+#else
+    FragPos = vec3(model * vec4(position, 1.0));
+#endif
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
     TexCoord = aTexCoord;
+#ifdef MULTI_DRAW
+    DrawColor = draws[aDrawIndex].color;
+#endif
+    
+    // Model space tangent frame
+    vec3 tangent, normal;
+    float sign;
+    if (compactVertices)
+    {
+        tangent = aTangent.xyz;
+        normal = aNormal;
+        sign = aTangent.w < 0.0 ? -1.0 : 1.0;
+    }
+    else
+        decodeQTangent(aTangent, tangent, normal, sign);
     
-    // Calculate normal in world space
-    Normal = normalize(mat3(transpose(inverse(model))) * aNormal);
+    // Calculate the frame in world space
+#ifdef INSTANCED
+    vec3 N = normalize(rotate(aRotation, normal));
+    vec3 T = normalize(rotate(aRotation, tangent));
+#else
+    mat3 normalMatrix = mat3(transpose(inverse(model)));
+    vec3 N = normalize(normalMatrix * normal);
+    vec3 T = normalize(mat3(model) * tangent);
+#endif
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(N, T) * sign;
     
-    // Basic lighting without normal mapping
-    // We'll pass world space vectors directly
-} 
\ No newline at end of file
+    Normal = N;
+    TBN = mat3(T, B, N);
+}
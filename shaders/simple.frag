@@ -5,28 +5,51 @@ in vec2 TexCoord;
 in vec3 Normal;
 in vec3 FragPos;
 
+#ifdef INSTANCED
+in vec4 Tint; // Per-instance tint
+#endif
+
 uniform sampler2D texture_diffuse;
+#ifdef MULTI_DRAW
+flat in vec4 DrawColor; // Color of the draw, instead of the uniform
+#define objectColor DrawColor.rgb
+#else
 uniform vec3 objectColor;
+#endif
+
+// Camera and light properties, shared by every program
+layout(std140) uniform ViewData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition; // World space
+};
 
-// Light properties
-uniform vec3 LightPosition_worldspace;
-uniform vec3 LightColor;
-uniform float LightPower;
-uniform vec3 AmbientLightColor;
-uniform vec3 EyePosition_worldspace;
+layout(std140) uniform LightData
+{
+    vec4 pointLightPosition; // World space
+    vec4 pointLightColor;    // w is the power
+    vec4 dirLightDirection;  // World space, from the light
+    vec4 dirLightColor;
+    vec4 ambientColor;
+};
 
 void main()
 {
     // Material properties
     vec3 diffuseColor = texture(texture_diffuse, TexCoord).rgb * objectColor;
-    vec3 ambientColor = diffuseColor * AmbientLightColor;
+#ifdef INSTANCED
+    diffuseColor *= Tint.rgb;
+#endif
+    vec3 ambient = diffuseColor * ambientColor.rgb;
     vec3 specularColor = vec3(0.5, 0.5, 0.5); // Medium gray specular
     float shininess = 32.0;
 
     // Direction vectors
     vec3 normal = normalize(Normal);
-    vec3 lightDir = normalize(LightPosition_worldspace - FragPos);
-    vec3 viewDir = normalize(EyePosition_worldspace - FragPos);
+    vec3 lightDir = normalize(pointLightPosition.xyz - FragPos);
+    vec3 viewDir = normalize(viewPosition.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, normal);
 
     // Diffuse lighting
@@ -37,13 +60,12 @@ void main()
     float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
     
     // Attenuation - make this very weak to ensure lighting remains strong
-    float distance = length(LightPosition_worldspace - FragPos);
+    float distance = length(pointLightPosition.xyz - FragPos);
     float attenuation = 1.0 / (1.0 + 0.001 * distance + 0.00001 * distance * distance);
     
     // Calculate lighting components with very little attenuation
-    vec3 ambient = ambientColor;
-    vec3 diffuse = LightColor * diff * diffuseColor * LightPower;
-    vec3 specular = LightColor * spec * specularColor * LightPower;
+    vec3 diffuse = pointLightColor.rgb * diff * diffuseColor * pointLightColor.w;
+    vec3 specular = pointLightColor.rgb * spec * specularColor * pointLightColor.w;
     
     // Apply very weak attenuation to ensure visibility
     diffuse *= attenuation;
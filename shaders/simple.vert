@@ -1,20 +1,78 @@
 #version 330 core
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_storage_buffer_object : require
+#endif
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 layout (location = 2) in vec3 aNormal;
 
+#ifdef MULTI_DRAW
+// Per-draw data of a multi-draw batch (see indirect_batch.hpp), read at the
+// draw index each command passes as its base instance
+struct Draw
+{
+    mat4 model;
+    vec4 color;
+};
+layout(std430) buffer DrawData
+{
+    Draw draws[];
+};
+layout (location = 8) in uint aDrawIndex;
+flat out vec4 DrawColor;
+#define model draws[aDrawIndex].model
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+// Shared by every program, filled once per frame (see frame_uniforms.hpp)
+layout(std140) uniform ViewData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition; // World space
+};
+
+// Compact vertices store positions as unorm16 inside the model's bounds
+uniform bool compactVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 FragPos;
 
+#ifdef INSTANCED
+// Per-instance attributes (see instance_batch.hpp), used instead of model
+layout (location = 4) in vec4 aPositionScale; // w is the uniform scale
+layout (location = 5) in vec4 aRotation;      // Unit quaternion
+layout (location = 6) in vec4 aTint;
+out vec4 Tint;
+
+// Rotate v by the unit quaternion q
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
+
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = compactVertices ? positionOffset + aPos * positionScale : aPos;
+    
+#ifdef INSTANCED
+    // Uniform scale and rotation, so normals only need the rotation
+    FragPos = rotate(aRotation, position * aPositionScale.w) + aPositionScale.xyz;
+    Normal = rotate(aRotation, aNormal);
+    Tint = aTint;
+#else
+    FragPos = vec3(model * vec4(position, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;
+#endif
     TexCoord = aTexCoord;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef MULTI_DRAW
+    DrawColor = draws[aDrawIndex].color;
+#endif
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
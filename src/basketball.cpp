@@ -6,24 +6,12 @@
 #include <iostream> // For debugging output
 
 Basketball::Basketball(const std::string& modelPath, const std::string& texturePath) {
-    model = new Model(modelPath.c_str());
+    // Every ball shares one model and texture
+    AssetManager &assets = AssetManager::instance();
+    model = assets.loadModelAsync(modelPath.c_str());
     
-    // Generate a extremely bright red texture for maximum visibility
-    GLubyte redColor[3] = {255, 0, 0}; // Bright red
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, redColor);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    // Try to load the actual texture, but use our bright red texture instead
-    GLuint loadedTexID = loadTexture(texturePath.c_str());
-    if (loadedTexID != 0) {
-        glDeleteTextures(1, &textureID);
-        textureID = loadedTexID;
-    }
+    // Show a shared bright red texture for maximum visibility until the actual one has loaded, or if it can't be
+    texture = assets.loadTextureAsync(texturePath.c_str(), assets.solidTexture(255, 0, 0));
     
     // Position the ball very close to the camera for maximum visibility
     position = glm::vec3(0.0f, 0.0f, 5.0f); 
@@ -36,8 +24,7 @@ Basketball::Basketball(const std::string& modelPath, const std::string& textureP
 }
 
 Basketball::~Basketball() {
-    delete model;
-    glDeleteTextures(1, &textureID);
+    // The handles release the shared model and texture
 }
 
 // Simple animation variables
@@ -82,29 +69,44 @@ void Basketball::update(float deltaTime) {
     }
 }
 
-void Basketball::draw(GLuint shaderID, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
+// Uniforms set per draw, hashed once
+static const UniformId uniformMVP = uniformId("MVP");
+static const UniformId uniformModel = uniformId("model");
+static const UniformId uniformTextureDiffuse = uniformId("texture_diffuse");
+static const UniformId uniformTextureNormal = uniformId("texture_normal");
+static const UniformId uniformUseNormalMap = uniformId("useNormalMap");
+
+void Basketball::submit(RenderQueue& queue, ShaderProgram& shader) {
     // Create model matrix components
     glm::mat4 transMatrix = MyMaths::createTranslationMatrix(position);
     glm::mat4 scaleMatrix = MyMaths::createScaleMatrix(scale);
     glm::mat4 rotMatrix = glm::mat4_cast(orientation); // Convert quaternion to rotation matrix
 
     // Order: Scale -> Rotate -> Translate
-    glm::mat4 modelMatrix = transMatrix * rotMatrix * scaleMatrix;
+    DrawPacket packet;
+    packet.model = transMatrix * rotMatrix * scaleMatrix;
+    packet.program = &shader;
+    packet.textures[0] = texture->id;
+    packet.textures[1] = texture->id; // Just reuse the diffuse texture as a dummy normal map
+    packet.sortVao = model->vao();
+    packet.bindsOwnState = true; // Model::draw binds its vertex array
+    packet.draw = drawPacket;
+    packet.object = this;
+    queue.submit(packet);
+}
 
-    glm::mat4 MVP = projectionMatrix * viewMatrix * modelMatrix;
+void Basketball::drawPacket(const DrawPacket& packet, const RenderQueue& queue) {
+    Basketball* ball = static_cast<Basketball*>(packet.object);
+    ShaderProgram& shader = *packet.program;
+    glm::mat4 MVP = queue.projection() * queue.view() * packet.model;
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, &modelMatrix[0][0]);
-    
-    // Set texture to unit 0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, this->textureID);
-    glUniform1i(glGetUniformLocation(shaderID, "texture_diffuse"), 0);
+    shader.setMat4(uniformMVP, MVP);
+    shader.setMat4(uniformModel, packet.model);
     
-    // Provide a dummy texture for the normal map to avoid errors
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, this->textureID); // Just reuse the diffuse texture
-    glUniform1i(glGetUniformLocation(shaderID, "texture_normal"), 1);
+    // The queue has bound the textures to units 0 and 1
+    shader.setInt(uniformTextureDiffuse, 0);
+    shader.setInt(uniformTextureNormal, 1);
+    shader.setInt(uniformUseNormalMap, 0); // No real normal map
 
-    model->draw(shaderID);
+    ball->model->draw(shader);
 } 
\ No newline at end of file
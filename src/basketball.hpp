@@ -5,20 +5,23 @@
 #include <GL/glew.h> // For GLuint
 #include <glm/glm.hpp> // For glm types
 #include <glm/gtc/quaternion.hpp> // For quaternions
-#include "../common/model.hpp" // For Model class
+#include "../common/asset_manager.hpp" // For shared Model and texture handles
+#include "../common/render_queue.hpp" // For submitting draws
 
 class Basketball {
 public:
     Basketball(const std::string& modelPath, const std::string& texturePath);
     ~Basketball();
 
-    void draw(GLuint shaderID, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+    void submit(RenderQueue& queue, ShaderProgram& shader); // Drawn when the queue is flushed
     void update(float deltaTime);
     void resetBall(); // New method to reset the ball
 
 private:
-    Model* model;
-    GLuint textureID;
+    static void drawPacket(const DrawPacket& packet, const RenderQueue& queue);
+
+    ModelHandle model;
+    TextureHandle texture;
     glm::vec3 position;
     // glm::vec3 rotation; // Euler angles in degrees - Replaced by quaternion
     glm::quat orientation; // Quaternion for orientation
@@ -1,27 +1,19 @@
 #include "basketball_court.hpp"
 #include "../common/texture.hpp" // Assuming this is the correct path for loadTexture
 #include "../common/maths.hpp" // Include MyMaths
+#include "../common/texture_streamer.hpp" // For streaming the court's mips
 // #include <glm/gtc/matrix_transform.hpp> // No longer directly needed
 
 BasketballCourt::BasketballCourt(const std::string& modelPath, const std::string& texturePath) {
-    model = new Model(modelPath.c_str());
+    AssetManager &assets = AssetManager::instance();
+    model = assets.loadModelAsync(modelPath.c_str());
     
-    // Generate a dummy texture for the court (light brown/wooden)
-    GLubyte courtColor[3] = {200, 160, 100}; // Light brown wooden color
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, courtColor);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    // Try to load the actual texture, but don't worry if it fails
-    GLuint loadedTexID = loadTexture(texturePath.c_str());
-    if (loadedTexID != 0) {
-        glDeleteTextures(1, &textureID);
-        textureID = loadedTexID;
-    }
+    // Show a shared light brown/wooden texture until the actual one has loaded, or if it can't be.
+    // The court texture is the largest one, BC1 cuts it to an eighth and its
+    // finer mips are only streamed in when the camera gets close enough to need them
+    TextureParams params;
+    params.compression = TextureBC1;
+    texture = TextureStreamer::instance().load(texturePath.c_str(), assets.solidTexture(200, 160, 100), params);
 
     // Initial position, rotation, and scale for the court (typically static)
     position = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -31,8 +23,7 @@ BasketballCourt::BasketballCourt(const std::string& modelPath, const std::string
 }
 
 BasketballCourt::~BasketballCourt() {
-    delete model;
-    glDeleteTextures(1, &textureID);
+    // The handles release the shared model and texture
 }
 
 void BasketballCourt::update(float deltaTime) {
@@ -40,7 +31,14 @@ void BasketballCourt::update(float deltaTime) {
     // (void)deltaTime; // To suppress unused parameter warning if your compiler is strict
 }
 
-void BasketballCourt::draw(GLuint shaderID, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
+// Uniforms set per draw, hashed once
+static const UniformId uniformMVP = uniformId("MVP");
+static const UniformId uniformModel = uniformId("model");
+static const UniformId uniformTextureDiffuse = uniformId("texture_diffuse");
+static const UniformId uniformTextureNormal = uniformId("texture_normal");
+static const UniformId uniformUseNormalMap = uniformId("useNormalMap");
+
+void BasketballCourt::submit(RenderQueue& queue, ShaderProgram& shader) {
     glm::mat4 modelMatrix = glm::mat4(1.0f);
     // Apply transformations using MyMaths functions
     glm::mat4 scaleMatrix = MyMaths::createScaleMatrix(scale);
@@ -52,22 +50,41 @@ void BasketballCourt::draw(GLuint shaderID, const glm::mat4& viewMatrix, const g
     // Order: Scale -> Rotate -> Translate (T * Rz * Ry * Rx * S)
     modelMatrix = transMatrix * rotZMatrix * rotYMatrix * rotXMatrix * scaleMatrix;
 
-    glm::mat4 MVP = projectionMatrix * viewMatrix * modelMatrix;
+    // Use a coarser level of detail when its error is under a pixel
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    model->selectLod(modelMatrix, queue.view(), queue.projection(), static_cast<float>(viewport[3]));
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, &modelMatrix[0][0]);
-    // Note: View and Projection matrices are set in the main loop in coursework.cpp before this draw call.
-    // Light and object color uniforms are also set in the main loop.
+    // Ask for the mip level the court covers on screen
+    TextureStreamer::instance().request(texture, model->uvDensity(modelMatrix, queue.view(), queue.projection(),
+                                                                  static_cast<float>(viewport[3])));
 
-    // Set texture to unit 0 and make sure binding is correct
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, this->textureID);
-    glUniform1i(glGetUniformLocation(shaderID, "texture_diffuse"), 0);
-    
-    // Provide a dummy texture for the normal map to avoid errors
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, this->textureID); // Just reuse the diffuse texture
-    glUniform1i(glGetUniformLocation(shaderID, "texture_normal"), 1);
+    DrawPacket packet;
+    packet.model = modelMatrix;
+    packet.program = &shader;
+    packet.textures[0] = texture->id;
+    packet.textures[1] = texture->id; // Just reuse the diffuse texture as a dummy normal map
+    packet.sortVao = model->vao();
+    packet.bindsOwnState = true; // Model::drawClusters binds its vertex array
+    packet.draw = drawPacket;
+    packet.object = this;
+    queue.submit(packet);
+}
+
+void BasketballCourt::drawPacket(const DrawPacket& packet, const RenderQueue& queue) {
+    BasketballCourt* court = static_cast<BasketballCourt*>(packet.object);
+    ShaderProgram& shader = *packet.program;
+    glm::mat4 MVP = queue.projection() * queue.view() * packet.model;
+
+    shader.setMat4(uniformMVP, MVP);
+    shader.setMat4(uniformModel, packet.model);
+    // View, projection and lights come from the shared ViewData and LightData blocks (see frame_uniforms.hpp)
+
+    // The queue has bound the textures to units 0 and 1
+    shader.setInt(uniformTextureDiffuse, 0);
+    shader.setInt(uniformTextureNormal, 1);
+    shader.setInt(uniformUseNormalMap, 0); // No real normal map
 
-    model->draw(shaderID);
+    // Dense geometry, skip the clusters that are off screen or facing away
+    court->model->drawClusters(shader, packet.model, queue.view(), queue.projection());
 } 
\ No newline at end of file
@@ -4,19 +4,22 @@
 #include <string>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
-#include "../common/model.hpp" // Corrected path
+#include "../common/asset_manager.hpp" // For shared Model and texture handles
+#include "../common/render_queue.hpp" // For submitting draws
 
 class BasketballCourt {
 public:
     BasketballCourt(const std::string& modelPath, const std::string& texturePath);
     ~BasketballCourt();
 
-    void draw(GLuint shaderID, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+    void submit(RenderQueue& queue, ShaderProgram& shader); // Drawn when the queue is flushed
     void update(float deltaTime); // Even if static, good for consistency
 
 private:
-    Model* model;
-    GLuint textureID;
+    static void drawPacket(const DrawPacket& packet, const RenderQueue& queue);
+
+    ModelHandle model;
+    TextureHandle texture;
     glm::vec3 position;
     glm::vec3 rotation; // Euler angles in degrees
     glm::vec3 scale;
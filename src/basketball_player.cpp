@@ -5,9 +5,17 @@
 // #include <glm/gtc/matrix_transform.hpp> // No longer directly needed for these ops
 
 BasketballPlayer::BasketballPlayer(const std::string& modelPath, const std::string& diffuseTexturePath, const std::string& normalTexturePath) {
-    model = new Model(modelPath.c_str());
-    this->diffuseTextureID = loadTexture(diffuseTexturePath.c_str());
-    this->normalTextureID = loadTexture(normalTexturePath.c_str()); // Load normal map
+    AssetManager &assets = AssetManager::instance();
+    model = assets.loadModelAsync(modelPath.c_str());
+    
+    // Block compressed, BC1 colour and a two channel BC5 normal map
+    TextureParams diffuseParams, normalParams;
+    diffuseParams.compression = TextureBC1;
+    normalParams.compression = TextureBC5;
+    
+    // Plain white and a flat normal map until the files have loaded, or if they are missing
+    diffuseTexture = assets.loadTextureAsync(diffuseTexturePath.c_str(), assets.solidTexture(255, 255, 255), diffuseParams);
+    normalTexture = assets.loadTextureAsync(normalTexturePath.c_str(), assets.solidTexture(128, 128, 255), normalParams); // Load normal map
 
     position = glm::vec3(0.0f, 0.0f, 0.0f);
     rotation = glm::vec3(0.0f, 0.0f, 0.0f); // Euler angles in degrees
@@ -15,9 +23,7 @@ BasketballPlayer::BasketballPlayer(const std::string& modelPath, const std::stri
 }
 
 BasketballPlayer::~BasketballPlayer() {
-    delete model;
-    glDeleteTextures(1, &diffuseTextureID);
-    glDeleteTextures(1, &normalTextureID); // Delete normal map texture
+    // The handles release the shared model and textures
 }
 
 void BasketballPlayer::update(float deltaTime) {
@@ -62,7 +68,12 @@ void BasketballPlayer::processPlayerKeyboardInput(GLFWwindow* window, float delt
     }
 }
 
-void BasketballPlayer::draw(GLuint shaderID, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
+// Uniforms set per draw, hashed once
+static const UniformId uniformMVP = uniformId("MVP");
+static const UniformId uniformModel = uniformId("model");
+static const UniformId uniformUseNormalMap = uniformId("useNormalMap");
+
+void BasketballPlayer::submit(RenderQueue& queue, ShaderProgram& shader) {
     glm::mat4 modelMatrix = glm::mat4(1.0f);
     // Apply transformations using MyMaths functions
     glm::mat4 scaleMatrix = MyMaths::createScaleMatrix(scale);
@@ -74,19 +85,33 @@ void BasketballPlayer::draw(GLuint shaderID, const glm::mat4& viewMatrix, const
     // Order: Scale -> Rotate -> Translate (T * Rz * Ry * Rx * S)
     modelMatrix = transMatrix * rotZMatrix * rotYMatrix * rotXMatrix * scaleMatrix;
 
-    glm::mat4 MVP = projectionMatrix * viewMatrix * modelMatrix;
+    // Use a coarser level of detail when its error is under a pixel
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    model->selectLod(modelMatrix, queue.view(), queue.projection(), static_cast<float>(viewport[3]));
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, &modelMatrix[0][0]);
-    
-    // Bind textures
-    glActiveTexture(GL_TEXTURE0); // Diffuse map to texture unit 0
-    glBindTexture(GL_TEXTURE_2D, this->diffuseTextureID);
-    // glUniform1i(glGetUniformLocation(shaderID, "texture_diffuse"), 0); // Sampler set in coursework.cpp
+    DrawPacket packet;
+    packet.model = modelMatrix;
+    packet.program = &shader;
+    packet.textures[0] = diffuseTexture->id; // Diffuse map to texture unit 0
+    packet.textures[1] = normalTexture->id;  // Normal map to texture unit 1
+    packet.sortVao = model->vao();
+    packet.bindsOwnState = true; // Model::drawClusters binds its vertex array
+    packet.draw = drawPacket;
+    packet.object = this;
+    queue.submit(packet);
+}
+
+void BasketballPlayer::drawPacket(const DrawPacket& packet, const RenderQueue& queue) {
+    BasketballPlayer* player = static_cast<BasketballPlayer*>(packet.object);
+    ShaderProgram& shader = *packet.program;
+    glm::mat4 MVP = queue.projection() * queue.view() * packet.model;
 
-    glActiveTexture(GL_TEXTURE1); // Normal map to texture unit 1
-    glBindTexture(GL_TEXTURE_2D, this->normalTextureID);
-    // glUniform1i(glGetUniformLocation(shaderID, "texture_normal"), 1); // Sampler set in coursework.cpp
+    shader.setMat4(uniformMVP, MVP);
+    shader.setMat4(uniformModel, packet.model);
+    // Samplers set in coursework.cpp
+    shader.setInt(uniformUseNormalMap, 1); // Player has a real normal map
 
-    model->draw(shaderID);
+    // Dense geometry, skip the clusters that are off screen or facing away
+    player->model->drawClusters(shader, packet.model, queue.view(), queue.projection());
 } 
\ No newline at end of file
@@ -8,21 +8,24 @@ struct GLFWwindow; // Forward declaration for GLFWwindow as including glfw3.h in
                  // Alternatively, include <GLFW/glfw3.h> if it's managed well.
                  // For simplicity here, let's include it, assuming it's okay in this project structure.
 #include <GLFW/glfw3.h> 
-#include "../common/model.hpp" // For Model class
+#include "../common/asset_manager.hpp" // For shared Model and texture handles
+#include "../common/render_queue.hpp" // For submitting draws
 
 class BasketballPlayer {
 public:
     BasketballPlayer(const std::string& modelPath, const std::string& diffuseTexturePath, const std::string& normalTexturePath);
     ~BasketballPlayer();
 
-    void draw(GLuint shaderID, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+    void submit(RenderQueue& queue, ShaderProgram& shader); // Drawn when the queue is flushed
     void update(float deltaTime);
     void processPlayerKeyboardInput(GLFWwindow* window, float deltaTime);
 
 private:
-    Model* model;
-    GLuint diffuseTextureID;
-    GLuint normalTextureID;
+    static void drawPacket(const DrawPacket& packet, const RenderQueue& queue);
+
+    ModelHandle model;
+    TextureHandle diffuseTexture;
+    TextureHandle normalTexture;
     glm::vec3 position;
     glm::vec3 rotation; // Euler angles in degrees
     glm::vec3 scale;
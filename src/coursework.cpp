@@ -5,6 +5,63 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 #include <cmath>
+#include <stddef.h>
+
+#include "../common/vertex_layout.hpp"
+#include "../common/vfs.hpp"
+#include "../common/render_queue.hpp"
+#include "../common/shader_program.hpp"
+#include "../common/frame_uniforms.hpp"
+#include "../common/asset_manager.hpp"
+#include "../common/texture_streamer.hpp"
+
+// Procedural meshes are built as 8 floats per vertex
+struct SceneVertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+template <>
+struct VertexFormat<SceneVertex> {
+    static VertexLayout layout() {
+        VertexLayout layout(sizeof(SceneVertex));
+        layout.add(0, 3, GL_FLOAT, GL_FALSE, offsetof(SceneVertex, position))
+              .add(1, 3, GL_FLOAT, GL_FALSE, offsetof(SceneVertex, normal))
+              .add(2, 2, GL_FLOAT, GL_FALSE, offsetof(SceneVertex, uv));
+        return layout;
+    }
+};
+
+// Uniforms of the scene shader, hashed once
+static const UniformId uniformModel = uniformId("model");
+static const UniformId uniformObjectColor = uniformId("objectColor");
+static const UniformId uniformUseNormalMap = uniformId("useNormalMap");
+static const UniformId uniformTextureDiffuse = uniformId("texture_diffuse");
+
+// A procedural mesh drawn through the render queue
+struct SceneDraw {
+    GLsizei indexCount;
+    int useNormalMap;
+};
+
+// Set the per-draw uniforms and draw, the queue has bound the program and vertex array
+static void drawScenePacket(const DrawPacket& packet, const RenderQueue&) {
+    const SceneDraw* scene = static_cast<const SceneDraw*>(packet.object);
+    packet.program->setMat4(uniformModel, packet.model);
+    packet.program->setVec3(uniformObjectColor, packet.color);
+    packet.program->setInt(uniformUseNormalMap, scene->useNormalMap);
+    glDrawElements(GL_TRIANGLES, scene->indexCount, GL_UNSIGNED_INT, 0);
+}
+
+// Set the per-draw uniforms of a loaded model and draw it, the queue has bound
+// the program and the texture, Model::draw binds its vertex array
+static void drawModelPacket(const DrawPacket& packet, const RenderQueue&) {
+    Model* model = static_cast<Model*>(packet.object);
+    packet.program->setMat4(uniformModel, packet.model);
+    packet.program->setVec3(uniformObjectColor, packet.color);
+    model->draw(*packet.program);
+}
 
 // Camera class to replace GLM view matrix functions
 class Camera {
@@ -155,6 +212,9 @@ enum CameraMovement {
 // Main function
 int main(void)
 {
+    // Cooked assets from the embedded pak or assets.pak, loose files otherwise
+    mountDefaultPaks();
+    
     // Initialize GLFW
     if (!glfwInit()) {
         fprintf(stderr, "Failed to initialize GLFW\n");
@@ -375,85 +435,15 @@ int main(void)
         hoopIndices.push_back(rimBaseIndex + i * 3 + 2);
     }
     
-    // Create basketball VAO, VBO and EBO
-    GLuint basketballVAO, basketballVBO, basketballEBO;
-    glGenVertexArrays(1, &basketballVAO);
-    glGenBuffers(1, &basketballVBO);
-    glGenBuffers(1, &basketballEBO);
-    
-    glBindVertexArray(basketballVAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, basketballVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, basketballEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // Texcoord attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    // Create floor VAO, VBO and EBO
-    GLuint floorVAO, floorVBO, floorEBO;
-    glGenVertexArrays(1, &floorVAO);
-    glGenBuffers(1, &floorVBO);
-    glGenBuffers(1, &floorEBO);
-    
-    glBindVertexArray(floorVAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, floorVBO);
-    glBufferData(GL_ARRAY_BUFFER, floorVertices.size() * sizeof(float), floorVertices.data(), GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, floorEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, floorIndices.size() * sizeof(unsigned int), floorIndices.data(), GL_STATIC_DRAW);
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // Texcoord attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    // Unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    
-    // Create hoop VAO, VBO and EBO
-    GLuint hoopVAO, hoopVBO, hoopEBO;
-    glGenVertexArrays(1, &hoopVAO);
-    glGenBuffers(1, &hoopVBO);
-    glGenBuffers(1, &hoopEBO);
-    
-    glBindVertexArray(hoopVAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, hoopVBO);
-    glBufferData(GL_ARRAY_BUFFER, hoopVertices.size() * sizeof(float), hoopVertices.data(), GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, hoopEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, hoopIndices.size() * sizeof(unsigned int), hoopIndices.data(), GL_STATIC_DRAW);
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // Texcoord attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    // Unbind
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // Create basketball, floor and hoop vertex arrays, one interleaved buffer each
+    const VertexLayout sceneLayout = VertexFormat<SceneVertex>::layout();
+    VertexArray basketballArray, floorArray, hoopArray;
+    createVertexArray(sceneLayout, vertices.data(), vertices.size() * sizeof(float),
+                      indices.data(), indices.size() * sizeof(unsigned int), basketballArray);
+    createVertexArray(sceneLayout, floorVertices.data(), floorVertices.size() * sizeof(float),
+                      floorIndices.data(), floorIndices.size() * sizeof(unsigned int), floorArray);
+    createVertexArray(sceneLayout, hoopVertices.data(), hoopVertices.size() * sizeof(float),
+                      hoopIndices.data(), hoopIndices.size() * sizeof(unsigned int), hoopArray);
     
     // Simple vertex shader with normal mapping
     const char* vertexShaderSource = 
@@ -468,8 +458,14 @@ int main(void)
         "out mat3 TBN;\n"  // Added for normal mapping
         "\n"
         "uniform mat4 model;\n"
-        "uniform mat4 view;\n"
-        "uniform mat4 projection;\n"
+        "\n"
+        "layout(std140) uniform ViewData\n"  // Shared by every program, filled once per frame
+        "{\n"
+        "    mat4 view;\n"
+        "    mat4 projection;\n"
+        "    mat4 viewProjection;\n"
+        "    vec4 viewPosition;\n"
+        "};\n"
         "\n"
         "void main()\n"
         "{\n"
@@ -477,10 +473,14 @@ int main(void)
         "    Normal = mat3(transpose(inverse(model))) * aNormal;\n"
         "    TexCoord = aTexCoord;\n"
         "    \n"
-        "    // Calculate tangent vectors for normal mapping\n"
-        "    vec3 T = normalize(vec3(model * vec4(1.0, 0.0, 0.0, 0.0)));\n"
-        "    vec3 B = normalize(vec3(model * vec4(0.0, 0.0, 1.0, 0.0)));\n"
+        "    // Tangent frame of the sphere's uv mapping: u runs around the y axis,\n"
+        "    // so the tangent is cross(normal, up) (any direction at the poles)\n"
+        "    vec3 tangent = cross(aNormal, vec3(0.0, 1.0, 0.0));\n"
+        "    if (dot(tangent, tangent) < 1e-6) tangent = vec3(1.0, 0.0, 0.0);\n"
         "    vec3 N = normalize(Normal);\n"
+        "    vec3 T = normalize(mat3(model) * tangent);\n"
+        "    T = normalize(T - dot(T, N) * N);\n"
+        "    vec3 B = cross(N, T);\n"
         "    TBN = mat3(T, B, N);\n"
         "    \n"
         "    gl_Position = projection * view * vec4(FragPos, 1.0);\n"
@@ -496,8 +496,23 @@ int main(void)
         "in vec2 TexCoord;\n"
         "in mat3 TBN;\n"  // Added for normal mapping
         "\n"
-        "uniform vec3 lightPos;\n"
-        "uniform vec3 viewPos;\n"
+        "layout(std140) uniform ViewData\n"
+        "{\n"
+        "    mat4 view;\n"
+        "    mat4 projection;\n"
+        "    mat4 viewProjection;\n"
+        "    vec4 viewPosition;\n"
+        "};\n"
+        "\n"
+        "layout(std140) uniform LightData\n"
+        "{\n"
+        "    vec4 pointLightPosition;\n"
+        "    vec4 pointLightColor;\n"
+        "    vec4 dirLightDirection;\n"
+        "    vec4 dirLightColor;\n"
+        "    vec4 ambientColor;\n"
+        "};\n"
+        "\n"
         "uniform vec3 objectColor;\n"
         "uniform bool useNormalMap;\n"  // Flag to toggle normal mapping
         "\n"
@@ -543,13 +558,13 @@ int main(void)
         "    vec3 ambient = ambientStrength * vec3(1.0);\n"
         "    \n"
         "    // Diffuse\n"
-        "    vec3 lightDir = normalize(lightPos - FragPos);\n"
+        "    vec3 lightDir = normalize(pointLightPosition.xyz - FragPos);\n"
         "    float diff = max(dot(norm, lightDir), 0.0);\n"
         "    vec3 diffuse = diff * vec3(1.0);\n"
         "    \n"
         "    // Specular\n"
         "    float specularStrength = 0.5;\n"
-        "    vec3 viewDir = normalize(viewPos - FragPos);\n"
+        "    vec3 viewDir = normalize(viewPosition.xyz - FragPos);\n"
         "    vec3 reflectDir = reflect(-lightDir, norm);\n"
         "    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);\n"
         "    vec3 specular = specularStrength * spec * vec3(1.0);\n"
@@ -573,44 +588,22 @@ int main(void)
         "    FragColor = vec4(result, 1.0);\n"
         "}\n";
     
-    // Compile shaders
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    
-    // Check for errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    // Compile shaders, their uniforms are looked up once
+    ShaderProgram shaderProgram;
+    if (!shaderProgram.compile(vertexShaderSource, fragmentShaderSource)) {
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED" << std::endl;
     }
     
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    // Crate beside the court, loaded on a worker thread and uploaded by
+    // finishLoads. It draws nothing and shows a plain colour until then, and
+    // its texture's finer mip levels are streamed in as the camera gets close
+    ShaderProgram crateShader;
+    if (!crateShader.load("shaders/simple.vert", "shaders/simple.frag")) {
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED" << std::endl;
     }
-    
-    // Link shaders
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    ModelHandle crate = AssetManager::instance().loadModelAsync("models/cube.obj");
+    TextureHandle crateTexture = TextureStreamer::instance().load(
+        "models/crate.png", AssetManager::instance().solidTexture(160, 110, 60));
     
     // Enable depth testing
     glEnable(GL_DEPTH_TEST);
@@ -618,14 +611,22 @@ int main(void)
     // Set background color
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     
-    // Get uniform locations
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-    GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-    GLint lightPosLoc = glGetUniformLocation(shaderProgram, "lightPos");
-    GLint viewPosLoc = glGetUniformLocation(shaderProgram, "viewPos");
-    GLint objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
-    GLint useNormalMapLoc = glGetUniformLocation(shaderProgram, "useNormalMap");
+    // Camera and light uniforms are written once per frame and shared by every program
+    FrameUniforms frameUniforms;
+    frameUniforms.create();
+    LightBlock lights;
+    lights.pointLightPosition = glm::vec4(2.0f, 5.0f, 5.0f, 1.0f);
+    lights.pointLightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    lights.dirLightDirection = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f);
+    lights.dirLightColor = glm::vec4(0.0f);
+    lights.ambientColor = glm::vec4(0.3f, 0.3f, 0.3f, 1.0f);
+    
+    // Draws are submitted to the queue and sorted to bind as little as possible
+    RenderQueue renderQueue;
+    SceneDraw floorDraw = { (GLsizei)floorIndices.size(), 0 }; // No normal mapping for floor
+    SceneDraw hoopDraw = { (GLsizei)hoopIndices.size(), 0 }; // No normal mapping for hoop
+    SceneDraw basketballDraw = { (GLsizei)indices.size(), 1 }; // Normal mapping for basketball
+    float statsTimer = 0.0f;
     
     // Bouncing parameters
     float g = 9.8f; // Gravity
@@ -637,6 +638,7 @@ int main(void)
     // Timing
     float lastTime = glfwGetTime();
     float deltaTime = 0.0f;
+    bool firstFrame = true;
     
     // Main loop
     while (!glfwWindowShouldClose(window)) {
@@ -673,51 +675,96 @@ int main(void)
         // Clear buffers
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        // Use shader
-        glUseProgram(shaderProgram);
-        
         // Custom perspective and view matrices
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 projection = perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
         
-        // Set uniforms
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &view[0][0]);
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, &projection[0][0]);
-        glUniform3f(lightPosLoc, 2.0f, 5.0f, 5.0f);
-        glUniform3f(viewPosLoc, camera.Position.x, camera.Position.y, camera.Position.z);
+        // Set the shared uniforms
+        FrameBlock frame;
+        frame.time = currentTime;
+        frame.deltaTime = deltaTime;
+        frame.viewportSize = glm::vec2(800.0f, 600.0f);
+        ViewBlock viewBlock;
+        viewBlock.view = view;
+        viewBlock.projection = projection;
+        viewBlock.viewProjection = projection * view;
+        viewBlock.viewPosition = glm::vec4(camera.Position, 1.0f);
+        frameUniforms.update(frame, viewBlock, lights);
+        
+        renderQueue.begin(view, projection);
+        DrawPacket packet;
+        packet.program = &shaderProgram;
+        packet.draw = drawScenePacket;
         
         // Draw floor
-        glBindVertexArray(floorVAO);
-        glm::mat4 model = glm::mat4(1.0f);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-        glUniform3f(objectColorLoc, 0.5f, 0.5f, 0.5f); // Gray floor
-        glUniform1i(useNormalMapLoc, 0); // No normal mapping for floor
-        glDrawElements(GL_TRIANGLES, floorIndices.size(), GL_UNSIGNED_INT, 0);
+        packet.vao = floorArray.vao;
+        packet.color = glm::vec3(0.5f, 0.5f, 0.5f); // Gray floor
+        packet.object = &floorDraw;
+        renderQueue.submit(packet);
         
         // Draw basketball hoop
-        glBindVertexArray(hoopVAO);
-        model = glm::mat4(1.0f);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-        glUniform3f(objectColorLoc, 0.2f, 0.2f, 0.2f); // Dark gray hoop
-        glUniform1i(useNormalMapLoc, 0); // No normal mapping for hoop
-        glDrawElements(GL_TRIANGLES, hoopIndices.size(), GL_UNSIGNED_INT, 0);
+        packet.vao = hoopArray.vao;
+        packet.color = glm::vec3(0.2f, 0.2f, 0.2f); // Dark gray hoop
+        packet.object = &hoopDraw;
+        renderQueue.submit(packet);
         
         // Draw basketball
-        glBindVertexArray(basketballVAO);
-        model = glm::mat4(1.0f);
+        glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, height, 0.0f));
         
         // Add slight rotation for realism
-        model = glm::rotate(model, currentTime * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &model[0][0]);
-        glUniform3f(objectColorLoc, 1.0f, 0.5f, 0.0f); // Orange basketball
-        glUniform1i(useNormalMapLoc, 1); // Enable normal mapping for basketball
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        packet.model = glm::rotate(model, currentTime * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+        packet.vao = basketballArray.vao;
+        packet.color = glm::vec3(1.0f, 0.5f, 0.0f); // Orange basketball
+        packet.object = &basketballDraw;
+        renderQueue.submit(packet);
+        
+        // Draw crate, its camera and lights come from the shared blocks
+        crateShader.use();
+        crateShader.setInt(uniformTextureDiffuse, 0);
+        
+        DrawPacket cratePacket;
+        cratePacket.program = &crateShader;
+        cratePacket.textures[0] = crateTexture->id;
+        cratePacket.sortVao = crate->vao();
+        cratePacket.bindsOwnState = true; // Model::draw binds its vertex array
+        cratePacket.model = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 0.5f, -2.0f));
+        cratePacket.draw = drawModelPacket;
+        cratePacket.object = crate.get();
+        renderQueue.submit(cratePacket);
+        
+        renderQueue.flush();
+        frameUniforms.endFrame();
+        
+        // Ask for the mip level the crate covers on screen
+        TextureStreamer::instance().request(crateTexture, crate->uvDensity(cratePacket.model, view, projection, 600.0f));
+        
+        // Upload the models and textures that finished loading, 2 ms a frame at most
+        AssetManager::instance().finishLoads(2.0);
+        
+        // Stream in the mip levels this frame's draws asked for, and evict over the budget
+        TextureStreamer::instance().update();
+        
+        // Delete the GL objects of models and textures released this frame
+        AssetManager::instance().collectGarbage();
         
         // Swap buffers and poll events
         glfwSwapBuffers(window);
         glfwPollEvents();
         
+        // Startup time, the crate and its texture finish loading later
+        if (firstFrame) {
+            std::cout << "First frame after " << glfwGetTime() * 1000.0 << " ms" << std::endl;
+            firstFrame = false;
+        }
+        
+        // State changes the sort saves, once a second
+        statsTimer += deltaTime;
+        if (statsTimer >= 1.0f) {
+            renderQueue.printStats();
+            statsTimer = 0.0f;
+        }
+        
         // Simple debug output
         if (int(currentTime) % 1 == 0 && int(currentTime) != int(lastTime)) {
             std::cout << "Ball height: " << height << ", velocity: " << velocity << std::endl;
@@ -727,16 +774,17 @@ int main(void)
     }
     
     // Clean up
-    glDeleteVertexArrays(1, &basketballVAO);
-    glDeleteBuffers(1, &basketballVBO);
-    glDeleteBuffers(1, &basketballEBO);
-    glDeleteVertexArrays(1, &floorVAO);
-    glDeleteBuffers(1, &floorVBO);
-    glDeleteBuffers(1, &floorEBO);
-    glDeleteVertexArrays(1, &hoopVAO);
-    glDeleteBuffers(1, &hoopVBO);
-    glDeleteBuffers(1, &hoopEBO);
-    glDeleteProgram(shaderProgram);
+    deleteVertexArray(basketballArray);
+    deleteVertexArray(floorArray);
+    deleteVertexArray(hoopArray);
+    shaderProgram.destroy();
+    frameUniforms.destroy();
+    crateShader.destroy();
+    
+    // Release the crate while the context is still alive
+    crate.reset();
+    crateTexture.reset();
+    AssetManager::instance().collectGarbage();
     
     glfwTerminate();
     return 0;
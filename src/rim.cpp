@@ -3,8 +3,11 @@
 #include "../common/maths.hpp"
 
 Rim::Rim(const std::string& modelPath, const std::string& texturePath) {
-    model = new Model(modelPath.c_str());
-    this->textureID = loadTexture(texturePath.c_str());
+    AssetManager &assets = AssetManager::instance();
+    model = assets.loadModelAsync(modelPath.c_str());
+    
+    // Plain white until the texture has loaded, or if it can't be
+    texture = assets.loadTextureAsync(texturePath.c_str(), assets.solidTexture(255, 255, 255));
 
     // Initial position for the rim
     position = glm::vec3(0.0f, 3.0f, -5.0f); 
@@ -13,8 +16,7 @@ Rim::Rim(const std::string& modelPath, const std::string& texturePath) {
 }
 
 Rim::~Rim() {
-    delete model;
-    glDeleteTextures(1, &textureID);
+    // The handles release the shared model and texture
 }
 
 void Rim::update(float deltaTime) {
@@ -23,23 +25,35 @@ void Rim::update(float deltaTime) {
     if (rotation.z > 360.0f) rotation.z -= 360.0f;
 }
 
-void Rim::draw(GLuint shaderID, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
-    glm::mat4 modelMatrix = glm::mat4(1.0f);
+// Uniforms set per draw, hashed once
+static const UniformId uniformMVP = uniformId("MVP");
+static const UniformId uniformModel = uniformId("model");
+
+void Rim::submit(RenderQueue& queue, ShaderProgram& shader) {
     glm::mat4 scaleMatrix = MyMaths::createScaleMatrix(scale);
     glm::mat4 rotXMatrix = MyMaths::createRotationMatrixX(rotation.x);
     glm::mat4 rotYMatrix = MyMaths::createRotationMatrixY(rotation.y);
     glm::mat4 rotZMatrix = MyMaths::createRotationMatrixZ(rotation.z);
     glm::mat4 transMatrix = MyMaths::createTranslationMatrix(position);
 
-    modelMatrix = transMatrix * rotZMatrix * rotYMatrix * rotXMatrix * scaleMatrix;
+    DrawPacket packet;
+    packet.model = transMatrix * rotZMatrix * rotYMatrix * rotXMatrix * scaleMatrix;
+    packet.program = &shader;
+    packet.textures[0] = texture->id;
+    packet.sortVao = model->vao();
+    packet.bindsOwnState = true; // Model::draw binds its vertex array
+    packet.draw = drawPacket;
+    packet.object = this;
+    queue.submit(packet);
+}
 
-    glm::mat4 MVP = projectionMatrix * viewMatrix * modelMatrix;
+void Rim::drawPacket(const DrawPacket& packet, const RenderQueue& queue) {
+    Rim* rim = static_cast<Rim*>(packet.object);
+    ShaderProgram& shader = *packet.program;
+    glm::mat4 MVP = queue.projection() * queue.view() * packet.model;
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, &modelMatrix[0][0]);
-    
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, this->textureID);
+    shader.setMat4(uniformMVP, MVP);
+    shader.setMat4(uniformModel, packet.model);
 
-    model->draw(shaderID);
+    rim->model->draw(shader);
 } 
\ No newline at end of file
@@ -4,19 +4,22 @@
 #include <string> // For std::string
 #include <GL/glew.h> // For GLuint
 #include <glm/glm.hpp> // For glm types
-#include "../common/model.hpp" // For Model class
+#include "../common/asset_manager.hpp" // For shared Model and texture handles
+#include "../common/render_queue.hpp" // For submitting draws
 
 class Rim {
 public:
     Rim(const std::string& modelPath, const std::string& texturePath);
     ~Rim();
 
-    void draw(GLuint shaderID, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+    void submit(RenderQueue& queue, ShaderProgram& shader); // Drawn when the queue is flushed
     void update(float deltaTime);
 
 private:
-    Model* model;
-    GLuint textureID;
+    static void drawPacket(const DrawPacket& packet, const RenderQueue& queue);
+
+    ModelHandle model;
+    TextureHandle texture;
     glm::vec3 position;
     glm::vec3 rotation; // Euler angles in degrees
     glm::vec3 scale;
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "gl_context.hpp"
+
+#if defined(TEST_EGL)
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLContext context = EGL_NO_CONTEXT;
+
+bool createTestContext()
+{
+    // A display with no window system, rendering goes to framebuffer objects
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+    {
+        printf("No EGL display.\n");
+        return false;
+    }
+
+    const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+        configCount = 0;
+
+    const EGLint contextAttributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    eglBindAPI(EGL_OPENGL_API);
+    context = eglCreateContext(display, configCount > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        printf("No EGL context.\n");
+        destroyTestContext();
+        return false;
+    }
+
+    glewExperimental = GL_TRUE;
+    GLenum error = glewInit();
+    glGetError(); // glewInit leaves GL_INVALID_ENUM in core profiles
+    if (error != GLEW_OK)
+    {
+        printf("Failed to initialize GLEW.\n");
+        destroyTestContext();
+        return false;
+    }
+    printf("GL %s, %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+    return true;
+}
+
+void destroyTestContext()
+{
+    if (display == EGL_NO_DISPLAY)
+        return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT)
+        eglDestroyContext(display, context);
+    eglTerminate(display);
+    context = EGL_NO_CONTEXT;
+    display = EGL_NO_DISPLAY;
+}
+
+#elif defined(TEST_GLFW)
+
+#include <GLFW/glfw3.h>
+
+static GLFWwindow *window = NULL;
+
+bool createTestContext()
+{
+    if (!glfwInit())
+    {
+        printf("Failed to initialize GLFW.\n");
+        return false;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    window = glfwCreateWindow(64, 64, "Test", NULL, NULL);
+    if (!window)
+    {
+        printf("Failed to open a GLFW window.\n");
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK)
+    {
+        printf("Failed to initialize GLEW.\n");
+        destroyTestContext();
+        return false;
+    }
+    glGetError();
+    printf("GL %s, %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+    return true;
+}
+
+void destroyTestContext()
+{
+    if (window)
+        glfwDestroyWindow(window);
+    window = NULL;
+    glfwTerminate();
+}
+
+#else
+
+bool createTestContext()
+{
+    printf("Built without EGL or GLFW, no GL context.\n");
+    return false;
+}
+
+void destroyTestContext()
+{
+}
+
+#endif
+
+bool hasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Make a GL 3.3 core context current without showing a window: surfaceless
+// EGL where it is available, otherwise a hidden GLFW window. GLEW is
+// initialised. Returns false if there is no context, the test is then skipped
+bool createTestContext();
+
+// Release the context
+void destroyTestContext();
+
+// Whether the context lists an extension. GLEW 1.13 reads the extension
+// string, which core profiles don't have, so its GLEW_EXT_* flags stay false
+bool hasExtension(const char *name);
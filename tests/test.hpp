@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include <stdio.h>
+#include <math.h>
+
+// Checks for the test executables, each of which is one ctest test. A failed
+// check prints where it is and the test carries on, main returns testResult
+static int testFailures = 0;
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+    do \
+    { \
+        double checkA = (a), checkB = (b); \
+        if (!(fabs(checkA - checkB) <= (tolerance))) \
+        { \
+            printf("%s:%d: CHECK_NEAR(%s, %s) failed, %g and %g\n", __FILE__, __LINE__, #a, #b, checkA, checkB); \
+            testFailures++; \
+        } \
+    } while (0)
+
+// Exit code ctest reads as skipped (see tests/CMakeLists.txt)
+static const int testSkipped = 77;
+
+static inline int testResult(const char *name)
+{
+    if (testFailures > 0)
+        printf("%s: %d check(s) failed\n", name, testFailures);
+    else
+        printf("%s: passed\n", name);
+    return testFailures > 0 ? 1 : 0;
+}
+
+// Write a scratch file into the working directory (the build directory)
+static inline bool writeTestFile(const char *path, const void *data, size_t size)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
+
+static inline bool writeTestFile(const char *path, const std::string &text)
+{
+    return writeTestFile(path, text.data(), text.size());
+}
+
+static inline std::string readTestFile(const char *path)
+{
+    std::string data;
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return data;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, read);
+    fclose(file);
+    return data;
+}
+
+// Write an uncompressed TGA, bottom row first, from RGB or RGBA pixels stored top row first
+static inline bool writeTestTga(const char *path, int width, int height, int channels, const unsigned char *pixels)
+{
+    std::string data(18, '\0');
+    data[2] = 2; // Uncompressed true colour
+    data[12] = static_cast<char>(width & 0xFF);
+    data[13] = static_cast<char>(width >> 8);
+    data[14] = static_cast<char>(height & 0xFF);
+    data[15] = static_cast<char>(height >> 8);
+    data[16] = static_cast<char>(channels * 8);
+    data[17] = static_cast<char>(channels == 4 ? 8 : 0); // Alpha bits
+    for (int y = height - 1; y >= 0; y--)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const unsigned char *pixel = pixels + (y * width + x) * channels;
+            data += static_cast<char>(pixel[2]);
+            data += static_cast<char>(pixel[1]);
+            data += static_cast<char>(pixel[0]);
+            if (channels == 4)
+                data += static_cast<char>(pixel[3]);
+        }
+    }
+    return writeTestFile(path, data);
+}
+
+// A file of the repository, such as a shader
+static inline std::string sourcePath(const char *path)
+{
+    return std::string(COURSEWORK_SOURCE_DIR) + "/" + path;
+}
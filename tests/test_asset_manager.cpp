@@ -0,0 +1,101 @@
+#include <vector>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "asset_manager.hpp"
+
+static const char *squareObj =
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "vt 0 0\n"
+    "vn 0 0 1\n"
+    "f 1/1/1 2/1/1 3/1/1 4/1/1\n";
+
+static void writeAssets()
+{
+    CHECK(writeTestFile("square.obj", std::string(squareObj)));
+    unsigned char pixels[4 * 4 * 3];
+    for (int i = 0; i < 4 * 4 * 3; i++)
+        pixels[i] = static_cast<unsigned char>(i * 5);
+    CHECK(writeTestTga("checker.tga", 4, 4, 3, pixels));
+}
+
+// Every spelling of a file shares one asset, other parameters load another
+static void testSharing()
+{
+    AssetManager &assets = AssetManager::instance();
+
+    ModelHandle model = assets.loadModel("square.obj");
+    ModelHandle same = assets.loadModel("./square.obj");
+    CHECK(model && model == same);
+    CHECK(model->ready());
+    CHECK(assets.modelCount() == 1);
+
+    TextureParams srgb;
+    srgb.srgb = true;
+    TextureHandle texture = assets.loadTexture("checker.tga");
+    TextureHandle sameTexture = assets.loadTexture("./checker.tga");
+    TextureHandle srgbTexture = assets.loadTexture("checker.tga", srgb);
+    CHECK(texture && texture == sameTexture);
+    CHECK(srgbTexture && srgbTexture != texture && srgbTexture->id != texture->id);
+    CHECK(!assets.loadTexture("missing.tga"));
+
+    TextureHandle red = assets.solidTexture(255, 0, 0);
+    CHECK(red && red == assets.solidTexture(255, 0, 0));
+    CHECK(red != assets.solidTexture(0, 255, 0));
+
+    CHECK(assets.textureCount() == 3);
+    CHECK(assets.residentTextureBytes() >= texture->residentBytes + srgbTexture->residentBytes + red->residentBytes);
+    CHECK(texture->residentBytes > 0);
+}
+
+// Textures are deleted by collectGarbage once nobody holds them, not before
+static void testCollectGarbage()
+{
+    AssetManager &assets = AssetManager::instance();
+    assets.collectGarbage();
+
+    ModelHandle model = assets.loadModel("square.obj");
+    TextureHandle texture = assets.loadTexture("checker.tga");
+    const GLuint id = texture->id;
+    CHECK(glIsTexture(id));
+
+    // Still held: nothing is collected
+    assets.collectGarbage();
+    CHECK(glIsTexture(id));
+    CHECK(assets.modelCount() == 1 && assets.textureCount() == 1);
+
+    // Released: gone from the registry at once, deleted at the next collection
+    model.reset();
+    texture.reset();
+    CHECK(assets.modelCount() == 0 && assets.textureCount() == 0);
+    CHECK(glIsTexture(id));
+    assets.collectGarbage();
+    CHECK(!glIsTexture(id));
+    CHECK(assets.residentTextureBytes() == 0);
+
+    // Loading again makes a new asset
+    texture = assets.loadTexture("checker.tga");
+    CHECK(texture && glIsTexture(texture->id));
+    texture.reset();
+    assets.collectGarbage();
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    if (!createTestContext())
+        return testSkipped;
+
+    writeAssets();
+    testSharing();
+    testCollectGarbage();
+
+    destroyTestContext();
+    return testResult("test_asset_manager");
+}
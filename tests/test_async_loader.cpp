@@ -0,0 +1,112 @@
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#include <GL/glew.h>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "asset_manager.hpp"
+#include "async_loader.hpp"
+
+// Finish loads like the main loop does, frame after frame, until none are left
+static bool finishAll(AssetManager &assets)
+{
+    for (int frame = 0; frame < 1000 && assets.pendingLoads() > 0; frame++)
+    {
+        assets.finishLoads(2.0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return assets.pendingLoads() == 0;
+}
+
+// Work runs on a worker, finishing on the thread calling finishLoads, at least one per call
+static void testLoader()
+{
+    AsyncLoader loader(2);
+    const std::thread::id mainThread = std::this_thread::get_id();
+    std::atomic<int> worked(0), workedOnWorkers(0);
+    int finished = 0, finishedOnMain = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        loader.submit([&]()
+                      {
+                          workedOnWorkers += std::this_thread::get_id() != mainThread ? 1 : 0;
+                          worked++;
+                      },
+                      [&]()
+                      {
+                          finished++;
+                          finishedOnMain += std::this_thread::get_id() == mainThread ? 1 : 0;
+                      });
+    }
+    CHECK(finished == 0);
+
+    // A zero budget finishes one job per call, which is enough to drain them
+    for (int frame = 0; frame < 1000 && loader.pending() > 0; frame++)
+    {
+        CHECK(loader.finishLoads(0.0) <= 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(worked == 8 && workedOnWorkers == 8);
+    CHECK(finished == 8 && finishedOnMain == 8);
+    CHECK(loader.pending() == 0);
+}
+
+// Async assets stand in until they're uploaded by finishLoads
+static void testAsyncAssets()
+{
+    CHECK(writeTestFile("async.obj", std::string("v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n")));
+    unsigned char pixels[2 * 2 * 4] = { 255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255, 255, 255, 255, 0 };
+    CHECK(writeTestTga("async.tga", 2, 2, 4, pixels));
+
+    AssetManager &assets = AssetManager::instance();
+    TextureHandle placeholder = assets.solidTexture(128, 128, 128);
+
+    ModelHandle model = assets.loadModelAsync("async.obj");
+    CHECK(model && assets.loadModelAsync("./async.obj") == model);
+    TextureHandle texture = assets.loadTextureAsync("async.tga", placeholder);
+    TextureHandle missing = assets.loadTextureAsync("missing.tga", placeholder);
+    TextureHandle shared = assets.loadTextureAsync("./async.tga", placeholder);
+    CHECK(shared == texture);
+
+    // Nothing is uploaded before finishLoads runs
+    CHECK(!model->ready());
+    CHECK(texture->id == placeholder->id && texture->residentBytes == 0);
+
+    // A texture nobody holds any more is not uploaded
+    TextureParams other;
+    other.filter = GL_NEAREST;
+    TextureHandle released = assets.loadTextureAsync("async.tga", placeholder, other);
+    std::weak_ptr<TextureAsset> releasedWeak(released);
+    released.reset();
+
+    CHECK(finishAll(assets));
+    CHECK(model->ready());
+    CHECK(texture->id != placeholder->id && glIsTexture(texture->id));
+    CHECK(texture->residentBytes > 0 && !texture->placeholder);
+    CHECK(missing->id == placeholder->id && missing->placeholder == placeholder);
+    CHECK(releasedWeak.expired());
+
+    model.reset();
+    texture.reset();
+    shared.reset();
+    missing.reset();
+    placeholder.reset();
+    assets.collectGarbage();
+    CHECK(assets.modelCount() == 0 && assets.textureCount() == 0);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    testLoader();
+
+    if (!createTestContext())
+        return testFailures > 0 ? 1 : testSkipped;
+    testAsyncAssets();
+    destroyTestContext();
+    return testResult("test_async_loader");
+}
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "shader_program.hpp"
+#include "frame_uniforms.hpp"
+
+// A triangle covering the target, made from the vertex index
+static const char *vertexSource =
+    "#version 330 core\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = vec4(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0, 0.0, 1.0);\n"
+    "}\n";
+
+// Each pixel of a 4x1 target shows part of a block
+static const char *fragmentSource =
+    "#version 330 core\n"
+    "layout(std140) uniform FrameData { float time; float deltaTime; vec2 viewportSize; };\n"
+    "layout(std140) uniform ViewData { mat4 view; mat4 projection; mat4 viewProjection; vec4 viewPosition; };\n"
+    "layout(std140) uniform LightData { vec4 pointLightPosition; vec4 pointLightColor;\n"
+    "                                   vec4 dirLightDirection; vec4 dirLightColor; vec4 ambientColor; };\n"
+    "out vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "    int x = int(gl_FragCoord.x);\n"
+    "    if (x == 0)\n"
+    "        color = vec4(time, deltaTime, viewportSize / 100.0);\n"
+    "    else if (x == 1)\n"
+    "        color = viewProjection[3];\n"
+    "    else if (x == 2)\n"
+    "        color = viewPosition;\n"
+    "    else\n"
+    "        color = ambientColor + dirLightColor;\n"
+    "}\n";
+
+static bool near(unsigned char pixel, float value)
+{
+    return abs(static_cast<int>(pixel) - static_cast<int>(value * 255.0f + 0.5f)) <= 1;
+}
+
+static bool nearPixel(const unsigned char *pixel, const glm::vec4 &value)
+{
+    return near(pixel[0], value.x) && near(pixel[1], value.y) && near(pixel[2], value.z) && near(pixel[3], value.w);
+}
+
+// Blocks written each frame reach the shader, over more frames than there are slots
+static void testFrames()
+{
+    ShaderProgram program;
+    CHECK(program.compile(vertexSource, fragmentSource));
+
+    GLuint fbo, color, vao;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 4, 1);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    CHECK(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glViewport(0, 0, 4, 1);
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    const unsigned int frames = 3;
+    FrameUniforms uniforms;
+    uniforms.create(frames);
+    GLint previousStart = -1;
+    for (int f = 0; f < 7; f++)
+    {
+        float t = 0.1f * f;
+        FrameBlock frame = { t, 0.5f, glm::vec2(20.0f + 10.0f * f, 80.0f) };
+        ViewBlock view;
+        view.view = view.projection = glm::mat4(1.0f);
+        view.viewProjection = glm::mat4(1.0f);
+        view.viewProjection[3] = glm::vec4(0.2f, t, 0.6f, 1.0f);
+        view.viewPosition = glm::vec4(t, 0.4f, 0.0f, 1.0f);
+        LightBlock light;
+        light.pointLightPosition = light.pointLightColor = light.dirLightDirection = glm::vec4(0.0f);
+        light.ambientColor = glm::vec4(0.1f, 0.2f, 0.3f, 0.4f);
+        light.dirLightColor = glm::vec4(t, 0.0f, 0.0f, 0.0f);
+
+        uniforms.update(frame, view, light);
+
+        // Each block's range is bound, aligned, and the slot moves every frame
+        GLint starts[SharedBlockCount], sizes[SharedBlockCount];
+        for (int b = 0; b < SharedBlockCount; b++)
+        {
+            glGetIntegeri_v(GL_UNIFORM_BUFFER_START, b, &starts[b]);
+            glGetIntegeri_v(GL_UNIFORM_BUFFER_SIZE, b, &sizes[b]);
+            CHECK(alignment > 0 && starts[b] % alignment == 0);
+        }
+        CHECK(sizes[FrameBlockBinding] == sizeof(FrameBlock));
+        CHECK(sizes[ViewBlockBinding] == sizeof(ViewBlock));
+        CHECK(sizes[LightBlockBinding] == sizeof(LightBlock));
+        CHECK(starts[FrameBlockBinding] < starts[ViewBlockBinding] && starts[ViewBlockBinding] < starts[LightBlockBinding]);
+        CHECK(starts[FrameBlockBinding] != previousStart);
+        previousStart = starts[FrameBlockBinding];
+
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        program.use();
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        uniforms.endFrame();
+
+        unsigned char pixels[4 * 4];
+        glReadPixels(0, 0, 4, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        CHECK(nearPixel(pixels, glm::vec4(t, 0.5f, frame.viewportSize / 100.0f)));
+        CHECK(nearPixel(pixels + 4, view.viewProjection[3]));
+        CHECK(nearPixel(pixels + 8, view.viewPosition));
+        CHECK(nearPixel(pixels + 12, light.ambientColor + light.dirLightColor));
+    }
+
+    // Destroyed, it has nothing to write to
+    uniforms.destroy();
+    FrameBlock frame = { 0.0f, 0.0f, glm::vec2(0.0f) };
+    ViewBlock view;
+    LightBlock light;
+    uniforms.update(frame, view, light);
+    uniforms.endFrame();
+
+    glUseProgram(0);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteFramebuffers(1, &fbo);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+// Binding points name the blocks declared in GLSL
+static void testBlockNames()
+{
+    CHECK(strcmp(uniformBlockName(FrameBlockBinding), "FrameData") == 0);
+    CHECK(strcmp(uniformBlockName(ViewBlockBinding), "ViewData") == 0);
+    CHECK(strcmp(uniformBlockName(LightBlockBinding), "LightData") == 0);
+    CHECK(uniformBlockName(SharedBlockCount) == NULL);
+}
+
+int main()
+{
+    testBlockNames();
+
+    if (!createTestContext())
+        return testFailures > 0 ? 1 : testSkipped;
+    testFrames();
+    destroyTestContext();
+    return testResult("test_frame_uniforms");
+}
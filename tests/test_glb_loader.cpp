@@ -0,0 +1,234 @@
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "json.hpp"
+#include "glb_loader.hpp"
+
+static bool parse(const std::string &text, JsonValue &value)
+{
+    std::string error;
+    return parseJson(text.data(), text.size(), value, error);
+}
+
+// Every value type, nesting, and members in file order
+static void testJson()
+{
+    JsonValue value;
+    CHECK(parse(" { \"b\": true, \"a\": [1, -2.5e2, 0.125, null, false], \"s\": \"x\\ty\\\"\\\\\\/\", \"o\": {} } ", value));
+    CHECK(value.isObject() && value.members.size() == 4);
+    if (value.members.size() == 4)
+        CHECK(value.members[0].first == "b" && value.members[1].first == "a");
+    const JsonValue *array = value.find("a");
+    CHECK(array && array->isArray() && array->size() == 5);
+    if (array && array->size() == 5)
+    {
+        CHECK((*array)[0].number == 1.0 && (*array)[1].number == -250.0 && (*array)[2].number == 0.125);
+        CHECK((*array)[3].type == JsonNull && (*array)[4].type == JsonBool && !(*array)[4].boolean);
+    }
+    CHECK(value.stringOr("s", "") == "x\ty\"\\/");
+    CHECK(value.find("o") && value.find("o")->isObject() && value.find("o")->members.empty());
+    CHECK(value.find("missing") == NULL);
+    CHECK(value.numberOr("b", 7.0) == 7.0); // Another type gives the fallback
+    CHECK(value.intOr("missing", -1) == -1);
+
+    // Only whole numbers that fit in an int are ints
+    CHECK(parse("{\"i\": -7, \"big\": 1e20, \"small\": -3e9, \"half\": 2.5}", value));
+    CHECK(value.intOr("i", 0) == -7);
+    CHECK(value.intOr("big", -1) == -1);
+    CHECK(value.intOr("small", -1) == -1);
+    CHECK(value.intOr("half", -1) == -1);
+}
+
+// \u escapes become UTF-8, surrogate pairs included
+static void testJsonUnicode()
+{
+    JsonValue value;
+    CHECK(parse("\"\\u0041\\u00e9\\u20ac\\ud83d\\ude00\"", value));
+    CHECK(value.type == JsonString);
+    CHECK(value.string == "A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+    CHECK(parse("\"caf\xc3\xa9\"", value) && value.string == "caf\xc3\xa9");
+
+    // Half a pair becomes U+FFFD without swallowing what follows, bad hex is an error
+    CHECK(parse("\"\\ud83d\"", value) && value.string == "\xef\xbf\xbd");
+    CHECK(parse("\"\\ud83d\\u0041\"", value) && value.string == "\xef\xbf\xbd" "A");
+    CHECK(parse("\"\\ude00x\"", value) && value.string == "\xef\xbf\xbd" "x");
+    CHECK(!parse("\"\\u12g4\"", value));
+}
+
+static void testJsonErrors()
+{
+    JsonValue value;
+    const char *invalid[] = { "", "{", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "tru", "01x", "\"unterminated",
+                              "[1] 2", "{a:1}", "\"\x01\"", "-", "1e" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        std::string error;
+        bool ok = parseJson(invalid[i], strlen(invalid[i]), value, error);
+        CHECK(!ok && !error.empty());
+        if (ok)
+            printf("  accepted %s\n", invalid[i]);
+    }
+
+    // Deep nesting is refused instead of overflowing the stack
+    std::string deep(100000, '[');
+    CHECK(!parse(deep, value));
+}
+
+static void append(std::string &data, const void *bytes, size_t size)
+{
+    data.append(static_cast<const char *>(bytes), size);
+}
+
+static void append32(std::string &data, uint32_t value)
+{
+    append(data, &value, sizeof(value));
+}
+
+// A .glb with a JSON chunk and a binary chunk, both padded to 4 bytes
+static std::string buildGlb(std::string json, std::string bin)
+{
+    while (json.size() % 4)
+        json += ' ';
+    while (bin.size() % 4)
+        bin += '\0';
+    std::string glb;
+    append32(glb, 0x46546c67);
+    append32(glb, 2);
+    append32(glb, static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size()));
+    append32(glb, static_cast<uint32_t>(json.size()));
+    append32(glb, 0x4e4f534a);
+    glb += json;
+    append32(glb, static_cast<uint32_t>(bin.size()));
+    append32(glb, 0x004e4942);
+    glb += bin;
+    return glb;
+}
+
+// A triangle with interleaved float positions and normalized ushort uvs, placed
+// by a child node under a translated parent, with an embedded image
+static void testGlb()
+{
+    std::string bin;
+    const float positions[3][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } };
+    const uint16_t uvs[3][2] = { { 0, 0 }, { 65535, 0 }, { 0, 32768 } };
+    for (int v = 0; v < 3; v++)
+    {
+        append(bin, positions[v], sizeof(positions[v]));
+        append(bin, uvs[v], sizeof(uvs[v]));
+    }
+    const uint16_t indices[3] = { 0, 1, 2 };
+    append(bin, indices, sizeof(indices)); // At 48
+    bin += "PNGDATA!";                     // At 54
+
+    const char *json =
+        "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+        "\"nodes\":[{\"translation\":[10,0,0],\"children\":[1]},{\"mesh\":0,\"scale\":[2,2,2]}],"
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1},\"indices\":2,\"material\":0}]}],"
+        "\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorTexture\":{\"index\":0}}}],"
+        "\"textures\":[{\"source\":0}],\"images\":[{\"bufferView\":2,\"mimeType\":\"image/png\"}],"
+        "\"buffers\":[{\"byteLength\":62}],"
+        "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":48,\"byteStride\":16},"
+        "{\"buffer\":0,\"byteOffset\":48,\"byteLength\":6},{\"buffer\":0,\"byteOffset\":54,\"byteLength\":8}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+        "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5123,\"normalized\":true,\"count\":3,\"type\":\"VEC2\"},"
+        "{\"bufferView\":1,\"componentType\":5123,\"count\":3,\"type\":\"SCALAR\"},"
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"}]}";
+    CHECK(writeTestFile("triangle.glb", buildGlb(json, bin)));
+
+    GlbFile glb;
+    CHECK(parseGlb("triangle.glb", glb));
+    CHECK(glb.binSize == 64);
+    CHECK(glb.accessors.size() == 4 && glb.primitives.size() == 1);
+    CHECK(glb.materials.size() == 1 && glb.images.size() == 1);
+    if (glb.accessors.size() != 4 || glb.primitives.size() != 1 || glb.images.size() != 1)
+        return;
+
+    const GlbPrimitive &primitive = glb.primitives[0];
+    CHECK(primitive.position == 0 && primitive.uv == 1 && primitive.indices == 2);
+    CHECK(primitive.normal == -1 && primitive.material == 0);
+    glm::vec4 corner = primitive.transform * glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    CHECK(corner == glm::vec4(12.0f, 0.0f, 0.0f, 1.0f));
+
+    std::vector<glm::vec3> readPositions;
+    readGlbAccessor(glb, glb.accessors[0], readPositions);
+    CHECK(readPositions.size() == 3 && readPositions[2] == glm::vec3(0.0f, 1.0f, 0.0f));
+    CHECK(glbAccessorIs(glb.accessors[0], GL_FLOAT, 3) && glb.accessors[0].stride == 16);
+
+    std::vector<glm::vec2> readUVs;
+    readGlbAccessor(glb, glb.accessors[1], readUVs);
+    CHECK(readUVs.size() == 3);
+    if (readUVs.size() == 3)
+    {
+        CHECK(readUVs[1] == glm::vec2(1.0f, 0.0f));
+        CHECK_NEAR(readUVs[2].y, 32768.0 / 65535.0, 1e-6);
+    }
+
+    std::vector<unsigned int> readIndices;
+    readGlbIndices(glb, glb.accessors[2], readIndices);
+    CHECK(readIndices.size() == 3 && readIndices[1] == 1 && readIndices[2] == 2);
+
+    // Past the end of its view, so it can't be read
+    CHECK(glb.accessors[3].components == 0);
+
+    CHECK(glb.materials[0].baseColorImage == 0 && glb.materials[0].normalImage == -1);
+    CHECK(glb.images[0].mimeType == "image/png" && glb.images[0].size == 8);
+    CHECK(memcmp(glb.bin + glb.images[0].offset, "PNGDATA!", 8) == 0);
+    closeGlb(glb);
+
+    // Damaged files are refused
+    std::string file = buildGlb(json, bin);
+    CHECK(writeTestFile("truncated.glb", file.substr(0, file.size() / 2)));
+    CHECK(!parseGlb("truncated.glb", glb));
+    CHECK(writeTestFile("not.glb", std::string("solid cube\n")));
+    CHECK(!parseGlb("not.glb", glb));
+    CHECK(writeTestFile("bad_json.glb", buildGlb("{\"asset\":", bin)));
+    CHECK(!parseGlb("bad_json.glb", glb));
+}
+
+// Counts, offsets, strides and view indices that don't fit leave accessors empty
+static void testAccessorRanges()
+{
+    std::string bin(24, '\0');
+    const char *json =
+        "{\"asset\":{\"version\":\"2.0\"},"
+        "\"bufferViews\":[{\"buffer\":0,\"byteLength\":24},{\"buffer\":0,\"byteLength\":12,\"byteStride\":1e300},"
+        "{\"buffer\":0,\"byteOffset\":-4,\"byteLength\":12}],"
+        "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":2,\"type\":\"VEC3\"},"
+        "{\"bufferView\":1e20,\"componentType\":5126,\"count\":2,\"type\":\"VEC3\"},"
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":-1,\"type\":\"VEC3\"},"
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":1e20,\"type\":\"VEC3\"},"
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":1.5,\"type\":\"VEC3\"},"
+        "{\"bufferView\":0,\"byteOffset\":-12,\"componentType\":5126,\"count\":1,\"type\":\"VEC3\"},"
+        "{\"bufferView\":1,\"componentType\":5126,\"count\":1,\"type\":\"VEC3\"},"
+        "{\"bufferView\":2,\"componentType\":5126,\"count\":1,\"type\":\"VEC3\"}]}";
+    CHECK(writeTestFile("ranges.glb", buildGlb(json, bin)));
+
+    GlbFile glb;
+    CHECK(parseGlb("ranges.glb", glb));
+    CHECK(glb.accessors.size() == 8);
+    if (glb.accessors.size() != 8)
+        return;
+    CHECK(glb.accessors[0].components == 3 && glb.accessors[0].count == 2);
+    for (size_t a = 1; a < glb.accessors.size(); a++)
+        CHECK(glb.accessors[a].components == 0 && glb.accessors[a].count == 0);
+
+    std::vector<glm::vec3> positions;
+    readGlbAccessor(glb, glb.accessors[3], positions);
+    CHECK(positions.empty());
+    closeGlb(glb);
+}
+
+int main()
+{
+    testJson();
+    testJsonUnicode();
+    testJsonErrors();
+    testGlb();
+    testAccessorRanges();
+    return testResult("test_glb_loader");
+}
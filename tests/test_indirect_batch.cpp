@@ -0,0 +1,242 @@
+#include <vector>
+#include <string>
+#include <stdlib.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "shader_program.hpp"
+#include "frame_uniforms.hpp"
+#include "indirect_batch.hpp"
+
+static const UniformId uniformObjectColor = uniformId("objectColor");
+static const UniformId uniformTextureDiffuse = uniformId("texture_diffuse");
+
+static const int targetSize = 64; // Pixels, showing -4..4 in x and y
+
+// A 2x2 quad and the lower left half of one, packed into the same buffers
+static const float vertices[] = {
+    // Position, uv, normal
+    -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+     1.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+     1.0f,  1.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+    -1.0f,  1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+    -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+     1.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+    -1.0f,  1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+};
+static const unsigned short indices[] = { 0, 1, 2, 2, 3, 0, 0, 1, 2 };
+static const GLsizei quadIndices = 6, triangleIndices = 3;
+static const GLuint triangleFirstIndex = 6;
+static const GLint triangleBaseVertex = 4;
+
+struct Scene
+{
+    GLuint fbo, color, vao, vertexBuffer, elementBuffer, white;
+    FrameUniforms uniforms;
+};
+
+static void createScene(Scene &scene)
+{
+    glGenFramebuffers(1, &scene.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, scene.fbo);
+    glGenRenderbuffers(1, &scene.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, scene.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, targetSize, targetSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, scene.color);
+    CHECK(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glViewport(0, 0, targetSize, targetSize);
+
+    glGenVertexArrays(1, &scene.vao);
+    glBindVertexArray(scene.vao);
+    glGenBuffers(1, &scene.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, scene.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glGenBuffers(1, &scene.elementBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene.elementBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    const GLint components[3] = { 3, 2, 3 };
+    for (GLuint a = 0; a < 3; a++)
+    {
+        glEnableVertexAttribArray(a);
+        glVertexAttribPointer(a, components[a], GL_FLOAT, GL_FALSE, 8 * sizeof(float),
+                              (void*)(a == 0 ? 0 : a == 1 ? 3 * sizeof(float) : 5 * sizeof(float)));
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    glGenTextures(1, &scene.white);
+    glBindTexture(GL_TEXTURE_2D, scene.white);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    // Looking down -z at -4..4, lit by the ambient color alone, so a pixel is its draw's color
+    FrameBlock frame = { 0.0f, 0.0f, glm::vec2(static_cast<float>(targetSize)) };
+    ViewBlock view;
+    view.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    view.projection = glm::ortho(-4.0f, 4.0f, -4.0f, 4.0f, 0.1f, 100.0f);
+    view.viewProjection = view.projection * view.view;
+    view.viewPosition = glm::vec4(0.0f, 0.0f, 10.0f, 1.0f);
+    LightBlock light;
+    light.pointLightPosition = glm::vec4(0.0f, 0.0f, 50.0f, 1.0f);
+    light.pointLightColor = glm::vec4(0.0f);
+    light.dirLightDirection = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
+    light.dirLightColor = glm::vec4(0.0f);
+    light.ambientColor = glm::vec4(1.0f);
+    scene.uniforms.create();
+    scene.uniforms.update(frame, view, light);
+}
+
+static void destroyScene(Scene &scene)
+{
+    scene.uniforms.endFrame();
+    scene.uniforms.destroy();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteTextures(1, &scene.white);
+    glDeleteBuffers(1, &scene.vertexBuffer);
+    glDeleteBuffers(1, &scene.elementBuffer);
+    glDeleteVertexArrays(1, &scene.vao);
+    glDeleteRenderbuffers(1, &scene.color);
+    glDeleteFramebuffers(1, &scene.fbo);
+}
+
+static std::vector<unsigned char> drawFrame(const Scene &scene, ShaderProgram &shader, IndirectBatch &batch)
+{
+    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    shader.use();
+    shader.setInt(uniformTextureDiffuse, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, scene.white);
+    glBindVertexArray(scene.vao);
+    batch.draw(shader, GL_UNSIGNED_SHORT);
+
+    // The draw index attribute is left disabled
+    GLint enabled = GL_TRUE;
+    glGetVertexAttribiv(drawIndexLocation, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+    CHECK(enabled == GL_FALSE);
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    std::vector<unsigned char> pixels(targetSize * targetSize * 4);
+    glReadPixels(0, 0, targetSize, targetSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+static bool colorAt(const std::vector<unsigned char> &pixels, float x, float y, int r, int g, int b)
+{
+    const int px = static_cast<int>((x + 4.0f) * targetSize / 8.0f);
+    const int py = static_cast<int>((y + 4.0f) * targetSize / 8.0f);
+    const unsigned char *pixel = &pixels[(py * targetSize + px) * 4];
+    return abs(pixel[0] - r) <= 2 && abs(pixel[1] - g) <= 2 && abs(pixel[2] - b) <= 2;
+}
+
+static glm::mat4 at(float x, float y)
+{
+    return glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+}
+
+// Each draw reads its own mesh, transform and color, and set() changes only its draw
+static void testBatch(const Scene &scene, ShaderProgram &shader)
+{
+    IndirectBatch batch;
+    CHECK(batch.empty());
+    CHECK(batch.add(quadIndices, 0, 0, at(-2.0f, -2.0f), glm::vec3(1.0f, 0.0f, 0.0f)) == 0);
+    CHECK(batch.add(triangleIndices, triangleFirstIndex, triangleBaseVertex, at(2.0f, -2.0f),
+                    glm::vec3(0.0f, 1.0f, 0.0f)) == 1);
+    CHECK(batch.add(quadIndices, 0, 0, at(-2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 1.0f)) == 2);
+    CHECK(batch.size() == 3);
+
+    std::vector<unsigned char> pixels = drawFrame(scene, shader, batch);
+    CHECK(colorAt(pixels, -2.0f, -2.0f, 255, 0, 0));
+    CHECK(colorAt(pixels, -2.0f + 0.9f, -2.0f + 0.9f, 255, 0, 0));
+    CHECK(colorAt(pixels, 2.0f - 0.5f, -2.0f - 0.5f, 0, 255, 0));
+    CHECK(colorAt(pixels, 2.0f + 0.5f, -2.0f + 0.5f, 128, 128, 128)); // Outside the triangle
+    CHECK(colorAt(pixels, -2.0f, 2.0f, 0, 0, 255));
+    CHECK(colorAt(pixels, 2.0f, 2.0f, 128, 128, 128));
+
+    // Moved and recolored, the other draws stay as they were
+    batch.set(2, at(2.0f, 2.0f), glm::vec3(1.0f, 1.0f, 0.0f));
+    batch.set(3, at(0.0f, 0.0f), glm::vec3(1.0f)); // Not a draw, ignored
+    pixels = drawFrame(scene, shader, batch);
+    CHECK(colorAt(pixels, -2.0f, 2.0f, 128, 128, 128));
+    CHECK(colorAt(pixels, 2.0f, 2.0f, 255, 255, 0));
+    CHECK(colorAt(pixels, -2.0f, -2.0f, 255, 0, 0));
+    CHECK(colorAt(pixels, 2.0f - 0.5f, -2.0f - 0.5f, 0, 255, 0));
+
+    // Cleared, it draws nothing until draws are added again from index 0
+    batch.clear();
+    CHECK(batch.empty());
+    pixels = drawFrame(scene, shader, batch);
+    CHECK(colorAt(pixels, -2.0f, -2.0f, 128, 128, 128));
+    CHECK(batch.add(quadIndices, 0, 0, at(2.0f, 2.0f), glm::vec3(0.0f, 1.0f, 1.0f)) == 0);
+    pixels = drawFrame(scene, shader, batch);
+    CHECK(colorAt(pixels, 2.0f, 2.0f, 0, 255, 255));
+    CHECK(colorAt(pixels, -2.0f, -2.0f, 128, 128, 128));
+
+    batch.destroy();
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+// One glMultiDrawElementsIndirect with the MULTI_DRAW shaders
+static void testMultiDraw(const Scene &scene)
+{
+    if (!IndirectBatch::supported())
+    {
+        printf("No multi-draw indirect, only the fallback is tested.\n");
+        return;
+    }
+
+    std::string vertexPath = sourcePath("shaders/simple.vert"), fragmentPath = sourcePath("shaders/simple.frag");
+    ShaderProgram shader;
+    CHECK(shader.load(vertexPath.c_str(), fragmentPath.c_str(), "#define MULTI_DRAW"));
+
+    // The storage block is bound to the batch's binding point
+    GLuint block = glGetProgramResourceIndex(shader.id(), GL_SHADER_STORAGE_BLOCK, drawDataBlockName);
+    CHECK(block != GL_INVALID_INDEX);
+    if (block != GL_INVALID_INDEX)
+    {
+        const GLenum property = GL_BUFFER_BINDING;
+        GLint binding = -1;
+        glGetProgramResourceiv(shader.id(), GL_SHADER_STORAGE_BLOCK, block, 1, &property, 1, NULL, &binding);
+        CHECK(binding == static_cast<GLint>(drawDataBinding));
+    }
+    testBatch(scene, shader);
+}
+
+// A draw per command with the plain shaders, as on a GL 3.3 context
+static void testFallback(const Scene &scene)
+{
+    const GLboolean version43 = __GLEW_VERSION_4_3, multiDrawIndirect = __GLEW_ARB_multi_draw_indirect;
+    __GLEW_VERSION_4_3 = GL_FALSE;
+    __GLEW_ARB_multi_draw_indirect = GL_FALSE;
+    CHECK(!IndirectBatch::supported());
+
+    std::string vertexPath = sourcePath("shaders/simple.vert"), fragmentPath = sourcePath("shaders/simple.frag");
+    ShaderProgram shader;
+    CHECK(shader.load(vertexPath.c_str(), fragmentPath.c_str()));
+    CHECK(shader.has(uniformId("model")) && shader.has(uniformObjectColor));
+    testBatch(scene, shader);
+
+    __GLEW_VERSION_4_3 = version43;
+    __GLEW_ARB_multi_draw_indirect = multiDrawIndirect;
+}
+
+int main()
+{
+    if (!createTestContext())
+        return testSkipped;
+
+    Scene scene;
+    createScene(scene);
+    testMultiDraw(scene);
+    testFallback(scene);
+    destroyScene(scene);
+
+    destroyTestContext();
+    return testResult("test_indirect_batch");
+}
@@ -0,0 +1,224 @@
+#include <vector>
+#include <string>
+#include <stdlib.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "asset_manager.hpp"
+#include "model.hpp"
+#include "shader_program.hpp"
+#include "frame_uniforms.hpp"
+#include "instance_batch.hpp"
+
+// A 2x2 square around the origin, facing +z
+static const char *squareObj =
+    "v -1 -1 0\n"
+    "v 1 -1 0\n"
+    "v 1 1 0\n"
+    "v -1 1 0\n"
+    "vt 0.5 0.5\n"
+    "vn 0 0 1\n"
+    "f 1/1/1 2/1/1 3/1/1 4/1/1\n";
+
+static const UniformId uniformObjectColor = uniformId("objectColor");
+static const UniformId uniformTextureDiffuse = uniformId("texture_diffuse");
+
+static const int targetSize = 64; // Pixels, showing -4..4 in x and y
+
+// The attributes follow the model's at locations 4-7, 40 bytes an instance
+static void testLayout()
+{
+    static_assert(sizeof(InstanceData) == 40, "InstanceData must stay 40 bytes");
+    VertexLayout layout = VertexFormat<InstanceData>::layout();
+    CHECK(layout.stride == sizeof(InstanceData));
+    CHECK(layout.attributes.size() == 4);
+    for (size_t i = 0; i < layout.attributes.size(); i++)
+        CHECK(layout.attributes[i].location == 4 + i);
+    CHECK(layout.attributes[2].type == GL_UNSIGNED_BYTE && layout.attributes[2].normalized == GL_TRUE);
+}
+
+static InstanceData instanceAt(float x, uint32_t material)
+{
+    InstanceData instance;
+    instance.positionScale = glm::vec4(x, 0.0f, 0.0f, 1.0f);
+    instance.rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    instance.tint[0] = instance.tint[1] = instance.tint[2] = instance.tint[3] = 255;
+    instance.material = material;
+    return instance;
+}
+
+// Uploads group instances by material, keeping their order within a material
+static void testRanges()
+{
+    InstanceBatch batch;
+    const uint32_t materials[6] = { 2, 0, 2, 1, 0, 2 };
+    for (int i = 0; i < 6; i++)
+        batch.add(instanceAt(static_cast<float>(i), materials[i]));
+    CHECK(batch.size() == 6 && !batch.empty());
+    batch.upload();
+
+    const std::vector<InstanceBatch::Range> &ranges = batch.ranges();
+    CHECK(ranges.size() == 3);
+    if (ranges.size() == 3)
+    {
+        CHECK(ranges[0].material == 0 && ranges[0].first == 0 && ranges[0].count == 2);
+        CHECK(ranges[1].material == 1 && ranges[1].first == 2 && ranges[1].count == 1);
+        CHECK(ranges[2].material == 2 && ranges[2].first == 3 && ranges[2].count == 3);
+    }
+    const std::vector<InstanceData> &instances = batch.instances();
+    const float order[6] = { 1.0f, 4.0f, 3.0f, 0.0f, 2.0f, 5.0f };
+    for (int i = 0; i < 6; i++)
+        CHECK(instances[i].positionScale.x == order[i]);
+
+    // Cleared and built again, the next upload starts over
+    batch.clear();
+    CHECK(batch.empty());
+    batch.add(glm::vec3(0.0f), glm::quat(), 2.0f, glm::vec4(1.0f, 0.5f, 0.0f, 1.0f), 7);
+    batch.upload();
+    CHECK(batch.ranges().size() == 1 && batch.ranges()[0].material == 7 && batch.ranges()[0].count == 1);
+    CHECK(batch.instances()[0].positionScale.w == 2.0f);
+    CHECK(batch.instances()[0].tint[0] == 255 && batch.instances()[0].tint[2] == 0);
+    batch.destroy();
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+static glm::ivec3 pixelAt(const std::vector<unsigned char> &pixels, float x, float y)
+{
+    const int px = static_cast<int>((x + 4.0f) * targetSize / 8.0f);
+    const int py = static_cast<int>((y + 4.0f) * targetSize / 8.0f);
+    const unsigned char *pixel = &pixels[(py * targetSize + px) * 4];
+    return glm::ivec3(pixel[0], pixel[1], pixel[2]);
+}
+
+static bool nearColor(const glm::ivec3 &pixel, int r, int g, int b)
+{
+    return abs(pixel.r - r) <= 2 && abs(pixel.g - g) <= 2 && abs(pixel.b - b) <= 2;
+}
+
+static std::vector<unsigned char> drawFrame(Model &model, ShaderProgram &shader, InstanceBatch &batch,
+                                            const std::vector<TextureHandle> &materialTextures,
+                                            const TextureHandle &white)
+{
+    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    shader.use();
+    shader.setVec3(uniformObjectColor, glm::vec3(1.0f));
+    shader.setInt(uniformTextureDiffuse, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, white->id);
+    model.drawInstanced(shader, batch, materialTextures);
+
+    std::vector<unsigned char> pixels(targetSize * targetSize * 4);
+    glReadPixels(0, 0, targetSize, targetSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+// The INSTANCED variant places, rotates, scales and tints each instance, in one
+// call or one per material, with the instances' own data after grouping
+static void testDraw()
+{
+    AssetManager &assets = AssetManager::instance();
+    CHECK(writeTestFile("instance_square.obj", std::string(squareObj)));
+    ModelHandle model = assets.loadModel("instance_square.obj");
+    CHECK(model && model->ready());
+    if (!model || !model->ready())
+        return;
+
+    std::string vertexPath = sourcePath("shaders/simple.vert"), fragmentPath = sourcePath("shaders/simple.frag");
+    ShaderProgram shader;
+    CHECK(shader.load(vertexPath.c_str(), fragmentPath.c_str(), "#define INSTANCED"));
+
+    GLuint fbo, color;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, targetSize, targetSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    CHECK(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glViewport(0, 0, targetSize, targetSize);
+
+    // Looking down -z at -4..4, lit by the ambient color alone, so a pixel is its tint times its texture
+    FrameBlock frame = { 0.0f, 0.0f, glm::vec2(static_cast<float>(targetSize)) };
+    ViewBlock view;
+    view.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    view.projection = glm::ortho(-4.0f, 4.0f, -4.0f, 4.0f, 0.1f, 100.0f);
+    view.viewProjection = view.projection * view.view;
+    view.viewPosition = glm::vec4(0.0f, 0.0f, 10.0f, 1.0f);
+    LightBlock light;
+    light.pointLightPosition = glm::vec4(0.0f, 0.0f, 50.0f, 1.0f);
+    light.pointLightColor = glm::vec4(0.0f);
+    light.dirLightDirection = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
+    light.dirLightColor = glm::vec4(0.0f);
+    light.ambientColor = glm::vec4(1.0f);
+    FrameUniforms uniforms;
+    uniforms.create();
+    uniforms.update(frame, view, light);
+
+    // One instance per quadrant. Turned 45 degrees a square becomes a diamond,
+    // which covers (1.5, 0) from its centre but not (1, 1)
+    const glm::quat turned = glm::angleAxis(glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    InstanceBatch batch;
+    batch.add(glm::vec3(-2.0f, -2.0f, 0.0f), turned, 1.25f, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), 1);
+    batch.add(glm::vec3(2.0f, -2.0f, 0.0f), glm::quat(), 1.25f, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), 0);
+    batch.add(glm::vec3(-2.0f, 2.0f, 0.0f), glm::quat(), 1.25f, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), 1);
+    batch.add(glm::vec3(2.0f, 2.0f, 0.0f), turned, 1.25f, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), 0);
+
+    TextureHandle white = assets.solidTexture(255, 255, 255);
+    std::vector<unsigned char> pixels = drawFrame(*model, shader, batch, std::vector<TextureHandle>(), white);
+    CHECK(nearColor(pixelAt(pixels, -2.0f, -2.0f), 255, 0, 0));
+    CHECK(nearColor(pixelAt(pixels, 2.0f, -2.0f), 0, 255, 0));
+    CHECK(nearColor(pixelAt(pixels, -2.0f, 2.0f), 0, 0, 255));
+    CHECK(nearColor(pixelAt(pixels, 2.0f, 2.0f), 255, 255, 255));
+    CHECK(nearColor(pixelAt(pixels, -2.0f + 1.5f, -2.0f), 255, 0, 0));
+    CHECK(nearColor(pixelAt(pixels, -2.0f + 1.0f, -2.0f + 1.0f), 128, 128, 128));
+    CHECK(nearColor(pixelAt(pixels, 2.0f + 1.0f, -2.0f + 1.0f), 0, 255, 0));
+    CHECK(nearColor(pixelAt(pixels, 2.0f + 1.5f, -2.0f), 128, 128, 128));
+    CHECK(nearColor(pixelAt(pixels, 0.0f, 0.0f), 128, 128, 128));
+
+    // Material 1 is yellow, which keeps the red instance and blacks out the blue one
+    std::vector<TextureHandle> materialTextures;
+    materialTextures.push_back(white);
+    materialTextures.push_back(assets.solidTexture(255, 255, 0));
+    pixels = drawFrame(*model, shader, batch, materialTextures, white);
+    CHECK(nearColor(pixelAt(pixels, -2.0f, -2.0f), 255, 0, 0));
+    CHECK(nearColor(pixelAt(pixels, 2.0f, -2.0f), 0, 255, 0));
+    CHECK(nearColor(pixelAt(pixels, -2.0f, 2.0f), 0, 0, 0));
+    CHECK(nearColor(pixelAt(pixels, 2.0f, 2.0f), 255, 255, 255));
+    CHECK(nearColor(pixelAt(pixels, 2.0f + 1.5f, 2.0f), 255, 255, 255));
+    CHECK(nearColor(pixelAt(pixels, 2.0f + 1.0f, 2.0f + 1.0f), 128, 128, 128));
+
+    // The model's vertex array is left without instance attributes
+    GLint enabled = GL_TRUE;
+    glBindVertexArray(model->vao());
+    glGetVertexAttribiv(4, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+    CHECK(enabled == GL_FALSE);
+    glBindVertexArray(0);
+
+    uniforms.endFrame();
+    uniforms.destroy();
+    batch.destroy();
+    glUseProgram(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteFramebuffers(1, &fbo);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    testLayout();
+
+    if (!createTestContext())
+        return testFailures > 0 ? 1 : testSkipped;
+    testRanges();
+    testDraw();
+    AssetManager::instance().collectGarbage();
+    destroyTestContext();
+    return testResult("test_instance_batch");
+}
@@ -0,0 +1,272 @@
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "mesh_cache.hpp"
+#include "vertex_format.hpp"
+#include "model.hpp"
+
+static const char *squareObj =
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "vt 0 0\n"
+    "vt 2 0\n"
+    "vt 2 2\n"
+    "vt 0 2\n"
+    "vn 0 0 1\n"
+    "f 1/1/1 2/2/1 3/3/1 4/4/1\n";
+
+// Five float vertices, a full level of three triangles and a coarse one
+static void testMesh(MeshData &mesh)
+{
+    std::vector<ModelVertex> vertices(5);
+    for (int i = 0; i < 5; i++)
+    {
+        memset(&vertices[i], 0, sizeof(ModelVertex));
+        vertices[i].position = glm::vec3(i, -2.0f * i, 0.5f + i);
+        vertices[i].uv = glm::vec2(0.25f * i, 1.0f - 0.25f * i);
+    }
+    const uint16_t indices[12] = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 2, 4 };
+    setMeshStreams(mesh, vertices.data(), 5, sizeof(ModelVertex), indices, 12, sizeof(uint16_t));
+
+    MeshLod full = { 0, 9, 0.0f }, coarse = { 9, 3, 0.75f };
+    mesh.lods.clear();
+    mesh.lods.push_back(full);
+    mesh.lods.push_back(coarse);
+    Meshlet meshlet;
+    memset(&meshlet, 0, sizeof(meshlet));
+    meshlet.indexCount = 9;
+    meshlet.vertexCount = 5;
+    meshlet.radius = 3.5f;
+    mesh.meshlets.assign(1, meshlet);
+    mesh.boundsMin = glm::vec3(0.0f, -8.0f, 0.5f);
+    mesh.boundsMax = glm::vec3(4.0f, 0.0f, 4.5f);
+    mesh.worldPerUv = 2.5f;
+}
+
+static bool sameBytes(const void *a, const void *b, size_t size)
+{
+    return a && b && memcmp(a, b, size) == 0;
+}
+
+// Every stream comes back as written, read in place from the mapping
+static void testRoundTrip()
+{
+    MeshData mesh;
+    testMesh(mesh);
+    MeshSource source;
+    source.size = 123;
+    source.modified = 456;
+    source.hash = 0x0123456789abcdefull;
+    source.options = 7;
+    CHECK(saveMeshCache("round_trip.mesh", source, mesh));
+
+    MeshData loaded;
+    CHECK(loadMeshCache("round_trip.mesh", "round_trip.obj", source, loaded));
+    CHECK(!source.hashed);
+    CHECK(loaded.vertexCount == 5 && loaded.vertexSize == sizeof(ModelVertex) && !loaded.compact);
+    CHECK(loaded.indexCount == 12 && loaded.indexSize == sizeof(uint16_t));
+    CHECK(sameBytes(loaded.vertices, mesh.vertices, 5 * sizeof(ModelVertex)));
+    CHECK(sameBytes(loaded.indices, mesh.indices, 12 * sizeof(uint16_t)));
+    const char *vertices = static_cast<const char *>(loaded.vertices);
+    CHECK(vertices >= loaded.file.data() && vertices < loaded.file.data() + loaded.file.size());
+    CHECK(loaded.lods.size() == 2);
+    if (loaded.lods.size() == 2)
+        CHECK(loaded.lods[1].firstIndex == 9 && loaded.lods[1].indexCount == 3 && loaded.lods[1].error == 0.75f);
+    CHECK(loaded.meshlets.size() == 1);
+    if (loaded.meshlets.size() == 1)
+        CHECK(loaded.meshlets[0].indexCount == 9 && loaded.meshlets[0].radius == 3.5f);
+    CHECK(loaded.boundsMin == mesh.boundsMin);
+    CHECK(loaded.boundsMax == mesh.boundsMax);
+    CHECK(loaded.worldPerUv == 2.5f);
+
+    closeMeshCache(loaded);
+    CHECK(!loaded.file.isOpen() && loaded.vertices == NULL && loaded.indices == NULL);
+
+    // Shipped caches load without their source
+    MeshData shipped;
+    CHECK(loadMeshCache("round_trip.mesh", shipped));
+    CHECK(sameBytes(shipped.indices, mesh.indices, 12 * sizeof(uint16_t)));
+
+    // No temporary file is left behind
+    CHECK(readTestFile("round_trip.mesh.tmp").empty());
+}
+
+// Size and time decide without reading the source, its contents only when they change
+static void testSourceStamp()
+{
+    CHECK(writeTestFile("stamp.obj", std::string("v 0 0 0\n")));
+    MeshSource source;
+    CHECK(statMeshSource("stamp.obj", source));
+    CHECK(source.size == 8 && source.modified != 0 && !source.hashed);
+    CHECK(!statMeshSource("missing.obj", source));
+    CHECK(statMeshSource("stamp.obj", source));
+    CHECK(hashMeshSource("stamp.obj", source));
+    CHECK(source.hashed);
+
+    MeshData mesh, loaded;
+    testMesh(mesh);
+    CHECK(saveMeshCache("stamp.mesh", source, mesh));
+
+    // Unchanged: no hashing
+    MeshSource same;
+    CHECK(statMeshSource("stamp.obj", same));
+    CHECK(loadMeshCache("stamp.mesh", "stamp.obj", same, loaded));
+    CHECK(!same.hashed && same.hash == source.hash);
+
+    // Touched but the same: hashed once, then the new time is remembered
+    MeshSource touched = same;
+    touched.modified += 1000;
+    CHECK(loadMeshCache("stamp.mesh", "stamp.obj", touched, loaded));
+    CHECK(touched.hashed);
+    touched.hashed = false;
+    CHECK(loadMeshCache("stamp.mesh", "stamp.obj", touched, loaded));
+    CHECK(!touched.hashed);
+
+    // Same size, other contents
+    CHECK(writeTestFile("stamp.obj", std::string("v 0 0 1\n")));
+    MeshSource changed;
+    CHECK(statMeshSource("stamp.obj", changed));
+    changed.modified = touched.modified + 1000;
+    CHECK(!loadMeshCache("stamp.mesh", "stamp.obj", changed, loaded));
+    CHECK(changed.hashed && changed.hash != source.hash);
+
+    // Other size or other build options
+    MeshSource resized = same, rebuilt = same;
+    resized.size++;
+    CHECK(!loadMeshCache("stamp.mesh", "stamp.obj", resized, loaded));
+    rebuilt.options++;
+    CHECK(!loadMeshCache("stamp.mesh", "stamp.obj", rebuilt, loaded));
+    CHECK(!loadMeshCache("missing.mesh", loaded));
+}
+
+// Damaged files are rejected rather than read out of bounds
+static void testCorrupt()
+{
+    MeshData mesh, loaded;
+    testMesh(mesh);
+    MeshSource source;
+    CHECK(saveMeshCache("corrupt.mesh", source, mesh));
+    std::string data = readTestFile("corrupt.mesh");
+    CHECK(data.size() > 160);
+    if (data.size() <= 160)
+        return;
+
+    // Another version
+    std::string version = data;
+    version[4] ^= 1;
+    CHECK(writeTestFile("version.mesh", version));
+    CHECK(!loadMeshCache("version.mesh", loaded));
+
+    // Truncated header and truncated streams
+    CHECK(writeTestFile("truncated.mesh", data.substr(0, 16)));
+    CHECK(!loadMeshCache("truncated.mesh", loaded));
+    CHECK(writeTestFile("truncated.mesh", data.substr(0, data.size() - 8)));
+    CHECK(!loadMeshCache("truncated.mesh", loaded));
+
+    // An index past the vertices
+    std::string indexData = data;
+    const uint16_t badIndex = 5;
+    size_t indexAt = indexData.find(std::string(static_cast<const char *>(mesh.indices), 12 * sizeof(uint16_t)));
+    CHECK(indexAt != std::string::npos);
+    if (indexAt != std::string::npos)
+    {
+        memcpy(&indexData[indexAt], &badIndex, sizeof(badIndex));
+        CHECK(writeTestFile("index.mesh", indexData));
+        CHECK(!loadMeshCache("index.mesh", loaded));
+    }
+
+    // A level or a meshlet past the indices
+    MeshData badLod;
+    testMesh(badLod);
+    badLod.lods[1].indexCount = 6;
+    CHECK(saveMeshCache("lod.mesh", source, badLod));
+    CHECK(!loadMeshCache("lod.mesh", loaded));
+    MeshData badMeshlet;
+    testMesh(badMeshlet);
+    badMeshlet.meshlets[0].firstIndex = 6;
+    CHECK(saveMeshCache("meshlet.mesh", source, badMeshlet));
+    CHECK(!loadMeshCache("meshlet.mesh", loaded));
+
+    // Vertices of the wrong size can't be saved
+    MeshData mismatched;
+    testMesh(mismatched);
+    mismatched.compact = true;
+    CHECK(!saveMeshCache("mismatched.mesh", source, mismatched));
+}
+
+// Set a file's modification time to a whole number of seconds
+static bool setModifiedTime(const char *path, time_t seconds)
+{
+#ifdef _WIN32
+    struct _utimbuf times = { seconds, seconds };
+    return _utime(path, &times) == 0;
+#else
+    struct utimbuf times = { seconds, seconds };
+    return utime(path, &times) == 0;
+#endif
+}
+
+// A model builds its cache once, later loads take everything from it
+static void testModelCache()
+{
+    CHECK(writeTestFile("square.obj", std::string(squareObj)));
+    CHECK(setModifiedTime("square.obj", 1000000));
+    remove("square.obj.mesh");
+
+    Model built;
+    CHECK(built.load("square.obj"));
+    CHECK(built.lods.size() >= 1 && built.lods[0].indexCount == 6);
+    CHECK(!built.meshlets.empty());
+    CHECK_NEAR(built.worldPerUv, 0.5, 1e-5);
+    CHECK(built.boundsMin == glm::vec3(0.0f) && built.boundsMax == glm::vec3(1.0f, 1.0f, 0.0f));
+
+    // Same size and time: nothing is read from the source or rebuilt, so
+    // other contents go unnoticed
+    CHECK(writeTestFile("square.obj", std::string(strlen(squareObj), '#')));
+    CHECK(setModifiedTime("square.obj", 1000000));
+    Model cached;
+    CHECK(cached.load("square.obj"));
+    CHECK(cached.lods.size() == built.lods.size() && cached.lods[0].indexCount == 6);
+    CHECK(cached.meshlets.size() == built.meshlets.size());
+    CHECK(cached.worldPerUv == built.worldPerUv);
+
+    // A new time has the contents checked, and they changed
+    CHECK(setModifiedTime("square.obj", 2000000));
+    Model changed;
+    changed.load("square.obj");
+    CHECK(changed.lods[0].indexCount == 0);
+
+    // Other build options rebuild it
+    CHECK(writeTestFile("square.obj", std::string(squareObj)));
+    Model floats;
+    CHECK(floats.load("square.obj"));
+    Model::compactVertices = !Model::compactVertices;
+    Model compact;
+    CHECK(compact.load("square.obj"));
+    MeshData compactCache;
+    CHECK(loadMeshCache("square.obj.mesh", compactCache));
+    CHECK(compactCache.compact == Model::compactVertices);
+    Model::compactVertices = !Model::compactVertices;
+}
+
+int main()
+{
+    testRoundTrip();
+    testSourceStamp();
+    testCorrupt();
+    testModelCache();
+    return testResult("test_mesh_cache");
+}
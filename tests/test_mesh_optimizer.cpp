@@ -0,0 +1,130 @@
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "mesh_optimizer.hpp"
+
+// A size x size grid of quads with its triangles shuffled, the worst case for the cache
+static void shuffledGrid(int size, std::vector<glm::vec3> &positions, std::vector<unsigned int> &indices)
+{
+    positions.clear();
+    indices.clear();
+    for (int y = 0; y <= size; y++)
+        for (int x = 0; x <= size; x++)
+            positions.push_back(glm::vec3(x, y, 0.0f));
+
+    std::vector<glm::uvec3> triangles;
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 2, d = a + size + 1;
+            triangles.push_back(glm::uvec3(a, b, c));
+            triangles.push_back(glm::uvec3(a, c, d));
+        }
+    }
+    srand(5);
+    for (size_t i = triangles.size() - 1; i > 0; i--)
+        std::swap(triangles[i], triangles[rand() % (i + 1)]);
+    for (size_t i = 0; i < triangles.size(); i++)
+        for (int j = 0; j < 3; j++)
+            indices.push_back(triangles[i][j]);
+}
+
+// Triangles as sorted keys that ignore where each starts its winding
+static std::vector<glm::uvec3> triangleSet(const std::vector<unsigned int> &indices)
+{
+    std::vector<glm::uvec3> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::uvec3 triangle(indices[i], indices[i + 1], indices[i + 2]);
+        while (triangle.x > triangle.y || triangle.x > triangle.z)
+            triangle = glm::uvec3(triangle.y, triangle.z, triangle.x);
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end(), [](const glm::uvec3 &a, const glm::uvec3 &b)
+    {
+        return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+    });
+    return triangles;
+}
+
+static void testAnalyze()
+{
+    // A lone triangle misses three times, a strip of quads about once per triangle
+    std::vector<unsigned int> single = { 0, 1, 2 };
+    VertexCacheStats stats = analyzeVertexCache(single, 3);
+    CHECK_NEAR(stats.acmr, 3.0, 1e-9);
+    CHECK_NEAR(stats.atvr, 1.0, 1e-9);
+
+    std::vector<unsigned int> strip;
+    for (unsigned int i = 0; i < 10; i++)
+    {
+        unsigned int quad[6] = { 2 * i, 2 * i + 1, 2 * i + 3, 2 * i, 2 * i + 3, 2 * i + 2 };
+        strip.insert(strip.end(), quad, quad + 6);
+    }
+    stats = analyzeVertexCache(strip, 22);
+    CHECK_NEAR(stats.acmr, 22.0 / 20.0, 1e-9);
+    CHECK_NEAR(stats.atvr, 1.0, 1e-9);
+}
+
+// Reordering keeps every triangle with its winding and lowers the misses
+static void testVertexCache()
+{
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    shuffledGrid(40, positions, indices);
+    const std::vector<glm::uvec3> before = triangleSet(indices);
+    const double shuffledAcmr = analyzeVertexCache(indices, positions.size()).acmr;
+
+    optimizeVertexCache(indices, positions.size());
+    CHECK(triangleSet(indices) == before);
+    const double optimizedAcmr = analyzeVertexCache(indices, positions.size()).acmr;
+    CHECK(optimizedAcmr < 0.8);
+    CHECK(optimizedAcmr < shuffledAcmr * 0.5);
+
+    // Overdraw ordering moves whole clusters, so it keeps most of the gain
+    optimizeOverdraw(indices, positions);
+    CHECK(triangleSet(indices) == before);
+    CHECK(analyzeVertexCache(indices, positions.size()).acmr < optimizedAcmr * 1.2);
+}
+
+// Vertices are renumbered by first use, the unused one dropped, the geometry unchanged
+static void testVertexFetch()
+{
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> uvs;
+    for (int i = 0; i < 5; i++)
+    {
+        positions.push_back(glm::vec3(i, 0.0f, 0.0f));
+        uvs.push_back(glm::vec2(i, 1.0f));
+        normals.push_back(glm::vec3(0.0f, i, 1.0f));
+    }
+    std::vector<unsigned int> indices = { 4, 2, 0, 0, 2, 1 };
+    const std::vector<unsigned int> original = indices;
+    const std::vector<glm::vec3> originalPositions = positions;
+    const std::vector<glm::vec2> originalUVs = uvs;
+    const std::vector<glm::vec3> originalNormals = normals;
+
+    optimizeVertexFetch(indices, positions, uvs, normals);
+    CHECK(positions.size() == 4 && uvs.size() == 4 && normals.size() == 4);
+    const std::vector<unsigned int> expected = { 0, 1, 2, 2, 1, 3 };
+    CHECK(indices == expected);
+    for (size_t i = 0; i < indices.size() && i < original.size(); i++)
+    {
+        CHECK(positions[indices[i]] == originalPositions[original[i]]);
+        CHECK(uvs[indices[i]] == originalUVs[original[i]]);
+        CHECK(normals[indices[i]] == originalNormals[original[i]]);
+    }
+}
+
+int main()
+{
+    testAnalyze();
+    testVertexCache();
+    testVertexFetch();
+    return testResult("test_mesh_optimizer");
+}
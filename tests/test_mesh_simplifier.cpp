@@ -0,0 +1,126 @@
+#include <vector>
+#include <math.h>
+
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "mesh_simplifier.hpp"
+
+// A latitude-longitude sphere with a closed surface, poles shared by their fans
+static void sphere(int rings, int segments, std::vector<glm::vec3> &positions, std::vector<unsigned int> &indices)
+{
+    positions.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+    for (int r = 1; r < rings; r++)
+    {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s < segments; s++)
+        {
+            float phi = 2.0f * 3.14159265f * s / segments;
+            positions.push_back(glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+        }
+    }
+    positions.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+    const unsigned int bottom = static_cast<unsigned int>(positions.size() - 1);
+
+    for (int s = 0; s < segments; s++)
+    {
+        unsigned int next = (s + 1) % segments;
+        unsigned int top[3] = { 0, 1 + next, 1 + (unsigned int)s };
+        indices.insert(indices.end(), top, top + 3);
+        for (int r = 0; r < rings - 2; r++)
+        {
+            unsigned int a = 1 + r * segments + s, b = 1 + r * segments + next;
+            unsigned int c = a + segments, d = b + segments;
+            unsigned int quad[6] = { a, b, d, a, d, c };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+        unsigned int last = 1 + (rings - 2) * segments;
+        unsigned int end[3] = { bottom, last + (unsigned int)s, last + next };
+        indices.insert(indices.end(), end, end + 3);
+    }
+}
+
+// A flat grid collapses to a few triangles without moving, keeping its outline
+static void testFlatGrid()
+{
+    const int size = 16;
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices, simplified;
+    for (int y = 0; y <= size; y++)
+        for (int x = 0; x <= size; x++)
+            positions.push_back(glm::vec3(x, y, 0.0f));
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 2, d = a + size + 1;
+            unsigned int quad[6] = { a, b, c, a, c, d };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    float error = simplifyMesh(indices, positions, indices.size() / 4, simplified);
+    CHECK(simplified.size() <= indices.size() / 4);
+    CHECK(simplified.size() > 0 && simplified.size() % 3 == 0);
+    CHECK_NEAR(error, 0.0, 1e-4);
+
+    // Still covers the whole square, with the triangles facing the same way
+    double area = 0.0;
+    for (size_t i = 0; i + 2 < simplified.size(); i += 3)
+    {
+        glm::vec3 a = positions[simplified[i]], b = positions[simplified[i + 1]], c = positions[simplified[i + 2]];
+        float z = glm::cross(b - a, c - a).z;
+        CHECK(z >= 0.0f);
+        area += 0.5 * z;
+    }
+    CHECK_NEAR(area, size * size, 1e-3);
+}
+
+// Each level has fewer triangles and a larger error, and is a valid range of vertices
+static void testLodChain()
+{
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    sphere(24, 48, positions, indices);
+
+    std::vector<unsigned int> lodIndices;
+    std::vector<MeshLod> lods;
+    buildLodChain(indices, positions, 5, lodIndices, lods);
+    CHECK(lods.size() >= 3 && lods.size() <= 5);
+    if (lods.empty())
+        return;
+
+    CHECK(lods[0].firstIndex == 0 && lods[0].indexCount == indices.size() && lods[0].error == 0.0f);
+    const size_t totalIndices = indices.size() + lodIndices.size();
+    for (size_t i = 1; i < lods.size(); i++)
+    {
+        CHECK(lods[i].indexCount > 0 && lods[i].indexCount % 3 == 0);
+        CHECK(lods[i].indexCount < lods[i - 1].indexCount);
+        CHECK(lods[i].error >= lods[i - 1].error);
+        CHECK(lods[i].firstIndex >= indices.size());
+        CHECK(lods[i].firstIndex + lods[i].indexCount <= totalIndices);
+    }
+    CHECK(lods[1].indexCount <= indices.size() * 3 / 5);
+    CHECK(lods[1].error > 0.0f && lods[1].error < 0.1f);
+    for (size_t i = 0; i < lodIndices.size(); i++)
+        CHECK(lodIndices[i] < positions.size());
+
+    // Far away the coarsest level is enough, close up only the full mesh is
+    const float fovY = glm::radians(45.0f);
+    CHECK(selectLod(lods, 0.5f, fovY, 1080.0f, 1.0f) == 0);
+    CHECK(selectLod(lods, 1e6f, fovY, 1080.0f, 1.0f) == lods.size() - 1);
+    unsigned int previous = 0;
+    for (float distance = 1.0f; distance < 1e5f; distance *= 2.0f)
+    {
+        unsigned int lod = selectLod(lods, distance, fovY, 1080.0f, 1.0f);
+        CHECK(lod >= previous);
+        previous = lod;
+    }
+}
+
+int main()
+{
+    testFlatGrid();
+    testLodChain();
+    return testResult("test_mesh_simplifier");
+}
@@ -0,0 +1,108 @@
+#include <vector>
+#include <set>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "test.hpp"
+#include "meshlet.hpp"
+
+// A size x size grid of quads in the xy plane, facing +z, in row order
+static void grid(int size, std::vector<glm::vec3> &positions, std::vector<unsigned int> &indices)
+{
+    for (int y = 0; y <= size; y++)
+        for (int x = 0; x <= size; x++)
+            positions.push_back(glm::vec3(x, y, 0.0f));
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 2, d = a + size + 1;
+            unsigned int quad[6] = { a, b, c, a, c, d };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// Meshlets cover the index buffer in order, within the limits, and bound their vertices
+static void testBuild()
+{
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    grid(32, positions, indices);
+
+    std::vector<Meshlet> meshlets;
+    buildMeshlets(indices, positions, meshlets);
+    CHECK(meshlets.size() > 1);
+
+    unsigned int nextIndex = 0;
+    for (size_t m = 0; m < meshlets.size(); m++)
+    {
+        const Meshlet &meshlet = meshlets[m];
+        CHECK(meshlet.firstIndex == nextIndex);
+        CHECK(meshlet.indexCount > 0 && meshlet.indexCount % 3 == 0);
+        CHECK(meshlet.indexCount / 3 <= meshletMaxTriangles);
+        CHECK(meshlet.vertexCount <= meshletMaxVertices);
+        nextIndex = meshlet.firstIndex + meshlet.indexCount;
+
+        std::set<unsigned int> vertices;
+        for (unsigned int i = meshlet.firstIndex; i < nextIndex && i < indices.size(); i++)
+        {
+            vertices.insert(indices[i]);
+            CHECK(glm::length(positions[indices[i]] - meshlet.center) <= meshlet.radius * 1.0001f);
+        }
+        CHECK(vertices.size() == meshlet.vertexCount);
+
+        // A flat patch faces one way, so its cone is the plane's normal
+        CHECK_NEAR(meshlet.coneAxis.z, 1.0, 1e-5);
+        CHECK_NEAR(meshlet.coneCutoff, 0.0, 1e-3);
+    }
+    CHECK(nextIndex == indices.size());
+}
+
+// Clusters outside the frustum or facing away are culled, visible ones are kept
+static void testCull()
+{
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    grid(6, positions, indices);
+    std::vector<Meshlet> meshlets;
+    buildMeshlets(indices, positions, meshlets);
+    CHECK(meshlets.size() == 1);
+    if (meshlets.empty())
+        return;
+    const Meshlet &meshlet = meshlets[0];
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+    const glm::vec3 target(3.0f, 3.0f, 0.0f);
+
+    // In front, looking at it
+    glm::vec3 eye(3.0f, 3.0f, 20.0f);
+    Frustum frustum = extractFrustum(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+    CHECK(!cullMeshlet(meshlet, frustum, eye));
+
+    // In front, looking away
+    frustum = extractFrustum(projection * glm::lookAt(eye, eye + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    CHECK(cullMeshlet(meshlet, frustum, eye));
+
+    // Too far away
+    frustum = extractFrustum(glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 10.0f) *
+                             glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+    CHECK(cullMeshlet(meshlet, frustum, eye));
+
+    // Behind, looking at its back
+    eye = glm::vec3(3.0f, 3.0f, -20.0f);
+    frustum = extractFrustum(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+    CHECK(cullMeshlet(meshlet, frustum, eye));
+
+    // Edge on, where some of it may still be seen
+    eye = glm::vec3(-20.0f, 3.0f, 0.5f);
+    frustum = extractFrustum(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+    CHECK(!cullMeshlet(meshlet, frustum, eye));
+}
+
+int main()
+{
+    testBuild();
+    testCull();
+    return testResult("test_meshlet");
+}
@@ -0,0 +1,135 @@
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+#include "test.hpp"
+#include "mip_generator.hpp"
+
+// Each level halves down to 1x1, rounding down, and level 0 is the image
+static void testSizes()
+{
+    std::vector<uint8_t> pixels(13 * 5 * 3, 9);
+    std::vector<MipLevel> levels;
+    generateMips(pixels.data(), 13, 5, 3, MipOptions(), levels, 1);
+
+    const int widths[4] = { 13, 6, 3, 1 }, heights[4] = { 5, 2, 1, 1 };
+    CHECK(levels.size() == 4);
+    for (size_t l = 0; l < levels.size() && l < 4; l++)
+    {
+        CHECK(levels[l].width == widths[l] && levels[l].height == heights[l]);
+        CHECK(levels[l].channels == 3);
+        CHECK(levels[l].pixels.size() == static_cast<size_t>(widths[l] * heights[l] * 3));
+    }
+    if (!levels.empty())
+        CHECK(levels[0].pixels == pixels);
+}
+
+// A flat image stays flat with either filter
+static void testConstant()
+{
+    std::vector<uint8_t> pixels(16 * 16 * 4);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = static_cast<uint8_t>(40 + (i % 4) * 60);
+
+    const MipFilter filters[2] = { MipBox, MipKaiser };
+    for (int f = 0; f < 2; f++)
+    {
+        MipOptions options;
+        options.filter = filters[f];
+        options.srgb = f == 1;
+        std::vector<MipLevel> levels;
+        generateMips(pixels.data(), 16, 16, 4, options, levels, 1);
+        CHECK(levels.size() == 5);
+        int largest = 0;
+        for (size_t l = 1; l < levels.size(); l++)
+            for (size_t i = 0; i < levels[l].pixels.size(); i++)
+                largest = std::max(largest, abs(levels[l].pixels[i] - pixels[i % 4]));
+        CHECK(largest <= 1);
+    }
+}
+
+// Black and white average to mid grey in linear light, which is 188 in sRGB
+static void testSrgb()
+{
+    std::vector<uint8_t> pixels(2 * 2 * 3, 0);
+    for (int i = 0; i < 3; i++)
+    {
+        pixels[i] = 255;
+        pixels[9 + i] = 255;
+    }
+
+    MipOptions linear, srgb;
+    srgb.srgb = true;
+    std::vector<MipLevel> levels;
+    generateMips(pixels.data(), 2, 2, 3, linear, levels, 1);
+    CHECK(levels.size() == 2);
+    if (levels.size() == 2)
+        CHECK_NEAR(levels[1].pixels[0], 127.5, 1.0);
+
+    generateMips(pixels.data(), 2, 2, 3, srgb, levels, 1);
+    CHECK(levels.size() == 2);
+    if (levels.size() == 2)
+        CHECK_NEAR(levels[1].pixels[0], 188.0, 1.0);
+}
+
+// Fraction of texels passing the alpha test
+static double coverage(const MipLevel &level, float cutoff)
+{
+    int passed = 0;
+    for (int i = 0; i < level.width * level.height; i++)
+        passed += level.pixels[i * 4 + 3] / 255.0f > cutoff ? 1 : 0;
+    return passed / static_cast<double>(level.width * level.height);
+}
+
+// Cutouts keep their coverage instead of fading away in the distance
+static void testAlphaCoverage()
+{
+    // Thin noisy leaves, about 30% opaque
+    const int size = 64;
+    srand(13);
+    std::vector<uint8_t> pixels(size * size * 4, 200);
+    for (int i = 0; i < size * size; i++)
+        pixels[i * 4 + 3] = rand() % 100 < 30 ? 255 : 0;
+
+    MipOptions options;
+    options.alphaCutoff = 0.5f;
+    std::vector<MipLevel> levels;
+    generateMips(pixels.data(), size, size, 4, options, levels, 1);
+    const double original = coverage(levels[0], 0.5f);
+    for (size_t l = 1; l + 2 < levels.size(); l++)
+        CHECK_NEAR(coverage(levels[l], 0.5f), original, 0.08);
+
+    // Without it the averaged alpha drops under the cutoff
+    MipOptions plain;
+    generateMips(pixels.data(), size, size, 4, plain, levels, 1);
+    CHECK(coverage(levels[3], 0.5f) < original * 0.5);
+}
+
+// Rows split across threads give the same levels
+static void testThreads()
+{
+    srand(17);
+    std::vector<uint8_t> pixels(100 * 60 * 4);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = static_cast<uint8_t>(rand());
+
+    MipOptions options;
+    options.filter = MipKaiser;
+    options.srgb = true;
+    std::vector<MipLevel> serial, parallel;
+    generateMips(pixels.data(), 100, 60, 4, options, serial, 1);
+    generateMips(pixels.data(), 100, 60, 4, options, parallel, 4);
+    CHECK(serial.size() == parallel.size());
+    for (size_t l = 0; l < serial.size() && l < parallel.size(); l++)
+        CHECK(serial[l].pixels == parallel[l].pixels);
+}
+
+int main()
+{
+    testSizes();
+    testConstant();
+    testSrgb();
+    testAlphaCoverage();
+    testThreads();
+    return testResult("test_mip_generator");
+}
@@ -0,0 +1,253 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "obj_loader.hpp"
+#include "thread_pool.hpp"
+
+static bool parseText(const char *path, const std::string &text, ObjMesh &mesh, unsigned int threads = 1)
+{
+    ObjLoadStats stats;
+    CHECK(writeTestFile(path, text));
+    return parseObj(path, mesh, stats, threads);
+}
+
+static bool sameCorner(const ObjCorner &corner, int position, int uv, int normal)
+{
+    return corner.position == position && corner.uv == uv && corner.normal == normal;
+}
+
+// Attribute records and every face corner form
+static void testRecords()
+{
+    ObjMesh mesh;
+    CHECK(parseText("records.obj",
+                    "# comment\n"
+                    "mtllib scene.mtl\n"
+                    "o thing\n"
+                    "v 1 2 3\n"
+                    "v -1.5 +2.25e1 3E-2\n"
+                    "v\t0.5\t0.5\t0.5\n"
+                    "vt 0.25 0.75\n"
+                    "vn 0 0 1\n"
+                    "g group\n"
+                    "usemtl wood\n"
+                    "s off\n"
+                    "f 1 2 3\n"
+                    "f 1/1 2/1 3/1\n"
+                    "f 1//1 2//1 3//1\n"
+                    "f 1/1/1 2/1/1 3/1/1\n",
+                    mesh));
+    CHECK(mesh.positions.size() == 3);
+    CHECK(mesh.uvs.size() == 1);
+    CHECK(mesh.normals.size() == 1);
+    CHECK(mesh.positions[0] == glm::vec3(1.0f, 2.0f, 3.0f));
+    CHECK(mesh.positions[1] == glm::vec3(-1.5f, 22.5f, 0.03f));
+    CHECK(mesh.positions[2] == glm::vec3(0.5f));
+    CHECK(mesh.uvs[0] == glm::vec2(0.25f, 0.75f));
+    CHECK(mesh.normals[0] == glm::vec3(0.0f, 0.0f, 1.0f));
+
+    CHECK(mesh.corners.size() == 12);
+    if (mesh.corners.size() == 12)
+    {
+        CHECK(sameCorner(mesh.corners[0], 0, -1, -1));
+        CHECK(sameCorner(mesh.corners[3], 0, 0, -1));
+        CHECK(sameCorner(mesh.corners[6], 0, -1, 0));
+        CHECK(sameCorner(mesh.corners[11], 2, 0, 0));
+    }
+}
+
+// Polygons become fans, negative indices count back from the last record
+static void testPolygonsAndRelativeIndices()
+{
+    ObjMesh mesh;
+    CHECK(parseText("polygons.obj",
+                    "v 0 0 0\r\n"
+                    "v 1 0 0\r\n"
+                    "v 1 1 0\r\n"
+                    "v 0 1 0\r\n"
+                    "f 1 2 3 4\r\n"
+                    "v 2 0 0\r\n"
+                    "f -1 -4 -5", // No line break after the last record
+                    mesh));
+    CHECK(mesh.positions.size() == 5);
+    CHECK(mesh.corners.size() == 9);
+    if (mesh.corners.size() == 9)
+    {
+        const int expected[9] = { 0, 1, 2, 0, 2, 3, 4, 1, 0 };
+        for (int i = 0; i < 9; i++)
+            CHECK(mesh.corners[i].position == expected[i]);
+    }
+}
+
+static void testMalformed()
+{
+    ObjMesh mesh;
+    CHECK(!parseText("two_corners.obj", "v 0 0 0\nv 1 0 0\nf 1 2\n", mesh));
+    CHECK(!parseText("out_of_range.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 4\n", mesh));
+    CHECK(!parseText("bad_uv.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1/2 2/2 3/2\n", mesh));
+    CHECK(!parseText("garbage.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 x\n", mesh));
+
+    ObjLoadStats stats;
+    CHECK(!parseObj("missing.obj", mesh, stats, 1));
+}
+
+// Floats parse to the nearest float, like strtof
+static void testFloats()
+{
+    srand(1);
+    std::string text;
+    std::vector<float> values;
+    for (int i = 0; i < 3000; i++)
+    {
+        double value = (rand() / (double)RAND_MAX - 0.5) * pow(10.0, rand() % 12 - 6);
+        char line[64];
+        snprintf(line, sizeof(line), "v %.9g 0 0\n", value);
+        text += line;
+        values.push_back(strtof(line + 2, NULL));
+    }
+
+    ObjMesh mesh;
+    CHECK(parseText("floats.obj", text, mesh));
+    CHECK(mesh.positions.size() == values.size());
+    int mismatches = 0;
+    for (size_t i = 0; i < values.size() && i < mesh.positions.size(); i++)
+        mismatches += fabs(mesh.positions[i].x - values[i]) > fabs(values[i]) * 2e-7 ? 1 : 0;
+    CHECK(mismatches == 0);
+}
+
+static bool sameMesh(const ObjMesh &a, const ObjMesh &b)
+{
+    if (a.positions != b.positions || a.uvs != b.uvs || a.normals != b.normals ||
+        a.corners.size() != b.corners.size())
+        return false;
+    for (size_t i = 0; i < a.corners.size(); i++)
+        if (!sameCorner(a.corners[i], b.corners[i].position, b.corners[i].uv, b.corners[i].normal))
+            return false;
+    return true;
+}
+
+// A grid of quads big enough to be split, faces using relative indices too,
+// so some refer to records in earlier chunks
+static std::string gridObj(int size)
+{
+    std::string text;
+    char line[128];
+    for (int y = 0; y <= size; y++)
+    {
+        for (int x = 0; x <= size; x++)
+        {
+            snprintf(line, sizeof(line), "v %d.5 %d.25 0.125\nvt %g %g\nvn 0 0 1\n", x, y, x / (double)size, y / (double)size);
+            text += line;
+        }
+    }
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            int a = y * (size + 1) + x + 1, b = a + 1, c = a + size + 2, d = a + size + 1;
+            if ((x + y) % 2)
+                snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+            else
+            {
+                int count = (size + 1) * (size + 1);
+                snprintf(line, sizeof(line), "f %d//1 %d//1 %d//1\n", a - count - 1, b - count - 1, c - count - 1);
+            }
+            text += line;
+        }
+    }
+    return text;
+}
+
+// The result is the same for any number of chunks
+static void testParallelChunks()
+{
+    CHECK(writeTestFile("grid.obj", gridObj(300)));
+
+    ObjMesh serial;
+    ObjLoadStats stats;
+    CHECK(parseObj("grid.obj", serial, stats, 1));
+    CHECK(stats.chunks == 1);
+    CHECK(serial.positions.size() == 301 * 301);
+    CHECK(serial.corners.size() == 300 * 300 / 2 * 6 + 300 * 300 / 2 * 3);
+
+    const unsigned int threadCounts[] = { 2, 3, 4, 7 };
+    for (int i = 0; i < 4; i++)
+    {
+        ObjMesh parallel;
+        CHECK(parseObj("grid.obj", parallel, stats, threadCounts[i]));
+        CHECK(stats.chunks > 1);
+        CHECK(sameMesh(serial, parallel));
+    }
+
+    // Loads already running on the shared pool can parse in parallel too
+    CHECK(&ThreadPool::shared() == &ThreadPool::shared());
+    std::vector<ObjMesh> nested(3);
+    ThreadPool::shared().parallelFor(nested.size(), [&nested](size_t i)
+    {
+        ObjLoadStats nestedStats;
+        parseObj("grid.obj", nested[i], nestedStats, 4);
+    });
+    for (size_t i = 0; i < nested.size(); i++)
+        CHECK(sameMesh(serial, nested[i]));
+}
+
+// Corners sharing all three indices share a vertex, any difference splits it
+static void testIndexing()
+{
+    ObjMesh mesh;
+    CHECK(parseText("indexing.obj",
+                    "v 0 0 0\n"
+                    "v 1 0 0\n"
+                    "v 1 1 0\n"
+                    "v 0 1 0\n"
+                    "vt 0 0\n"
+                    "vt 1 1\n"
+                    "vn 0 0 1\n"
+                    "vn 0 0 -1\n"
+                    "f 1/1/1 2/1/1 3/1/1 4/1/1\n" // The quad's diagonal is shared
+                    "f 1/2/1 2/1/1 3/1/2\n"       // New uv and new normal
+                    "f 4 1 2\n",                  // No uv or normal
+                    mesh));
+
+    std::vector<glm::vec3> vertices, normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<unsigned int> indices;
+    ObjLoadStats stats;
+    indexObj(mesh, vertices, uvs, normals, indices, stats);
+
+    CHECK(indices.size() == mesh.corners.size());
+    CHECK(vertices.size() == 9);
+    CHECK(stats.uniqueVertices == vertices.size());
+    CHECK(uvs.size() == vertices.size() && normals.size() == vertices.size());
+    if (indices.size() == 12 && vertices.size() == 9)
+    {
+        const unsigned int expected[12] = { 0, 1, 2, 0, 2, 3, 4, 1, 5, 6, 7, 8 };
+        for (int i = 0; i < 12; i++)
+            CHECK(indices[i] == expected[i]);
+
+        // Each vertex has its corner's attributes, missing ones are zero
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            const ObjCorner &corner = mesh.corners[i];
+            CHECK(vertices[indices[i]] == mesh.positions[corner.position]);
+            CHECK(uvs[indices[i]] == (corner.uv >= 0 ? mesh.uvs[corner.uv] : glm::vec2(0.0f)));
+            CHECK(normals[indices[i]] == (corner.normal >= 0 ? mesh.normals[corner.normal] : glm::vec3(0.0f)));
+        }
+    }
+}
+
+int main()
+{
+    testRecords();
+    testPolygonsAndRelativeIndices();
+    testMalformed();
+    testFloats();
+    testParallelChunks();
+    testIndexing();
+    return testResult("test_obj_loader");
+}
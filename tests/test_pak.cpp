@@ -0,0 +1,231 @@
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test.hpp"
+#include "lz_block.hpp"
+#include "pak.hpp"
+#include "vfs.hpp"
+#include "hash.hpp"
+
+static bool lzRoundTrip(const std::string &data, size_t *compressedSize = NULL)
+{
+    std::vector<uint8_t> compressed(lzCompressBound(data.size()));
+    size_t size = lzCompress(reinterpret_cast<const uint8_t *>(data.data()), data.size(), compressed.data());
+    if (compressedSize)
+        *compressedSize = size;
+    if (size > compressed.size())
+        return false;
+    std::vector<uint8_t> out(data.size() + 1);
+    return lzDecompress(compressed.data(), size, out.data(), data.size()) &&
+           memcmp(out.data(), data.data(), data.size()) == 0;
+}
+
+static std::string randomBytes(size_t size, unsigned int seed)
+{
+    srand(seed);
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; i++)
+        data[i] = static_cast<char>(rand());
+    return data;
+}
+
+static std::string repetitiveText(size_t size)
+{
+    std::string text;
+    for (int i = 0; text.size() < size; i++)
+        text += "v 1.0 2.0 " + std::to_string(i % 37) + "\nf 1 2 3\n";
+    return text.substr(0, size);
+}
+
+// Anything round trips, data with repeats shrinks, random data stays within the bound
+static void testLzRoundTrip()
+{
+    CHECK(lzRoundTrip(""));
+    CHECK(lzRoundTrip("a"));
+    CHECK(lzRoundTrip("abcd"));
+    CHECK(lzRoundTrip(std::string(100000, 'z'))); // Matches overlapping their own output
+    CHECK(lzRoundTrip(randomBytes(70000, 1)));
+
+    size_t compressed = 0;
+    std::string text = repetitiveText(200000);
+    CHECK(lzRoundTrip(text, &compressed));
+    CHECK(compressed < text.size() / 4);
+
+    // Repeats further apart than the window still decode
+    std::string block = randomBytes(40000, 2);
+    CHECK(lzRoundTrip(block + randomBytes(30000, 3) + block));
+
+    for (size_t size = 0; size < 300; size += 7)
+        CHECK(lzRoundTrip(randomBytes(size, static_cast<unsigned int>(size)) + repetitiveText(size)));
+}
+
+// Damaged data fails instead of writing out of bounds
+static void testLzCorrupt()
+{
+    std::string text = repetitiveText(5000);
+    std::vector<uint8_t> compressed(lzCompressBound(text.size()));
+    size_t size = lzCompress(reinterpret_cast<const uint8_t *>(text.data()), text.size(), compressed.data());
+    std::vector<uint8_t> out(text.size());
+
+    CHECK(!lzDecompress(compressed.data(), size / 2, out.data(), out.size()));
+    CHECK(!lzDecompress(compressed.data(), size, out.data(), out.size() - 1));
+    std::vector<uint8_t> larger(text.size() + 1);
+    CHECK(!lzDecompress(compressed.data(), size, larger.data(), larger.size()));
+
+    // Random damage may still decode to something, but never crashes
+    srand(23);
+    for (int i = 0; i < 2000; i++)
+    {
+        std::vector<uint8_t> damaged(compressed.begin(), compressed.begin() + size);
+        damaged[rand() % size] = static_cast<uint8_t>(rand());
+        lzDecompress(damaged.data(), damaged.size(), out.data(), out.size());
+    }
+}
+
+static bool sameBytes(const void *a, const std::string &b)
+{
+    return memcmp(a, b.data(), b.size()) == 0;
+}
+
+// Files come back as added, compressed only when it pays, in place when not
+static void testPakRoundTrip()
+{
+    const std::string text = repetitiveText(50000), noise = randomBytes(20000, 4);
+    PakWriter writer;
+    writer.add("models/ball.obj.mesh", text.data(), text.size(), true);
+    writer.add("textures/noise.tex", noise.data(), noise.size(), true);
+    writer.add("shaders/empty.frag", "", 0, false);
+    writer.add("shaders/simple.vert", text.data(), 1000, false);
+    CHECK(writer.fileCount() == 4);
+    CHECK(writer.write("round_trip.pak"));
+
+    PakArchive pak;
+    CHECK(pak.open("round_trip.pak"));
+    CHECK(pak.entryCount() == 4);
+    CHECK(pak.find("models/missing.obj") == NULL);
+
+    const PakEntry *mesh = pak.find("models/ball.obj.mesh");
+    CHECK(mesh && (mesh->flags & PakCompressed) && mesh->storedSize < text.size() / 4);
+    if (mesh)
+    {
+        std::vector<char> out;
+        CHECK(pak.decompress(*mesh, out));
+        CHECK(out.size() == text.size() && sameBytes(out.data(), text));
+        CHECK(pak.entryName(*mesh) == "models/ball.obj.mesh");
+    }
+
+    const PakEntry *tex = pak.find("textures/noise.tex");
+    CHECK(tex && !(tex->flags & PakCompressed) && tex->size == noise.size());
+    if (tex)
+    {
+        CHECK(sameBytes(pak.storedData(*tex), noise));
+        CHECK(tex->offset % 16 == 0);
+        CHECK(tex->hash == hashBytes(noise.data(), noise.size()));
+    }
+
+    const PakEntry *empty = pak.find("shaders/empty.frag");
+    CHECK(empty && empty->size == 0);
+
+    // Names are sorted for lookup
+    for (size_t i = 1; i < pak.entryCount(); i++)
+        CHECK(pak.entryName(pak.entry(i - 1)) < pak.entryName(pak.entry(i)));
+
+    // The same files in another order give the same bytes
+    PakWriter reordered;
+    reordered.add("shaders/simple.vert", text.data(), 1000, false);
+    reordered.add("shaders/empty.frag", "", 0, false);
+    reordered.add("textures/noise.tex", noise.data(), noise.size(), true);
+    reordered.add("models/ball.obj.mesh", text.data(), text.size(), true);
+    CHECK(reordered.write("reordered.pak"));
+    CHECK(readTestFile("round_trip.pak") == readTestFile("reordered.pak"));
+
+    // And a pak in memory reads the same
+    std::string bytes = readTestFile("round_trip.pak");
+    PakArchive memory;
+    CHECK(memory.openMemory(bytes.data(), bytes.size(), "memory"));
+    CHECK(memory.entryCount() == 4 && memory.find("textures/noise.tex") != NULL);
+}
+
+// Damaged paks fail to open, damaged compressed files fail their hash
+static void testPakCorrupt()
+{
+    const std::string text = repetitiveText(20000);
+    PakWriter writer;
+    writer.add("a.txt", text.data(), text.size(), true);
+    CHECK(writer.write("corrupt.pak"));
+    std::string bytes = readTestFile("corrupt.pak");
+
+    PakArchive pak;
+    CHECK(!pak.openMemory(bytes.data(), 8, "truncated"));
+    std::string version = bytes;
+    version[4] ^= 1;
+    CHECK(!pak.openMemory(version.data(), version.size(), "version"));
+    std::string truncated = bytes.substr(0, bytes.size() - 1);
+    CHECK(!pak.openMemory(truncated.data(), truncated.size(), "truncated"));
+
+    // Flip a byte of the stored data, the file must not be returned
+    PakArchive intact;
+    CHECK(intact.openMemory(bytes.data(), bytes.size(), "intact"));
+    const PakEntry *entry = intact.find("a.txt");
+    CHECK(entry != NULL);
+    if (!entry)
+        return;
+    std::string damaged = bytes;
+    damaged[static_cast<size_t>(entry->offset + entry->storedSize / 2)] ^= 0x20;
+    PakArchive damagedPak;
+    CHECK(damagedPak.openMemory(damaged.data(), damaged.size(), "damaged"));
+    std::vector<char> out;
+    CHECK(!damagedPak.decompress(*damagedPak.find("a.txt"), out));
+
+    CHECK(mountPakMemory(damaged.data(), damaged.size(), "damaged"));
+    VfsFile file;
+    CHECK(!file.open("a.txt"));
+    unmountPaks();
+}
+
+// Paks mounted later win, then the disk, and open files outlive the mount
+static void testVfs()
+{
+    CHECK(normalizePakPath("./models\\ball.obj") == "models/ball.obj");
+    CHECK(normalizePakPath("models//textures/../ball.obj") == "models/ball.obj");
+    CHECK(normalizePakPath("../ball.obj") == "../ball.obj");
+
+    CHECK(writeTestFile("disk_only.txt", std::string("disk")));
+    CHECK(writeTestFile("shared.txt", std::string("disk")));
+
+    PakWriter first, second;
+    first.add("shared.txt", "first", 5, false);
+    first.add("models/first.txt", "first", 5, false);
+    second.add("shared.txt", "second", 6, false);
+    CHECK(first.write("first.pak") && second.write("second.pak"));
+    CHECK(mountPak("first.pak"));
+    CHECK(mountPak("second.pak"));
+    CHECK(!mountPak("missing.pak"));
+
+    VfsFile file;
+    CHECK(file.open("shared.txt") && file.inPak());
+    CHECK(file.size() == 6 && memcmp(file.data(), "second", 6) == 0);
+    CHECK(file.open("./models/../models/first.txt") && file.inPak());
+    CHECK(file.open("disk_only.txt") && !file.inPak() && file.size() == 4);
+    CHECK(vfsExists("models/first.txt") && vfsExists("disk_only.txt") && !vfsExists("nowhere.txt"));
+    CHECK(!file.open("nowhere.txt") && !file.isOpen());
+
+    VfsFile kept;
+    CHECK(kept.open("shared.txt"));
+    unmountPaks();
+    CHECK(kept.isOpen() && memcmp(kept.data(), "second", 6) == 0);
+    CHECK(file.open("shared.txt") && !file.inPak() && memcmp(file.data(), "disk", 4) == 0);
+    CHECK(!vfsExists("models/first.txt"));
+}
+
+int main()
+{
+    testLzRoundTrip();
+    testLzCorrupt();
+    testPakRoundTrip();
+    testPakCorrupt();
+    testVfs();
+    return testResult("test_pak");
+}
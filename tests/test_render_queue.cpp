@@ -0,0 +1,153 @@
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "render_queue.hpp"
+
+static DrawPacket packetAt(RenderPass pass, GLuint texture, GLuint vao)
+{
+    DrawPacket packet;
+    packet.pass = pass;
+    packet.textures[0] = texture;
+    packet.vao = vao;
+    return packet;
+}
+
+// Opaque state sorts before depth, translucent depth before state
+static void testSortKeys()
+{
+    DrawPacket a = packetAt(RenderOpaque, 1, 1), b = packetAt(RenderOpaque, 2, 1);
+    CHECK(RenderQueue::sortKey(a, 1.0f) < RenderQueue::sortKey(a, 2.0f));  // Front to back
+    CHECK(RenderQueue::sortKey(a, 50.0f) < RenderQueue::sortKey(b, 1.0f)); // Material first
+    CHECK(RenderQueue::sortKey(a, -5.0f) == RenderQueue::sortKey(a, 0.0f)); // Behind the camera
+
+    DrawPacket c = packetAt(RenderTranslucent, 1, 1), d = packetAt(RenderTranslucent, 2, 1);
+    CHECK(RenderQueue::sortKey(a, 1e6f) < RenderQueue::sortKey(c, 1e6f));  // Opaque first
+    CHECK(RenderQueue::sortKey(c, 2.0f) < RenderQueue::sortKey(c, 1.0f));  // Back to front
+    CHECK(RenderQueue::sortKey(d, 2.0f) < RenderQueue::sortKey(c, 1.0f));  // Whatever the material
+
+    // Depths closer than the key's precision still keep their order
+    CHECK(RenderQueue::sortKey(a, 10.0f) < RenderQueue::sortKey(a, 10.01f));
+}
+
+struct Drawn
+{
+    int id;
+    GLuint program;
+    GLuint texture;
+    GLuint vao;
+    float depth;
+    bool blending;
+};
+
+static std::vector<Drawn> drawn;
+
+static void recordDraw(const DrawPacket &packet, const RenderQueue &queue)
+{
+    Drawn record;
+    record.id = static_cast<int>(reinterpret_cast<size_t>(packet.object));
+    GLint program = 0, texture = 0, vao = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+    record.program = program;
+    record.texture = texture;
+    record.vao = vao;
+    record.depth = -(queue.view() * packet.model[3]).z;
+    record.blending = glIsEnabled(GL_BLEND) == GL_TRUE;
+    drawn.push_back(record);
+}
+
+// A shuffled frame draws grouped by state with its state bound, and fewer binds
+static void testFlush()
+{
+    const char *vertex = "#version 330 core\nvoid main() { gl_Position = vec4(0.0); }\n";
+    const char *fragment = "#version 330 core\nout vec4 color;\nvoid main() { color = vec4(1.0); }\n";
+    ShaderProgram programs[2];
+    CHECK(programs[0].compile(vertex, fragment) && programs[1].compile(vertex, fragment));
+    GLuint textures[3], vaos[2];
+    glGenTextures(3, textures);
+    for (int i = 0; i < 3; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glGenVertexArrays(2, vaos);
+
+    RenderQueue queue;
+    queue.begin(glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+                glm::perspective(1.0f, 1.0f, 0.1f, 100.0f));
+    srand(29);
+    const int count = 60;
+    for (int i = 0; i < count; i++)
+    {
+        DrawPacket packet = packetAt(i % 5 == 0 ? RenderTranslucent : RenderOpaque, textures[rand() % 3], vaos[rand() % 2]);
+        packet.program = &programs[rand() % 2];
+        packet.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.0f - rand() % 50));
+        packet.draw = recordDraw;
+        packet.object = reinterpret_cast<void *>(static_cast<size_t>(i));
+        queue.submit(packet);
+    }
+
+    drawn.clear();
+    queue.flush();
+    CHECK(drawn.size() == count);
+    CHECK(queue.sortedStats().draws == count && queue.unsortedStats().draws == count);
+    CHECK(queue.sortedStats().total() < queue.unsortedStats().total() / 2);
+
+    // Each packet ran with its own state bound
+    size_t firstTranslucent = drawn.size();
+    for (size_t i = 0; i < drawn.size(); i++)
+    {
+        if (drawn[i].id % 5 == 0 && firstTranslucent == drawn.size())
+            firstTranslucent = i;
+        CHECK(drawn[i].blending == (drawn[i].id % 5 == 0));
+        CHECK(drawn[i].program != 0 && drawn[i].texture != 0 && drawn[i].vao != 0);
+    }
+    CHECK(firstTranslucent == drawn.size() - count / 5);
+
+    // Opaque draws change program once, and go front to back within the same state
+    int programChanges = 0;
+    for (size_t i = 1; i < firstTranslucent; i++)
+    {
+        programChanges += drawn[i].program != drawn[i - 1].program ? 1 : 0;
+        if (drawn[i].program == drawn[i - 1].program && drawn[i].texture == drawn[i - 1].texture &&
+            drawn[i].vao == drawn[i - 1].vao)
+            CHECK(drawn[i].depth >= drawn[i - 1].depth);
+    }
+    CHECK(programChanges == 1);
+
+    // Translucent ones go back to front whatever their state
+    for (size_t i = firstTranslucent + 1; i < drawn.size(); i++)
+        CHECK(drawn[i].depth <= drawn[i - 1].depth);
+
+    // State is put back, and the next frame starts empty
+    GLint vao = -1;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+    CHECK(vao == 0 && !glIsEnabled(GL_BLEND));
+    drawn.clear();
+    queue.flush();
+    CHECK(drawn.empty());
+
+    glDeleteVertexArrays(2, vaos);
+    glDeleteTextures(3, textures);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    testSortKeys();
+
+    if (!createTestContext())
+        return testFailures > 0 ? 1 : testSkipped;
+    testFlush();
+    destroyTestContext();
+    return testResult("test_render_queue");
+}
@@ -0,0 +1,173 @@
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "shader_program.hpp"
+#include "frame_uniforms.hpp"
+
+static const char *vertexSource =
+    "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout(std140) uniform FrameData { float time; float deltaTime; vec2 viewportSize; };\n"
+    "uniform mat4 model;\n"
+    "uniform vec3 offsets[2];\n"
+    "uniform float scale;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = model * vec4(aPos * scale + offsets[0] + offsets[1], 1.0) + vec4(time);\n"
+    "}\n";
+
+static const char *fragmentSource =
+    "#version 330 core\n"
+    "layout(std140) uniform LightData { vec4 pointLightPosition; vec4 pointLightColor;\n"
+    "                                   vec4 dirLightDirection; vec4 dirLightColor; vec4 ambientColor; };\n"
+    "uniform sampler2D first;\n"
+    "uniform sampler2D second;\n"
+    "uniform vec4 tint;\n"
+    "uniform int mode;\n"
+    "out vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "    color = texture(first, vec2(0.5)) + texture(second, vec2(0.5)) + tint * float(mode) + ambientColor;\n"
+    "}\n";
+
+static const UniformId uniformModel = uniformId("model");
+static const UniformId uniformOffsets = uniformId("offsets");
+static const UniformId uniformScale = uniformId("scale");
+static const UniformId uniformTint = uniformId("tint");
+static const UniformId uniformMode = uniformId("mode");
+static const UniformId uniformMissing = uniformId("missing");
+
+// Names hash to 32-bit FNV-1a at compile time
+static void testUniformId()
+{
+    static_assert(uniformId("") == 2166136261u, "empty name hashes to the offset basis");
+    static_assert(uniformId("a") == 0xe40c292cu, "uniformId must be FNV-1a");
+    CHECK(uniformId("model") != uniformId("Model"));
+}
+
+static GLint blockBinding(GLuint program, const char *name)
+{
+    GLuint block = glGetUniformBlockIndex(program, name);
+    GLint binding = -1;
+    if (block != GL_INVALID_INDEX)
+        glGetActiveUniformBlockiv(program, block, GL_UNIFORM_BLOCK_BINDING, &binding);
+    return binding;
+}
+
+// Active uniforms are reflected, arrays under their own name, and shared blocks bound
+static void testReflection()
+{
+    ShaderProgram program;
+    CHECK(program.compile(vertexSource, fragmentSource));
+    CHECK(program.id() != 0);
+
+    CHECK(program.has(uniformModel) && program.has(uniformScale) && program.has(uniformTint));
+    CHECK(program.has(uniformOffsets));
+    CHECK(!program.has(uniformId("offsets[0]")));
+    CHECK(!program.has(uniformId("time"))); // In a block, so it has no location
+    CHECK(!program.has(uniformMissing) && program.location(uniformMissing) == -1);
+    CHECK(program.location(uniformScale) == glGetUniformLocation(program.id(), "scale"));
+    CHECK(program.samplerCount() == 2);
+
+    CHECK(blockBinding(program.id(), "FrameData") == FrameBlockBinding);
+    CHECK(blockBinding(program.id(), "LightData") == LightBlockBinding);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+// Setters upload to the program in use, and skip values it already has
+static void testSetters()
+{
+    ShaderProgram program;
+    CHECK(program.compile(vertexSource, fragmentSource));
+    program.use();
+    GLuint id = program.id();
+
+    GLfloat value = 0.0f;
+    program.setFloat(uniformScale, 2.0f);
+    glGetUniformfv(id, program.location(uniformScale), &value);
+    CHECK(value == 2.0f);
+
+    // Changed behind its back, so a setter that uploaded again would restore it
+    glUniform1f(program.location(uniformScale), 5.0f);
+    program.setFloat(uniformScale, 2.0f);
+    glGetUniformfv(id, program.location(uniformScale), &value);
+    CHECK(value == 5.0f);
+    program.setFloat(uniformScale, 3.0f);
+    glGetUniformfv(id, program.location(uniformScale), &value);
+    CHECK(value == 3.0f);
+
+    // Arrays are set from their first element
+    GLfloat offset[3] = { 0.0f, 0.0f, 0.0f };
+    program.setVec3(uniformOffsets, glm::vec3(1.0f, 2.0f, 3.0f));
+    glGetUniformfv(id, program.location(uniformOffsets), offset);
+    CHECK(offset[0] == 1.0f && offset[1] == 2.0f && offset[2] == 3.0f);
+
+    GLfloat tint[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    program.setVec4(uniformTint, glm::vec4(0.25f, 0.5f, 0.75f, 1.0f));
+    glGetUniformfv(id, program.location(uniformTint), tint);
+    CHECK(tint[0] == 0.25f && tint[1] == 0.5f && tint[2] == 0.75f && tint[3] == 1.0f);
+
+    GLfloat model[16] = { 0.0f };
+    glm::mat4 translation(1.0f);
+    translation[3] = glm::vec4(4.0f, 5.0f, 6.0f, 1.0f);
+    program.setMat4(uniformModel, translation);
+    glGetUniformfv(id, program.location(uniformModel), model);
+    CHECK(model[0] == 1.0f && model[12] == 4.0f && model[13] == 5.0f && model[14] == 6.0f);
+
+    GLint mode = 0;
+    program.setInt(uniformMode, 7);
+    glGetUniformiv(id, program.location(uniformMode), &mode);
+    CHECK(mode == 7);
+
+    // Uniforms the program doesn't have are ignored
+    program.setFloat(uniformMissing, 1.0f);
+    CHECK(glGetError() == GL_NO_ERROR);
+    glUseProgram(0);
+}
+
+// Sources that don't compile leave no program, and no uniforms
+static void testFailedCompile()
+{
+    ShaderProgram program;
+    CHECK(program.compile(vertexSource, fragmentSource));
+    CHECK(!program.compile(vertexSource, "#version 330 core\nvoid main() { undeclared = 1; }\n"));
+    CHECK(program.id() == 0 && !program.has(uniformScale) && program.samplerCount() == 0);
+    program.setFloat(uniformScale, 1.0f);
+
+    CHECK(!program.load("missing.vert", "missing.frag"));
+    CHECK(program.id() == 0);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+// Variants of the same files differ in their uniforms
+static void testLoadVariants()
+{
+    std::string vertexPath = sourcePath("shaders/simple.vert"), fragmentPath = sourcePath("shaders/simple.frag");
+    ShaderProgram plain, instanced;
+    CHECK(plain.load(vertexPath.c_str(), fragmentPath.c_str()));
+    CHECK(instanced.load(vertexPath.c_str(), fragmentPath.c_str(), "#define INSTANCED"));
+    CHECK(plain.has(uniformModel) && !instanced.has(uniformModel));
+    CHECK(plain.has(uniformId("texture_diffuse")) && instanced.has(uniformId("texture_diffuse")));
+    CHECK(blockBinding(plain.id(), "ViewData") == ViewBlockBinding);
+    CHECK(blockBinding(instanced.id(), "LightData") == LightBlockBinding);
+
+    plain.destroy();
+    CHECK(plain.id() == 0 && !plain.has(uniformModel));
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    testUniformId();
+
+    if (!createTestContext())
+        return testFailures > 0 ? 1 : testSkipped;
+    testReflection();
+    testSetters();
+    testFailedCompile();
+    testLoadVariants();
+    destroyTestContext();
+    return testResult("test_shader_program");
+}
@@ -0,0 +1,148 @@
+#include <vector>
+#include <stdlib.h>
+
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "tangent_space.hpp"
+
+static glm::vec3 randomDirection()
+{
+    glm::vec3 v;
+    do
+        v = glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX * 2.0f - 1.0f;
+    while (glm::length(v) < 0.1f || glm::length(v) > 1.0f);
+    return glm::normalize(v);
+}
+
+static void checkRoundTrip(const glm::vec3 &normal, const glm::vec4 &tangent, float &worstError, int &wrongSigns)
+{
+    glm::vec3 unpackedNormal;
+    glm::vec4 unpackedTangent;
+    unpackQTangent(packQTangent(normal, tangent), unpackedNormal, unpackedTangent);
+    worstError = glm::max(worstError, glm::length(unpackedNormal - normal));
+    worstError = glm::max(worstError, glm::length(glm::vec3(unpackedTangent) - glm::vec3(tangent)));
+    wrongSigns += unpackedTangent.w == tangent.w ? 0 : 1;
+}
+
+// Frames come back within snorm16 precision, with their bitangent sign
+static void testQTangentRoundTrip()
+{
+    srand(3);
+    float worstError = 0.0f;
+    int wrongSigns = 0;
+    for (int i = 0; i < 2000; i++)
+    {
+        glm::vec3 normal = randomDirection();
+        glm::vec3 tangent = glm::normalize(glm::cross(normal, randomDirection()));
+        checkRoundTrip(normal, glm::vec4(tangent, i % 2 ? -1.0f : 1.0f), worstError, wrongSigns);
+    }
+
+    // Half turns, whose quaternions have a w of zero that would lose the sign
+    checkRoundTrip(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec4(1.0f, 0.0f, 0.0f, -1.0f), worstError, wrongSigns);
+    checkRoundTrip(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), worstError, wrongSigns);
+    checkRoundTrip(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec4(-1.0f, 0.0f, 0.0f, -1.0f), worstError, wrongSigns);
+
+    CHECK(worstError < 1e-3f);
+    CHECK(wrongSigns == 0);
+}
+
+// Two triangles sharing an edge, the second with its u mirrored across it
+static void mirroredQuad(std::vector<unsigned int> &indices, std::vector<glm::vec3> &positions,
+                         std::vector<glm::vec2> &uvs, std::vector<glm::vec3> &normals)
+{
+    const glm::vec3 p[4] = { glm::vec3(0, 0, 0), glm::vec3(1, 0, 0), glm::vec3(1, 1, 0), glm::vec3(2, 1, 0) };
+    const glm::vec2 t[4] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1) };
+    positions.assign(p, p + 4);
+    uvs.assign(t, t + 4);
+    normals.assign(4, glm::vec3(0.0f, 0.0f, 1.0f));
+    const unsigned int i[6] = { 0, 1, 2, 1, 3, 2 };
+    indices.assign(i, i + 6);
+}
+
+static void testGenerateTangents()
+{
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec4> tangents;
+    mirroredQuad(indices, positions, uvs, normals);
+    const std::vector<glm::vec3> originalPositions = positions;
+    const std::vector<unsigned int> originalIndices = indices;
+    generateTangents(indices, positions, uvs, normals, tangents, 1);
+
+    // The shared edge is split, the triangles keep their corners
+    CHECK(positions.size() == 6);
+    CHECK(uvs.size() == positions.size() && normals.size() == positions.size() && tangents.size() == positions.size());
+    CHECK(indices.size() == 6);
+    for (size_t i = 0; i < indices.size() && i < originalIndices.size(); i++)
+        CHECK(positions[indices[i]] == originalPositions[originalIndices[i]]);
+
+    // u grows along +x on the first triangle and -x on the mirrored one, v along +y on both
+    for (size_t i = 0; i < 3 && i < indices.size(); i++)
+    {
+        const glm::vec4 &first = tangents[indices[i]], &second = tangents[indices[i + 3]];
+        CHECK_NEAR(first.x, 1.0, 1e-4);
+        CHECK(first.w == 1.0f);
+        CHECK_NEAR(second.x, -1.0, 1e-4);
+        CHECK(second.w == -1.0f);
+        CHECK_NEAR(glm::dot(glm::vec3(first), normals[indices[i]]), 0.0, 1e-5);
+    }
+}
+
+// A curved surface gets unit tangents orthogonal to its normals, the same on any thread count
+static void testCurvedSurface()
+{
+    const int size = 40;
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> uvs;
+    for (int y = 0; y <= size; y++)
+    {
+        for (int x = 0; x <= size; x++)
+        {
+            float angle = 3.0f * x / size;
+            positions.push_back(glm::vec3(sinf(angle), y / (float)size, cosf(angle)));
+            normals.push_back(glm::vec3(sinf(angle), 0.0f, cosf(angle)));
+            uvs.push_back(glm::vec2(x / (float)size, y / (float)size));
+        }
+    }
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 2, d = a + size + 1;
+            unsigned int quad[6] = { a, b, c, a, c, d };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    std::vector<unsigned int> serialIndices = indices, parallelIndices = indices;
+    std::vector<glm::vec3> serialPositions = positions, parallelPositions = positions;
+    std::vector<glm::vec3> serialNormals = normals, parallelNormals = normals;
+    std::vector<glm::vec2> serialUVs = uvs, parallelUVs = uvs;
+    std::vector<glm::vec4> serial, parallel;
+    generateTangents(serialIndices, serialPositions, serialUVs, serialNormals, serial, 1);
+    generateTangents(parallelIndices, parallelPositions, parallelUVs, parallelNormals, parallel, 4);
+    CHECK(serial == parallel);
+    CHECK(serialIndices == parallelIndices);
+
+    float worstLength = 0.0f, worstDot = 0.0f;
+    for (size_t i = 0; i < serial.size(); i++)
+    {
+        glm::vec3 tangent(serial[i]);
+        worstLength = glm::max(worstLength, fabsf(glm::length(tangent) - 1.0f));
+        worstDot = glm::max(worstDot, fabsf(glm::dot(tangent, serialNormals[i])));
+        CHECK(serial[i].w == 1.0f);
+    }
+    CHECK(worstLength < 1e-4f);
+    CHECK(worstDot < 1e-4f);
+}
+
+int main()
+{
+    testQTangentRoundTrip();
+    testGenerateTangents();
+    testCurvedSurface();
+    return testResult("test_tangent_space");
+}
@@ -0,0 +1,207 @@
+#include <vector>
+#include <string>
+#include <set>
+#include <thread>
+
+#include <GL/glew.h>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "texture.hpp"
+#include "asset_manager.hpp"
+
+// Every load parameter is part of the key
+static void testTextureKeys()
+{
+    std::vector<TextureParams> variants(8);
+    variants[1].flip = false;
+    variants[2].srgb = true;
+    variants[3].wrap = GL_CLAMP_TO_EDGE;
+    variants[4].filter = GL_NEAREST;
+    variants[5].compression = TextureBC1;
+    variants[6].mipFilter = MipKaiser;
+    variants[7].alphaCutoff = 0.5f;
+
+    std::set<std::string> keys;
+    for (size_t i = 0; i < variants.size(); i++)
+        keys.insert(AssetManager::textureKey("/textures/wood.png", variants[i]));
+    CHECK(keys.size() == variants.size());
+    CHECK(AssetManager::textureKey("/textures/wood.png", variants[2]) ==
+          AssetManager::textureKey("/textures/wood.png", variants[2]));
+    CHECK(AssetManager::textureKey("/textures/wood.png", variants[0]) !=
+          AssetManager::textureKey("/textures/oak.png", variants[0]));
+}
+
+// Resident memory counts the mip levels, with RGB padded to four bytes
+static void testTextureBytes()
+{
+    TextureParams mipmapped, linear;
+    linear.filter = GL_LINEAR;
+    CHECK(textureBytes(4, 4, 3, mipmapped) == (16 + 4 + 1) * 4);
+    CHECK(textureBytes(4, 4, 3, linear) == 16 * 4);
+    CHECK(textureBytes(5, 3, 4, mipmapped) == (15 + 2 + 1) * 4);
+    CHECK(textureBytes(8, 1, 1, mipmapped) == 8 + 4 + 2 + 1);
+}
+
+// Flipping puts the bottom row first, as OpenGL expects
+static void testDecodeFlip()
+{
+    const unsigned char pixels[2 * 3] = { 255, 0, 0, 0, 0, 255 }; // Red above blue
+    CHECK(writeTestTga("flip.tga", 1, 2, 3, pixels));
+
+    Image image;
+    CHECK(decodeImage("flip.tga", false, image));
+    CHECK(image.width == 1 && image.height == 2 && image.channels == 3);
+    if (image.pixels)
+        CHECK(image.pixels[0] == 255 && image.pixels[5] == 255);
+    freeImage(image);
+
+    CHECK(decodeImage("flip.tga", true, image));
+    if (image.pixels)
+        CHECK(image.pixels[2] == 255 && image.pixels[3] == 255);
+    freeImage(image);
+}
+
+static GLint textureLevelParameter(GLuint id, GLint level, GLenum name)
+{
+    GLint value = 0;
+    glBindTexture(GL_TEXTURE_2D, id);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, name, &value);
+    return value;
+}
+
+// Uploads follow the parameters: sRGB formats, mipmaps only for mipmap filters
+static void testUpload()
+{
+    unsigned char pixels[4 * 4 * 3];
+    for (int i = 0; i < 4 * 4 * 3; i++)
+        pixels[i] = static_cast<unsigned char>(i * 3);
+    Image image = { 4, 4, 3, pixels };
+
+    TextureParams srgb;
+    srgb.srgb = true;
+    GLuint id = uploadTexture(image, srgb);
+    CHECK(textureLevelParameter(id, 0, GL_TEXTURE_INTERNAL_FORMAT) == GL_SRGB8);
+    CHECK(textureLevelParameter(id, 2, GL_TEXTURE_WIDTH) == 1);
+    GLint maxLevel = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    CHECK(maxLevel == 2);
+    glDeleteTextures(1, &id);
+
+    TextureParams linear;
+    linear.filter = GL_LINEAR;
+    linear.wrap = GL_CLAMP_TO_EDGE;
+    id = uploadTexture(image, linear);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    CHECK(maxLevel == 0);
+    GLint wrap = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrap);
+    CHECK(wrap == GL_CLAMP_TO_EDGE);
+    glDeleteTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+// Batches decode in parallel, each image landing at its request's index
+static void testDecodeBatch()
+{
+    std::vector<ImageRequest> requests;
+    for (int i = 0; i < 12; i++)
+    {
+        char path[32];
+        snprintf(path, sizeof(path), "batch%d.tga", i);
+        std::vector<unsigned char> pixels((i + 1) * 2 * 3, static_cast<unsigned char>(i * 20));
+        CHECK(writeTestTga(path, i + 1, 2, 3, pixels.data()));
+        ImageRequest request;
+        request.path = i == 5 ? "missing.tga" : path;
+        request.flip = i % 2 == 0;
+        requests.push_back(request);
+    }
+
+    std::vector<Image> images;
+    CHECK(!decodeImages(requests, images, 4)); // One is missing
+    CHECK(images.size() == requests.size());
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        if (i == 5)
+        {
+            CHECK(images[i].pixels == NULL);
+            continue;
+        }
+        CHECK(images[i].pixels != NULL);
+        CHECK(images[i].width == static_cast<int>(i) + 1 && images[i].height == 2);
+        if (images[i].pixels)
+            CHECK(images[i].pixels[0] == i * 20);
+        freeImage(images[i]);
+    }
+
+    requests[5].path = "batch5.tga";
+    CHECK(decodeImages(requests, images, 3));
+    for (size_t i = 0; i < images.size(); i++)
+        freeImage(images[i]);
+}
+
+// Batched texture loads return each texture at its request's index
+static void testLoadTextures()
+{
+    AssetManager &assets = AssetManager::instance();
+    TextureHandle single = assets.loadTexture("batch3.tga");
+
+    std::vector<TextureRequest> requests(4);
+    requests[0].path = "batch1.tga";
+    requests[1].path = "missing.tga";
+    requests[2].path = "batch3.tga"; // Already loaded, shared
+    requests[3].path = "batch1.tga";
+    requests[3].params.srgb = true;
+    std::vector<TextureHandle> textures = assets.loadTextures(requests);
+    CHECK(textures.size() == 4);
+    if (textures.size() == 4)
+    {
+        CHECK(textures[0] && textures[3] && textures[0] != textures[3]);
+        CHECK(!textures[1]);
+        CHECK(textures[2] == single);
+        CHECK(textures[0] == assets.loadTexture("batch1.tga"));
+    }
+    textures.clear();
+    single.reset();
+    assets.collectGarbage();
+}
+
+// Reporting while another thread drops the last handles must not deadlock
+static void testReportWhileReleasing()
+{
+    AssetManager &assets = AssetManager::instance();
+    std::vector<TextureHandle> handles;
+    for (int i = 0; i < 256; i++)
+        handles.push_back(assets.solidTexture(static_cast<unsigned char>(i), 7, 9));
+    CHECK(assets.textureCount() == 256);
+
+    std::thread releaser([&handles]()
+    {
+        while (!handles.empty())
+            handles.pop_back();
+    });
+    for (int i = 0; i < 2000; i++)
+        assets.residentTextureBytes();
+    releaser.join();
+
+    assets.collectGarbage();
+    CHECK(assets.textureCount() == 0);
+    CHECK(assets.residentTextureBytes() == 0);
+}
+
+int main()
+{
+    testTextureKeys();
+    testTextureBytes();
+    testDecodeFlip();
+    testDecodeBatch();
+
+    if (!createTestContext())
+        return testFailures > 0 ? 1 : testSkipped;
+    testUpload();
+    testLoadTextures();
+    testReportWhileReleasing();
+    destroyTestContext();
+    return testResult("test_texture");
+}
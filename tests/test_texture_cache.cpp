@@ -0,0 +1,141 @@
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+
+#include <GL/glew.h>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "texture_cache.hpp"
+#include "texture.hpp"
+
+static std::vector<MipLevel> testLevels(int width, int height, int channels)
+{
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+    srand(19);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = static_cast<uint8_t>(rand());
+    std::vector<MipLevel> levels;
+    generateMips(pixels.data(), width, height, channels, MipOptions(), levels, 1);
+    return levels;
+}
+
+// Uncompressed levels come back byte for byte
+static void testRoundTrip()
+{
+    std::vector<MipLevel> levels = testLevels(12, 7, 3);
+    CompressedImage none;
+    none.compression = TextureUncompressed;
+    CHECK(saveTextureCache("plain.tex", 100, 200, 300, TextureCacheSrgb | TextureCacheFlipped, levels, none));
+
+    TextureCache cache;
+    CHECK(loadTextureCache("plain.tex", 100, 200, 300, cache));
+    CHECK(cache.width == 12 && cache.height == 7 && cache.channels == 3);
+    CHECK(cache.compression == TextureUncompressed);
+    CHECK(cache.flags == (TextureCacheSrgb | TextureCacheFlipped));
+    CHECK(cache.levels.size() == levels.size());
+    for (size_t l = 0; l < cache.levels.size() && l < levels.size(); l++)
+    {
+        const TextureCacheLevel &level = cache.levels[l];
+        CHECK(level.width == levels[l].width && level.height == levels[l].height);
+        CHECK(level.size == levels[l].pixels.size());
+        CHECK(memcmp(level.data, levels[l].pixels.data(), level.size) == 0);
+    }
+    closeTextureCache(cache);
+    CHECK(cache.levels.empty());
+}
+
+// Compressed mips are stored instead of the pixels when there are any
+static void testCompressed()
+{
+    std::vector<MipLevel> levels = testLevels(16, 8, 4);
+    CompressedImage compressed;
+    compressImage(levels, TextureBC3, compressed, 1);
+    CHECK(saveTextureCache("bc3.tex", 1, 2, 3, 0, levels, compressed));
+
+    TextureCache cache;
+    CHECK(loadTextureCache("bc3.tex", 3, cache));
+    CHECK(cache.compression == TextureBC3 && cache.channels == 4);
+    CHECK(cache.levels.size() == compressed.mips.size());
+    for (size_t l = 0; l < cache.levels.size() && l < compressed.mips.size(); l++)
+    {
+        CHECK(cache.levels[l].size == compressed.mips[l].blocks.size());
+        CHECK(memcmp(cache.levels[l].data, compressed.mips[l].blocks.data(), cache.levels[l].size) == 0);
+    }
+    closeTextureCache(cache);
+}
+
+// Another source or other settings make the cache stale, damage makes it corrupt
+static void testRejected()
+{
+    std::vector<MipLevel> levels = testLevels(8, 8, 4);
+    CompressedImage none;
+    none.compression = TextureUncompressed;
+    CHECK(saveTextureCache("stale.tex", 10, 20, 30, 0, levels, none));
+
+    TextureCache cache;
+    CHECK(!loadTextureCache("stale.tex", 11, 20, 30, cache));
+    CHECK(!loadTextureCache("stale.tex", 10, 21, 30, cache));
+    CHECK(!loadTextureCache("stale.tex", 10, 20, 31, cache));
+    CHECK(!loadTextureCache("stale.tex", 31, cache));
+    CHECK(!loadTextureCache("missing.tex", 30, cache));
+
+    std::string data = readTestFile("stale.tex");
+    CHECK(writeTestFile("truncated.tex", data.substr(0, data.size() - 1)));
+    CHECK(!loadTextureCache("truncated.tex", 30, cache));
+    CHECK(writeTestFile("truncated.tex", data.substr(0, 20)));
+    CHECK(!loadTextureCache("truncated.tex", 30, cache));
+
+    std::string version = data;
+    version[4] ^= 1;
+    CHECK(writeTestFile("version.tex", version));
+    CHECK(!loadTextureCache("version.tex", 30, cache));
+
+    // The cook settings are in the name, so differently cooked files live side by side
+    CHECK(textureCachePath("textures/ball.png", 0x1a2b3c4dull) != textureCachePath("textures/ball.png", 0x1a2b3c4eull));
+    CHECK(textureCachePath("textures/ball.png", 0x1a2b3c4dull).find("textures/ball.png.") == 0);
+}
+
+// The mapped levels upload as they are
+static void testUpload()
+{
+    std::vector<MipLevel> levels = testLevels(8, 4, 4);
+    CompressedImage none;
+    none.compression = TextureUncompressed;
+    CHECK(saveTextureCache("upload.tex", 1, 2, 3, 0, levels, none));
+    TextureCache cache;
+    CHECK(loadTextureCache("upload.tex", 3, cache));
+
+    GLuint id = uploadTextureCache(cache, TextureParams());
+    GLint immutable = GL_FALSE;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+    CHECK(immutable == (GLEW_VERSION_4_2 ? GL_TRUE : GL_FALSE));
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        std::vector<uint8_t> pixels(levels[l].pixels.size());
+        glGetTexImage(GL_TEXTURE_2D, static_cast<GLint>(l), GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        CHECK(pixels == levels[l].pixels);
+    }
+    GLint maxLevel = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    CHECK(maxLevel == static_cast<GLint>(levels.size()) - 1);
+
+    glDeleteTextures(1, &id);
+    closeTextureCache(cache);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    testRoundTrip();
+    testCompressed();
+    testRejected();
+
+    if (!createTestContext())
+        return testFailures > 0 ? 1 : testSkipped;
+    testUpload();
+    destroyTestContext();
+    return testResult("test_texture_cache");
+}
@@ -0,0 +1,198 @@
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "texture_compression.hpp"
+#include "texture.hpp"
+
+// A smooth image with some noise, like a photo texture
+static MipLevel testImage(int width, int height, int channels)
+{
+    MipLevel level;
+    level.width = width;
+    level.height = height;
+    level.channels = channels;
+    srand(11);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int base[4] = { x * 255 / width, y * 255 / height, (x + y) * 127 / (width + height), 255 - x * 200 / width };
+            for (int c = 0; c < channels; c++)
+                level.pixels.push_back(static_cast<uint8_t>(glm::clamp(base[c] + rand() % 7 - 3, 0, 255)));
+        }
+    }
+    return level;
+}
+
+static int largestDifference(const uint8_t *a, const uint8_t *b, size_t count)
+{
+    int largest = 0;
+    for (size_t i = 0; i < count; i++)
+        largest = glm::max(largest, abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+    return largest;
+}
+
+// Blocks of one colour come back exactly, gradients within the palette's spacing
+static void testBlocks()
+{
+    uint8_t texels[16][4], decoded[16][4], block[8];
+    for (int i = 0; i < 16; i++)
+    {
+        texels[i][0] = 255;
+        texels[i][1] = 0;
+        texels[i][2] = 255;
+        texels[i][3] = 255;
+    }
+    encodeBC1Block(texels, block);
+    decodeBC1Block(block, decoded);
+    CHECK(memcmp(texels, decoded, sizeof(texels)) == 0);
+
+    for (int i = 0; i < 16; i++)
+    {
+        texels[i][0] = static_cast<uint8_t>(i * 16);
+        texels[i][1] = static_cast<uint8_t>(255 - i * 16);
+        texels[i][2] = 64;
+    }
+    encodeBC1Block(texels, block);
+    decodeBC1Block(block, decoded);
+    int largest = 0;
+    for (int i = 0; i < 16; i++)
+        largest = glm::max(largest, largestDifference(texels[i], decoded[i], 3));
+    CHECK(largest <= 48);
+
+    uint8_t values[16], decodedValues[16];
+    memset(values, 77, sizeof(values));
+    encodeBC4Block(values, block);
+    decodeBC4Block(block, decodedValues);
+    CHECK(memcmp(values, decodedValues, sizeof(values)) == 0);
+
+    for (int i = 0; i < 16; i++)
+        values[i] = static_cast<uint8_t>(i * 17);
+    encodeBC4Block(values, block);
+    decodeBC4Block(block, decodedValues);
+    CHECK(decodedValues[0] == 0 && decodedValues[15] == 255);
+    CHECK(largestDifference(values, decodedValues, 16) <= 19);
+}
+
+// Every level is compressed, partial blocks included, the same on any thread count
+static void testCompressImage()
+{
+    std::vector<MipLevel> levels;
+    for (int width = 66, height = 38; width > 0; width /= 2, height = glm::max(height / 2, 1))
+        levels.push_back(testImage(width, height, 4));
+
+    const TextureCompression formats[3] = { TextureBC1, TextureBC3, TextureBC5 };
+    for (int f = 0; f < 3; f++)
+    {
+        CompressedImage serial, parallel;
+        compressImage(levels, formats[f], serial, 1);
+        compressImage(levels, formats[f], parallel, 4);
+        CHECK(serial.compression == formats[f]);
+        CHECK(serial.mips.size() == levels.size() && levels.size() == 7);
+        for (size_t l = 0; l < serial.mips.size() && l < parallel.mips.size(); l++)
+        {
+            size_t blocks = static_cast<size_t>((levels[l].width + 3) / 4) * ((levels[l].height + 3) / 4);
+            CHECK(serial.mips[l].width == levels[l].width && serial.mips[l].height == levels[l].height);
+            CHECK(serial.mips[l].blocks.size() == blocks * compressedBlockBytes(formats[f]));
+            CHECK(serial.mips[l].blocks == parallel.mips[l].blocks);
+        }
+        CHECK(serial.psnr > 35.0);
+    }
+    CHECK(compressedBlockBytes(TextureBC1) == 8);
+    CHECK(compressedBlockBytes(TextureBC3) == 16);
+    CHECK(compressedBlockBytes(TextureBC5) == 16);
+}
+
+// Decode a level the way the blocks are laid out: BC1 colour, or BC5 red and green
+static std::vector<uint8_t> decodeLevel(const CompressedMip &mip, TextureCompression compression)
+{
+    std::vector<uint8_t> rgba(static_cast<size_t>(mip.width) * mip.height * 4);
+    const int blocksX = (mip.width + 3) / 4, blocksY = (mip.height + 3) / 4;
+    const size_t blockBytes = compressedBlockBytes(compression);
+    for (int by = 0; by < blocksY; by++)
+    {
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            const uint8_t *block = &mip.blocks[(by * blocksX + bx) * blockBytes];
+            uint8_t texels[16][4];
+            if (compression == TextureBC1)
+                decodeBC1Block(block, texels);
+            else
+            {
+                uint8_t red[16], green[16];
+                decodeBC4Block(block, red);
+                decodeBC4Block(block + 8, green);
+                for (int i = 0; i < 16; i++)
+                {
+                    texels[i][0] = red[i];
+                    texels[i][1] = green[i];
+                    texels[i][2] = 0;
+                    texels[i][3] = 255;
+                }
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x < mip.width && y < mip.height)
+                    memcpy(&rgba[(y * mip.width + x) * 4], texels[i], 4);
+            }
+        }
+    }
+    return rgba;
+}
+
+// The GPU decodes the blocks as the CPU decoder does, so the layout is GL's
+static void testUpload()
+{
+    const TextureCompression formats[2] = { TextureBC1, TextureBC5 };
+    for (int f = 0; f < 2; f++)
+    {
+        if (formats[f] == TextureBC1 && !hasExtension("GL_EXT_texture_compression_s3tc"))
+        {
+            printf("No S3TC, skipping the BC1 upload.\n");
+            continue;
+        }
+
+        std::vector<MipLevel> levels(1, testImage(12, 8, 4));
+        CompressedImage image;
+        compressImage(levels, formats[f], image, 1);
+
+        TextureParams params;
+        params.filter = GL_NEAREST;
+        params.compression = formats[f];
+        GLuint id = uploadCompressedTexture(image, params);
+        GLint compressed = 0, size = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+        CHECK(compressed == GL_TRUE);
+        CHECK(static_cast<size_t>(size) == image.mips[0].blocks.size());
+        CHECK(compressedTextureBytes(image) == image.mips[0].blocks.size());
+
+        std::vector<uint8_t> gpu(12 * 8 * 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, gpu.data());
+        std::vector<uint8_t> cpu = decodeLevel(image.mips[0], formats[f]);
+        CHECK(largestDifference(gpu.data(), cpu.data(), gpu.size()) <= 2);
+
+        glDeleteTextures(1, &id);
+    }
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    testBlocks();
+    testCompressImage();
+
+    if (!createTestContext())
+        return testFailures > 0 ? 1 : testSkipped;
+    testUpload();
+    destroyTestContext();
+    return testResult("test_texture_compression");
+}
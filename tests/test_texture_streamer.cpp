@@ -0,0 +1,113 @@
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "texture_streamer.hpp"
+#include "asset_manager.hpp"
+
+static GLint baseLevel(GLuint id)
+{
+    GLint level = -1;
+    glBindTexture(GL_TEXTURE_2D, id);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &level);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return level;
+}
+
+static TextureResidency residencyOf(const TextureHandle &texture)
+{
+    std::vector<TextureResidency> all = TextureStreamer::instance().residency();
+    for (size_t i = 0; i < all.size(); i++)
+        if (all[i].key == texture->key)
+            return all[i];
+    TextureResidency none = TextureResidency();
+    return none;
+}
+
+// Textures start with their coarse levels, stream in finer ones when drawn
+// closer up, and give them back when over the budget
+static void testStreaming()
+{
+    std::vector<unsigned char> pixels(256 * 256 * 3);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = static_cast<unsigned char>(i * 7);
+    CHECK(writeTestTga("streamed.tga", 256, 256, 3, pixels.data()));
+    CHECK(writeTestTga("other.tga", 256, 256, 3, pixels.data() + 3));
+
+    AssetManager &assets = AssetManager::instance();
+    TextureStreamer &streamer = TextureStreamer::instance();
+    streamer.setMinimumSize(64);
+    TextureHandle placeholder = assets.solidTexture(0, 0, 0);
+    TextureHandle texture = streamer.load("streamed.tga", placeholder);
+    TextureHandle other = streamer.load("other.tga", placeholder);
+    CHECK(streamer.load("./streamed.tga", placeholder) == texture);
+    CHECK(texture->id == placeholder->id);
+
+    for (int frame = 0; frame < 1000 && assets.pendingLoads() > 0; frame++)
+    {
+        assets.finishLoads(2.0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    CHECK(texture->id != placeholder->id);
+
+    // The size of the full texture, whether it was cooked now or mapped from the cache
+    TextureResidency residency = residencyOf(texture);
+    CHECK(residency.width == 256 && residency.height == 256);
+    CHECK(residency.levelCount == 9);
+    CHECK(residency.residentLevel == 2); // 64x64 and smaller
+    CHECK(baseLevel(texture->id) == 2);
+    const size_t coarseBytes = streamer.residentBytes();
+
+    // Up close the full level is wanted, and streamed in within the upload budget
+    streamer.request(texture, 300.0f);
+    streamer.update();
+    residency = residencyOf(texture);
+    CHECK(residency.wantedLevel == 0 && residency.residentLevel == 0);
+    CHECK(baseLevel(texture->id) == 0);
+    CHECK(streamer.residentBytes() > coarseBytes);
+    CHECK(residency.residentBytes == residency.fullBytes);
+
+    // Further away the finest level is dropped, a frame without requests keeps the rest
+    streamer.request(texture, 100.0f);
+    streamer.update();
+    residency = residencyOf(texture);
+    CHECK(residency.wantedLevel == 1 && residency.residentLevel == 1);
+    streamer.update();
+    CHECK(residencyOf(texture).residentLevel == 1);
+    streamer.request(texture, 300.0f);
+    streamer.update();
+
+    // Over the budget the least recently used texture goes back to its coarse levels
+    streamer.request(other, 300.0f);
+    streamer.update();
+    streamer.setBudget(residency.fullBytes + coarseBytes);
+    streamer.request(other, 300.0f);
+    streamer.update();
+    CHECK(residencyOf(other).residentLevel == 0);
+    CHECK(residencyOf(texture).residentLevel == 2);
+    CHECK(streamer.residentBytes() <= streamer.getBudget());
+
+    // Textures nobody else holds are released by the next update
+    texture.reset();
+    other.reset();
+    streamer.update();
+    CHECK(streamer.residency().empty());
+    CHECK(streamer.residentBytes() == 0);
+
+    placeholder.reset();
+    assets.collectGarbage();
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    if (!createTestContext())
+        return testSkipped;
+    testStreaming();
+    destroyTestContext();
+    return testResult("test_texture_streamer");
+}
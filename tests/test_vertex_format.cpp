@@ -0,0 +1,167 @@
+#include <vector>
+#include <stdlib.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "test.hpp"
+#include "gl_context.hpp"
+#include "vertex_format.hpp"
+
+static float randomFloat(float low, float high)
+{
+    return low + (high - low) * (rand() / (float)RAND_MAX);
+}
+
+// Decoding a compact vertex the way the vertex fetch and the shader do
+// gives back the float vertex within the precision of each format
+static void testCompactQuantization()
+{
+    srand(7);
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec4> tangents;
+    for (int i = 0; i < 1000; i++)
+    {
+        positions.push_back(glm::vec3(randomFloat(-3.0f, 5.0f), randomFloat(0.0f, 0.5f), randomFloat(-100.0f, 100.0f)));
+        uvs.push_back(glm::vec2(randomFloat(-2.0f, 2.0f), randomFloat(0.0f, 1.0f)));
+        glm::vec3 normal = glm::normalize(glm::vec3(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), 0.5f));
+        glm::vec3 tangent = glm::normalize(glm::cross(normal, glm::vec3(0.0f, 0.0f, 1.0f)));
+        normals.push_back(normal);
+        tangents.push_back(glm::vec4(tangent, i % 2 ? -1.0f : 1.0f));
+    }
+    const glm::vec3 boundsMin(-3.0f, 0.0f, -100.0f), boundsMax(5.0f, 0.5f, 100.0f);
+
+    std::vector<CompactVertex> compact;
+    packCompactVertices(positions, uvs, normals, tangents, boundsMin, boundsMax, compact);
+    CHECK(compact.size() == positions.size());
+
+    glm::vec3 offset, scale;
+    compactPositionTransform(boundsMin, boundsMax, offset, scale);
+
+    float positionError = 0.0f, uvError = 0.0f, normalError = 0.0f, tangentError = 0.0f;
+    int wrongSigns = 0;
+    for (size_t i = 0; i < compact.size(); i++)
+    {
+        const CompactVertex &vertex = compact[i];
+        glm::vec3 position = offset + scale * glm::vec3(glm::unpackUnorm1x16(vertex.position[0]),
+                                                        glm::unpackUnorm1x16(vertex.position[1]),
+                                                        glm::unpackUnorm1x16(vertex.position[2]));
+        glm::vec3 relative = glm::abs(position - positions[i]) / scale;
+        positionError = glm::max(positionError, glm::max(relative.x, glm::max(relative.y, relative.z)));
+
+        glm::vec2 uv(glm::unpackHalf1x16(vertex.uv[0]), glm::unpackHalf1x16(vertex.uv[1]));
+        uvError = glm::max(uvError, glm::length(uv - uvs[i]));
+
+        glm::vec4 normal = glm::unpackSnorm3x10_1x2(vertex.normal);
+        glm::vec4 tangent = glm::unpackSnorm3x10_1x2(vertex.tangent);
+        normalError = glm::max(normalError, glm::length(glm::vec3(normal) - normals[i]));
+        tangentError = glm::max(tangentError, glm::length(glm::vec3(tangent) - glm::vec3(tangents[i])));
+        wrongSigns += tangent.w == tangents[i].w ? 0 : 1;
+    }
+
+    // Half a unorm16 step of the bounds, a half float step at 2, and 10 bit snorms
+    CHECK(positionError <= 0.5f / 65535.0f + 1e-6f);
+    CHECK(uvError <= 1.0f / 1024.0f);
+    CHECK(normalError <= 2.0f / 511.0f);
+    CHECK(tangentError <= 2.0f / 511.0f);
+    CHECK(wrongSigns == 0);
+}
+
+// Flat bounds and missing streams pack to valid vertices
+static void testDegenerate()
+{
+    std::vector<glm::vec3> positions(3, glm::vec3(1.0f, 2.0f, 3.0f)), normals;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec4> tangents;
+    std::vector<CompactVertex> compact;
+    packCompactVertices(positions, uvs, normals, tangents, positions[0], positions[0], compact);
+    CHECK(compact.size() == 3);
+    if (compact.size() == 3)
+    {
+        CHECK(compact[0].position[0] == 0 && compact[0].position[1] == 0 && compact[0].position[2] == 0);
+        glm::vec4 normal = glm::unpackSnorm3x10_1x2(compact[0].normal);
+        glm::vec4 tangent = glm::unpackSnorm3x10_1x2(compact[0].tangent);
+        CHECK_NEAR(normal.z, 1.0, 1e-3);
+        CHECK_NEAR(tangent.x, 1.0, 1e-3);
+        CHECK(tangent.w == 1.0f);
+    }
+}
+
+// Layouts match the structs they describe
+static void testLayouts()
+{
+    VertexLayout model = VertexFormat<ModelVertex>::layout();
+    CHECK(model.stride == 40 && sizeof(ModelVertex) == 40);
+    CHECK(model.attributes.size() == 4);
+    if (model.attributes.size() == 4)
+        CHECK(model.attributes[3].offset == 32 && model.attributes[3].type == GL_SHORT);
+
+    VertexLayout compact = VertexFormat<CompactVertex>::layout();
+    CHECK(compact.stride == 20 && sizeof(CompactVertex) == 20);
+    CHECK(compact.attributes.size() == 4);
+    if (compact.attributes.size() == 4)
+    {
+        for (GLuint i = 0; i < 4; i++)
+            CHECK(compact.attributes[i].location == i);
+        CHECK(compact.attributes[1].offset == 8 && compact.attributes[1].type == GL_HALF_FLOAT);
+        CHECK(compact.attributes[3].offset == 16 && compact.attributes[3].type == GL_INT_2_10_10_10_REV);
+    }
+}
+
+// A vertex array reads each attribute from the one buffer as the layout says
+static void testVertexArray()
+{
+    std::vector<ModelVertex> vertices(3);
+    const unsigned short indices[3] = { 0, 1, 2 };
+    VertexArray array;
+    createVertexArray(vertices, std::vector<unsigned short>(indices, indices + 3), array);
+    CHECK(array.vao != 0 && array.vertexBuffer != 0 && array.elementBuffer != 0);
+
+    const VertexLayout layout = VertexFormat<ModelVertex>::layout();
+    glBindVertexArray(array.vao);
+    GLint elementBuffer = 0;
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+    CHECK(static_cast<GLuint>(elementBuffer) == array.elementBuffer);
+    for (size_t i = 0; i < layout.attributes.size(); i++)
+    {
+        const VertexAttribute &attribute = layout.attributes[i];
+        GLint enabled = 0, size = 0, type = 0, normalized = 0, stride = 0, buffer = 0;
+        void *pointer = NULL;
+        glGetVertexAttribiv(attribute.location, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+        glGetVertexAttribiv(attribute.location, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+        glGetVertexAttribiv(attribute.location, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+        glGetVertexAttribiv(attribute.location, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &normalized);
+        glGetVertexAttribiv(attribute.location, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+        glGetVertexAttribiv(attribute.location, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+        glGetVertexAttribPointerv(attribute.location, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+        CHECK(enabled == GL_TRUE);
+        CHECK(size == attribute.components);
+        CHECK(static_cast<GLenum>(type) == attribute.type);
+        CHECK(normalized == attribute.normalized);
+        CHECK(stride == layout.stride);
+        CHECK(static_cast<GLuint>(buffer) == array.vertexBuffer);
+        CHECK(pointer == (void *)attribute.offset);
+    }
+    glBindVertexArray(0);
+
+    deleteVertexArray(array);
+    CHECK(array.vao == 0 && array.vertexBuffer == 0 && array.elementBuffer == 0);
+    CHECK(glGetError() == GL_NO_ERROR);
+}
+
+int main()
+{
+    testCompactQuantization();
+    testDegenerate();
+    testLayouts();
+
+    // The vertex array checks need a context, the rest run anyway
+    if (createTestContext())
+    {
+        testVertexArray();
+        destroyTestContext();
+    }
+    return testResult("test_vertex_format");
+}
@@ -0,0 +1,164 @@
+// Asset cooker: cooks models and textures and packs them with any other files
+// into one pak the game mounts at startup
+//
+//   cooker [--compress] [--raw|--bc1|--bc3|--bc5] [--srgb|--linear] out.pak files...
+//   cooker --embed in.pak out.cpp
+//
+// .obj files are packed as their cooked .mesh, images as their cooked .tex with
+// the texture options given before them. Everything else, e.g. shaders and .glb
+// files, is packed as it is. --embed turns a pak into a source file to build
+// into the game
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+
+#include "../common/model.hpp"
+#include "../common/mesh_cache.hpp"
+#include "../common/texture.hpp"
+#include "../common/vfs.hpp"
+#include "../common/pak.hpp"
+
+static bool endsWith(const std::string &text, const char *suffix)
+{
+    size_t length = strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static bool isImage(const std::string &path)
+{
+    static const char *extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".ppm", ".pgm" };
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+        if (endsWith(path, extensions[i]))
+            return true;
+    return false;
+}
+
+// Add a file from disk under the name of the path it is loaded from
+static bool packFile(PakWriter &pak, const std::string &path, bool compress)
+{
+    VfsFile file;
+    if (!file.open(path.c_str()))
+    {
+        printf("Can't read %s.\n", path.c_str());
+        return false;
+    }
+    pak.add(normalizePakPath(path.c_str()), file.data(), file.size(), compress);
+    printf("Packed %s (%u bytes)\n", path.c_str(), (unsigned int)file.size());
+    return true;
+}
+
+// Cook a model into its .mesh cache
+static bool cookModel(const std::string &path, std::string &cookedPath)
+{
+    Model model;
+    if (!model.load(path.c_str()))
+        return false;
+    cookedPath = meshCachePath(path.c_str());
+    return true;
+}
+
+// Cook an image into its .tex cache
+static bool cookImage(const std::string &path, const TextureParams &params, std::string &cookedPath)
+{
+    TextureSource source;
+    bool ok = loadTextureSource(path.c_str(), params, source);
+    freeTextureSource(source);
+    cookedPath = textureCookPath(path.c_str(), params);
+    return ok;
+}
+
+// Write a pak as a C++ source defining the symbols mountDefaultPaks looks for
+static int embed(const char *pakPath, const char *outPath)
+{
+    VfsFile pak;
+    if (!pak.open(pakPath))
+    {
+        printf("Can't read %s.\n", pakPath);
+        return 1;
+    }
+    FILE *out = fopen(outPath, "w");
+    if (out == NULL)
+    {
+        printf("Can't write %s.\n", outPath);
+        return 1;
+    }
+
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(pak.data());
+    fprintf(out, "// Generated from %s by the cooker, do not edit\n", pakPath);
+    fprintf(out, "#include <stddef.h>\n\n");
+    fprintf(out, "alignas(16) extern const unsigned char embeddedPak[] = {");
+    for (size_t i = 0; i < pak.size(); i++)
+        fprintf(out, "%s0x%02x,", i % 16 == 0 ? "\n    " : " ", bytes[i]);
+    // An empty array isn't valid C++
+    if (pak.size() == 0)
+        fprintf(out, "\n    0");
+    fprintf(out, "\n};\nextern const size_t embeddedPakSize = %u;\n", (unsigned int)pak.size());
+
+    bool ok = fclose(out) == 0;
+    if (!ok)
+        printf("Can't write %s.\n", outPath);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && strcmp(argv[1], "--embed") == 0)
+        return embed(argv[2], argv[3]);
+
+    bool compress = false;
+    TextureParams params;
+    const char *outPath = NULL;
+    PakWriter pak;
+    int failed = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--compress")
+            compress = true;
+        else if (arg == "--raw")
+            params.compression = TextureUncompressed;
+        else if (arg == "--bc1")
+            params.compression = TextureBC1;
+        else if (arg == "--bc3")
+            params.compression = TextureBC3;
+        else if (arg == "--bc5")
+            params.compression = TextureBC5;
+        else if (arg == "--srgb")
+            params.srgb = true;
+        else if (arg == "--linear")
+            params.srgb = false;
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            printf("Unknown option %s.\n", arg.c_str());
+            return 1;
+        }
+        else if (outPath == NULL)
+            outPath = argv[i];
+        else
+        {
+            std::string packed = arg;
+            bool ok = true;
+            if (endsWith(arg, ".obj"))
+                ok = cookModel(arg, packed);
+            else if (isImage(arg))
+                ok = cookImage(arg, params, packed);
+            if (!ok || !packFile(pak, packed, compress))
+            {
+                printf("Failed to cook %s.\n", arg.c_str());
+                failed++;
+            }
+        }
+    }
+
+    if (outPath == NULL)
+    {
+        printf("Usage: cooker [--compress] [--raw|--bc1|--bc3|--bc5] [--srgb|--linear] out.pak files...\n"
+               "       cooker --embed in.pak out.cpp\n");
+        return 1;
+    }
+    if (failed > 0 || !pak.write(outPath))
+        return 1;
+    printf("Wrote %s: %u files\n", outPath, (unsigned int)pak.fileCount());
+    return 0;
+}